@@ -17,7 +17,25 @@
 #include "Modules/ErrorHandling/ErrorHandler.h" // EditorHandling class
 #include "Modules/Logging/Logger.h"             // Logger class
 #include "Modules/FileHandling/FileManager.h"   // FileManager class
+#include "Modules/FileHandling/FileWatcher.h"   // FileWatcher class
 #include "Modules/Utilities/Tools.h"            // Tool class
+#include "Modules/Utilities/ImageView.h"        // ImageView class
+#include "Modules/Utilities/SpriteSlicer.h"     // SpriteSlicer class
+#include "Modules/Utilities/AtlasPacker.h"      // AtlasPacker class
+#include "Modules/Utilities/HardwareSprites.h"  // HardwareSpriteEncoder class
+#include "Modules/Utilities/PlanarSprites.h"    // PlanarSpriteEncoder class
+#include "Modules/Utilities/SpriteCompiler.h"   // SpriteCompiler class
+#include "Modules/Utilities/CostModel.h"        // DrawCostModel class
+#include "Modules/Utilities/TrueColour.h"       // TrueColourConverter class
+#include "Modules/Utilities/Metrics.h"          // Metrics class
+#include "Modules/Utilities/Channel.h"          // Channel class
+#include "Modules/Utilities/ThreadPool.h"       // ThreadPool class
+#include "Modules/Utilities/Coroutine.h"        // Task and AsyncChannel classes
+#include "Modules/Utilities/Arena.h"            // Arena and ObjectPool classes
+#include "Modules/Utilities/Pipeline.h"         // ConvertPipeline class
+#include "Modules/Utilities/ConvertServer.h"    // ConvertServer and ConvertClient classes
+#include "Modules/Utilities/JobManifest.h"      // JobManifest class
+#include "Modules/Utilities/PaletteStore.h"     // PaletteStore class
 
 //-----------------------------------------------------------------------------
 // End of file: AmigaGfxLib.h
@@ -14,9 +14,12 @@
 // Include files
 // ----------------------------------------------------------------------------
 
+#include <array>
+#include <atomic>
 #include <string>
 #include <chrono>
 #include <ctime>
+#include <mutex>
 #include <vector>
 
 #include "../Logging/Logger.h"
@@ -43,6 +46,7 @@ enum class ErrorType
     Warning,    //!, Reporting a warning erorr
     Error,      //!< Reporting an error
     Critical,   //!< Reporting a critical error, Library will terminate
+    TotalTypes, //!< Number of error types
 };
 
 /**---------------------------------------------------------------------------
@@ -51,10 +55,11 @@ enum class ErrorType
   --------------------------------------------------------------------------*/
 struct ErrorInformation
 {
-    std::string  message; //!< Error message
-    std::time_t  time;    //!< Time of error
-    ErrorType    type;    //!< Error type
-    LibraryError number;  //!< Error code
+    std::string  message;  //!< Error message
+    std::time_t  time;     //!< Time of error
+    ErrorType    type;     //!< Error type
+    LibraryError number;   //!< Error code
+    uint64_t     sequence; //!< Order the error was handled in
 };
 
 /**---------------------------------------------------------------------------
@@ -68,6 +73,7 @@ struct ErrorStatus
     uint32_t numStatus;   //!< Number of status messages
     uint32_t numCritical; //!< Number of critical errors
     uint32_t totalErrors; //!< Total number of errors
+    uint32_t numOverflow; //!< Number of errors no longer held in the history
 
     // General Functionality -------------------------------------------------
     void Clear();
@@ -91,9 +97,14 @@ class ErrorHandler : public Logger
     void reportErrors();
     void clearErrors();
 
+    std::vector<ErrorInformation> getRecentErrors();
+
     // Unit Test functions -----------------------------------------------------
     ErrorStatus getStatusInformation();
 
+    // Constants ---------------------------------------------------------------
+    static constexpr uint32_t ERROR_HISTORY_SIZE = 1024; //!< Most recent errors held in the history
+
   private:
     // Singleton constructor and destructor ------------------------------------
     ErrorHandler();
@@ -101,8 +112,25 @@ class ErrorHandler : public Logger
     ErrorHandler( const ErrorHandler& )            = delete;
     ErrorHandler& operator=( const ErrorHandler& ) = delete;
 
+    // Private Types ------------------------------------------------------------
+    /**-----------------------------------------------------------------------
+        @ingroup    AmigaGfxLIBError AmigaGfx Library Error Module
+        @brief      Slot of the error history ring, each error goes in the slot
+                    picked by its sequence, so threads only contend when they
+                    write the same slot
+      ----------------------------------------------------------------------*/
+    struct ErrorSlot
+    {
+        std::mutex       lock;  //!< Guards this slot
+        ErrorInformation error; //!< Error held in this slot
+        bool             bUsed; //!< Slot holds an error
+    };
+
     // Private Data -------------------------------------------------------------
-    std::vector<ErrorInformation> errorList; //!< List of errors
+    std::array<ErrorSlot, ERROR_HISTORY_SIZE>                        history;      //!< Ring of the most recent errors
+    std::array<std::atomic<uint32_t>, (size_t)ErrorType::TotalTypes> typeCounts;   //!< Errors handled per ErrorType
+    std::atomic<uint64_t>                                            nextSequence; //!< Sequence given to the next error
+    std::atomic<uint32_t>                                            overflow;     //!< Errors pushed out of the history
 
     // Private functions --------------------------------------------------------
     void displayMessage( const ErrorInformation& error );
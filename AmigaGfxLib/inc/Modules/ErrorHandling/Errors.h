@@ -60,6 +60,8 @@ enum class LibraryError
 
     Logger_base_error = LIBRARY_ERROR_BASE,                                 //!< 0x10001000 Base error for the Logger
     Logger_InitializeNotCalled,                                             //!< 0x10001001 Failed to initialise the Logger
+    Logger_MessageDropped,                                                  //!< 0x10001002 Log ring full, message dropped
+    Logger_FailedToOpenFile,                                                //!< 0x10001003 Failed to open the log file
     Curses_base_error = Logger_base_error + MODULE_OFFSET,                  //!< 0x10002000 Base error for the Curses module
     CursesColour_AlreadyInitialised,                                        //!< 0x10002001 Curses Colour class already initialised
     CursesColour_InvalidColourPair,                                         //!< 0x10002002 Curses Colour class invalid colour pair
@@ -73,6 +75,9 @@ enum class LibraryError
     CursesWin_FailedToDrawVerticalLine,                                     //!< 0x10001006 Curses Window class failed to draw vertical line
     CursesWin_FailedToDrawHorizontalLine,                                   //!< 0x10001007 Curses Window class failed to draw horizontal line
     FileHandlding_base_error = Curses_base_error + MODULE_OFFSET,           //!< 0x10003000 Base error for the File Handling module
+    FileWatcher_NotSupported,                                               //!< 0x10003001 File watching not supported on this platform
+    FileWatcher_FailedToWatch,                                              //!< 0x10003002 Failed to watch a directory
+    FileWatcher_EventsOverflowed,                                           //!< 0x10003003 Change events were lost, rescan needed
     ErrorHandler_base_error  = FileHandlding_base_error + MODULE_OFFSET,    //!< 0x10004000 Base error for the Error Handling module
     Screen_base_error        = FileHandlding_base_error + MODULE_OFFSET,    //!< 0x10005000 Base error for the Screen module
     Screen_ConsoleInfoFailed,                                               //!< 0x10005001 Failed to get the console information
@@ -86,6 +91,24 @@ enum class LibraryError
     Screen_InitPairFailed,                                                  //!< 0x10005009 Failed to setup the console
     Screen_EndWinFailed,                                                    //!< 0x1000500A Failed to end the window
     Utilities_base_error = Screen_base_error + MODULE_OFFSET,               //!< 0x10006000 Base error for the Utilities module
+    Pipeline_FailedToReadFile,                                              //!< 0x10006001 Pipeline failed to read an image
+    Pipeline_FailedToDecode,                                                //!< 0x10006002 Pipeline failed to decode an image
+    Pipeline_FailedToWriteFile,                                             //!< 0x10006003 Pipeline failed to write an output file
+    Atlas_SpriteTooLarge,                                                   //!< 0x10006004 Sprite does not fit on an atlas sheet
+    Server_NotSupported,                                                    //!< 0x10006005 Conversion server not supported on this platform
+    Server_FailedToListen,                                                  //!< 0x10006006 Conversion server failed to open its socket
+    Server_AlreadyRunning,                                                  //!< 0x10006007 A conversion server already listens on the socket
+    Server_FailedToConnect,                                                 //!< 0x10006008 No conversion server listening on the socket
+    Manifest_FailedToOpen,                                                  //!< 0x10006009 Failed to open a job manifest
+    Manifest_InvalidLine,                                                   //!< 0x1000600A Job manifest line could not be read
+    Palette_FailedToWrite,                                                  //!< 0x1000600B Failed to write a palette store file
+    HardwareSprite_InvalidWidth,                                            //!< 0x1000600C Hardware sprite width is not 16, 32 or 64
+    Planar_InvalidConfig,                                                   //!< 0x1000600D Planar sprite shift or plane count not supported
+    Manifest_OutputClash,                                                   //!< 0x1000600E Two manifest jobs write the same output file
+    Pipeline_ImageFailed,                                                   //!< 0x1000600F An exception was thrown converting an image
+    Pipeline_StageFailed,                                                   //!< 0x10006010 A pipeline stage ended on an exception
+    ThreadPool_TaskFailed,                                                  //!< 0x10006011 A thread pool task ended on an exception
+    SpriteList_OutOfRange,                                                  //!< 0x10006012 A sprite list or atlas position or size is over 65535
     IDE_base_error       = Utilities_base_error + MODULE_OFFSET,            //!< 0x10007000 Base error for the IDE module
     IDEEditline_IncorrectBufferIndex,                                       //!< 0x10007001 Incorrect buffer index
     IDEEditline_InitNotCalled,                                              //!< 0x10007002 Init not called
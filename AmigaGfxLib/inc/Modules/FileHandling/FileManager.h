@@ -6,10 +6,14 @@
     @copyright  Neil Bereford 2024
 
 -----------------------------------------------------------------------------*/
+
+#pragma once
+
 //-----------------------------------------------------------------------------
 // Includes
 //-----------------------------------------------------------------------------
 
+#include <atomic>
 #include <cstdint>
 #include <fstream>
 #include <iostream>
@@ -17,6 +21,11 @@
 #include <fstream>
 #include <vector>
 #include <filesystem>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include "../Utilities/Channel.h"
+#include "../Utilities/ThreadPool.h"
 
 //-----------------------------------------------------------------------------
 // Namesapce
@@ -55,11 +64,26 @@ typedef struct
     std::ifstream        fileHandle; //!< File Handle, when opened
     std::vector<uint8_t> fileData;   //!< File Data, stored as bytes
     TE_FILE_STATE        fileState;  //!< File State Machine
-    uint32_t             fileSize;   //!< File Size in bytes
+    uint64_t             fileSize;   //!< File Size in bytes
     uint32_t             fileID;     //!< Unique File ID
+    int64_t              fileTime;   //!< Last write time of the file when it was read
 
 } TS_FILE_DATA, *PTS_FILE_DATA;
 
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBFile AmigaGfx Library File Module
+    @brief      File cache statistics
+  --------------------------------------------------------------------------*/
+typedef struct
+{
+    uint64_t cacheHits;      //!< OpenFile() calls served from memory
+    uint64_t cacheMisses;    //!< OpenFile() calls read from disk
+    uint64_t cacheEvictions; //!< Files dropped to stay within the budget
+    uint64_t bytesCached;    //!< Bytes held in the cache
+    uint32_t filesCached;    //!< Files held in the cache
+
+} TS_FILE_CACHE_STATS;
+
 /**---------------------------------------------------------------------------
     @ingroup    AmigaGfxLIBFile AmigaGfx Library File Module
     @brief      File Manager Class manages the files with their data
@@ -73,16 +97,51 @@ class FileManager
     ~FileManager();
     // File Handling --------------------------------------------------------
     bool        OpenFile( const std::string& fileName, std::vector<uint8_t>& fileData );
-    bool        SaveFile( const std::string& fileName, std::vector<uint8_t>& fileData );
+    bool        SaveFile( const std::string& fileName, const std::vector<uint8_t>& fileData );
     uint32_t    listAllFiles( const std::string& pathName );
     std::string processFileList( uint32_t fileIndex );
 
+    // Streaming directory walk ---------------------------------------------
+    uint32_t    walkFiles( const std::string& pathName, const std::vector<std::string>& filters, Channel<std::string>& output, uint32_t threadCount = 0 );
+    static bool matchesFilter( const std::string& fileName, const std::vector<std::string>& filters );
+
+    // File cache, shared by every FileManager -------------------------------
+    void                setCaching( bool enable );
+    void                setCacheBudget( uint64_t budgetBytes );
+    void                invalidateFile( const std::string& fileName );
+    void                clearCache();
+    TS_FILE_CACHE_STATS getCacheStatistics();
+
+    // Constants ------------------------------------------------------------
+    static constexpr uint64_t FILE_CACHE_BUDGET = 64 * 1024 * 1024; //!< Default bytes held by the file cache
+
   private:
+    // Private Types --------------------------------------------------------
+    /**-----------------------------------------------------------------------
+        @ingroup    AmigaGfxLIBFile AmigaGfx Library File Module
+        @brief      File cache shared by every FileManager, so a file read
+                    through one is served from memory to all of them
+      ----------------------------------------------------------------------*/
+    struct FileCache
+    {
+        std::list<TS_FILE_DATA>                                            fileList;   //!< Cached files, most recently used first
+        std::unordered_map<std::string, std::list<TS_FILE_DATA>::iterator> fileIndex;  //!< Cached files by name
+        std::mutex                                                         lock;       //!< Guards the cache, OpenFile() may be called from any thread
+        TS_FILE_CACHE_STATS                                                stats      = {};                //!< Cache hit, miss and size statistics
+        uint64_t                                                           budget     = FILE_CACHE_BUDGET; //!< Most bytes held by the cache, 0 disables it
+        uint32_t                                                           nextFileID = 0;                 //!< Unique File ID used for next file
+    };
+
+    // Private Functions ----------------------------------------------------
+    void              walkDirectory( const std::string& pathName, const std::vector<std::string>& filters, Channel<std::string>& output, ThreadPool& walkers, std::atomic<uint32_t>& matched );
+    void              trimCache( uint64_t budgetBytes );
+    static FileCache& SharedCache();
+
     // Private Data -------------------------------------------------------
-    std::vector<TS_FILE_DATA> fileList;   //!< List of files
-    std::vector<std::string>  fileNames;  //!< File Data
-    uint32_t                  nextFileID; //!< Unique File ID used for next file
-    uint32_t                  fileCount;  //!< Total number of files handled
+    FileCache&               fileCache; //!< Cache shared by every FileManager
+    std::vector<std::string> fileNames; //!< File Data
+    bool                     bCaching;  //!< Reads through this FileManager use the cache
+    uint32_t                 fileCount; //!< Total number of files handled
 };
 
 //-----------------------------------------------------------------------------
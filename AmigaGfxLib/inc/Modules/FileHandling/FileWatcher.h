@@ -0,0 +1,84 @@
+/**----------------------------------------------------------------------------
+
+    @file       FileWatcher.h
+    @defgroup   AmigaGfxLIBFile AmigaGfx Library File Module
+    @brief      Directory change watcher (Linux inotify)
+    @copyright  Neil Bereford 2024
+
+-----------------------------------------------------------------------------*/
+
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Namesapce
+//-----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Clsss Definitions
+//-----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBFile AmigaGfx Library File Module
+    @brief      Result of waiting for changes
+  --------------------------------------------------------------------------*/
+enum class WatchStatus
+{
+    Changed = 0, //!< Changed files were returned
+    Timeout,     //!< Nothing changed before the timeout
+    Overflow,    //!< Events were lost, the watched trees need a full rescan
+    Interrupted, //!< Wait interrupted by a signal
+    Failed,      //!< Watcher not set up, or the platform is not supported
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBFile AmigaGfx Library File Module
+    @brief      File Watcher Class, reports files written or moved into
+                watched directory trees, with bursts of events debounced
+                into a single list of changed files
+  --------------------------------------------------------------------------*/
+class FileWatcher
+{
+  public:
+    // Public Methods -------------------------------------------------------
+    // Constructor / Destructor ---------------------------------------------
+    FileWatcher();
+    ~FileWatcher();
+
+    FileWatcher( const FileWatcher& )            = delete;
+    FileWatcher& operator=( const FileWatcher& ) = delete;
+
+    // Watching -------------------------------------------------------------
+    bool        addWatch( const std::string& pathName );
+    WatchStatus waitForChanges( std::vector<std::string>& changed, const std::vector<std::string>& filters, uint32_t debounceMs, int32_t timeoutMs = -1 );
+    uint32_t    getWatchCount() const;
+
+  private:
+    // Private Functions ----------------------------------------------------
+    bool addDirectory( const std::string& pathName );
+    bool readEvents( std::vector<std::string>& changed, const std::vector<std::string>& filters );
+
+    // Private Data ---------------------------------------------------------
+    int                        watchHandle; //!< inotify handle, -1 when not available
+    std::map<int, std::string> watchPaths;  //!< Directory of each watch descriptor
+    bool                       overflowed;  //!< True, events were lost since the last wait
+};
+
+//-----------------------------------------------------------------------------
+
+} // namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: FileWatcher.h
+//-----------------------------------------------------------------------------
@@ -0,0 +1,155 @@
+/**----------------------------------------------------------------------------
+
+    @file       LogRing.h
+    @defgroup   AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Lock free ring of fixed size log records
+    @copyright  Neil Bereford 2024
+
+-----------------------------------------------------------------------------*/
+
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "../ErrorHandling/Errors.h"
+
+//-----------------------------------------------------------------------------
+// Namespace
+//-----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Define constants
+//-----------------------------------------------------------------------------
+
+#define LOG_RECORD_TEXT_SIZE ( 192 ) //!< Message bytes held by a single log record
+#define LOG_RECORD_MAX_ARGS  ( 6 )   //!< Deferred format arguments held by a single log record
+
+//-----------------------------------------------------------------------------
+// Enum definitions
+//-----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Severity of a logged message
+  --------------------------------------------------------------------------*/
+enum class LogLevel : uint8_t
+{
+    Trace = 0, //!< 0 - Fine grained tracing, hot paths
+    Debug,     //!< 1 - Debugging information
+    Info,      //!< 2 - General information (LogMessage)
+    Warning,   //!< 3 - Warnings
+    Error,     //!< 4 - Errors (LogError)
+    Critical,  //!< 5 - Critical errors
+    Off,       //!< 6 - Nothing is logged
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Type of a deferred format argument
+  --------------------------------------------------------------------------*/
+enum class LogArgType : uint8_t
+{
+    Signed = 0, //!< Signed integer
+    Unsigned,   //!< Unsigned integer
+    Float,      //!< Floating point
+    Text,       //!< Text, copied into the record text buffer
+};
+
+//-----------------------------------------------------------------------------
+// Class Definitions
+//-----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Deferred format argument, stored as raw data in a log record
+  --------------------------------------------------------------------------*/
+struct LogArg
+{
+    LogArgType type; //!< Type of the argument
+    union
+    {
+        int64_t  sValue; //!< Signed integer value
+        uint64_t uValue; //!< Unsigned integer value
+        double   fValue; //!< Floating point value
+        struct
+        {
+            uint16_t offset; //!< Offset of the text in the record text buffer
+            uint16_t length; //!< Length of the text
+        } text;
+    };
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Fixed size binary log record, filled in by the caller and
+                formatted later by the logger writer thread
+  --------------------------------------------------------------------------*/
+struct LogRecord
+{
+    int64_t      time;                         //!< Time stamp, milliseconds since the epoch
+    LibraryError error;                        //!< Error code, No_Error for plain messages
+    LogLevel     level;                        //!< Severity of the message
+    uint8_t      argCount;                     //!< Number of deferred arguments
+    bool         bTruncated;                   //!< True if text was cut to fit, the message is written with "..." after it
+    uint16_t     length;                       //!< Number of valid bytes in text
+    const char*  format;                       //!< Deferred format string (string literal), nullptr for plain text
+    LogArg       args[ LOG_RECORD_MAX_ARGS ];  //!< Deferred format arguments
+    char         text[ LOG_RECORD_TEXT_SIZE ]; //!< Message text, not null terminated
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Bounded lock free multi producer ring of log records.
+                Any number of threads can push, one thread pops.
+  --------------------------------------------------------------------------*/
+class LogRing
+{
+  public:
+    // Constructor / Destructor ---------------------------------------------
+    LogRing( uint32_t capacity );
+    ~LogRing();
+
+    LogRing( const LogRing& )            = delete;
+    LogRing& operator=( const LogRing& ) = delete;
+
+    // Ring access ----------------------------------------------------------
+    bool push( const LogRecord& record );
+    bool pop( LogRecord& record );
+    bool empty() const;
+
+  private:
+    // Private Types --------------------------------------------------------
+    /**-----------------------------------------------------------------------
+        @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+        @brief      Ring slot, the sequence number tells producers and the
+                    consumer whose turn it is to use the slot
+      ----------------------------------------------------------------------*/
+    struct Cell
+    {
+        std::atomic<size_t> sequence; //!< Slot sequence number
+        LogRecord           record;   //!< Stored record
+    };
+
+    // Private Data ---------------------------------------------------------
+    std::unique_ptr<Cell[]>          cells;      //!< Ring storage
+    size_t                           mask;       //!< Capacity - 1, capacity is a power of two
+    alignas( 64 ) std::atomic<size_t> enqueuePos; //!< Next slot to be written by producers
+    alignas( 64 ) std::atomic<size_t> dequeuePos; //!< Next slot to be read by the consumer
+};
+
+//---------------------------------------------------------------------------
+
+} // namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: LogRing.h
+//-----------------------------------------------------------------------------
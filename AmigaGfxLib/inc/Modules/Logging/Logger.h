@@ -13,12 +13,62 @@
 // Includes
 //-----------------------------------------------------------------------------
 
+#include <algorithm>
+#include <atomic>
+#include <deque>
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include <string>
 #include <fstream>
+#include <string_view>
+#include <thread>
+#include <type_traits>
 #include <vector>
 #include "../ErrorHandling/Errors.h"
+#include "LogRing.h"
+
+//-----------------------------------------------------------------------------
+// Define constants
+//-----------------------------------------------------------------------------
+
+#ifndef AGL_LOG_MIN_LEVEL
+#define AGL_LOG_MIN_LEVEL ( 2 ) //!< Lowest LogLevel compiled in (0 Trace - 6 Off), set by the build
+#endif
+
+#ifndef AGL_LOG_FILE_LEVEL
+#define AGL_LOG_FILE_LEVEL AGL_LOG_MIN_LEVEL //!< Per source file override, define before including
+#endif
+
+//-----------------------------------------------------------------------------
+// Macros
+//-----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Logs a deferred format message at the given LogLevel.
+                Levels below AGL_LOG_FILE_LEVEL compile to nothing, the
+                arguments are not evaluated. The remaining levels are
+                checked against the runtime level before anything is done.
+  --------------------------------------------------------------------------*/
+#define AGL_LOG( logger, level, ... )                                                \
+    do                                                                               \
+    {                                                                                \
+        if constexpr ( (int)AmigaGfx::LogLevel::level >= AGL_LOG_FILE_LEVEL )        \
+        {                                                                            \
+            if ( ( logger ).isLogLevelEnabled( AmigaGfx::LogLevel::level ) )         \
+            {                                                                        \
+                ( logger ).LogDeferred( AmigaGfx::LogLevel::level, __VA_ARGS__ );    \
+            }                                                                        \
+        }                                                                            \
+    } while ( 0 )
+
+#define AGL_LOG_TRACE( logger, ... )    AGL_LOG( logger, Trace, __VA_ARGS__ )    //!< Log a Trace message
+#define AGL_LOG_DEBUG( logger, ... )    AGL_LOG( logger, Debug, __VA_ARGS__ )    //!< Log a Debug message
+#define AGL_LOG_INFO( logger, ... )     AGL_LOG( logger, Info, __VA_ARGS__ )     //!< Log an Info message
+#define AGL_LOG_WARNING( logger, ... )  AGL_LOG( logger, Warning, __VA_ARGS__ )  //!< Log a Warning message
+#define AGL_LOG_ERROR( logger, ... )    AGL_LOG( logger, Error, __VA_ARGS__ )    //!< Log an Error message
+#define AGL_LOG_CRITICAL( logger, ... ) AGL_LOG( logger, Critical, __VA_ARGS__ ) //!< Log a Critical message
 
 //-----------------------------------------------------------------------------
 // Namesapce
@@ -31,6 +81,16 @@ namespace AmigaGfx
 // Clsss Definitions
 //-----------------------------------------------------------------------------
 
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      What happens to a message when the log ring is full
+  --------------------------------------------------------------------------*/
+enum class LogOverflow
+{
+    Drop = 0, //!< Message is dropped and counted, the caller never waits
+    Block,    //!< Caller waits for the writer thread to make room
+};
+
 /**---------------------------------------------------------------------------
     @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
     @brief      Logging Manager Class manages the logging of errors
@@ -52,18 +112,152 @@ class Logger
     LibraryError LogMessage( const std::string& message );
     LibraryError LogError( LibraryError error, const std::string& message );
 
+    template <typename... Args>
+    LibraryError LogDeferred( LogLevel level, const char* format, const Args&... args );
+
+    // Log level control ----------------------------------------------------
+    void     setLogLevel( LogLevel level );
+    LogLevel getLogLevel() const;
+
+    /**-----------------------------------------------------------------------
+        @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+        @brief      Checks the level against the compiled and runtime levels
+        @param      level - Level to check
+        @return     bool - True if messages at this level are logged
+      ----------------------------------------------------------------------*/
+    bool isLogLevelEnabled( LogLevel level ) const
+    {
+        return (int)level >= AGL_LOG_MIN_LEVEL && level >= logLevel.load( std::memory_order_relaxed ) && level != LogLevel::Off;
+    }
+
+    // Output control -------------------------------------------------------
+    void         setOutputTerminal( bool enable );
+    LibraryError setOutputFile( const std::string& fileName );
+    void         setOverflowPolicy( LogOverflow policy );
+    void         flushLog();
+    uint64_t     getDroppedCount() const;
+
     // Control of log data --------------------------------------------------
-    void clearLog();
-    void saveLog();
+    void         clearLog();
+    LibraryError saveLog( const std::string& fileName );
 
   private:
+    // Constants ------------------------------------------------------------
+    const uint32_t LOG_RING_SIZE    = 1024; //!< Records held in the ring before the overflow policy applies
+    const uint32_t LOG_HISTORY_SIZE = 1024; //!< Formatted messages kept in memory for saveLog()
+    const uint32_t LOG_BATCH_SIZE   = 64;   //!< Records formatted per write to the sinks
+
+    // Private Functions ----------------------------------------------------
+    LibraryError pushRecord( LogLevel level, LibraryError error, const std::string& message );
+    LibraryError submitRecord( LogRecord& record );
+    void         wakeWriter();
+    void         writerThread();
+    void         formatRecord( const LogRecord& record, std::string& output );
+    void         formatArgs( const LogRecord& record, std::ostream& output );
+    void         loggerShutdown();
+
+    template <typename T>
+    static void storeArg( LogRecord& record, const T& value );
+
     // Private Data ---------------------------------------------------------
-    std::vector<std::string> loggedInformation; //!< Internal store of all logged messaages
-    bool                     loggerInitialized; //!< True, if the logger has been initialized
-    bool                     outputTerminal;    //!< True, will display on stdout to the terminal
-    bool                     outputFile;        //!< True, will log directly to file, not need to save log
+    LogRing                  logRing;           //!< Records waiting for the writer thread
+    std::thread              writer;            //!< Writer thread, formats and outputs records
+    std::atomic<bool>        writerRunning;     //!< False, asks the writer thread to finish
+    std::atomic<bool>        writerSleeping;    //!< True, writer is waiting on wakeSignal
+    std::atomic<uint32_t>    wakeSignal;        //!< Bumped to wake the writer thread
+    std::atomic<uint64_t>    submittedCount;    //!< Records pushed into the ring
+    std::atomic<uint64_t>    writtenCount;      //!< Records output by the writer thread
+    std::atomic<uint64_t>    droppedCount;      //!< Records dropped due to a full ring
+    std::atomic<LogOverflow> overflowPolicy;    //!< What to do when the ring is full
+    std::atomic<LogLevel>    logLevel;          //!< Runtime level, messages below it are ignored
+    std::mutex               outputLock;        //!< Guards the sinks and loggedInformation
+    std::ofstream            logFile;           //!< Log file, when file output is enabled
+    std::deque<std::string>  loggedInformation; //!< Most recent logged messages
+    std::atomic<bool>        loggerInitialized; //!< True, if the logger has been initialized
+    std::atomic<bool>        outputTerminal;    //!< True, will display on stdout to the terminal
+    std::atomic<bool>        outputFile;        //!< True, will log directly to file, not need to save log
 };
 
+//-----------------------------------------------------------------------------
+// Template Functions
+//-----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Logs a message whose formatting is deferred to the writer
+                thread. Only the format pointer and the raw argument values
+                are stored, use the AGL_LOG macros rather than calling this
+                directly so disabled levels cost nothing.
+    @param      level - Severity of the message
+    @param      format - Format string literal, {} and {:x} are replaced
+                by the arguments in order
+    @param      args - Integer, floating point or text arguments
+    @return     LibraryError - Error code
+  --------------------------------------------------------------------------*/
+template <typename... Args>
+LibraryError Logger::LogDeferred( LogLevel level, const char* format, const Args&... args )
+{
+    static_assert( sizeof...( Args ) <= LOG_RECORD_MAX_ARGS, "Too many deferred log arguments" );
+
+    if ( loggerInitialized == false )
+    {
+        return LibraryError::Logger_InitializeNotCalled;
+    }
+
+    LogRecord record;
+    record.level      = level;
+    record.error      = LibraryError::No_Error;
+    record.format     = format;
+    record.argCount   = 0;
+    record.bTruncated = false;
+    record.length     = 0;
+    ( storeArg( record, args ), ... );
+
+    return submitRecord( record );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Stores a deferred argument in the log record, text is copied
+                into the record text buffer, cut to what fits and the record
+                marked truncated if it does not
+    @param      record - Record being built
+    @param      value - Argument value
+  --------------------------------------------------------------------------*/
+template <typename T>
+void Logger::storeArg( LogRecord& record, const T& value )
+{
+    LogArg& arg = record.args[ record.argCount++ ];
+
+    if constexpr ( std::is_floating_point_v<T> )
+    {
+        arg.type   = LogArgType::Float;
+        arg.fValue = value;
+    }
+    else if constexpr ( std::is_integral_v<T> && std::is_signed_v<T> )
+    {
+        arg.type   = LogArgType::Signed;
+        arg.sValue = value;
+    }
+    else if constexpr ( std::is_integral_v<T> || std::is_enum_v<T> )
+    {
+        arg.type   = LogArgType::Unsigned;
+        arg.uValue = (uint64_t)value;
+    }
+    else
+    {
+        std::string_view text( value );
+        uint16_t         length = (uint16_t)std::min<size_t>( text.size(), LOG_RECORD_TEXT_SIZE - record.length );
+
+        arg.type        = LogArgType::Text;
+        arg.text.offset = record.length;
+        arg.text.length = length;
+        text.copy( record.text + record.length, length );
+        record.length += length;
+        record.bTruncated |= length < text.size();
+    }
+}
+
 //---------------------------------------------------------------------------
 
 } // namespace AmigaGfx
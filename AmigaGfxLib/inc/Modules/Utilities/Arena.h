@@ -0,0 +1,189 @@
+/**----------------------------------------------------------------------------
+
+    @file       Arena.h
+    @defgroup   AmigaGfxLIBMemory AmigaGfx Library Memory Module
+    @brief      Per thread arena and object pool for the conversion hot path
+
+    @copyright  Neil Bereford 2024
+
+-----------------------------------------------------------------------------*/
+
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Include files
+// ----------------------------------------------------------------------------
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Metrics.h"
+
+//-----------------------------------------------------------------------------
+// Namespace
+// ----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Class definitions
+// ----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBMemory AmigaGfx Library Memory Module
+    @brief      Bump allocator. Allocations are never freed one by one,
+                reset() makes all the memory reusable while keeping the
+                blocks, so once warmed up an arena makes no heap allocations.
+                An arena belongs to one thread, see getThreadArena().
+  --------------------------------------------------------------------------*/
+class Arena
+{
+  public:
+    // Constructor / Destructor ---------------------------------------------
+    Arena( size_t defaultBlockSize = ARENA_BLOCK_SIZE );
+    ~Arena();
+
+    Arena( const Arena& )            = delete;
+    Arena& operator=( const Arena& ) = delete;
+
+    // Allocation -----------------------------------------------------------
+    void*         allocate( size_t size, size_t alignment = alignof( std::max_align_t ) );
+    void          reset();
+    uint64_t      getBlockAllocations() const;
+    size_t        getBytesReserved() const;
+    static Arena& getThreadArena();
+
+    // Constants ------------------------------------------------------------
+    static constexpr size_t ARENA_BLOCK_SIZE = 256 * 1024; //!< Default block size, larger requests get their own block
+
+  private:
+    // Private Types --------------------------------------------------------
+    /**-----------------------------------------------------------------------
+        @ingroup    AmigaGfxLIBMemory AmigaGfx Library Memory Module
+        @brief      Block of arena memory
+      ----------------------------------------------------------------------*/
+    struct Block
+    {
+        std::unique_ptr<uint8_t[]> data; //!< Block memory
+        size_t                     size; //!< Size of the block in bytes
+    };
+
+    // Private Data ---------------------------------------------------------
+    std::vector<Block> blocks;           //!< Blocks, kept across reset()
+    size_t             currentBlock;     //!< Block being allocated from
+    size_t             offset;           //!< Next free byte in the current block
+    size_t             blockSize;        //!< Size of new blocks
+    uint64_t           blockAllocations; //!< Heap allocations made for blocks
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBMemory AmigaGfx Library Memory Module
+    @brief      Pool of reusable objects, such as the per image buffers of
+                the pipeline. A released object keeps its vector and string
+                capacity, so the next user of it does not allocate.
+                acquire() only creates a new object when the pool is empty,
+                which is counted as a buffer allocation.
+  --------------------------------------------------------------------------*/
+template <typename T>
+class ObjectPool
+{
+  public:
+    // Constructor / Destructor ---------------------------------------------
+    ObjectPool( size_t maxPooled );
+
+    ObjectPool( const ObjectPool& )            = delete;
+    ObjectPool& operator=( const ObjectPool& ) = delete;
+
+    // Pool access ----------------------------------------------------------
+    T        acquire();
+    void     release( T&& object );
+    uint64_t getMisses() const;
+
+  private:
+    // Private Data ---------------------------------------------------------
+    std::mutex            lock;       //!< Guards pooled
+    std::vector<T>        pooled;     //!< Objects ready to reuse
+    size_t                maxObjects; //!< Most objects kept, extras are freed
+    std::atomic<uint64_t> misses;     //!< acquire() calls that created an object
+};
+
+//-----------------------------------------------------------------------------
+// Template Functions
+//-----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBMemory AmigaGfx Library Memory Module
+    @brief      Constructor for the ObjectPool class
+    @param      maxPooled - Most objects kept for reuse
+  --------------------------------------------------------------------------*/
+template <typename T>
+ObjectPool<T>::ObjectPool( size_t maxPooled )
+{
+    maxObjects = maxPooled;
+    misses     = 0;
+    pooled.reserve( maxObjects );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBMemory AmigaGfx Library Memory Module
+    @brief      Takes an object from the pool, or creates one if it is empty
+    @return     T - Object, with whatever contents it was released with
+  --------------------------------------------------------------------------*/
+template <typename T>
+T ObjectPool<T>::acquire()
+{
+    {
+        std::lock_guard<std::mutex> guard( lock );
+
+        if ( pooled.empty() == false )
+        {
+            T object = std::move( pooled.back() );
+            pooled.pop_back();
+            return object;
+        }
+    }
+
+    misses++;
+    Metrics::getInstance().addCount( MetricCounter::BufferAllocations );
+    return T();
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBMemory AmigaGfx Library Memory Module
+    @brief      Returns an object to the pool for reuse
+    @param      object - Object to return
+  --------------------------------------------------------------------------*/
+template <typename T>
+void ObjectPool<T>::release( T&& object )
+{
+    std::lock_guard<std::mutex> guard( lock );
+
+    if ( pooled.size() < maxObjects )
+    {
+        pooled.push_back( std::move( object ) );
+    }
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBMemory AmigaGfx Library Memory Module
+    @brief      Number of acquire() calls that had to create an object
+    @return     uint64_t - Miss count
+  --------------------------------------------------------------------------*/
+template <typename T>
+uint64_t ObjectPool<T>::getMisses() const
+{
+    return misses;
+}
+
+//-----------------------------------------------------------------------------
+
+} // end namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: Arena.h
+// ----------------------------------------------------------------------------
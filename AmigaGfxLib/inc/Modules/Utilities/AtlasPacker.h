@@ -0,0 +1,131 @@
+/**----------------------------------------------------------------------------
+
+    @file       AtlasPacker.h
+    @defgroup   AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Packs sprites onto shared atlas sheets
+
+    @copyright  Neil Bereford 2024
+
+-----------------------------------------------------------------------------*/
+
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Include files
+// ----------------------------------------------------------------------------
+
+#include <cstdint>
+#include <vector>
+
+#include "ImageView.h"
+#include "SpriteSlicer.h"
+
+//-----------------------------------------------------------------------------
+// Namespace
+// ----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Class definitions
+// ----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Atlas sheet size and packing settings
+  --------------------------------------------------------------------------*/
+struct AtlasConfig
+{
+    uint32_t sheetWidth  = 320;  //!< Width of each sheet
+    uint32_t sheetHeight = 256;  //!< Most rows of each sheet
+    uint32_t padding     = 0;    //!< Transparent pixels kept between sprites
+    bool     trim        = true; //!< Remove the transparent border of each sprite before packing
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Where a sprite was packed, one per sprite in the order given
+  --------------------------------------------------------------------------*/
+struct AtlasEntry
+{
+    uint32_t sheet;        //!< Sheet the sprite is on
+    uint32_t sheetIndex;   //!< Index of the sprite in its sheet's sprite list
+    uint32_t x;            //!< Left edge on the sheet
+    uint32_t y;            //!< Top edge on the sheet
+    uint32_t width;        //!< Packed width, after trimming
+    uint32_t height;       //!< Packed height, after trimming
+    uint32_t trimX;        //!< Columns trimmed from the left of the original sprite
+    uint32_t trimY;        //!< Rows trimmed from the top of the original sprite
+    uint32_t sourceWidth;  //!< Width of the original sprite
+    uint32_t sourceHeight; //!< Height of the original sprite
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Atlas packer, places sprites on as few sheets as it can with
+                a skyline bottom left packer, opening a new sheet when none
+                of the open ones has room. Sprites are placed tallest first
+                with ties broken by width then input order, so the same
+                input always gives the same atlas.
+  --------------------------------------------------------------------------*/
+class AtlasPacker
+{
+  public:
+    // Constructor / Destructor ---------------------------------------------
+    AtlasPacker( const AtlasConfig& config = AtlasConfig() );
+    ~AtlasPacker();
+
+    // Packing --------------------------------------------------------------
+    bool     pack( const std::vector<SpriteRect>& sprites, std::vector<AtlasEntry>& entries );
+    bool     build( const std::vector<ImageView<const uint8_t>>& sprites, std::vector<std::vector<uint8_t>>& sheetPixels, std::vector<AtlasEntry>& entries );
+    bool     buildTable( const std::vector<AtlasEntry>& entries, std::vector<uint8_t>& tableFile ) const;
+    uint32_t getSheetCount() const;
+    uint32_t getSheetHeight( uint32_t sheet ) const;
+    double   getOccupancy() const;
+
+    static SpriteRect TrimSprite( ImageView<const uint8_t> sprite );
+
+  private:
+    // Private Types --------------------------------------------------------
+    /**-----------------------------------------------------------------------
+        @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+        @brief      Top edge of the packed area over a span of columns
+      ----------------------------------------------------------------------*/
+    struct SkylineNode
+    {
+        uint32_t x;     //!< First column
+        uint32_t y;     //!< First free row
+        uint32_t width; //!< Columns covered
+    };
+
+    /**-----------------------------------------------------------------------
+        @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+        @brief      One sheet being packed
+      ----------------------------------------------------------------------*/
+    struct Sheet
+    {
+        std::vector<SkylineNode> skyline;     //!< Skyline, left to right
+        uint64_t                 usedArea;    //!< Pixels covered by sprites
+        uint32_t                 usedHeight;  //!< Lowest row used by a sprite
+        uint32_t                 spriteCount; //!< Sprites placed on the sheet
+        uint32_t                 failWidth;   //!< Width of the last sprite that did not fit
+        uint32_t                 failHeight;  //!< Height of the last sprite that did not fit
+    };
+
+    // Private Functions ----------------------------------------------------
+    bool findPosition( const Sheet& sheet, uint32_t width, uint32_t height, uint32_t& x, uint32_t& y, size_t& node ) const;
+    void placeRect( Sheet& sheet, size_t node, uint32_t x, uint32_t y, uint32_t width, uint32_t height );
+
+    // Private Data ---------------------------------------------------------
+    AtlasConfig        atlasConfig; //!< Sheet size and packing settings
+    std::vector<Sheet> sheets;      //!< Sheets of the last pack
+};
+
+//-----------------------------------------------------------------------------
+
+} // end namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: AtlasPacker.h
+// ----------------------------------------------------------------------------
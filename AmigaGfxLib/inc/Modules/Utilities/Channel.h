@@ -0,0 +1,205 @@
+/**----------------------------------------------------------------------------
+
+    @file       Channel.h
+    @defgroup   AmigaGfxLIBThreads AmigaGfx Library Threading Module
+    @brief      Bounded multi producer, multi consumer channel
+
+    @copyright  Neil Bereford 2024
+
+-----------------------------------------------------------------------------*/
+
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Include files
+// ----------------------------------------------------------------------------
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+//-----------------------------------------------------------------------------
+// Namespace
+// ----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Class definitions
+// ----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBThreads AmigaGfx Library Threading Module
+    @brief      Bounded channel, producers wait while it is full and
+                consumers wait while it is empty. Once closed, producers are
+                refused and consumers drain what is left before pop()
+                returns false.
+  --------------------------------------------------------------------------*/
+template <typename T>
+class Channel
+{
+  public:
+    // Constructor / Destructor ---------------------------------------------
+    Channel( size_t channelCapacity );
+
+    Channel( const Channel& )            = delete;
+    Channel& operator=( const Channel& ) = delete;
+
+    // Channel access -------------------------------------------------------
+    bool   push( T value );
+    bool   pop( T& value );
+    bool   tryPop( T& value );
+    void   close();
+    bool   isClosed() const;
+    size_t size() const;
+
+  private:
+    // Private Data ---------------------------------------------------------
+    mutable std::mutex      lock;     //!< Guards items and closed
+    std::condition_variable notFull;  //!< Signalled when an item is taken
+    std::condition_variable notEmpty; //!< Signalled when an item is added
+    std::deque<T>           items;    //!< Items waiting to be taken
+    size_t                  capacity; //!< Most items held before push() waits
+    bool                    closed;   //!< True, no more items will be added
+};
+
+//-----------------------------------------------------------------------------
+// Template Functions
+//-----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBThreads AmigaGfx Library Threading Module
+    @brief      Constructor for the Channel class
+    @param      channelCapacity - Most items held before push() waits
+  --------------------------------------------------------------------------*/
+template <typename T>
+Channel<T>::Channel( size_t channelCapacity )
+{
+    capacity = channelCapacity > 0 ? channelCapacity : 1;
+    closed   = false;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBThreads AmigaGfx Library Threading Module
+    @brief      Adds an item, waiting while the channel is full
+    @param      value - Item to add
+    @return     bool - False if the channel was closed, the item is dropped
+  --------------------------------------------------------------------------*/
+template <typename T>
+bool Channel<T>::push( T value )
+{
+    std::unique_lock<std::mutex> guard( lock );
+
+    notFull.wait( guard, [ this ]() { return closed || items.size() < capacity; } );
+
+    if ( closed )
+    {
+        return false;
+    }
+
+    items.push_back( std::move( value ) );
+    guard.unlock();
+    notEmpty.notify_one();
+
+    return true;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBThreads AmigaGfx Library Threading Module
+    @brief      Takes the oldest item, waiting while the channel is empty
+    @param      value - Receives the item
+    @return     bool - False once the channel is closed and empty
+  --------------------------------------------------------------------------*/
+template <typename T>
+bool Channel<T>::pop( T& value )
+{
+    std::unique_lock<std::mutex> guard( lock );
+
+    notEmpty.wait( guard, [ this ]() { return closed || items.empty() == false; } );
+
+    if ( items.empty() )
+    {
+        return false;
+    }
+
+    value = std::move( items.front() );
+    items.pop_front();
+    guard.unlock();
+    notFull.notify_one();
+
+    return true;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBThreads AmigaGfx Library Threading Module
+    @brief      Takes the oldest item if there is one, never waits
+    @param      value - Receives the item
+    @return     bool - True if an item was taken
+  --------------------------------------------------------------------------*/
+template <typename T>
+bool Channel<T>::tryPop( T& value )
+{
+    std::unique_lock<std::mutex> guard( lock );
+
+    if ( items.empty() )
+    {
+        return false;
+    }
+
+    value = std::move( items.front() );
+    items.pop_front();
+    guard.unlock();
+    notFull.notify_one();
+
+    return true;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBThreads AmigaGfx Library Threading Module
+    @brief      Closes the channel, wakes every waiting producer and consumer
+  --------------------------------------------------------------------------*/
+template <typename T>
+void Channel<T>::close()
+{
+    {
+        std::lock_guard<std::mutex> guard( lock );
+        closed = true;
+    }
+
+    notFull.notify_all();
+    notEmpty.notify_all();
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBThreads AmigaGfx Library Threading Module
+    @brief      Checks if the channel has been closed
+    @return     bool - True if closed
+  --------------------------------------------------------------------------*/
+template <typename T>
+bool Channel<T>::isClosed() const
+{
+    std::lock_guard<std::mutex> guard( lock );
+    return closed;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBThreads AmigaGfx Library Threading Module
+    @brief      Number of items waiting in the channel
+    @return     size_t - Item count
+  --------------------------------------------------------------------------*/
+template <typename T>
+size_t Channel<T>::size() const
+{
+    std::lock_guard<std::mutex> guard( lock );
+    return items.size();
+}
+
+//-----------------------------------------------------------------------------
+
+} // end namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: Channel.h
+// ----------------------------------------------------------------------------
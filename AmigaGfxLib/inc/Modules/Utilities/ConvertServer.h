@@ -0,0 +1,170 @@
+/**----------------------------------------------------------------------------
+
+    @file       ConvertServer.h
+    @defgroup   AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Resident conversion server and client (Unix domain socket)
+
+    @copyright  Neil Bereford 2024
+
+-----------------------------------------------------------------------------*/
+
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Include files
+// ----------------------------------------------------------------------------
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../FileHandling/FileManager.h"
+#include "ThreadPool.h"
+#include "Tools.h"
+
+//-----------------------------------------------------------------------------
+// Namespace
+// ----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Class definitions
+// ----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Conversion server settings
+  --------------------------------------------------------------------------*/
+struct ServerConfig
+{
+    std::string socketPath;                                         //!< Unix socket the server listens on
+    uint32_t    connectionThreads = 0;                              //!< Connections served at once, 0 uses one per hardware thread
+    uint64_t    fileCacheBudget   = FileManager::FILE_CACHE_BUDGET; //!< Bytes of source PNGs kept in memory
+    uint64_t    dedupBudget       = 64 * 1024 * 1024;               //!< Bytes of converted outputs kept for repeated images
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Conversion server statistics
+  --------------------------------------------------------------------------*/
+struct ServerStats
+{
+    uint64_t jobs;        //!< Conversion requests handled
+    uint64_t failed;      //!< Conversion requests that failed
+    uint64_t dedupHits;   //!< Images whose outputs came from the dedup index
+    uint64_t dedupBytes;  //!< Bytes held by the dedup index
+    uint64_t connections; //!< Client connections accepted
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Conversion server, a resident process that converts images
+                for clients over a Unix domain socket. The connection
+                threads, the source file cache and an index of converted
+                outputs stay warm between jobs, so a client pays for a
+                connect and a round trip rather than a process start.
+                Requests are single text lines:
+
+                    CONVERT <sprW> <sprH> <absolute png path>
+                    STATS
+                    SHUTDOWN
+  --------------------------------------------------------------------------*/
+class ConvertServer
+{
+  public:
+    // Constructor / Destructor ---------------------------------------------
+    ConvertServer( const ServerConfig& config );
+    ~ConvertServer();
+
+    ConvertServer( const ConvertServer& )            = delete;
+    ConvertServer& operator=( const ConvertServer& ) = delete;
+
+    // Serving --------------------------------------------------------------
+    bool        start();
+    bool        serve( int32_t timeoutMs );
+    void        stop();
+    bool        convert( const std::string& fileName, uint32_t sprW, uint32_t sprH, bool& bDeduplicated );
+    std::string handleRequest( const std::string& request );
+    ServerStats getStats();
+
+  private:
+    // Private Types --------------------------------------------------------
+    /**-----------------------------------------------------------------------
+        @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+        @brief      Outputs of a converted image, kept for later requests
+                    with the same PNG and sprite size
+      ----------------------------------------------------------------------*/
+    struct DedupEntry
+    {
+        uint64_t                   key;       //!< Hash of the PNG and sprite size
+        uint32_t                   sprW;      //!< Sprite width the outputs were made with
+        uint32_t                   sprH;      //!< Sprite height the outputs were made with
+        std::vector<uint8_t>       pngData;   //!< Source PNG, compared on a hash match
+        std::vector<ConvertedFile> outputs;   //!< Outputs, file names hold only the suffix
+        uint64_t                   entrySize; //!< Bytes held by the entry
+    };
+
+    using DedupPointer = std::shared_ptr<const DedupEntry>;
+
+    // Private Functions ----------------------------------------------------
+    bool         convertImage( const std::string& fileName, uint32_t sprW, uint32_t sprH, bool& bDeduplicated );
+    void         serveConnection( int connection );
+    DedupPointer findOutputs( uint64_t key, const std::vector<uint8_t>& pngData, uint32_t sprW, uint32_t sprH );
+    void         addOutputs( DedupPointer entry );
+    bool         writeOutputs( const std::string& fileName, const std::vector<ConvertedFile>& outputs, size_t suffixStart );
+
+    // Private Data ---------------------------------------------------------
+    ServerConfig                                                    serverConfig;   //!< Server settings
+    ThreadPool                                                      connectionPool; //!< Serves the client connections
+    FileManager                                                     fileManager;    //!< Reads the PNGs, caching them, and writes the outputs
+    int                                                             listenSocket;   //!< Listening socket, -1 when not started
+    std::atomic<bool>                                               stopping;       //!< True once stop() or SHUTDOWN has been called
+    std::mutex                                                      lock;           //!< Guards the connections, dedup index and statistics
+    std::set<int>                                                   connections;    //!< Open client connections
+    std::list<DedupPointer>                                         dedupList;      //!< Dedup entries, most recently used first
+    std::unordered_map<uint64_t, std::list<DedupPointer>::iterator> dedupIndex;     //!< Dedup entries by key
+    ServerStats                                                     stats;          //!< Job, dedup and connection statistics
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Conversion client, sends requests to a ConvertServer and
+                waits for each reply. One connection carries any number of
+                requests.
+  --------------------------------------------------------------------------*/
+class ConvertClient
+{
+  public:
+    // Constructor / Destructor ---------------------------------------------
+    ConvertClient();
+    ~ConvertClient();
+
+    ConvertClient( const ConvertClient& )            = delete;
+    ConvertClient& operator=( const ConvertClient& ) = delete;
+
+    // Requests -------------------------------------------------------------
+    bool connect( const std::string& socketPath );
+    bool request( const std::string& request, std::string& reply );
+    void disconnect();
+
+  private:
+    // Private Data ---------------------------------------------------------
+    int         clientSocket; //!< Connected socket, -1 when not connected
+    std::string received;     //!< Bytes read past the end of the last reply
+};
+
+//-----------------------------------------------------------------------------
+
+} // end namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: ConvertServer.h
+// ----------------------------------------------------------------------------
@@ -0,0 +1,333 @@
+/**----------------------------------------------------------------------------
+
+    @file       Coroutine.h
+    @defgroup   AmigaGfxLIBThreads AmigaGfx Library Threading Module
+    @brief      Coroutine task and awaitable bounded channel
+
+    @copyright  Neil Bereford 2024
+
+-----------------------------------------------------------------------------*/
+
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Include files
+// ----------------------------------------------------------------------------
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+
+#include "ThreadPool.h"
+
+//-----------------------------------------------------------------------------
+// Namespace
+// ----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Class definitions
+// ----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBThreads AmigaGfx Library Threading Module
+    @brief      Fire and forget coroutine. It does not run until start() is
+                called, then runs on the given ThreadPool and frees itself
+                when it finishes. Completion must be signalled by the
+                coroutine itself. An exception that ends the coroutine is
+                kept in the promise and handed to the onException()
+                handler, so the coroutine's owner can tidy up after it.
+  --------------------------------------------------------------------------*/
+class Task
+{
+  public:
+    /**-----------------------------------------------------------------------
+        @ingroup    AmigaGfxLIBThreads AmigaGfx Library Threading Module
+        @brief      Coroutine promise for Task
+      ----------------------------------------------------------------------*/
+    struct promise_type
+    {
+        Task                get_return_object() { return Task( std::coroutine_handle<promise_type>::from_promise( *this ) ); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never  final_suspend() noexcept
+        {
+            if ( exception && exceptionHandler )
+            {
+                exceptionHandler( exception );
+            }
+            return {};
+        }
+        void return_void() {}
+        void unhandled_exception() { exception = std::current_exception(); }
+
+        std::exception_ptr                        exception;        //!< Exception that ended the coroutine
+        std::function<void( std::exception_ptr )> exceptionHandler; //!< Called with it as the coroutine finishes, must not throw
+    };
+
+    Task( Task&& other ) noexcept : handle( other.handle ) { other.handle = nullptr; }
+    ~Task()
+    {
+        if ( handle )
+        {
+            handle.destroy();
+        }
+    }
+
+    Task( const Task& )            = delete;
+    Task& operator=( const Task& ) = delete;
+
+    /**-----------------------------------------------------------------------
+        @ingroup    AmigaGfxLIBThreads AmigaGfx Library Threading Module
+        @brief      Sets the handler called if an exception ends the
+                    coroutine, before it is started
+        @param      handler - Called with the exception, must not throw
+        @return     Task& - This task, to chain start()
+      ----------------------------------------------------------------------*/
+    Task& onException( std::function<void( std::exception_ptr )> handler )
+    {
+        handle.promise().exceptionHandler = std::move( handler );
+        return *this;
+    }
+
+    /**-----------------------------------------------------------------------
+        @ingroup    AmigaGfxLIBThreads AmigaGfx Library Threading Module
+        @brief      Starts the coroutine on a worker of the pool
+        @param      pool - Pool the coroutine first runs on
+      ----------------------------------------------------------------------*/
+    void start( ThreadPool& pool )
+    {
+        std::coroutine_handle<> start = handle;
+        handle                        = nullptr;
+        pool.submit( [ start ]() { start.resume(); } );
+    }
+
+  private:
+    explicit Task( std::coroutine_handle<promise_type> coroutine ) : handle( coroutine ) {}
+
+    std::coroutine_handle<promise_type> handle; //!< Coroutine, until it is started
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBThreads AmigaGfx Library Threading Module
+    @brief      Bounded channel between coroutines. co_await push() suspends
+                while the channel is full, co_await pop() while it is empty,
+                so no thread is held while waiting. A suspended coroutine is
+                resumed on the ThreadPool it passed in, so each stage keeps
+                running on its own threads. The channel closes once every
+                producer has called producerDone().
+  --------------------------------------------------------------------------*/
+template <typename T>
+class AsyncChannel
+{
+  private:
+    struct PushAwaiter;
+    struct PopAwaiter;
+
+  public:
+    // Constructor / Destructor ---------------------------------------------
+    AsyncChannel( size_t channelCapacity, uint32_t producerCount );
+
+    AsyncChannel( const AsyncChannel& )            = delete;
+    AsyncChannel& operator=( const AsyncChannel& ) = delete;
+
+    // Channel access -------------------------------------------------------
+    PushAwaiter push( T value, ThreadPool& resumePool ) { return PushAwaiter( *this, std::move( value ), resumePool ); }
+    PopAwaiter  pop( ThreadPool& resumePool ) { return PopAwaiter( *this, resumePool ); }
+    void        producerDone();
+
+  private:
+    // Private Types --------------------------------------------------------
+    /**-----------------------------------------------------------------------
+        @ingroup    AmigaGfxLIBThreads AmigaGfx Library Threading Module
+        @brief      Awaiter for push(), co_await gives false if the channel
+                    was already closed
+      ----------------------------------------------------------------------*/
+    struct PushAwaiter
+    {
+        PushAwaiter( AsyncChannel& owner, T item, ThreadPool& pool ) : channel( owner ), value( std::move( item ) ), resumePool( pool ) {}
+
+        bool await_ready() { return false; }
+        bool await_suspend( std::coroutine_handle<> coroutine );
+        bool await_resume() { return result; }
+
+        AsyncChannel&           channel;    //!< Channel pushed to
+        T                       value;      //!< Item to push
+        ThreadPool&             resumePool; //!< Pool to resume on after waiting
+        std::coroutine_handle<> handle;     //!< Waiting coroutine
+        bool                    result;     //!< True, the item was added
+    };
+
+    /**-----------------------------------------------------------------------
+        @ingroup    AmigaGfxLIBThreads AmigaGfx Library Threading Module
+        @brief      Awaiter for pop(), co_await gives std::nullopt once the
+                    channel is closed and empty
+      ----------------------------------------------------------------------*/
+    struct PopAwaiter
+    {
+        PopAwaiter( AsyncChannel& owner, ThreadPool& pool ) : channel( owner ), resumePool( pool ) {}
+
+        bool             await_ready() { return false; }
+        bool             await_suspend( std::coroutine_handle<> coroutine );
+        std::optional<T> await_resume() { return std::move( result ); }
+
+        AsyncChannel&           channel;    //!< Channel popped from
+        ThreadPool&             resumePool; //!< Pool to resume on after waiting
+        std::coroutine_handle<> handle;     //!< Waiting coroutine
+        std::optional<T>        result;     //!< Item taken
+    };
+
+    // Private Functions ----------------------------------------------------
+    static void resume( std::coroutine_handle<> coroutine, ThreadPool& pool );
+
+    // Private Data ---------------------------------------------------------
+    std::mutex               lock;        //!< Guards everything below
+    std::deque<T>            items;       //!< Items waiting to be taken
+    std::deque<PushAwaiter*> pushWaiters; //!< Producers waiting for room
+    std::deque<PopAwaiter*>  popWaiters;  //!< Consumers waiting for an item
+    size_t                   capacity;    //!< Most items held before push() waits
+    uint32_t                 producers;   //!< Producers still running
+};
+
+//-----------------------------------------------------------------------------
+// Template Functions
+//-----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBThreads AmigaGfx Library Threading Module
+    @brief      Constructor for the AsyncChannel class
+    @param      channelCapacity - Most items held before push() waits
+    @param      producerCount - Producers that will call producerDone()
+  --------------------------------------------------------------------------*/
+template <typename T>
+AsyncChannel<T>::AsyncChannel( size_t channelCapacity, uint32_t producerCount )
+{
+    capacity  = channelCapacity > 0 ? channelCapacity : 1;
+    producers = producerCount;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBThreads AmigaGfx Library Threading Module
+    @brief      Called by each producer when it has finished, the last one
+                closes the channel and wakes the waiting consumers
+  --------------------------------------------------------------------------*/
+template <typename T>
+void AsyncChannel<T>::producerDone()
+{
+    std::lock_guard<std::mutex> guard( lock );
+
+    if ( producers > 0 && --producers == 0 )
+    {
+        // any waiting consumer means the channel is empty
+        for ( PopAwaiter* waiter : popWaiters )
+        {
+            resume( waiter->handle, waiter->resumePool );
+        }
+        popWaiters.clear();
+    }
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBThreads AmigaGfx Library Threading Module
+    @brief      Adds the item, handing it straight to a waiting consumer if
+                there is one, or suspends while the channel is full
+    @param      coroutine - Coroutine pushing
+    @return     bool - True if the coroutine has to wait
+  --------------------------------------------------------------------------*/
+template <typename T>
+bool AsyncChannel<T>::PushAwaiter::await_suspend( std::coroutine_handle<> coroutine )
+{
+    std::lock_guard<std::mutex> guard( channel.lock );
+
+    result = true;
+
+    if ( channel.producers == 0 )
+    {
+        result = false;
+    }
+    else if ( channel.popWaiters.empty() == false )
+    {
+        PopAwaiter* waiter = channel.popWaiters.front();
+        channel.popWaiters.pop_front();
+        waiter->result = std::move( value );
+        resume( waiter->handle, waiter->resumePool );
+    }
+    else if ( channel.items.size() < channel.capacity )
+    {
+        channel.items.push_back( std::move( value ) );
+    }
+    else
+    {
+        // full, wait for a consumer to take the item, nothing may touch
+        // this awaiter once the lock is released
+        handle = coroutine;
+        channel.pushWaiters.push_back( this );
+        return true;
+    }
+
+    return false;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBThreads AmigaGfx Library Threading Module
+    @brief      Takes the oldest item, moving a waiting producer's item into
+                the freed slot, or suspends while the channel is empty
+    @param      coroutine - Coroutine popping
+    @return     bool - True if the coroutine has to wait
+  --------------------------------------------------------------------------*/
+template <typename T>
+bool AsyncChannel<T>::PopAwaiter::await_suspend( std::coroutine_handle<> coroutine )
+{
+    std::lock_guard<std::mutex> guard( channel.lock );
+
+    if ( channel.items.empty() == false )
+    {
+        result = std::move( channel.items.front() );
+        channel.items.pop_front();
+
+        if ( channel.pushWaiters.empty() == false )
+        {
+            PushAwaiter* waiter = channel.pushWaiters.front();
+            channel.pushWaiters.pop_front();
+            channel.items.push_back( std::move( waiter->value ) );
+            resume( waiter->handle, waiter->resumePool );
+        }
+        return false;
+    }
+
+    if ( channel.producers == 0 )
+    {
+        return false;
+    }
+
+    // empty, wait for a producer
+    handle = coroutine;
+    channel.popWaiters.push_back( this );
+    return true;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBThreads AmigaGfx Library Threading Module
+    @brief      Resumes a waiting coroutine on its own pool
+    @param      coroutine - Coroutine to resume
+    @param      pool - Pool to resume it on
+  --------------------------------------------------------------------------*/
+template <typename T>
+void AsyncChannel<T>::resume( std::coroutine_handle<> coroutine, ThreadPool& pool )
+{
+    pool.submit( [ coroutine ]() { coroutine.resume(); } );
+}
+
+//-----------------------------------------------------------------------------
+
+} // end namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: Coroutine.h
+// ----------------------------------------------------------------------------
@@ -0,0 +1,151 @@
+/**----------------------------------------------------------------------------
+
+    @file       CostModel.h
+    @defgroup   AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Estimates the cost of drawing sprites in each output format
+
+    @copyright  Neil Bereford 2024
+
+-----------------------------------------------------------------------------*/
+
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Include files
+// ----------------------------------------------------------------------------
+
+#include <cstdint>
+#include <vector>
+
+#include "HardwareSprites.h"
+#include "ImageView.h"
+#include "SpriteCompiler.h"
+#include "SpriteSlicer.h"
+
+//-----------------------------------------------------------------------------
+// Namespace
+// ----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Enum definitions
+// ----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      CPUs the cost model has timings for
+  --------------------------------------------------------------------------*/
+enum class CpuModel : uint8_t
+{
+    M68000 = 0,  //!< 68000, 7MHz, no cache
+    M68020,      //!< 68020, 14MHz with instruction cache
+    M68080,      //!< 68080 with AMMX, Apollo Vampire
+    TotalModels, //!< Number of CPU models
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Output formats a sprite can be drawn from
+  --------------------------------------------------------------------------*/
+enum class DrawFormat : uint8_t
+{
+    Rle = 0,      //!< Compressed sprite stream (.SPR), decoded by the CPU
+    Planar,       //!< Bitplanes and mask (.PLN), cookie cut by the blitter
+    Compiled,     //!< 68k code (.CSP), run by the CPU
+    Hardware,     //!< Hardware sprites (.HWS), drawn by sprite DMA
+    TotalFormats, //!< Number of formats
+};
+
+//-----------------------------------------------------------------------------
+// Class definitions
+// ----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Cost of drawing one sprite once in each format, and the
+                format chosen for it
+  --------------------------------------------------------------------------*/
+struct SpriteDrawCost
+{
+    uint64_t   cycles[ (size_t)DrawFormat::TotalFormats ]; //!< CPU cycles to draw, DRAW_UNAVAILABLE if the format cannot show the sprite
+    uint64_t   bytes[ (size_t)DrawFormat::TotalFormats ];  //!< Bytes of data or code held for the sprite
+    uint32_t   channels;                                   //!< Sprite DMA channels needed as hardware sprites
+    DrawFormat chosen;                                     //!< Format picked by chooseFormats()
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Static draw cost model, walks what each encoder writes for a
+                sprite, the RLE commands, the compiled instructions, the
+                blits of the planes and the hardware sprite channels, and
+                adds up the cycles each costs on the chosen CPU from a table
+                of instruction timings. chooseFormats() then picks the
+                cheapest format for every sprite, within a memory budget if
+                one is given.
+  --------------------------------------------------------------------------*/
+class DrawCostModel
+{
+  public:
+    // Constructor / Destructor ---------------------------------------------
+    DrawCostModel( CpuModel cpu = CpuModel::M68000 );
+    ~DrawCostModel();
+
+    // Costing --------------------------------------------------------------
+    uint64_t rleCycles( const uint8_t* pStream, const uint8_t* pEnd ) const;
+    uint64_t compiledCycles( const std::vector<M68kInstruction>& code ) const;
+    uint64_t planarCycles( uint32_t words, uint32_t rows, uint32_t planes ) const;
+    uint64_t hardwareCycles( const HardwareSpriteCell& cell ) const;
+
+    void     costSprites( ImageView<const uint8_t> image, const std::vector<SpriteRect>& sprites, std::vector<SpriteDrawCost>& costs ) const;
+    uint64_t chooseFormats( std::vector<SpriteDrawCost>& costs, uint64_t byteBudget = 0 ) const;
+
+    static const char* getCpuName( CpuModel cpu );
+    static const char* getFormatName( DrawFormat format );
+
+    // Constants ------------------------------------------------------------
+    static constexpr uint64_t DRAW_UNAVAILABLE = ~0ull; //!< Cycles of a format that cannot show a sprite
+
+  private:
+    // Private Types --------------------------------------------------------
+    /**-----------------------------------------------------------------------
+        @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+        @brief      Cycle timings of one CPU
+      ----------------------------------------------------------------------*/
+    struct CycleTable
+    {
+        double rleSkip;         //!< Skip command, read and step the destination
+        double rleLiteral;      //!< Literal run, read the count and set up the copy
+        double rleLiteralPixel; //!< Each pixel copied by a literal run
+        double rleFill;         //!< Fill run, read the length and colour
+        double rleFillPixel;    //!< Each pixel written by a fill run
+        double rleEndLine;      //!< End of line, down a row
+        double rleEndSprite;    //!< End of sprite, return
+        double moveLong;        //!< move.l #imm,(a0)+
+        double moveWord;        //!< move.w #imm,(a0)+
+        double moveByte;        //!< move.b #imm,(a0)+
+        double stepQuick;       //!< addq.w / subq.w #n,a0
+        double lea;             //!< lea d16(a0),a0
+        double addRow;          //!< adda.l d0,a0
+        double rts;             //!< rts
+        double blitSetup;       //!< Waiting for the blitter and loading its registers, per blit
+        double blitWord;        //!< Each word of a cookie cut blit, four DMA channels, in CPU cycles
+        double spriteCell;      //!< Finding the sprite lists of a hardware sprite cell, per frame
+        double spriteChannel;   //!< Writing the control words of one sprite channel, per frame
+    };
+
+    // Private Data ---------------------------------------------------------
+    static const CycleTable CYCLE_TABLES[ (size_t)CpuModel::TotalModels ]; //!< Timings of each CPU
+
+    CpuModel          cpuModel; //!< CPU costed for
+    const CycleTable& timings;  //!< Timings of that CPU
+};
+
+//-----------------------------------------------------------------------------
+
+} // end namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: CostModel.h
+// ----------------------------------------------------------------------------
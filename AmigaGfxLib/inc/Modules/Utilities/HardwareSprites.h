@@ -0,0 +1,107 @@
+/**----------------------------------------------------------------------------
+
+    @file       HardwareSprites.h
+    @defgroup   AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Encodes sprite cells as Amiga hardware sprites
+
+    @copyright  Neil Bereford 2024
+
+-----------------------------------------------------------------------------*/
+
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Include files
+// ----------------------------------------------------------------------------
+
+#include <cstdint>
+#include <vector>
+
+#include "ImageView.h"
+#include "SpriteSlicer.h"
+
+//-----------------------------------------------------------------------------
+// Namespace
+// ----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Class definitions
+// ----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Hardware sprite width and pairing settings
+  --------------------------------------------------------------------------*/
+struct HardwareSpriteConfig
+{
+    uint32_t fetchWidth = 16;   //!< Sprite width in pixels, 16 on OCS/ECS, 32 or 64 with the AGA fetch modes
+    bool     bAttach    = true; //!< Pair attached sprites for cells with 4 to 15 colours
+    bool     bTrim      = true; //!< Drop the transparent rows above and below each cell
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      How a cell was split into hardware sprites, one per cell in
+                the order given
+  --------------------------------------------------------------------------*/
+struct HardwareSpriteCell
+{
+    uint32_t x;               //!< Left edge on the sheet
+    uint32_t y;               //!< Top edge on the sheet
+    uint32_t width;           //!< Width of the cell
+    uint32_t height;          //!< Height of the cell
+    uint32_t firstLine;       //!< Rows trimmed from the top of the cell
+    uint32_t lines;           //!< Rows of sprite data
+    uint32_t colours;         //!< Colours used, not counting transparent
+    uint32_t strips;          //!< Sprites across the cell, one per fetch width
+    uint32_t channels;        //!< Sprite DMA channels used, two per strip when attached
+    bool     bAttached;       //!< Strips are attached pairs, 15 colours
+    bool     bFits;           //!< Colours, channels and lines are within what the hardware shows at once
+    uint8_t  colourMap[ 16 ]; //!< Palette index shown by each sprite colour, 0 is transparent
+    uint32_t dataSize;        //!< Bytes of sprite data, every channel
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Hardware sprite encoder, splits each cell into strips the
+                width of a hardware sprite and writes them as sprite DMA
+                lists, control words, two bitplane words a line and the end
+                marker. A cell of up to 3 colours uses one sprite a strip,
+                up to 15 colours an attached pair a strip. The report gives
+                the DMA channels each cell needs out of the 8 available.
+  --------------------------------------------------------------------------*/
+class HardwareSpriteEncoder
+{
+  public:
+    // Constructor / Destructor ---------------------------------------------
+    HardwareSpriteEncoder( const HardwareSpriteConfig& config = HardwareSpriteConfig() );
+    ~HardwareSpriteEncoder();
+
+    // Encoding -------------------------------------------------------------
+    bool encode( ImageView<const uint8_t> image, const std::vector<SpriteRect>& cells, std::vector<uint8_t>& hwsFile, std::vector<HardwareSpriteCell>& report ) const;
+    void plan( ImageView<const uint8_t> image, const std::vector<SpriteRect>& cells, std::vector<HardwareSpriteCell>& report ) const;
+
+    // Constants ------------------------------------------------------------
+    static constexpr uint32_t HWS_CHANNELS  = 8;   //!< Sprite DMA channels
+    static constexpr uint32_t HWS_MAX_LINES = 511; //!< Most lines the nine bit stop position holds
+    static constexpr uint32_t HWS_ENTRY     = 12;  //!< Table entry (offset, first line, lines, strips, channels, colours, flags)
+
+  private:
+    // Private Functions ----------------------------------------------------
+    void     planCell( ImageView<const uint8_t> cell, HardwareSpriteCell& info ) const;
+    uint8_t* writeSprite( ImageView<const uint8_t> rows, const uint8_t* colourOf, uint32_t strip, uint32_t shift, bool bAttach, uint8_t* pOut ) const;
+
+    // Private Data ---------------------------------------------------------
+    HardwareSpriteConfig spriteConfig; //!< Sprite width and pairing settings
+};
+
+//-----------------------------------------------------------------------------
+
+} // end namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: HardwareSprites.h
+// ----------------------------------------------------------------------------
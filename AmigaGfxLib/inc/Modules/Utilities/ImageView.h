@@ -0,0 +1,126 @@
+/**----------------------------------------------------------------------------
+
+    @file       ImageView.h
+    @defgroup   AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Non owning, strided view of a rectangle of pixels
+
+    @copyright  Neil Bereford 2024
+
+-----------------------------------------------------------------------------*/
+
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Include files
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Namespace
+// ----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Class definitions
+// ----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      View of width x height pixels, rows stride pixels apart. The
+                view never owns the pixels, so sub views of a sprite sheet,
+                a band of rows or a libpng row buffer are made without
+                copying. A view must not outlive the pixels it looks at.
+  --------------------------------------------------------------------------*/
+template <typename T>
+class ImageView
+{
+  public:
+    // Constructor ----------------------------------------------------------
+    ImageView() : pPixels( nullptr ), viewWidth( 0 ), viewHeight( 0 ), viewStride( 0 ) {}
+    ImageView( T* pData, uint32_t width, uint32_t height, size_t stride ) : pPixels( pData ), viewWidth( width ), viewHeight( height ), viewStride( stride ) {}
+    ImageView( T* pData, uint32_t width, uint32_t height ) : ImageView( pData, width, height, width ) {}
+
+    /**-----------------------------------------------------------------------
+        @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+        @brief      Read only view of the same pixels
+      ----------------------------------------------------------------------*/
+    template <typename U = T, typename = std::enable_if_t<!std::is_const_v<U>>>
+    operator ImageView<const U>() const
+    {
+        return ImageView<const U>( pPixels, viewWidth, viewHeight, viewStride );
+    }
+
+    // Access ---------------------------------------------------------------
+    T*       getData() const { return pPixels; }
+    uint32_t getWidth() const { return viewWidth; }
+    uint32_t getHeight() const { return viewHeight; }
+    size_t   getStride() const { return viewStride; }
+    bool     isEmpty() const { return viewWidth == 0 || viewHeight == 0; }
+    bool     isContiguous() const { return viewStride == viewWidth || viewHeight <= 1; }
+    T*       getRow( uint32_t y ) const { return pPixels + y * viewStride; }
+    T&       at( uint32_t x, uint32_t y ) const { return pPixels[ y * viewStride + x ]; }
+
+    /**-----------------------------------------------------------------------
+        @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+        @brief      View of a rectangle inside this view, clipped to its
+                    edges, so cells along the right and bottom edges of a
+                    sheet come back smaller rather than reading past it
+        @param      x - Left edge, relative to this view
+        @param      y - Top edge, relative to this view
+        @param      width - Width of the rectangle
+        @param      height - Height of the rectangle
+        @return     ImageView - Sub view sharing this view's stride
+      ----------------------------------------------------------------------*/
+    ImageView subView( uint32_t x, uint32_t y, uint32_t width, uint32_t height ) const
+    {
+        x = std::min( x, viewWidth );
+        y = std::min( y, viewHeight );
+
+        return ImageView( pPixels + y * viewStride + x, std::min( width, viewWidth - x ), std::min( height, viewHeight - y ), viewStride );
+    }
+
+    /**-----------------------------------------------------------------------
+        @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+        @brief      View of a band of whole rows
+        @param      y - First row
+        @param      height - Number of rows
+        @return     ImageView - Rows y to y + height - 1
+      ----------------------------------------------------------------------*/
+    ImageView rows( uint32_t y, uint32_t height ) const { return subView( 0, y, viewWidth, height ); }
+
+    /**-----------------------------------------------------------------------
+        @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+        @brief      Copies the viewed pixels into a tightly packed buffer
+        @param      pixels - Receives width * height pixels
+      ----------------------------------------------------------------------*/
+    void copyTo( std::vector<std::remove_const_t<T>>& pixels ) const
+    {
+        pixels.resize( (size_t)viewWidth * viewHeight );
+        for ( uint32_t y = 0; y < viewHeight; y++ )
+        {
+            std::copy( getRow( y ), getRow( y ) + viewWidth, pixels.begin() + (size_t)y * viewWidth );
+        }
+    }
+
+  private:
+    // Private Data ---------------------------------------------------------
+    T*       pPixels;    //!< Top left pixel
+    uint32_t viewWidth;  //!< Width in pixels
+    uint32_t viewHeight; //!< Height in pixels
+    size_t   viewStride; //!< Pixels from the start of one row to the next
+};
+
+//-----------------------------------------------------------------------------
+
+} // end namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: ImageView.h
+// ----------------------------------------------------------------------------
@@ -0,0 +1,134 @@
+/**----------------------------------------------------------------------------
+
+    @file       JobManifest.h
+    @defgroup   AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Manifest of conversion jobs, run in one process
+
+    @copyright  Neil Bereford 2024
+
+-----------------------------------------------------------------------------*/
+
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Include files
+// ----------------------------------------------------------------------------
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../FileHandling/FileManager.h"
+#include "ThreadPool.h"
+#include "Tools.h"
+
+//-----------------------------------------------------------------------------
+// Namespace
+// ----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Class definitions
+// ----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      One conversion job of a manifest
+  --------------------------------------------------------------------------*/
+struct ManifestJob
+{
+    std::string input;       //!< Source PNG
+    uint32_t    sprW;        //!< Sprite grid width, 0 finds the sprites
+    uint32_t    sprH;        //!< Sprite grid height, 0 finds the sprites
+    uint32_t    formats;     //!< OutputFormat flags of the files to write
+    std::string destination; //!< Folder for the outputs, empty writes them beside the input
+    uint32_t    line;        //!< Manifest line the job came from
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      File written by a job
+  --------------------------------------------------------------------------*/
+struct ManifestOutput
+{
+    std::string fileName; //!< File written
+    uint64_t    size;     //!< Bytes written
+    uint32_t    crc32;    //!< zlib CRC-32 of the contents
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Result of a job, timings in microseconds
+  --------------------------------------------------------------------------*/
+struct ManifestResult
+{
+    bool                        bConverted;   //!< True if every output was written
+    std::string                 error;        //!< Why the job failed
+    uint64_t                    readMicros;   //!< Reading the PNG, or copying it from the file cache
+    uint64_t                    decodeMicros; //!< Decoding the PNG
+    uint64_t                    encodeMicros; //!< Building the outputs
+    uint64_t                    writeMicros;  //!< Writing the outputs
+    uint64_t                    startMicros;  //!< Start of the job, from the start of the run
+    std::vector<ManifestOutput> outputs;      //!< Files written
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Job manifest, reads a list of conversion jobs, each with
+                its own sprite size, outputs and destination, runs them all
+                on one thread pool with a shared file cache, and writes a
+                JSON result manifest with the timings and output CRCs. The
+                manifest is one job per line:
+
+                    <png> [<W>x<H>|auto [<pal,raw,spr,565,argb>|all [<destination>]]]
+  --------------------------------------------------------------------------*/
+class JobManifest
+{
+  public:
+    // Constructor / Destructor ---------------------------------------------
+    JobManifest( uint32_t threadCount = 0 );
+    ~JobManifest();
+
+    JobManifest( const JobManifest& )            = delete;
+    JobManifest& operator=( const JobManifest& ) = delete;
+
+    // Jobs -----------------------------------------------------------------
+    bool load( const std::string& fileName );
+    bool parse( const std::string& text, const std::string& basePath = "" );
+    bool addJob( const ManifestJob& job );
+
+    // Running --------------------------------------------------------------
+    uint32_t run();
+    bool     saveResults( const std::string& fileName ) const;
+    uint64_t getRunMicros() const;
+
+    const std::vector<ManifestJob>&    getJobs() const;
+    const std::vector<ManifestResult>& getResults() const;
+
+  private:
+    // Private Functions ----------------------------------------------------
+    void               runJob( size_t jobIndex, std::chrono::steady_clock::time_point runStart );
+    void               convertJob( size_t jobIndex, std::chrono::steady_clock::time_point runStart );
+    const ManifestJob* findClash( const ManifestJob& job ) const;
+
+    static std::string OutputBase( const ManifestJob& job );
+    static bool        ParseLine( const std::string& line, const std::string& basePath, ManifestJob& job, std::string& error );
+
+    // Private Data ---------------------------------------------------------
+    ThreadPool                  jobPool;     //!< Runs the jobs
+    FileManager                 fileManager; //!< Reads the PNGs, an input listed twice is read once
+    std::vector<ManifestJob>    jobs;        //!< Jobs, in manifest order
+    std::vector<ManifestResult> results;     //!< Result of each job, in manifest order
+    uint64_t                    runMicros;   //!< Wall time of the last run
+};
+
+//-----------------------------------------------------------------------------
+
+} // end namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: JobManifest.h
+// ----------------------------------------------------------------------------
@@ -0,0 +1,189 @@
+/**----------------------------------------------------------------------------
+
+    @file       Metrics.h
+    @defgroup   AmigaGfxLIBMetrics AmigaGfx Library Metrics Module
+    @brief      Pipeline stage timers and counters
+
+    @copyright  Neil Bereford 2024
+
+-----------------------------------------------------------------------------*/
+
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Include files
+// ----------------------------------------------------------------------------
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Namespace
+// ----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Enum definitions
+// ----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBMetrics AmigaGfx Library Metrics Module
+    @brief      Timed stages of the conversion pipeline
+  --------------------------------------------------------------------------*/
+enum class MetricStage : uint8_t
+{
+    PngDecode = 0, //!< libpng decode of the source image
+    PixelCopy,     //!< Copy of the decoded rows into the raw image
+    Compress,      //!< Sprite compression (CompressSpriteData)
+    PaletteWrite,  //!< Writing the palette
+    FileWrite,     //!< Writing output files
+    FileRead,      //!< Reading files (FileManager)
+    DirectoryWalk, //!< Listing directories (FileManager)
+    PngEncode,     //!< PNG encode (Encode_PNG, Write_PNG)
+    SpriteSlice,   //!< Finding the sprites on a sheet (SpriteSlicer)
+    TrueColour,    //!< Expanding indexes to truecolour pixels (TrueColourConverter)
+    TotalStages,   //!< Number of stages
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBMetrics AmigaGfx Library Metrics Module
+    @brief      Counted quantities of the conversion pipeline
+  --------------------------------------------------------------------------*/
+enum class MetricCounter : uint8_t
+{
+    BytesIn = 0,       //!< Bytes read from disk
+    BytesOut,          //!< Bytes written to disk
+    ImagesConverted,   //!< Images read by Read_PNG
+    SpritesEncoded,    //!< Sprites compressed
+    OpSkip,            //!< Sprite skip commands emitted (0-200)
+    OpLiteral,         //!< Sprite literal runs emitted
+    OpFill,            //!< Sprite fill runs emitted
+    OpEndLine,         //!< Sprite end of line commands emitted
+    OpEndSprite,       //!< Sprite end commands emitted
+    BufferAllocations, //!< Arena blocks and pooled objects created (flat once warmed up)
+    PalettesWritten,   //!< Palette files written by a PaletteStore
+    PalettesShared,    //!< Images whose palette was already in the PaletteStore
+    TotalCounters,     //!< Number of counters
+};
+
+//-----------------------------------------------------------------------------
+// Class definitions
+// ----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBMetrics AmigaGfx Library Metrics Module
+    @brief      Totals of the stage timers and counters
+  --------------------------------------------------------------------------*/
+struct MetricTotals
+{
+    std::array<uint64_t, (size_t)MetricStage::TotalStages>     stageCalls; //!< Number of timed calls per stage
+    std::array<uint64_t, (size_t)MetricStage::TotalStages>     stageNanos; //!< Time spent per stage, nanoseconds
+    std::array<uint64_t, (size_t)MetricCounter::TotalCounters> counters;   //!< Counter values
+
+    // General Functionality -------------------------------------------------
+    void Clear();
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBMetrics AmigaGfx Library Metrics Module
+    @brief      Metrics class, collects per thread stage timings and counters
+                and exports a summary as JSON or CSV
+  --------------------------------------------------------------------------*/
+class Metrics
+{
+  public:
+    // Function to access the singleton -----------------------------------------
+    static Metrics& getInstance()
+    {
+        static Metrics instance; // Created only once
+        return instance;
+    }
+
+    // Recording ---------------------------------------------------------------
+    void addTime( MetricStage stage, uint64_t nanoSeconds );
+    void addCount( MetricCounter counter, uint64_t count = 1 );
+    void setEnabled( bool enable );
+    bool isEnabled() const;
+    void reset();
+
+    // Reporting ---------------------------------------------------------------
+    MetricTotals getTotals();
+    std::string  toJSON();
+    std::string  toCSV();
+    bool         saveSummary( const std::string& fileName );
+
+    // Names -------------------------------------------------------------------
+    static const char* getStageName( MetricStage stage );
+    static const char* getCounterName( MetricCounter counter );
+
+  private:
+    // Singleton constructor and destructor ------------------------------------
+    Metrics();
+    ~Metrics();
+
+    Metrics( const Metrics& )            = delete;
+    Metrics& operator=( const Metrics& ) = delete;
+
+    // Private Types -----------------------------------------------------------
+    /**-----------------------------------------------------------------------
+        @ingroup    AmigaGfxLIBMetrics AmigaGfx Library Metrics Module
+        @brief      Metrics of a single thread, only that thread adds to them
+      ----------------------------------------------------------------------*/
+    struct ThreadMetrics
+    {
+        uint32_t                                                                threadIndex; //!< Order the thread first recorded
+        std::array<std::atomic<uint64_t>, (size_t)MetricStage::TotalStages>     stageCalls;  //!< Number of timed calls per stage
+        std::array<std::atomic<uint64_t>, (size_t)MetricStage::TotalStages>     stageNanos;  //!< Time spent per stage, nanoseconds
+        std::array<std::atomic<uint64_t>, (size_t)MetricCounter::TotalCounters> counters;    //!< Counter values
+    };
+
+    // Private functions -------------------------------------------------------
+    ThreadMetrics& getThreadMetrics();
+    void           releaseThreadMetrics( ThreadMetrics* pMetrics );
+    void           addTotals( MetricTotals& totals, const ThreadMetrics& metrics );
+    void           addRetired( MetricTotals& totals );
+
+    // Private Data ------------------------------------------------------------
+    std::mutex                                  registryLock;    //!< Guards threadMetrics and retiredTotals
+    std::vector<std::unique_ptr<ThreadMetrics>> threadMetrics;   //!< One entry per running thread that has recorded
+    MetricTotals                                retiredTotals;   //!< Metrics of the threads that have exited
+    uint32_t                                    nextThreadIndex; //!< Index given to the next thread to record
+    std::atomic<bool>                           enabled;         //!< False, recording is skipped
+
+}; // end class Singleton Metrics
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBMetrics AmigaGfx Library Metrics Module
+    @brief      Times a scope and adds the time to a stage
+  --------------------------------------------------------------------------*/
+class ScopedTimer
+{
+  public:
+    ScopedTimer( MetricStage timedStage );
+    ~ScopedTimer();
+
+    ScopedTimer( const ScopedTimer& )            = delete;
+    ScopedTimer& operator=( const ScopedTimer& ) = delete;
+
+  private:
+    MetricStage                           stage;   //!< Stage being timed
+    bool                                  running; //!< False if metrics were disabled at the start
+    std::chrono::steady_clock::time_point start;   //!< Start of the timed scope
+};
+
+//-----------------------------------------------------------------------------
+
+} // end namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: Metrics.h
+// ----------------------------------------------------------------------------
@@ -0,0 +1,94 @@
+/**----------------------------------------------------------------------------
+
+    @file       PaletteStore.h
+    @defgroup   AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Content addressed store of Apollo V4 palettes
+
+    @copyright  Neil Bereford 2024
+
+-----------------------------------------------------------------------------*/
+
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Include files
+// ----------------------------------------------------------------------------
+
+#include <png.h>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Namespace
+// ----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Class definitions
+// ----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Palette store, keeps one Apollo V4 palette file per unique
+                palette, named by a hash of its contents. Images sharing a
+                palette share its file, so a batch writes each palette once
+                however many images use it. The index file records the
+                palette ID of each sprite output, the latest one when an
+                output is added again.
+  --------------------------------------------------------------------------*/
+class PaletteStore
+{
+  public:
+    // Constructor / Destructor ---------------------------------------------
+    PaletteStore( const std::string& folder );
+    ~PaletteStore();
+
+    PaletteStore( const PaletteStore& )            = delete;
+    PaletteStore& operator=( const PaletteStore& ) = delete;
+
+    // Palettes -------------------------------------------------------------
+    bool        add( const std::vector<png_color>& palette, const std::string& outputName, uint64_t& paletteId );
+    std::string getFileName( uint64_t paletteId ) const;
+    bool        saveIndex() const;
+    std::string getIndexName() const;
+    uint32_t    getPaletteCount() const;
+    uint32_t    getWriteCount() const;
+
+  private:
+    // Private Types --------------------------------------------------------
+    /**-----------------------------------------------------------------------
+        @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+        @brief      A palette of the store, and whether its file is on disk
+      ----------------------------------------------------------------------*/
+    struct PaletteEntry
+    {
+        std::vector<uint8_t> paletteData; //!< Apollo V4 palette data
+        bool                 bOnDisk;     //!< File written or found, false while the adding thread writes it
+    };
+
+    // Private Functions ----------------------------------------------------
+    static bool FileMatches( const std::string& fileName, const std::vector<uint8_t>& paletteData );
+
+    // Private Data ---------------------------------------------------------
+    std::string                                storeFolder; //!< Folder holding the palette files and the index
+    mutable std::mutex                         lock;        //!< Guards the palettes and references
+    std::condition_variable                    fileDone;    //!< Signalled when a palette file has been written or has failed
+    std::unordered_map<uint64_t, PaletteEntry> palettes;    //!< Palettes by palette ID
+    std::map<std::string, uint64_t>            references;  //!< ID of the palette of each output, by output name
+    uint32_t                                   writeCount;  //!< Palette files written, palettes already on disk are not rewritten
+};
+
+//-----------------------------------------------------------------------------
+
+} // end namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: PaletteStore.h
+// ----------------------------------------------------------------------------
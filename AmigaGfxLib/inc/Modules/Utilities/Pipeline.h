@@ -0,0 +1,121 @@
+/**----------------------------------------------------------------------------
+
+    @file       Pipeline.h
+    @defgroup   AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Staged coroutine conversion pipeline
+
+    @copyright  Neil Bereford 2024
+
+-----------------------------------------------------------------------------*/
+
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Include files
+// ----------------------------------------------------------------------------
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../FileHandling/FileManager.h"
+#include "Arena.h"
+#include "Channel.h"
+#include "Coroutine.h"
+#include "PaletteStore.h"
+#include "ThreadPool.h"
+#include "Tools.h"
+
+//-----------------------------------------------------------------------------
+// Namespace
+// ----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Class definitions
+// ----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Pipeline stage concurrency and channel depth
+  --------------------------------------------------------------------------*/
+struct PipelineConfig
+{
+    uint32_t      readThreads   = 2;       //!< Threads reading PNG files
+    uint32_t      decodeThreads = 0;       //!< Threads decoding, 0 uses one per hardware thread
+    uint32_t      encodeThreads = 0;       //!< Threads compressing, 0 uses one per hardware thread
+    uint32_t      writeThreads  = 2;       //!< Threads writing the output files
+    uint32_t      channelDepth  = 4;       //!< Items held between two stages, caps the memory in flight
+    uint32_t      spriteWidth   = 0;       //!< Sprite grid width, 0 finds the sprites on each sheet
+    uint32_t      spriteHeight  = 0;       //!< Sprite grid height, 0 finds the sprites on each sheet
+    PaletteStore* paletteStore  = nullptr; //!< Takes the palettes, null writes a .PAL beside each image
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Conversion pipeline, reads, decodes, encodes and writes
+                images in four overlapping stages, each on its own threads
+  --------------------------------------------------------------------------*/
+class ConvertPipeline
+{
+  public:
+    // Constructor / Destructor ---------------------------------------------
+    ConvertPipeline( const PipelineConfig& config = PipelineConfig() );
+    ~ConvertPipeline();
+
+    ConvertPipeline( const ConvertPipeline& )            = delete;
+    ConvertPipeline& operator=( const ConvertPipeline& ) = delete;
+
+    // Conversion -----------------------------------------------------------
+    uint32_t run( Channel<std::string>& pngFiles );
+    uint32_t getFailedCount() const;
+
+  private:
+    // Private Types --------------------------------------------------------
+    /**-----------------------------------------------------------------------
+        @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+        @brief      PNG file read from disk, waiting to be decoded
+      ----------------------------------------------------------------------*/
+    struct FileJob
+    {
+        std::string          fileName; //!< Source file name
+        std::vector<uint8_t> pngData;  //!< PNG file contents
+    };
+
+    // Private Functions ----------------------------------------------------
+    Task readStage( Channel<std::string>& pngFiles, AsyncChannel<FileJob>& output );
+    Task decodeStage( AsyncChannel<FileJob>& input, AsyncChannel<DecodedImage>& output );
+    Task encodeStage( AsyncChannel<DecodedImage>& input, AsyncChannel<std::vector<ConvertedFile>>& output );
+    Task writeStage( AsyncChannel<std::vector<ConvertedFile>>& input );
+    void stageFinished();
+    void imageFailed( const std::string& fileName, std::exception_ptr exception );
+    void stageFailed( std::exception_ptr exception );
+
+    // Private Data ---------------------------------------------------------
+    uint32_t                               channelDepth;    //!< Items held between two stages
+    uint32_t                               spriteWidth;     //!< Sprite grid width, 0 slices each sheet
+    uint32_t                               spriteHeight;    //!< Sprite grid height, 0 slices each sheet
+    PaletteStore*                          paletteStore;    //!< Takes the palettes, null writes a .PAL per image
+    ThreadPool                             readPool;        //!< Read stage threads
+    ThreadPool                             decodePool;      //!< Decode stage threads
+    ThreadPool                             encodePool;      //!< Encode stage threads
+    ThreadPool                             writePool;       //!< Write stage threads
+    FileManager                            fileManager;     //!< Reads and writes the files
+    ObjectPool<FileJob>                    jobPool;         //!< Reused read buffers
+    ObjectPool<DecodedImage>               imagePool;       //!< Reused decoded images
+    ObjectPool<std::vector<ConvertedFile>> outputPool;      //!< Reused output file sets
+    std::atomic<uint32_t>                  runningStages;   //!< Stage coroutines not yet finished
+    std::atomic<uint32_t>                  convertedImages; //!< Images written by the current run
+    std::atomic<uint32_t>                  failedImages;    //!< Images that failed in the current run
+};
+
+//-----------------------------------------------------------------------------
+
+} // end namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: Pipeline.h
+// ----------------------------------------------------------------------------
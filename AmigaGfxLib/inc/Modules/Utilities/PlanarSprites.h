@@ -0,0 +1,110 @@
+/**----------------------------------------------------------------------------
+
+    @file       PlanarSprites.h
+    @defgroup   AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Encodes sprites as blitter bitplanes and masks, pre-shifted
+
+    @copyright  Neil Bereford 2024
+
+-----------------------------------------------------------------------------*/
+
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Include files
+// ----------------------------------------------------------------------------
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "ImageView.h"
+#include "SpriteSlicer.h"
+
+//-----------------------------------------------------------------------------
+// Namespace
+// ----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Class definitions
+// ----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Bitplane, mask and pre-shift settings
+  --------------------------------------------------------------------------*/
+struct PlanarConfig
+{
+    uint32_t planes = 0;    //!< Bitplanes, 0 uses enough for the highest colour on the image
+    uint32_t shifts = 1;    //!< Copies of each sprite, 1, 2, 4, 8 or 16, each shifted 16 / shifts pixels further right
+    bool     bMask  = true; //!< Write a mask plane for cookie cut blits
+    bool     bDedup = true; //!< Store identical planes once
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Memory cost of one pre-shift choice
+  --------------------------------------------------------------------------*/
+struct PlanarCost
+{
+    uint32_t shifts;      //!< Copies of each sprite
+    uint64_t fileBytes;   //!< Size of the .PLN file
+    uint64_t planeBytes;  //!< Bytes of plane data before identical planes are shared
+    uint64_t sharedBytes; //!< Bytes saved by sharing identical planes
+    uint64_t blitWords;   //!< Words the blitter moves to draw every sprite once, on average over the positions
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Planar sprite encoder, writes each sprite as separate
+                bitplanes and a mask, in as many pre-shifted copies as
+                asked for. With 16 copies a sprite is drawn at any x with
+                no blitter shift, the copy at x % 16 moved as it is, and
+                the copy for a word aligned x needs no extra word per row.
+                Fewer copies leave the blitter the shift within a step.
+                Identical planes, the same plane in two copies or two
+                sprites, or a plane with nothing on it, are stored once.
+  --------------------------------------------------------------------------*/
+class PlanarSpriteEncoder
+{
+  public:
+    // Constructor / Destructor ---------------------------------------------
+    PlanarSpriteEncoder( const PlanarConfig& config = PlanarConfig() );
+    ~PlanarSpriteEncoder();
+
+    // Encoding -------------------------------------------------------------
+    bool     encode( ImageView<const uint8_t> image, const std::vector<SpriteRect>& sprites, std::vector<uint8_t>& plnFile );
+    bool     measure( ImageView<const uint8_t> image, const std::vector<SpriteRect>& sprites, std::vector<PlanarCost>& costs ) const;
+    uint32_t getPlaneCount() const;
+    uint64_t getPlaneBytes() const;
+    uint64_t getSharedBytes() const;
+    uint64_t getBlitWords() const;
+
+    static uint32_t PlanesFor( ImageView<const uint8_t> image );
+
+    // Constants ------------------------------------------------------------
+    static constexpr uint32_t PLN_MAX_PLANES = 8; //!< Most bitplanes, one per bit of a colour index
+
+  private:
+    // Private Functions ----------------------------------------------------
+    uint32_t addPlane( const std::vector<uint16_t>& words, std::vector<uint8_t>& planeData );
+
+    // Private Data ---------------------------------------------------------
+    PlanarConfig                                        planarConfig; //!< Bitplane, mask and pre-shift settings
+    uint32_t                                            planeCount;   //!< Bitplanes of the last encode
+    uint64_t                                            planeBytes;   //!< Plane bytes of the last encode before sharing
+    uint64_t                                            sharedBytes;  //!< Plane bytes the last encode shared
+    uint64_t                                            blitWords;    //!< Words moved drawing each sprite once, averaged over x
+    std::unordered_map<uint64_t, std::vector<uint32_t>> planeOffsets; //!< Offsets of the planes written, by hash of their data
+};
+
+//-----------------------------------------------------------------------------
+
+} // end namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: PlanarSprites.h
+// ----------------------------------------------------------------------------
@@ -0,0 +1,123 @@
+/**----------------------------------------------------------------------------
+
+    @file       SpriteCompiler.h
+    @defgroup   AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Compiles sprites into 68k drawing code
+
+    @copyright  Neil Bereford 2024
+
+-----------------------------------------------------------------------------*/
+
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Include files
+// ----------------------------------------------------------------------------
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ImageView.h"
+#include "SpriteSlicer.h"
+
+//-----------------------------------------------------------------------------
+// Namespace
+// ----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Enum definitions
+// ----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Instructions a compiled sprite is made of, a0 is the
+                destination and d0 the bytes per screen row
+  --------------------------------------------------------------------------*/
+enum class M68kOp : uint8_t
+{
+    MoveLong = 0, //!< move.l #pixels,(a0)+
+    MoveWord,     //!< move.w #pixels,(a0)+
+    MoveByte,     //!< move.b #pixel,(a0)+
+    AddQuick,     //!< addq.w #1-8,a0, a short skip
+    SubQuick,     //!< subq.w #1-8,a0, a short step back
+    Lea,          //!< lea d16(a0),a0, any other skip
+    AddRow,       //!< adda.l d0,a0, down a row
+    Return,       //!< rts
+};
+
+//-----------------------------------------------------------------------------
+// Class definitions
+// ----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      One instruction of a compiled sprite
+  --------------------------------------------------------------------------*/
+struct M68kInstruction
+{
+    M68kOp   op;      //!< Instruction
+    uint32_t operand; //!< Pixels for a move, big endian, or the distance for a skip
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Code for one sprite, for an even or an odd destination
+  --------------------------------------------------------------------------*/
+struct CompiledSprite
+{
+    uint32_t                     index;     //!< Index of the sprite in the list compiled
+    uint32_t                     x;         //!< Left edge on the sheet
+    uint32_t                     y;         //!< Top edge on the sheet
+    uint32_t                     width;     //!< Width in pixels
+    uint32_t                     height;    //!< Height in pixels
+    bool                         bOdd;      //!< Code for a destination at an odd address
+    uint32_t                     offset;    //!< Offset of the code from the jump table
+    uint32_t                     codeBytes; //!< Size of the code
+    std::vector<M68kInstruction> code;      //!< Instructions, ending with rts
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Sprite compiler, turns each sprite into straight line 68k
+                code that writes its opaque pixels to a chunky screen with
+                long, word and byte moves and steps over the transparent
+                ones, so drawing a sprite costs no decoding. The code is
+                position independent, and the file holds every sprite's
+                code behind a jump table. With odd variants each sprite is
+                compiled twice, so the moves stay aligned for either parity
+                of destination address on the 68000.
+  --------------------------------------------------------------------------*/
+class SpriteCompiler
+{
+  public:
+    // Constructor / Destructor ---------------------------------------------
+    SpriteCompiler( bool bOddVariants = true );
+    ~SpriteCompiler();
+
+    // Compiling ------------------------------------------------------------
+    void compile( ImageView<const uint8_t> sprite, bool bOdd, std::vector<M68kInstruction>& code ) const;
+    void build( ImageView<const uint8_t> image, const std::vector<SpriteRect>& sprites, std::vector<uint8_t>& codeFile, std::vector<CompiledSprite>& compiled ) const;
+
+    static uint8_t*    Assemble( const M68kInstruction& instruction, uint8_t* pOut );
+    static uint32_t    InstructionBytes( const M68kInstruction& instruction );
+    static std::string Listing( const std::vector<CompiledSprite>& compiled );
+
+  private:
+    // Private Functions ----------------------------------------------------
+    static void AddSkip( int32_t distance, std::vector<M68kInstruction>& code );
+
+    // Private Data ---------------------------------------------------------
+    bool bOddCode; //!< Compile a second copy of each sprite for odd destinations
+};
+
+//-----------------------------------------------------------------------------
+
+} // end namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: SpriteCompiler.h
+// ----------------------------------------------------------------------------
@@ -0,0 +1,110 @@
+/**----------------------------------------------------------------------------
+
+    @file       SpriteSlicer.h
+    @defgroup   AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Finds the sprites on a sheet by connected components
+
+    @copyright  Neil Bereford 2024
+
+-----------------------------------------------------------------------------*/
+
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Include files
+// ----------------------------------------------------------------------------
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "ImageView.h"
+#include "ThreadPool.h"
+
+//-----------------------------------------------------------------------------
+// Namespace
+// ----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Class definitions
+// ----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Position and size of a sprite on a sheet
+  --------------------------------------------------------------------------*/
+struct SpriteRect
+{
+    uint32_t x;          //!< Left edge on the sheet
+    uint32_t y;          //!< Top edge on the sheet
+    uint32_t width;      //!< Width in pixels
+    uint32_t height;     //!< Height in pixels
+    uint32_t pixelCount; //!< Non transparent pixels inside the sprite
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Sprite slicing settings
+  --------------------------------------------------------------------------*/
+struct SliceConfig
+{
+    uint32_t mergeDistance = 2;  //!< Sprites this many transparent pixels apart, or closer, are merged
+    uint32_t minPixels     = 1;  //!< Sprites with fewer pixels once merged are dropped as noise
+    uint32_t bandHeight    = 64; //!< Rows labelled by each task
+    uint32_t threadCount   = 0;  //!< Labelling threads, 0 uses one per hardware thread, 1 labels inline
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Sprite slicer, labels the non transparent (non zero) pixels
+                of a sheet into 8 connected components, merges components
+                that sit close together (a detached eye or shadow) and
+                returns the bounding box of each sprite in reading order.
+                The buffers are kept between calls, so a slicer reused for
+                a run of sheets stops allocating once warmed up.
+  --------------------------------------------------------------------------*/
+class SpriteSlicer
+{
+  public:
+    // Constructor / Destructor ---------------------------------------------
+    SpriteSlicer( const SliceConfig& config = SliceConfig() );
+    ~SpriteSlicer();
+
+    SpriteSlicer( const SpriteSlicer& )            = delete;
+    SpriteSlicer& operator=( const SpriteSlicer& ) = delete;
+
+    // Slicing --------------------------------------------------------------
+    void     slice( ImageView<const uint8_t> image, std::vector<SpriteRect>& sprites );
+    uint32_t getComponentCount() const;
+
+    static void GridCells( uint32_t width, uint32_t height, uint32_t sprW, uint32_t sprH, std::vector<SpriteRect>& cells );
+
+  private:
+    // Private Functions ----------------------------------------------------
+    void     labelBand( ImageView<const uint8_t> image, uint32_t firstRow, uint32_t rowCount );
+    void     joinRows( ImageView<const uint8_t> image, uint32_t y );
+    void     collectComponents( ImageView<const uint8_t> image, std::vector<SpriteRect>& sprites );
+    void     mergeNearby( std::vector<SpriteRect>& sprites ) const;
+    uint32_t findRoot( uint32_t pixel );
+    void     unite( uint32_t pixelA, uint32_t pixelB );
+
+    // Private Data ---------------------------------------------------------
+    SliceConfig                 sliceConfig;    //!< Slicing settings
+    std::unique_ptr<ThreadPool> labelPool;      //!< Band labelling threads, created on first use
+    std::vector<uint32_t>       parent;         //!< Union-find parent of each pixel, NO_LABEL if transparent
+    std::vector<uint32_t>       componentIndex; //!< Sprite index of each root pixel
+    uint32_t                    componentCount; //!< Components found by the last slice, before merging
+
+    static constexpr uint32_t NO_LABEL = 0xFFFFFFFF; //!< Parent of a transparent pixel
+};
+
+//-----------------------------------------------------------------------------
+
+} // end namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: SpriteSlicer.h
+// ----------------------------------------------------------------------------
@@ -0,0 +1,77 @@
+/**----------------------------------------------------------------------------
+
+    @file       ThreadPool.h
+    @defgroup   AmigaGfxLIBThreads AmigaGfx Library Threading Module
+    @brief      Fixed size pool of worker threads
+
+    @copyright  Neil Bereford 2024
+
+-----------------------------------------------------------------------------*/
+
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Include files
+// ----------------------------------------------------------------------------
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Namespace
+// ----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Class definitions
+// ----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBThreads AmigaGfx Library Threading Module
+    @brief      Thread pool, runs submitted tasks on a fixed set of worker
+                threads. Tasks may submit further tasks, wait() returns once
+                every task, including those, has finished.
+  --------------------------------------------------------------------------*/
+class ThreadPool
+{
+  public:
+    // Constructor / Destructor ---------------------------------------------
+    ThreadPool( uint32_t threadCount = 0 );
+    ~ThreadPool();
+
+    ThreadPool( const ThreadPool& )            = delete;
+    ThreadPool& operator=( const ThreadPool& ) = delete;
+
+    // Task control ---------------------------------------------------------
+    void     submit( std::function<void()> task );
+    void     wait();
+    uint32_t getThreadCount() const;
+
+  private:
+    // Private Functions ----------------------------------------------------
+    void workerThread();
+
+    // Private Data ---------------------------------------------------------
+    std::vector<std::thread>          workers;      //!< Worker threads
+    std::deque<std::function<void()>> tasks;        //!< Tasks waiting for a worker
+    std::mutex                        lock;         //!< Guards tasks, pendingTasks and running
+    std::condition_variable           taskReady;    //!< Signalled when a task is submitted
+    std::condition_variable           tasksDone;    //!< Signalled when pendingTasks reaches zero
+    uint32_t                          pendingTasks; //!< Tasks submitted and not yet finished
+    bool                              running;      //!< False, asks the workers to finish
+};
+
+//-----------------------------------------------------------------------------
+
+} // end namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: ThreadPool.h
+// ----------------------------------------------------------------------------
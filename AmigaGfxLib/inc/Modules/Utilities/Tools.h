@@ -14,13 +14,18 @@
 // Include files
 // ----------------------------------------------------------------------------
 
+#include <png.h>
+#include <zlib.h>
 #include <string>
 #include <chrono>
 #include <ctime>
+#include <functional>
 #include <vector>
 
 #include "../Logging/Logger.h"
 #include "../ErrorHandling/Errors.h"
+#include "ImageView.h"
+#include "SpriteSlicer.h"
 
 //-----------------------------------------------------------------------------
 // Namespace
@@ -29,10 +34,119 @@
 namespace AmigaGfx
 {
 
+class PaletteStore;
+class ThreadPool;
+
+//-----------------------------------------------------------------------------
+// Enum definitions
+// ----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Command bytes of the compressed sprite (.SPR) data stream.
+                Values 0-199 are a skip of that many transparent pixels,
+                followed by a literal run (count byte + pixel bytes).
+  --------------------------------------------------------------------------*/
+enum class SpriteCmd : uint8_t
+{
+    Skip      = 200, //!< Skip 200 transparent pixels, no data follows
+    EndLine   = 201, //!< Skip to the start of the next line
+    Fill      = 202, //!< Fill run, followed by the length and colour index bytes
+    EndSprite = 255, //!< End of the sprite data
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Output files built by Encode_Image(), combined as flags
+  --------------------------------------------------------------------------*/
+enum OutputFormat : uint32_t
+{
+    OutputPalette = 0x01, //!< Apollo V4 palette (.PAL)
+    OutputRaw     = 0x02, //!< Colour indexes (-W-H.RAW)
+    OutputSprites = 0x04, //!< Compressed sprites (.SPR)
+    OutputRgb565  = 0x08, //!< Big endian RGB565 pixels for the Apollo V4 16 bit modes (-W-H.565)
+    OutputArgb32  = 0x10, //!< Big endian ARGB32 pixels for the Apollo V4 32 bit modes (-W-H.ARGB)
+    OutputAll     = 0x07, //!< Every indexed output, truecolour is only built when asked for
+    OutputEvery   = 0x1F, //!< Every output, indexed and truecolour
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Row filter choice of Encode_PNG()
+  --------------------------------------------------------------------------*/
+enum class PngFilter : uint8_t
+{
+    None = 0, //!< No filter, usually the best for indexed images
+    Sub,      //!< Difference from the pixel to the left
+    Up,       //!< Difference from the pixel above
+    Average,  //!< Difference from the mean of the pixels left and above
+    Paeth,    //!< Difference from the Paeth predictor
+    MinSum,   //!< Each row tries all five, keeping the smallest sum of absolute differences
+    Fast,     //!< Each row tries None, Sub and Up only, most of the gain of MinSum for less work
+};
+
 //-----------------------------------------------------------------------------
 // Class definitions
 // ----------------------------------------------------------------------------
 
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      PNG encoder settings for Encode_PNG() and Write_PNG()
+  --------------------------------------------------------------------------*/
+struct PngEncodeOptions
+{
+    int         zlibLevel      = Z_DEFAULT_COMPRESSION; //!< zlib level, 0 stores, 1 fastest to 9 smallest
+    int         zlibStrategy   = Z_DEFAULT_STRATEGY;    //!< zlib strategy, Z_RLE is quick and suits sprite sheets
+    PngFilter   filter         = PngFilter::None;       //!< Row filter choice
+    uint32_t    bandRows       = 0;                     //!< Rows per separately deflated band, 0 sizes the bands from the image
+    ThreadPool* pool           = nullptr;               //!< Deflates the bands in parallel, null deflates them in turn
+    bool        bSkipUnchanged = true;                  //!< Write_PNG() leaves a file already holding the same image alone
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Decoded 8 bit indexed image
+  --------------------------------------------------------------------------*/
+struct DecodedImage
+{
+    std::string            fileName; //!< Source file name
+    uint32_t               width;    //!< Width in pixels
+    uint32_t               height;   //!< Height in pixels
+    std::vector<png_color> palette;      //!< Palette colours
+    std::vector<uint8_t>   transparency; //!< Alpha of the first palette entries (tRNS), empty when opaque
+    std::vector<uint8_t>   pixels;       //!< Colour indexes, width * height bytes
+
+    ImageView<const uint8_t> getView() const { return ImageView<const uint8_t>( pixels.data(), width, height ); }
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Output file built in memory, ready to be written
+  --------------------------------------------------------------------------*/
+struct ConvertedFile
+{
+    std::string          fileName; //!< File name to write
+    std::vector<uint8_t> fileData; //!< File contents
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Converted image held in memory, built by Convert_PNG(). The
+                buffers hold the same bytes as the files Encode_Image()
+                names, an output not asked for is left empty.
+  --------------------------------------------------------------------------*/
+struct ConvertedImage
+{
+    uint32_t               width;       //!< Width in pixels
+    uint32_t               height;      //!< Height in pixels
+    std::vector<png_color> palette;     //!< Palette colours as read from the PNG
+    std::vector<uint8_t>   paletteData; //!< Apollo V4 palette (.PAL)
+    std::vector<uint8_t>   raw;         //!< Colour indexes, width * height bytes (-W-H.RAW)
+    std::vector<uint8_t>   sprites;     //!< Compressed sprites (.SPR)
+    std::vector<uint8_t>   rgb565;      //!< Big endian RGB565 pixels (-W-H.565)
+    std::vector<uint8_t>   argb32;      //!< Big endian ARGB32 pixels (-W-H.ARGB)
+};
+
 /**---------------------------------------------------------------------------
     @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
     @brief      Tools class (Support functionality) for the AmigaGfx Library
@@ -48,23 +162,45 @@ class Tools
     }
 
     uint16_t crc16( uint8_t* pData, uint32_t len ) const;
+    uint64_t hash64( const uint8_t* pData, size_t len, uint64_t seed = 0 ) const;
 
     // Image functions ---------------------------------------------------------
     void Read_PNG( const char* file_name, uint32_t sprWidth, uint32_t sprHeight );
-    void Write_PNG( const char* file_name );
+    void Write_PNG( const char* file_name, const PngEncodeOptions& options = PngEncodeOptions() );
     bool Check_8bitIndexed_PNG( const char* filename );
     void Save_ApolloV4_Palette( std::vector<png_color>& palette, const std::string& filename );
+    void Set_PaletteStore( PaletteStore* store );
+
+    // Reentrant image functions, nothing is kept in the instance ---------------
+    bool Decode_PNG( const std::vector<uint8_t>& pngData, DecodedImage& image ) const;
+    bool Decode_PNG( const uint8_t* pData, size_t size, DecodedImage& image ) const;
+    bool Encode_Image( const DecodedImage& image, std::vector<ConvertedFile>& outputs, uint32_t sprW = 0, uint32_t sprH = 0, uint32_t formats = OutputAll ) const;
+    bool Convert_PNG( const std::vector<uint8_t>& pngData, ConvertedImage& converted, uint32_t sprW = 0, uint32_t sprH = 0, uint32_t formats = OutputAll ) const;
+    bool Convert_PNG( const uint8_t* pData, size_t size, ConvertedImage& converted, uint32_t sprW = 0, uint32_t sprH = 0, uint32_t formats = OutputAll ) const;
+    bool Encode_PNG( const DecodedImage& image, std::vector<uint8_t>& pngData, const PngEncodeOptions& options = PngEncodeOptions() ) const;
+    void Build_ApolloV4_Palette( const std::vector<png_color>& palette, std::vector<uint8_t>& paletteData ) const;
 
     // Compression functions ---------------------------------------------------
     void CompressData( unsigned char* pData, uint32_t len, unsigned char* pOut, unsigned long* pLenout );
     void CompressSpriteData( std::vector<uint8_t>& data, uint32_t w, uint32_t h, uint32_t sprW, uint32_t sprH, std::string fileName );
+    void EncodeSpriteData( const std::vector<uint8_t>& data, uint32_t w, uint32_t h, uint32_t sprW, uint32_t sprH, const std::string& fileName, std::vector<uint8_t>& sprFile ) const;
+    void EncodeSpriteData( ImageView<const uint8_t> image, uint32_t sprW, uint32_t sprH, const std::string& fileName, std::vector<uint8_t>& sprFile ) const;
+    bool EncodeSpriteList( ImageView<const uint8_t> image, const std::vector<SpriteRect>& sprites, const std::string& fileName, std::vector<uint8_t>& sprFile ) const;
+    bool EncodeSpriteList( ImageView<const uint8_t> image, const std::vector<SpriteRect>& sprites, const std::string& fileName, std::vector<uint8_t>& sprFile, uint64_t* opCounts ) const;
+    uint8_t*      EncodeSpriteCell( ImageView<const uint8_t> cell, uint8_t* pOut, uint64_t* opCounts, bool bSpecialised = true ) const;
+    static size_t SpriteDataBound( uint32_t w, uint32_t h, uint32_t sprW, uint32_t sprH );
 
     // Disk related functions --------------------------------------------------
     void Save_Vector_To_File( const std::vector<uint8_t>& vData, const std::string& filename );
+    void Save_Converted( const ConvertedImage& converted, const std::string& fileName );
 
     // palette functions -------------------------------------------------------
     bool MergePalettes( std::vector<uint8_t>& paletteTo, std::vector<uint8_t>& paletteFrom, uint32_t ToStart, uint32_t FromStart, uint32_t FromSize );
 
+    // Constants ---------------------------------------------------------------
+    static constexpr uint32_t SPR_LIST_ENTRY = 12;        //<! Sprite list table entry (offset, x, y, width, height)
+    static constexpr uint64_t PNG_MAX_PIXELS = 1ull << 28; //<! Most pixels (width * height) Decode_PNG() allocates for, 256 MB of indexes
+
   private:
     // Singleton constructor and destructor ------------------------------------
     Tools();
@@ -81,10 +217,58 @@ class Tools
     const uint16_t CRC_SHIFT = 1;      //<! Const values for the crc16 - CRC shift
     const uint16_t CRC_BITS  = 8;      //<! Const values for the crc16 - CRC bits
 
-    png_infop      info_ptr; // <-- Global info_ptr (good)
-    png_bytepp     row_pointers;
+    // sprite compression constants ---------------------------------------------
+    const uint32_t SPR_MAX_RUN    = 255; //<! Longest run a single count byte can hold
+    const uint32_t SPR_FILL_COST  = 3;   //<! Bytes used by a fill run (command, length, colour)
+    const uint32_t SPR_LIT_COST   = 2;   //<! Bytes needed to restart a literal run (skip 0, count)
+
+    // PNG encoder constants ----------------------------------------------------
+    static constexpr size_t PNG_BAND_BYTES = 256 * 1024; //<! Filtered bytes per deflated band when bandRows is 0
+    static constexpr size_t PNG_WINDOW     = 32 * 1024;  //<! Bytes of the previous band each band is primed with
+
+    DecodedImage   readImage;    //<! Image read by Read_PNG(), written by Write_PNG()
+    SpriteSlicer   sheetSlicer;  //<! Finds the sprites for Read_PNG() when no grid is given
+    PaletteStore*  paletteStore; //<! Takes the palettes from Read_PNG(), null writes palette.bin
+
+    // Private types -----------------------------------------------------------
+    /**-----------------------------------------------------------------------
+        @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+        @brief      Read position in PNG data held in memory
+      ----------------------------------------------------------------------*/
+    struct PngMemoryReader
+    {
+        const uint8_t* pData;  //!< PNG data
+        size_t         size;   //!< Size of the PNG data
+        size_t         offset; //!< Next byte to read
+    };
+
+    /**-----------------------------------------------------------------------
+        @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+        @brief      Sprite encoder built for one cell width
+      ----------------------------------------------------------------------*/
+    struct CellKernel
+    {
+        uint32_t width;                                                                      //!< Cell width the kernel handles
+        uint8_t* ( Tools::*encoder )( ImageView<const uint8_t>, uint8_t*, uint64_t* ) const; //!< Kernel
+    };
+
+    static const CellKernel CELL_KERNELS[ 4 ]; //!< Kernels for the common sprite widths
 
     // private functions -------------------------------------------------------
+    uint32_t         ScanRunLength( const uint8_t* pData, uint32_t len, uint8_t value ) const;
+    uint32_t         ScanOpaqueLength( const uint8_t* pData, uint32_t len ) const;
+    uint8_t*         EncodeSpriteCellGeneric( ImageView<const uint8_t> cell, uint8_t* pOut, uint64_t* opCounts ) const;
+    bool             EncodeImageSprites( ImageView<const uint8_t> image, uint32_t sprW, uint32_t sprH, const std::string& fileName, std::vector<uint8_t>& sprFile ) const;
+    template <uint32_t W>
+    uint8_t*         EncodeSpriteCellFixed( ImageView<const uint8_t> cell, uint8_t* pOut, uint64_t* opCounts ) const;
+    static void      PngReadFromMemory( png_structp png_ptr, png_bytep outBytes, png_size_t byteCount );
+    static void      FilterPngRow( const uint8_t* pRow, const uint8_t* pPrior, uint32_t width, PngFilter filter, uint8_t* pOut );
+    static size_t    BeginPngChunk( std::vector<uint8_t>& pngData, const char* type );
+    static void      EndPngChunk( std::vector<uint8_t>& pngData, size_t chunkStart );
+    static void      RunPngBands( uint32_t bandCount, ThreadPool* pool, const std::function<void( uint32_t )>& work );
+    bool             PngHoldsImage( const std::string& fileName, const DecodedImage& image ) const;
+    static png_voidp PngArenaMalloc( png_structp png_ptr, png_alloc_size_t size );
+    static void      PngArenaFree( png_structp png_ptr, png_voidp pMemory );
 
 }; // end class Singleton Tools
 
@@ -0,0 +1,110 @@
+/**----------------------------------------------------------------------------
+
+    @file       TrueColour.h
+    @defgroup   AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Expands indexed images into Apollo V4 truecolour pixels
+
+    @copyright  Neil Bereford 2024
+
+-----------------------------------------------------------------------------*/
+
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Include files
+// ----------------------------------------------------------------------------
+
+#include <png.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "ImageView.h"
+#include "ThreadPool.h"
+
+//-----------------------------------------------------------------------------
+// Namespace
+// ----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Enum definitions
+// ----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Truecolour pixel formats of the Apollo V4 chunky modes, both
+                big endian
+  --------------------------------------------------------------------------*/
+enum class TrueColourFormat : uint8_t
+{
+    Rgb565 = 0,   //!< 16 bit, rrrrrggg gggbbbbb
+    Argb32,       //!< 32 bit, alpha, red, green, blue bytes
+    TotalFormats, //!< Number of formats
+};
+
+//-----------------------------------------------------------------------------
+// Class definitions
+// ----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Truecolour conversion settings
+  --------------------------------------------------------------------------*/
+struct TrueColourConfig
+{
+    TrueColourFormat format      = TrueColourFormat::Rgb565; //!< Pixel format written
+    int32_t          keyIndex    = 0;                        //!< Palette index drawn as the key colour, -1 for none
+    uint32_t         keyColour   = 0xFF00FF;                 //!< Key colour as 0xRRGGBB, written with alpha 0 in ARGB32
+    uint32_t         bandHeight  = 64;                       //!< Rows converted by each task
+    uint32_t         threadCount = 1;                        //!< Converting threads, 0 uses one per hardware thread, 1 converts inline
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Truecolour converter, expands 8 bit indexed pixels through
+                the palette into big endian RGB565 or ARGB32 pixels for the
+                Apollo V4 16 and 32 bit chunky modes. The palette is turned
+                into a table of finished pixels once, so converting is a
+                table lookup a pixel, done 16 pixels at a time with byte
+                shuffles for palettes of up to 16 colours and with gathers
+                otherwise, where the CPU has them. The key index is written
+                as the key colour, and any palette colour that would come
+                out the same is moved one step of blue, so the key stays
+                transparent and nothing else is.
+  --------------------------------------------------------------------------*/
+class TrueColourConverter
+{
+  public:
+    // Constructor / Destructor ---------------------------------------------
+    TrueColourConverter( const TrueColourConfig& config = TrueColourConfig() );
+    ~TrueColourConverter();
+
+    // Converting -----------------------------------------------------------
+    void setPalette( const std::vector<png_color>& palette, const std::vector<uint8_t>& transparency = {} );
+    void convert( ImageView<const uint8_t> image, std::vector<uint8_t>& pixels );
+    void convertRow( const uint8_t* pIndexes, uint32_t count, uint8_t* pOut ) const;
+    void convertRowScalar( const uint8_t* pIndexes, uint32_t count, uint8_t* pOut ) const;
+
+    uint32_t    getBytesPerPixel() const;
+    uint32_t    getKeyPixel() const;
+    const char* getKernelName() const;
+
+  private:
+    // Private Data ---------------------------------------------------------
+    TrueColourConfig            colourConfig;            //!< Format, key and threading settings
+    alignas( 32 ) uint32_t      pixelTable[ 256 ];       //!< Finished pixel of each index, its bytes in output order
+    alignas( 16 ) uint8_t       shuffleTable[ 4 ][ 16 ]; //!< Each output byte of the first 16 pixels, for byte shuffles
+    bool                        bSmallPalette;           //!< Palette of up to 16 colours, the shuffle kernel is used
+    std::unique_ptr<ThreadPool> bandPool;                //!< Converting threads, made on first use
+};
+
+//-----------------------------------------------------------------------------
+
+} // end namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: TrueColour.h
+// ----------------------------------------------------------------------------
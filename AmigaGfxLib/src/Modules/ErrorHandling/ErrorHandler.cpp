@@ -22,12 +22,21 @@ Notes:
     - std::string - Error message
 
     The ErrorHandler::handleError() function creates a new ErrorInformation
-    structure and adds it to the errorList vector. This vector is used to
+    structure and adds it to the error history. The history is used to
     report the errors to the console terminal if needed, and log them.
+    handleError() can be called from any number of threads. The history is
+    one ring of ERROR_HISTORY_SIZE slots, each with its own lock, and an
+    error goes in the slot picked by its sequence number, so threads only
+    contend when they write the same slot. Older errors are overwritten and
+    counted as overflow, so memory use is bounded, and the ring always holds
+    the most recent errors whichever threads reported them. Per ErrorType
+    counts are kept in atomics, so getStatusInformation() does not rescan
+    the history.
     The ErrorHandler::reportErrors() function is used to report the errors
-    to the console terminal. This function loops through the errorList vector
-    and calls the ErrorHandler::displayMessage() function to display the
-    error to the console terminal.
+    to the console terminal. This function gathers the history from the
+    ring in the order the errors were handled and calls the
+    ErrorHandler::displayMessage() function to display the error to the
+    console terminal.
     The ErrorHandler::displayMessage() function displays the error to the
     console terminal. This function takes one parameter:
 
@@ -63,7 +72,7 @@ namespace AmigaGfx
   --------------------------------------------------------------------------*/
 ErrorHandler::ErrorHandler()
 {
-    errorList.clear();
+    clearErrors();
 
     // Initialize the logger
     loggerInitialize();
@@ -76,7 +85,7 @@ ErrorHandler::ErrorHandler()
   --------------------------------------------------------------------------*/
 ErrorHandler::~ErrorHandler()
 {
-    errorList.clear();
+    clearErrors();
 }
 
 /**---------------------------------------------------------------------------
@@ -91,11 +100,37 @@ void ErrorHandler::handleError( ErrorType errorType, LibraryError errorNumber, c
 {
     // Create a new error
     ErrorInformation info;
-    info.type    = errorType;
-    info.number  = errorNumber;
-    info.message = message;
-    info.time    = std::chrono::system_clock::to_time_t( std::chrono::system_clock::now() ); // Add the error to the list
-    errorList.push_back( info );
+    info.type     = errorType;
+    info.number   = errorNumber;
+    info.message  = message;
+    info.time     = std::chrono::system_clock::to_time_t( std::chrono::system_clock::now() );
+    info.sequence = nextSequence++;
+
+    if ( errorType < ErrorType::Status || errorType >= ErrorType::TotalTypes )
+    {
+        info.type = ErrorType::Error;
+    }
+    typeCounts[ (size_t)info.type ]++;
+
+    // Add the error to the history, overwriting the oldest once full
+    ErrorSlot& slot = history[ info.sequence % ERROR_HISTORY_SIZE ];
+    {
+        std::lock_guard<std::mutex> lock( slot.lock );
+        if ( !slot.bUsed )
+        {
+            slot.error = std::move( info );
+            slot.bUsed = true;
+        }
+        else
+        {
+            // a thread a whole ring ahead may already have written the slot, then this error is the older one
+            if ( slot.error.sequence < info.sequence )
+            {
+                slot.error = std::move( info );
+            }
+            overflow++;
+        }
+    }
 
     // log error message
     LogError( errorNumber, message );
@@ -103,12 +138,24 @@ void ErrorHandler::handleError( ErrorType errorType, LibraryError errorNumber, c
 
 /**---------------------------------------------------------------------------
     @ingroup    AmigaGfxLIBError AmigaGfx Library Error Module
-    @brief      Clears the error list
+    @brief      Clears the error history and counts
     @return     void
   --------------------------------------------------------------------------*/
 void ErrorHandler::clearErrors()
 {
-    errorList.clear();
+    for ( auto& slot : history )
+    {
+        std::lock_guard<std::mutex> lock( slot.lock );
+        slot.error = ErrorInformation();
+        slot.bUsed = false;
+    }
+
+    for ( auto& count : typeCounts )
+    {
+        count = 0;
+    }
+    nextSequence = 0;
+    overflow     = 0;
 }
 
 /**---------------------------------------------------------------------------
@@ -118,6 +165,8 @@ void ErrorHandler::clearErrors()
  --------------------------------------------------------------------------*/
 void ErrorHandler::reportErrors()
 {
+    std::vector<ErrorInformation> errorList = getRecentErrors();
+
     if ( errorList.empty() )
     {
         std::cout << "No errors to report" << std::endl;
@@ -126,6 +175,10 @@ void ErrorHandler::reportErrors()
     else
     {
         std::cout << "Errors reported:" << std::endl;
+        if ( overflow )
+        {
+            std::cout << overflow << " older errors are no longer held" << std::endl;
+        }
         for ( auto& error : errorList )
         {
             displayMessage( error );
@@ -133,6 +186,31 @@ void ErrorHandler::reportErrors()
     }
 }
 
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBError AmigaGfx Library Error Module
+    @brief      Gathers the errors held in the history, oldest first. Errors
+                still being written when this is called are left out
+    @return     std::vector<ErrorInformation> - Most recent errors
+  --------------------------------------------------------------------------*/
+std::vector<ErrorInformation> ErrorHandler::getRecentErrors()
+{
+    std::vector<ErrorInformation> errorList;
+    uint64_t                      lastSequence  = nextSequence;
+    uint64_t                      firstSequence = lastSequence > ERROR_HISTORY_SIZE ? lastSequence - ERROR_HISTORY_SIZE : 0;
+
+    errorList.reserve( lastSequence - firstSequence );
+    for ( uint64_t sequence = firstSequence; sequence < lastSequence; sequence++ )
+    {
+        ErrorSlot&                  slot = history[ sequence % ERROR_HISTORY_SIZE ];
+        std::lock_guard<std::mutex> lock( slot.lock );
+        if ( slot.bUsed && slot.error.sequence == sequence )
+        {
+            errorList.push_back( slot.error );
+        }
+    }
+    return errorList;
+}
+
 /**---------------------------------------------------------------------------
     @ingroup    USBHIDConsoleApplication USB HID Console Application
     @brief      Returns the current status of the error handler
@@ -145,32 +223,11 @@ ErrorStatus ErrorHandler::getStatusInformation()
 
     info.Clear();
 
-    for ( auto& error : errorList )
-    {
-        switch ( error.type )
-        {
-            case ErrorType::Status:
-            {
-                info.numStatus++;
-                break;
-            }
-            case ErrorType::Warning:
-            {
-                info.numWarnings++;
-                break;
-            }
-            case ErrorType::Critical:
-            {
-                info.numCritical++;
-                break;
-            }
-            default:
-            {
-                info.numErrors++;
-                break;
-            }
-        }
-    }
+    info.numStatus   = typeCounts[ (size_t)ErrorType::Status ];
+    info.numWarnings = typeCounts[ (size_t)ErrorType::Warning ];
+    info.numErrors   = typeCounts[ (size_t)ErrorType::Error ];
+    info.numCritical = typeCounts[ (size_t)ErrorType::Critical ];
+    info.numOverflow = overflow;
     info.totalErrors = info.numErrors + info.numWarnings + info.numStatus + info.numCritical;
     return info;
 }
@@ -229,6 +286,7 @@ void ErrorStatus::Clear()
     numStatus   = 0;
     numCritical = 0;
     totalErrors = 0;
+    numOverflow = 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -7,12 +7,42 @@
 
 Notes:
 
+    walkFiles() streams the matching files of a directory tree into a
+    Channel as they are found, so the files can be processed while the walk
+    is still running. Each directory is listed by a ThreadPool task, and
+    the sub directories found are submitted as further tasks, so a wide
+    tree is listed by several threads at once. On POSIX systems the entry
+    type cached in the directory entry (d_type) is used, stat() is only
+    called when the file system does not supply it or for symbolic links.
+    Links to files are walked like files, links to directories are not
+    followed, so a link back up the tree cannot make the walk loop.
+
+    OpenFile() keeps the files it reads in a byte budgeted LRU cache of
+    TS_FILE_DATA entries, keyed by the file name and checked against the
+    file size and last write time, so a file changed on disk is read again.
+    SaveFile() and invalidateFile() drop a file from the cache. There is one
+    cache for the process, shared by every FileManager, so a file read by
+    one part of the library is served from memory to the others, and the
+    budget caps the memory held by all of them. A FileManager that reads
+    each file once, such as the pipeline's, turns caching off for its own
+    reads with setCaching() rather than emptying the shared cache.
+
 -----------------------------------------------------------------------------*/
 //-----------------------------------------------------------------------------
 // Includes
 //-----------------------------------------------------------------------------
 
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#if !defined( _WIN32 )
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
 #include "../../../inc/Modules/FileHandling/FileManager.h"
+#include "../../../inc/Modules/Utilities/Metrics.h"
 
 //-----------------------------------------------------------------------------
 // Namesapce
@@ -32,11 +62,10 @@ namespace AmigaGfx
     @brief      Constructor for the FileManager class
 
   --------------------------------------------------------------------------*/
-FileManager::FileManager()
+FileManager::FileManager() : fileCache( SharedCache() )
 {
-    fileCount  = 0;
-    nextFileID = 0;
-    fileList.clear();
+    fileCount = 0;
+    bCaching  = true;
 }
 
 /**---------------------------------------------------------------------------
@@ -52,7 +81,9 @@ FileManager::~FileManager()
 
 /**---------------------------------------------------------------------------
     @ingroup    AmigaGfxLIBFile AmigaGfx Library File Module
-    @brief      Open a file and read the data into memory
+    @brief      Open a file and read the data into memory. Files are kept in
+                the cache, a later call for the same file is served from
+                memory as long as its size and write time have not changed.
 
     @param      fileName - Full path and file name to open
     @param      fileData - Vector to store the file data
@@ -61,7 +92,45 @@ FileManager::~FileManager()
   --------------------------------------------------------------------------*/
 bool FileManager::OpenFile( const std::string& fileName, std::vector<uint8_t>& fileData )
 {
-    bool result = false;
+    bool            result = false;
+    ScopedTimer     timer( MetricStage::FileRead );
+    std::error_code error;
+
+    // the size and write time tell if a cached copy is still current
+    uint64_t fileSize = std::filesystem::file_size( fileName, error );
+    int64_t  fileTime = error ? 0 : (int64_t)std::filesystem::last_write_time( fileName, error ).time_since_epoch().count();
+
+    if ( error )
+    {
+        invalidateFile( fileName );
+        return false;
+    }
+
+    if ( bCaching )
+    {
+        std::lock_guard<std::mutex> guard( fileCache.lock );
+        auto                        cached = fileCache.fileIndex.find( fileName );
+
+        if ( cached != fileCache.fileIndex.end() )
+        {
+            TS_FILE_DATA& entry = *cached->second;
+
+            if ( entry.fileSize == fileSize && entry.fileTime == fileTime )
+            {
+                fileData = entry.fileData;
+                fileCache.fileList.splice( fileCache.fileList.begin(), fileCache.fileList, cached->second );
+                fileCache.stats.cacheHits++;
+                return true;
+            }
+
+            // stale, the file has changed on disk
+            fileCache.stats.bytesCached -= entry.fileData.size();
+            fileCache.fileList.erase( cached->second );
+            fileCache.fileIndex.erase( cached );
+        }
+
+        fileCache.stats.cacheMisses++;
+    }
 
     // Open the file
     std::ifstream file( fileName, std::ios::binary );
@@ -70,7 +139,7 @@ bool FileManager::OpenFile( const std::string& fileName, std::vector<uint8_t>& f
     {
         // Get the file size
         file.seekg( 0, std::ios::end );
-        size_t fileSize = file.tellg();
+        fileSize = file.tellg();
         file.seekg( 0, std::ios::beg );
 
         // Read the file into memory
@@ -80,9 +149,34 @@ bool FileManager::OpenFile( const std::string& fileName, std::vector<uint8_t>& f
         // Close the file
         file.close();
 
+        Metrics::getInstance().addCount( MetricCounter::BytesIn, fileSize );
         result = true;
     }
 
+    if ( result )
+    {
+        std::lock_guard<std::mutex> guard( fileCache.lock );
+
+        fileCount++;
+
+        // only cache what fits, and do not replace an entry another thread added
+        if ( bCaching && fileSize <= fileCache.budget && fileCache.fileIndex.find( fileName ) == fileCache.fileIndex.end() )
+        {
+            trimCache( fileCache.budget - fileSize );
+
+            TS_FILE_DATA& entry = fileCache.fileList.emplace_front();
+            entry.fileName      = fileName;
+            entry.fileData      = fileData;
+            entry.fileState     = READ;
+            entry.fileSize      = fileSize;
+            entry.fileID        = fileCache.nextFileID++;
+            entry.fileTime      = fileTime;
+
+            fileCache.fileIndex[ fileName ] = fileCache.fileList.begin();
+            fileCache.stats.bytesCached += fileSize;
+        }
+    }
+
     return result;
 }
 
@@ -95,9 +189,13 @@ bool FileManager::OpenFile( const std::string& fileName, std::vector<uint8_t>& f
     @return     bool - True if the file was saved successfully
 
   --------------------------------------------------------------------------*/
-bool FileManager::SaveFile( const std::string& fileName, std::vector<uint8_t>& fileData )
+bool FileManager::SaveFile( const std::string& fileName, const std::vector<uint8_t>& fileData )
 {
-    bool result = false;
+    bool        result = false;
+    ScopedTimer timer( MetricStage::FileWrite );
+
+    // the cached copy is out of date whatever happens
+    invalidateFile( fileName );
 
     // Open the file
     std::ofstream file( fileName, std::ios::binary );
@@ -105,11 +203,12 @@ bool FileManager::SaveFile( const std::string& fileName, std::vector<uint8_t>& f
     if ( file.is_open() )
     {
         // Write the file into memory
-        file.write( reinterpret_cast<char*>( fileData.data() ), fileData.size() );
+        file.write( reinterpret_cast<const char*>( fileData.data() ), fileData.size() );
 
         // Close the file
         file.close();
 
+        Metrics::getInstance().addCount( MetricCounter::BytesOut, fileData.size() );
         result = true;
     }
 
@@ -127,6 +226,7 @@ bool FileManager::SaveFile( const std::string& fileName, std::vector<uint8_t>& f
 uint32_t FileManager::listAllFiles( const std::string& pathName )
 {
     // List all files in the directory
+    ScopedTimer              timer( MetricStage::DirectoryWalk );
     std::string              path = pathName;
     std::vector<std::string> directorys;
 
@@ -171,6 +271,320 @@ std::string FileManager::processFileList( uint32_t fileIndex )
         return "ERROR";
 }
 
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBFile AmigaGfx Library File Module
+    @brief      Walks a directory tree, pushing each file that matches the
+                filters into the output channel as soon as it is found.
+                The channel is closed when the walk has finished, so the
+                caller must keep taking from it (normally on another
+                thread) or the walk will wait once the channel is full.
+
+    @param      pathName - Full path to the directory
+    @param      filters - File name filters, see matchesFilter()
+    @param      output - Channel receiving the full path of each match
+    @param      threadCount - Threads listing directories, 0 uses one per
+                hardware thread
+    @return     uint32_t - Number of files matched
+
+  --------------------------------------------------------------------------*/
+uint32_t FileManager::walkFiles( const std::string& pathName, const std::vector<std::string>& filters, Channel<std::string>& output, uint32_t threadCount )
+{
+    ScopedTimer           timer( MetricStage::DirectoryWalk );
+    std::atomic<uint32_t> matched = 0;
+
+    {
+        ThreadPool walkers( threadCount );
+
+        walkers.submit( [ this, &pathName, &filters, &output, &walkers, &matched ]() { walkDirectory( pathName, filters, output, walkers, matched ); } );
+        walkers.wait();
+    }
+
+    output.close();
+
+    return matched;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBFile AmigaGfx Library File Module
+    @brief      Checks a file name against a list of filters. A filter
+                holding '*' or '?' is a glob matched against the name
+                without its path, any other filter is a file extension
+                such as ".png". Matching ignores case.
+
+    @param      fileName - File name, with or without its path
+    @param      filters - Filters to check, an empty list matches everything
+    @return     bool - True if any filter matches
+
+  --------------------------------------------------------------------------*/
+bool FileManager::matchesFilter( const std::string& fileName, const std::vector<std::string>& filters )
+{
+    if ( filters.empty() )
+    {
+        return true;
+    }
+
+    size_t      slash    = fileName.find_last_of( "/\\" );
+    std::string baseName = slash == std::string::npos ? fileName : fileName.substr( slash + 1 );
+
+    auto sameChar = []( char a, char b ) { return std::tolower( (unsigned char)a ) == std::tolower( (unsigned char)b ); };
+
+    for ( const std::string& filter : filters )
+    {
+        if ( filter.find_first_of( "*?" ) == std::string::npos )
+        {
+            // extension filter
+            if ( baseName.size() >= filter.size() &&
+                 std::equal( filter.begin(), filter.end(), baseName.end() - filter.size(), sameChar ) )
+            {
+                return true;
+            }
+            continue;
+        }
+
+        // glob filter, '*' backtracks to the last star seen
+        size_t name = 0, glob = 0, starGlob = std::string::npos, starName = 0;
+
+        while ( name < baseName.size() )
+        {
+            if ( glob < filter.size() && ( filter[ glob ] == '?' || sameChar( filter[ glob ], baseName[ name ] ) ) )
+            {
+                name++;
+                glob++;
+            }
+            else if ( glob < filter.size() && filter[ glob ] == '*' )
+            {
+                starGlob = glob++;
+                starName = name;
+            }
+            else if ( starGlob != std::string::npos )
+            {
+                glob = starGlob + 1;
+                name = ++starName;
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        while ( glob < filter.size() && filter[ glob ] == '*' )
+        {
+            glob++;
+        }
+
+        if ( name == baseName.size() && glob == filter.size() )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBFile AmigaGfx Library File Module
+    @brief      Turns the cache on or off for reads through this FileManager,
+                the shared cache and other FileManagers are not affected
+
+    @param      enable - False, OpenFile() always reads from disk and keeps
+                nothing
+
+  --------------------------------------------------------------------------*/
+void FileManager::setCaching( bool enable )
+{
+    bCaching = enable;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBFile AmigaGfx Library File Module
+    @brief      Sets the most bytes the shared file cache may hold, the least
+                recently used files are dropped to fit
+
+    @param      budgetBytes - Cache size in bytes, 0 disables the cache
+
+  --------------------------------------------------------------------------*/
+void FileManager::setCacheBudget( uint64_t budgetBytes )
+{
+    std::lock_guard<std::mutex> guard( fileCache.lock );
+
+    fileCache.budget = budgetBytes;
+    trimCache( fileCache.budget );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBFile AmigaGfx Library File Module
+    @brief      Drops a file from the cache, the next OpenFile() reads it
+                from disk
+
+    @param      fileName - Full path and file name, as given to OpenFile()
+
+  --------------------------------------------------------------------------*/
+void FileManager::invalidateFile( const std::string& fileName )
+{
+    std::lock_guard<std::mutex> guard( fileCache.lock );
+    auto                        cached = fileCache.fileIndex.find( fileName );
+
+    if ( cached != fileCache.fileIndex.end() )
+    {
+        fileCache.stats.bytesCached -= cached->second->fileData.size();
+        fileCache.fileList.erase( cached->second );
+        fileCache.fileIndex.erase( cached );
+    }
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBFile AmigaGfx Library File Module
+    @brief      Drops every file from the cache, the statistics are kept
+
+  --------------------------------------------------------------------------*/
+void FileManager::clearCache()
+{
+    std::lock_guard<std::mutex> guard( fileCache.lock );
+
+    fileCache.fileList.clear();
+    fileCache.fileIndex.clear();
+    fileCache.stats.bytesCached = 0;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBFile AmigaGfx Library File Module
+    @brief      Gets the cache hit, miss and size statistics
+
+    @return     TS_FILE_CACHE_STATS - Statistics
+
+  --------------------------------------------------------------------------*/
+TS_FILE_CACHE_STATS FileManager::getCacheStatistics()
+{
+    std::lock_guard<std::mutex> guard( fileCache.lock );
+    TS_FILE_CACHE_STATS         stats = fileCache.stats;
+
+    stats.filesCached = (uint32_t)fileCache.fileList.size();
+    return stats;
+}
+
+// Private Functions ----------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBFile AmigaGfx Library File Module
+    @brief      Drops the least recently used files until the cache holds
+                no more than the given bytes, the cache lock must be held
+
+    @param      budgetBytes - Bytes the cache may hold afterwards
+
+  --------------------------------------------------------------------------*/
+void FileManager::trimCache( uint64_t budgetBytes )
+{
+    while ( fileCache.stats.bytesCached > budgetBytes && fileCache.fileList.empty() == false )
+    {
+        TS_FILE_DATA& oldest = fileCache.fileList.back();
+
+        fileCache.stats.bytesCached -= oldest.fileData.size();
+        fileCache.stats.cacheEvictions++;
+        fileCache.fileIndex.erase( oldest.fileName );
+        fileCache.fileList.pop_back();
+    }
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBFile AmigaGfx Library File Module
+    @brief      The process wide file cache, made on first use
+
+    @return     FileCache& - Cache shared by every FileManager
+
+  --------------------------------------------------------------------------*/
+FileManager::FileCache& FileManager::SharedCache()
+{
+    static FileCache cache; // Created only once
+    return cache;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBFile AmigaGfx Library File Module
+    @brief      Lists one directory for walkFiles(), sub directories are
+                submitted to the walkers as new tasks
+
+    @param      pathName - Directory to list
+    @param      filters - File name filters
+    @param      output - Channel receiving the matching files
+    @param      walkers - Pool running the walk
+    @param      matched - Count of files matched
+
+  --------------------------------------------------------------------------*/
+void FileManager::walkDirectory( const std::string& pathName, const std::vector<std::string>& filters, Channel<std::string>& output, ThreadPool& walkers, std::atomic<uint32_t>& matched )
+{
+    auto addEntry = [ & ]( const std::string& entryPath, bool isDirectory )
+    {
+        if ( isDirectory )
+        {
+            walkers.submit( [ this, entryPath, &filters, &output, &walkers, &matched ]() { walkDirectory( entryPath, filters, output, walkers, matched ); } );
+        }
+        else if ( matchesFilter( entryPath, filters ) )
+        {
+            output.push( entryPath );
+            matched++;
+        }
+    };
+
+#if defined( _WIN32 )
+    // the Windows directory iterator already caches the entry type
+    std::error_code error;
+
+    for ( const auto& entry : std::filesystem::directory_iterator( pathName, error ) )
+    {
+        // links to directories are not followed, one back up the tree would never end
+        if ( entry.is_symlink( error ) && entry.is_directory( error ) )
+        {
+            continue;
+        }
+        addEntry( entry.path().string(), entry.is_directory( error ) );
+    }
+#else
+    DIR* directory = opendir( pathName.c_str() );
+
+    if ( directory == nullptr )
+    {
+        return;
+    }
+
+    std::string prefix = pathName;
+
+    if ( prefix.empty() == false && prefix.back() != '/' )
+    {
+        prefix += '/';
+    }
+
+    while ( struct dirent* entry = readdir( directory ) )
+    {
+        if ( strcmp( entry->d_name, "." ) == 0 || strcmp( entry->d_name, ".." ) == 0 )
+        {
+            continue;
+        }
+
+        std::string entryPath   = prefix + entry->d_name;
+        bool        isDirectory = entry->d_type == DT_DIR;
+
+        // the file system did not give the type, or it is a link, so stat it
+        if ( entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK )
+        {
+            struct stat info;
+            bool        bLink = entry->d_type == DT_LNK || ( lstat( entryPath.c_str(), &info ) == 0 && S_ISLNK( info.st_mode ) );
+
+            isDirectory = stat( entryPath.c_str(), &info ) == 0 && S_ISDIR( info.st_mode );
+
+            // links to directories are not followed, one back up the tree would never end
+            if ( bLink && isDirectory )
+            {
+                continue;
+            }
+        }
+
+        addEntry( entryPath, isDirectory );
+    }
+
+    closedir( directory );
+#endif
+}
+
 //-----------------------------------------------------------------------------
 
 } // namespace AmigaGfx
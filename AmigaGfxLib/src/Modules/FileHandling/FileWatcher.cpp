@@ -0,0 +1,328 @@
+/**----------------------------------------------------------------------------
+
+    @file       FileWatcher.cpp
+    @defgroup   AmigaGfxLIBFile AmigaGfx Library File Module
+    @brief      Directory change watcher (Linux inotify)
+    @copyright  Neil Bereford 2024
+
+Notes:
+
+    Every directory of a watched tree gets an inotify watch, directories
+    created (or moved in) later are added as their events arrive, and any
+    files already inside them are reported as changed, since they may have
+    been written before the watch existed.
+
+    Only IN_CLOSE_WRITE and IN_MOVED_TO are treated as changes, so a file
+    is reported once the writer has finished with it rather than on every
+    write(). Editors that save through a temporary file and rename it are
+    caught by IN_MOVED_TO.
+
+    waitForChanges() debounces: after the first event it keeps reading
+    until no event has arrived for debounceMs, then returns the changed
+    files once each, in sorted order. If the kernel queue overflows the
+    Overflow status is returned and the caller should rescan.
+
+    On other platforms addWatch() reports FileWatcher_NotSupported.
+
+-----------------------------------------------------------------------------*/
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+
+#if defined( __linux__ )
+#include <cerrno>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "../../../inc/Modules/FileHandling/FileWatcher.h"
+#include "../../../inc/Modules/FileHandling/FileManager.h"
+#include "../../../inc/Modules/ErrorHandling/ErrorHandler.h"
+
+//-----------------------------------------------------------------------------
+// Namesapce
+//-----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Class Support Functions
+//-----------------------------------------------------------------------------
+
+// Constructors and Destructors -----------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBFile AmigaGfx Library File Module
+    @brief      Constructor for the FileWatcher class
+
+  --------------------------------------------------------------------------*/
+FileWatcher::FileWatcher()
+{
+    overflowed = false;
+#if defined( __linux__ )
+    watchHandle = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+#else
+    watchHandle = -1;
+#endif
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBFile AmigaGfx Library File Module
+    @brief      Destructor for the FileWatcher class, removes all watches
+
+  --------------------------------------------------------------------------*/
+FileWatcher::~FileWatcher()
+{
+#if defined( __linux__ )
+    if ( watchHandle >= 0 )
+    {
+        close( watchHandle );
+    }
+#endif
+}
+
+// Public Functions ----------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBFile AmigaGfx Library File Module
+    @brief      Watches a directory and all of its sub directories
+
+    @param      pathName - Directory to watch
+    @return     bool - True if the watch was added
+
+  --------------------------------------------------------------------------*/
+bool FileWatcher::addWatch( const std::string& pathName )
+{
+    if ( watchHandle < 0 )
+    {
+        ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::FileWatcher_NotSupported, "File watching is not available: " + pathName );
+        return false;
+    }
+
+    return addDirectory( pathName );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBFile AmigaGfx Library File Module
+    @brief      Waits for files to change in the watched directories. Once
+                a change arrives, events are gathered until none has been
+                seen for debounceMs, so a burst of saves gives one result.
+
+    @param      changed - Receives the changed files, once each
+    @param      filters - File name filters, see FileManager::matchesFilter()
+    @param      debounceMs - Quiet time that ends a burst of events
+    @param      timeoutMs - Longest wait for the first change, -1 waits
+                forever
+    @return     WatchStatus - Changed, Timeout, Overflow, Interrupted or
+                Failed
+
+  --------------------------------------------------------------------------*/
+WatchStatus FileWatcher::waitForChanges( std::vector<std::string>& changed, const std::vector<std::string>& filters, uint32_t debounceMs, int32_t timeoutMs )
+{
+    changed.clear();
+
+#if defined( __linux__ )
+    if ( watchHandle < 0 )
+    {
+        return WatchStatus::Failed;
+    }
+
+    auto          deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds( timeoutMs );
+    struct pollfd watch    = { watchHandle, POLLIN, 0 };
+
+    overflowed = false;
+
+    // wait for the first matching change, events for other files are skipped
+    while ( changed.empty() && overflowed == false )
+    {
+        int32_t waitMs = timeoutMs;
+
+        if ( timeoutMs >= 0 )
+        {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>( deadline - std::chrono::steady_clock::now() );
+            waitMs         = (int32_t)std::max<int64_t>( 0, remaining.count() );
+        }
+
+        int ready = poll( &watch, 1, waitMs );
+
+        if ( ready == 0 )
+        {
+            return WatchStatus::Timeout;
+        }
+        if ( ready < 0 )
+        {
+            return errno == EINTR ? WatchStatus::Interrupted : WatchStatus::Failed;
+        }
+
+        readEvents( changed, filters );
+    }
+
+    // debounce, keep gathering until the directories go quiet
+    while ( poll( &watch, 1, (int)debounceMs ) > 0 )
+    {
+        readEvents( changed, filters );
+    }
+
+    std::sort( changed.begin(), changed.end() );
+    changed.erase( std::unique( changed.begin(), changed.end() ), changed.end() );
+
+    if ( overflowed )
+    {
+        ErrorHandler::getInstance().handleError( ErrorType::Warning, LibraryError::FileWatcher_EventsOverflowed, "File change events lost, rescan needed" );
+        return WatchStatus::Overflow;
+    }
+
+    return WatchStatus::Changed;
+#else
+    return WatchStatus::Failed;
+#endif
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBFile AmigaGfx Library File Module
+    @brief      Number of directories being watched
+
+    @return     uint32_t - Watch count
+
+  --------------------------------------------------------------------------*/
+uint32_t FileWatcher::getWatchCount() const
+{
+    return (uint32_t)watchPaths.size();
+}
+
+// Private Functions ----------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBFile AmigaGfx Library File Module
+    @brief      Adds a watch to a directory and its sub directories
+
+    @param      pathName - Directory to watch
+    @return     bool - True if the directory itself was watched
+
+  --------------------------------------------------------------------------*/
+bool FileWatcher::addDirectory( const std::string& pathName )
+{
+#if defined( __linux__ )
+    int watch = inotify_add_watch( watchHandle, pathName.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ONLYDIR );
+
+    if ( watch < 0 )
+    {
+        ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::FileWatcher_FailedToWatch, "Failed to watch " + pathName );
+        return false;
+    }
+
+    watchPaths[ watch ] = pathName;
+
+    std::error_code error;
+
+    for ( const auto& entry : std::filesystem::directory_iterator( pathName, error ) )
+    {
+        if ( entry.is_directory( error ) && entry.is_symlink( error ) == false )
+        {
+            addDirectory( entry.path().string() );
+        }
+    }
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBFile AmigaGfx Library File Module
+    @brief      Reads the waiting inotify events
+
+    @param      changed - Changed files are added to this list
+    @param      filters - File name filters
+    @return     bool - True if any events were read
+
+  --------------------------------------------------------------------------*/
+bool FileWatcher::readEvents( std::vector<std::string>& changed, const std::vector<std::string>& filters )
+{
+#if defined( __linux__ )
+    alignas( struct inotify_event ) char buffer[ 16 * 1024 ];
+    bool                                 eventsRead = false;
+    ssize_t                              length;
+
+    while ( ( length = read( watchHandle, buffer, sizeof( buffer ) ) ) > 0 )
+    {
+        eventsRead = true;
+
+        for ( char* pEvent = buffer; pEvent < buffer + length; )
+        {
+            const struct inotify_event* event = (const struct inotify_event*)pEvent;
+            pEvent += sizeof( struct inotify_event ) + event->len;
+
+            if ( event->mask & IN_Q_OVERFLOW )
+            {
+                overflowed = true;
+                continue;
+            }
+
+            auto watchPath = watchPaths.find( event->wd );
+
+            if ( event->mask & IN_IGNORED )
+            {
+                if ( watchPath != watchPaths.end() )
+                {
+                    watchPaths.erase( watchPath );
+                }
+                continue;
+            }
+
+            if ( watchPath == watchPaths.end() || event->len == 0 )
+            {
+                continue;
+            }
+
+            std::string path = watchPath->second;
+
+            if ( path.empty() == false && path.back() != '/' )
+            {
+                path += '/';
+            }
+            path += event->name;
+
+            if ( event->mask & IN_ISDIR )
+            {
+                // new directory, watch it and pick up anything already in it
+                if ( addDirectory( path ) )
+                {
+                    std::error_code error;
+
+                    for ( const auto& entry : std::filesystem::recursive_directory_iterator( path, error ) )
+                    {
+                        if ( entry.is_regular_file( error ) && FileManager::matchesFilter( entry.path().string(), filters ) )
+                        {
+                            changed.push_back( entry.path().string() );
+                        }
+                    }
+                }
+            }
+            else if ( ( event->mask & ( IN_CLOSE_WRITE | IN_MOVED_TO ) ) && FileManager::matchesFilter( path, filters ) )
+            {
+                changed.push_back( path );
+            }
+        }
+    }
+
+    return eventsRead;
+#else
+    return false;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+
+} // namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: FileWatcher.cpp
+//-----------------------------------------------------------------------------
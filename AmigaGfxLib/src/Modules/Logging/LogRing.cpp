@@ -0,0 +1,151 @@
+/**----------------------------------------------------------------------------
+
+    @file       LogRing.cpp
+    @defgroup   AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Lock free ring of fixed size log records
+    @copyright  Neil Bereford 2024
+
+Notes:
+
+    Bounded ring buffer based on the per slot sequence number scheme.
+    Producers claim a slot by advancing enqueuePos with a compare and swap,
+    fill in the record and then publish it by bumping the slot sequence.
+    The single consumer (the logger writer thread) reads published slots
+    in order and hands them back to the producers one lap later.
+
+    No locks are taken, so a push from a worker thread never waits on the
+    writer thread. When the ring is full push() fails and the caller
+    decides whether to drop the record or retry.
+
+-----------------------------------------------------------------------------*/
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+
+#include <bit>
+#include "../../../inc/Modules/Logging/LogRing.h"
+
+//-----------------------------------------------------------------------------
+// Namespace
+//-----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Class Support Functions
+//-----------------------------------------------------------------------------
+
+// Constructors and Destructors -----------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Constructor for the LogRing class
+    @param      capacity - Number of records, rounded up to a power of two
+  --------------------------------------------------------------------------*/
+LogRing::LogRing( uint32_t capacity )
+{
+    size_t size = std::bit_ceil( capacity < 2 ? 2u : capacity );
+
+    cells       = std::make_unique<Cell[]>( size );
+    mask        = size - 1;
+
+    for ( size_t nIndex = 0; nIndex < size; nIndex++ )
+    {
+        cells[ nIndex ].sequence.store( nIndex, std::memory_order_relaxed );
+    }
+
+    enqueuePos.store( 0, std::memory_order_relaxed );
+    dequeuePos.store( 0, std::memory_order_relaxed );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Destructor for the LogRing class
+
+  --------------------------------------------------------------------------*/
+LogRing::~LogRing()
+{
+}
+
+// Public Functions ----------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Adds a record to the ring, safe to call from any thread
+    @param      record - Record to copy into the ring
+    @return     bool - False if the ring is full
+  --------------------------------------------------------------------------*/
+bool LogRing::push( const LogRecord& record )
+{
+    size_t pos = enqueuePos.load( std::memory_order_relaxed );
+
+    for ( ;; )
+    {
+        Cell&     cell = cells[ pos & mask ];
+        size_t    seq  = cell.sequence.load( std::memory_order_acquire );
+        ptrdiff_t diff = (ptrdiff_t)seq - (ptrdiff_t)pos;
+
+        if ( diff == 0 )
+        {
+            if ( enqueuePos.compare_exchange_weak( pos, pos + 1 ) )
+            {
+                cell.record = record;
+                cell.sequence.store( pos + 1, std::memory_order_release );
+                return true;
+            }
+        }
+        else if ( diff < 0 )
+        {
+            // ring is full
+            return false;
+        }
+        else
+        {
+            pos = enqueuePos.load( std::memory_order_relaxed );
+        }
+    }
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Removes the oldest record from the ring, consumer thread only
+    @param      record - Receives the record
+    @return     bool - False if no published record is available
+  --------------------------------------------------------------------------*/
+bool LogRing::pop( LogRecord& record )
+{
+    size_t    pos  = dequeuePos.load( std::memory_order_relaxed );
+    Cell&     cell = cells[ pos & mask ];
+    size_t    seq  = cell.sequence.load( std::memory_order_acquire );
+    ptrdiff_t diff = (ptrdiff_t)seq - (ptrdiff_t)( pos + 1 );
+
+    if ( diff < 0 )
+    {
+        return false;
+    }
+
+    record = cell.record;
+    cell.sequence.store( pos + mask + 1, std::memory_order_release );
+    dequeuePos.store( pos + 1 );
+
+    return true;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Checks if any record has been claimed but not yet popped
+    @return     bool - True if the ring is empty
+  --------------------------------------------------------------------------*/
+bool LogRing::empty() const
+{
+    return enqueuePos.load() == dequeuePos.load();
+}
+
+//-----------------------------------------------------------------------------
+
+} // namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: LogRing.cpp
+//-----------------------------------------------------------------------------
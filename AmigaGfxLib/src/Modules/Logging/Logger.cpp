@@ -18,14 +18,38 @@ Notes:
     - LogMessage()
     - LogError()
 
-    TODO: Add the ability to log to a file
-    TODO: Switch different output methods on and off
+    Logging is asynchronous. The calling thread only stamps the time and
+    copies the message into a fixed size LogRecord, which is pushed into
+    a lock free ring (LogRing). A writer thread, started by
+    loggerInitialize(), pops the records, formats them and writes them in
+    batches to the terminal and/or the log file. Text longer than the
+    record holds is cut, and the message is written with "..." after it.
+
+    Memory use is bounded: the ring holds LOG_RING_SIZE records and only
+    the last LOG_HISTORY_SIZE formatted messages are kept for saveLog().
+    When the ring is full the overflow policy decides if the message is
+    dropped (default, counted and reported by the writer) or if the
+    caller waits for room. flushLog() waits until everything submitted
+    so far has been written.
+
+    Each message has a LogLevel. Use the AGL_LOG_xxx macros for debug and
+    trace output: levels below AGL_LOG_MIN_LEVEL (set by the build, or per
+    source file with AGL_LOG_FILE_LEVEL) are removed at compile time along
+    with their arguments. The rest are checked against the runtime level
+    set by setLogLevel(). The macros store the format string pointer and
+    the raw argument values, formatting only happens in the writer thread.
 
 -----------------------------------------------------------------------------*/
 //-----------------------------------------------------------------------------
 // Includes
 //-----------------------------------------------------------------------------
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
 #include "../../../inc/Modules/ErrorHandling/ErrorHandler.h"
 #include "../../../inc/Modules/Logging/Logger.h"
 
@@ -47,32 +71,78 @@ namespace AmigaGfx
     @brief      Constructor for the Logger class
 
   --------------------------------------------------------------------------*/
-Logger::Logger()
+Logger::Logger() : logRing( LOG_RING_SIZE )
 {
     outputFile        = false;
     outputTerminal    = false;
     loggerInitialized = false;
+    writerRunning     = false;
+    writerSleeping    = false;
+    wakeSignal        = 0;
+    submittedCount    = 0;
+    writtenCount      = 0;
+    droppedCount      = 0;
+    overflowPolicy    = LogOverflow::Drop;
+    logLevel          = LogLevel::Info;
 }
 
 /**---------------------------------------------------------------------------
     @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
-    @brief      Destructor for the Logger class
+    @brief      Destructor for the Logger class, outstanding messages are
+                written before the writer thread is stopped
 
   --------------------------------------------------------------------------*/
 Logger::~Logger()
 {
+    loggerShutdown();
 }
 
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Initializes the logger and starts the writer thread
+
+  --------------------------------------------------------------------------*/
 void Logger::loggerInitialize()
 {
+    if ( loggerInitialized )
+    {
+        return;
+    }
+
     // defaulted to terminal output
     outputFile     = false;
     outputTerminal = true;
 
+    // start the writer thread
+    writerRunning  = true;
+    writer         = std::thread( &Logger::writerThread, this );
+
     // set the logger as initialized
     loggerInitialized = true;
 }
 
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Stops the writer thread once the ring has been drained
+
+  --------------------------------------------------------------------------*/
+void Logger::loggerShutdown()
+{
+    if ( writer.joinable() )
+    {
+        writerRunning = false;
+        wakeWriter();
+        writer.join();
+    }
+
+    std::lock_guard<std::mutex> lock( outputLock );
+    if ( logFile.is_open() )
+    {
+        logFile.close();
+    }
+    loggerInitialized = false;
+}
+
 /**---------------------------------------------------------------------------
     @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
     @brief      Log a message to the log file
@@ -80,63 +150,461 @@ void Logger::loggerInitialize()
     @return     LibraryError - Error code
   --------------------------------------------------------------------------*/
 LibraryError Logger::LogMessage( const std::string& message )
+{
+    return pushRecord( LogLevel::Info, LibraryError::No_Error, message );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Log a message to the log file
+    @param      error	   Error code
+    @param      message     Message to log
+    @return     LibraryError - Error code
+  --------------------------------------------------------------------------*/
+LibraryError Logger::LogError( LibraryError error, const std::string& message )
+{
+    return pushRecord( LogLevel::Error, error, message );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Sets the runtime log level, messages below it are ignored
+    @param      level - Lowest level to log
+  --------------------------------------------------------------------------*/
+void Logger::setLogLevel( LogLevel level )
+{
+    logLevel = level;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Returns the runtime log level
+    @return     LogLevel - Lowest level logged
+  --------------------------------------------------------------------------*/
+LogLevel Logger::getLogLevel() const
+{
+    return logLevel;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Enables or disables output to the terminal
+    @param      enable - True to display messages on stdout
+  --------------------------------------------------------------------------*/
+void Logger::setOutputTerminal( bool enable )
+{
+    outputTerminal = enable;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Sets the log file, messages are appended to it as they are
+                written. An empty file name switches file output off.
+    @param      fileName - Log file to append to
+    @return     LibraryError - Error code
+  --------------------------------------------------------------------------*/
+LibraryError Logger::setOutputFile( const std::string& fileName )
+{
+    flushLog();
+
+    std::lock_guard<std::mutex> lock( outputLock );
+
+    if ( logFile.is_open() )
+    {
+        logFile.close();
+    }
+    outputFile = false;
+
+    if ( fileName.empty() )
+    {
+        return LibraryError::No_Error;
+    }
+
+    logFile.open( fileName, std::ios::out | std::ios::app );
+    if ( !logFile.is_open() )
+    {
+        return LibraryError::Logger_FailedToOpenFile;
+    }
+
+    outputFile = true;
+    return LibraryError::No_Error;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Sets what happens to messages when the log ring is full
+    @param      policy - Drop or Block
+  --------------------------------------------------------------------------*/
+void Logger::setOverflowPolicy( LogOverflow policy )
+{
+    overflowPolicy = policy;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Waits until all messages logged so far have been written
+
+  --------------------------------------------------------------------------*/
+void Logger::flushLog()
 {
     if ( loggerInitialized == false )
     {
-        return LibraryError::Logger_InitializeNotCalled;
+        return;
     }
 
-    std::time_t       t  = std::chrono::system_clock::to_time_t( std::chrono::system_clock::now() );
-    std::tm*          tm = std::localtime( &t );
-    std::stringstream ss;
+    uint64_t target  = submittedCount.load();
+    uint64_t written = writtenCount.load();
 
-    // build the logged message
-    ss << "[" << std::put_time( tm, "%d-%m-%Y %H-%M-%S" ) << "] - " << message << std::endl;
+    while ( written < target )
+    {
+        wakeWriter();
+        writtenCount.wait( written );
+        written = writtenCount.load();
+    }
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Returns the number of messages dropped due to a full ring
+    @return     uint64_t - Dropped message count
+  --------------------------------------------------------------------------*/
+uint64_t Logger::getDroppedCount() const
+{
+    return droppedCount.load();
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Clears the stored log messages
+
+  --------------------------------------------------------------------------*/
+void Logger::clearLog()
+{
+    flushLog();
+
+    std::lock_guard<std::mutex> lock( outputLock );
+    loggedInformation.clear();
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Saves the stored log messages to disk
+    @param      fileName - File to write the messages to
+    @return     LibraryError - Error code
+  --------------------------------------------------------------------------*/
+LibraryError Logger::saveLog( const std::string& fileName )
+{
+    flushLog();
 
-    // Add the message to the log
-    loggedInformation.push_back( ss.str() );
+    std::lock_guard<std::mutex> lock( outputLock );
+    std::ofstream               file( fileName );
+
+    if ( !file.is_open() )
+    {
+        return LibraryError::Logger_FailedToOpenFile;
+    }
 
-    // Output to the terminal if required
-    if ( outputTerminal )
+    for ( auto& line : loggedInformation )
     {
-        std::cout << ss.str();
+        file << line;
     }
 
     return LibraryError::No_Error;
 }
 
+// Private Functions ---------------------------------------------------------
+
 /**---------------------------------------------------------------------------
     @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
-    @brief      Log a message to the log file
-    @param      error	   Error code
+    @brief      Builds a log record for a plain text message on the calling
+                thread and pushes it to the writer thread
+    @param      level	   Severity of the message
+    @param      error	   Error code, No_Error for plain messages
     @param      message     Message to log
     @return     LibraryError - Error code
   --------------------------------------------------------------------------*/
-LibraryError Logger::LogError( LibraryError error, const std::string& message )
+LibraryError Logger::pushRecord( LogLevel level, LibraryError error, const std::string& message )
 {
     if ( loggerInitialized == false )
     {
         return LibraryError::Logger_InitializeNotCalled;
     }
 
-    std::time_t       t  = std::chrono::system_clock::to_time_t( std::chrono::system_clock::now() );
+    if ( isLogLevelEnabled( level ) == false )
+    {
+        return LibraryError::No_Error;
+    }
+
+    LogRecord record;
+    record.level      = level;
+    record.error      = error;
+    record.format     = nullptr;
+    record.argCount   = 0;
+    record.length     = (uint16_t)std::min<size_t>( message.size(), LOG_RECORD_TEXT_SIZE );
+    record.bTruncated = record.length < message.size();
+    std::memcpy( record.text, message.data(), record.length );
+
+    return submitRecord( record );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Time stamps the record and pushes it into the ring, applying
+                the overflow policy if the ring is full
+    @param      record - Record to submit
+    @return     LibraryError - Error code
+  --------------------------------------------------------------------------*/
+LibraryError Logger::submitRecord( LogRecord& record )
+{
+    record.time = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::system_clock::now().time_since_epoch() ).count();
+
+    while ( logRing.push( record ) == false )
+    {
+        if ( overflowPolicy == LogOverflow::Drop )
+        {
+            droppedCount++;
+            return LibraryError::Logger_MessageDropped;
+        }
+
+        wakeWriter();
+        std::this_thread::yield();
+    }
+
+    submittedCount++;
+
+    if ( writerSleeping )
+    {
+        wakeWriter();
+    }
+
+    return LibraryError::No_Error;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Wakes the writer thread if it is waiting for records
+
+  --------------------------------------------------------------------------*/
+void Logger::wakeWriter()
+{
+    wakeSignal++;
+    wakeSignal.notify_one();
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Writer thread, pops records in batches, formats them and
+                writes them to the enabled outputs. Sleeps while the ring
+                is empty.
+
+  --------------------------------------------------------------------------*/
+void Logger::writerThread()
+{
+    LogRecord   record;
+    std::string batch;
+    uint64_t    droppedReported = 0;
+
+    for ( ;; )
+    {
+        uint32_t signal = wakeSignal.load();
+        uint32_t count  = 0;
+        size_t   lineStart;
+
+        batch.clear();
+
+        std::unique_lock<std::mutex> lock( outputLock );
+
+        while ( count < LOG_BATCH_SIZE && logRing.pop( record ) )
+        {
+            lineStart = batch.size();
+            formatRecord( record, batch );
+            loggedInformation.emplace_back( batch, lineStart );
+            count++;
+        }
+
+        // report any dropped messages once things have calmed down
+        uint64_t dropped = droppedCount.load();
+        if ( count < LOG_BATCH_SIZE && dropped != droppedReported )
+        {
+            record.time       = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::system_clock::now().time_since_epoch() ).count();
+            record.error      = LibraryError::Logger_MessageDropped;
+            record.level      = LogLevel::Warning;
+            record.format     = nullptr;
+            record.bTruncated = false;
+            record.length     = (uint16_t)std::snprintf( record.text, LOG_RECORD_TEXT_SIZE, "%llu messages dropped", (unsigned long long)( dropped - droppedReported ) );
+            lineStart         = batch.size();
+            formatRecord( record, batch );
+            loggedInformation.emplace_back( batch, lineStart );
+            droppedReported = dropped;
+        }
+
+        while ( loggedInformation.size() > LOG_HISTORY_SIZE )
+        {
+            loggedInformation.pop_front();
+        }
+
+        if ( batch.empty() == false )
+        {
+            if ( outputTerminal )
+            {
+                std::cout.write( batch.data(), batch.size() );
+                std::cout.flush();
+            }
+            if ( outputFile && logFile.is_open() )
+            {
+                logFile.write( batch.data(), batch.size() );
+                logFile.flush();
+            }
+        }
+
+        if ( count )
+        {
+            writtenCount += count;
+            writtenCount.notify_all();
+            continue;
+        }
+
+        // nothing to do, finish or sleep until woken
+        if ( writerRunning == false && logRing.empty() )
+        {
+            break;
+        }
+
+        lock.unlock();
+        writerSleeping = true;
+        if ( logRing.empty() && writerRunning )
+        {
+            wakeSignal.wait( signal );
+        }
+        writerSleeping = false;
+    }
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Formats a log record as a line of text
+    @param      record - Record to format
+    @param      output - String the formatted line is appended to
+  --------------------------------------------------------------------------*/
+void Logger::formatRecord( const LogRecord& record, std::string& output )
+{
+    std::time_t       t  = (std::time_t)( record.time / 1000 );
     std::tm*          tm = std::localtime( &t );
     std::stringstream ss;
 
     // build the logged message
-    ss << "[" << std::put_time( tm, "%d-%m-%Y %H-%M-%S" ) << "] - "
-       << "Error 0x" << std::hex << (uint32_t)error << std::dec << " - " << message << std::endl;
+    ss << "[" << std::put_time( tm, "%d-%m-%Y %H-%M-%S" ) << "] - ";
+    switch ( record.level )
+    {
+        case LogLevel::Trace:
+        {
+            ss << "Trace - ";
+            break;
+        }
+        case LogLevel::Debug:
+        {
+            ss << "Debug - ";
+            break;
+        }
+        case LogLevel::Warning:
+        {
+            ss << "Warning - ";
+            break;
+        }
+        case LogLevel::Critical:
+        {
+            ss << "Critical - ";
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+    if ( record.error != LibraryError::No_Error )
+    {
+        ss << "Error 0x" << std::hex << (uint32_t)record.error << std::dec << " - ";
+    }
+    if ( record.format )
+    {
+        formatArgs( record, ss );
+    }
+    else
+    {
+        ss.write( record.text, record.length );
+    }
+    if ( record.bTruncated )
+    {
+        ss << "...";
+    }
+    ss << std::endl;
+
+    output += ss.str();
+}
 
-    // Add the message to the log
-    loggedInformation.push_back( ss.str() );
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBLogger AmigaGfx Library Logger Module
+    @brief      Expands a deferred format string with the record arguments.
+                {} is replaced by the next argument, {:x} by the next
+                argument in hex, {{ and }} output a single brace.
+    @param      record - Record holding the format and arguments
+    @param      output - Stream the expanded text is written to
+  --------------------------------------------------------------------------*/
+void Logger::formatArgs( const LogRecord& record, std::ostream& output )
+{
+    uint32_t argIndex = 0;
 
-    // Output to the terminal if required
-    if ( outputTerminal )
+    for ( const char* pFormat = record.format; *pFormat; pFormat++ )
     {
-        std::cout << ss.str();
-    }
+        if ( ( pFormat[ 0 ] == '{' && pFormat[ 1 ] == '{' ) || ( pFormat[ 0 ] == '}' && pFormat[ 1 ] == '}' ) )
+        {
+            output << *pFormat++;
+            continue;
+        }
 
-    return LibraryError::No_Error;
+        const char* pEnd = ( *pFormat == '{' ) ? std::strchr( pFormat, '}' ) : nullptr;
+        if ( pEnd == nullptr )
+        {
+            output << *pFormat;
+            continue;
+        }
+
+        if ( argIndex < record.argCount )
+        {
+            const LogArg& arg = record.args[ argIndex++ ];
+            bool          hex = std::string_view( pFormat, pEnd - pFormat ) == "{:x";
+
+            if ( hex )
+            {
+                output << std::hex;
+            }
+            switch ( arg.type )
+            {
+                case LogArgType::Signed:
+                {
+                    output << arg.sValue;
+                    break;
+                }
+                case LogArgType::Unsigned:
+                {
+                    output << arg.uValue;
+                    break;
+                }
+                case LogArgType::Float:
+                {
+                    output << arg.fValue;
+                    break;
+                }
+                default:
+                {
+                    output.write( record.text + arg.text.offset, arg.text.length );
+                    break;
+                }
+            }
+            output << std::dec;
+        }
+        pFormat = pEnd;
+    }
 }
 
 //-----------------------------------------------------------------------------
@@ -0,0 +1,477 @@
+/**----------------------------------------------------------------------------
+
+    @file       AtlasPacker.cpp
+    @defgroup   AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Packs sprites onto shared atlas sheets
+
+    @copyright  Neil Bereford 2024
+
+Notes:
+
+    Each sheet keeps a skyline, the top edge of everything packed so far
+    as a list of spans. A sprite goes where its bottom edge ends up
+    highest on the sheet (lowest y + height), ties to the left, which
+    keeps the used part of each sheet compact. A skyline cannot use the
+    gaps left under overhanging sprites, but sorting tallest first keeps
+    those small, and it places each sprite in time proportional to the
+    skyline length rather than to the number of free rectangles.
+
+    Sheets stay open for the whole pack, a sprite goes on the first sheet
+    with room. Each sheet remembers the last size that did not fit, and
+    since sheets only fill up, anything at least that wide and tall skips
+    the sheet without searching it.
+
+    The lookup table (buildTable()) starts "ATLAS:count,sheets:" followed
+    by ten uint16 per sprite, in input order: sheet, index in the sheet's
+    sprite list, x, y, width, height, trim x, trim y and the original
+    width and height. A sheet larger than 65535 pixels has no table, a
+    field that does not fit is an error rather than wrapping.
+
+-----------------------------------------------------------------------------*/
+
+//-----------------------------------------------------------------------------
+// Include files
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+#include <string>
+
+#include "../../../inc/Modules/ErrorHandling/ErrorHandler.h"
+#include "../../../inc/Modules/Utilities/AtlasPacker.h"
+
+//-----------------------------------------------------------------------------
+// Namespace
+//-----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Class support functions
+// ----------------------------------------------------------------------------
+
+// Constructor and destructor  -------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Constructor for the AtlasPacker class
+    @param      config - Sheet size and packing settings
+  --------------------------------------------------------------------------*/
+AtlasPacker::AtlasPacker( const AtlasConfig& config )
+{
+    atlasConfig = config;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Destructor for the AtlasPacker class
+
+  --------------------------------------------------------------------------*/
+AtlasPacker::~AtlasPacker()
+{
+}
+
+// Public Functions ----------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Packs sprites of the given sizes onto sheets
+    @param      sprites - Sprite sizes, only width and height are used
+    @param      entries - Receives where each sprite was placed, in the
+                same order as sprites
+    @return     bool - False if a sprite is larger than a sheet, nothing is
+                packed
+  --------------------------------------------------------------------------*/
+bool AtlasPacker::pack( const std::vector<SpriteRect>& sprites, std::vector<AtlasEntry>& entries )
+{
+    sheets.clear();
+    entries.assign( sprites.size(), AtlasEntry{} );
+
+    for ( size_t nSprite = 0; nSprite < sprites.size(); nSprite++ )
+    {
+        if ( sprites[ nSprite ].width > atlasConfig.sheetWidth || sprites[ nSprite ].height > atlasConfig.sheetHeight )
+        {
+            ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::Atlas_SpriteTooLarge,
+                                                     "Sprite " + std::to_string( nSprite ) + " is larger than an atlas sheet" );
+            return false;
+        }
+    }
+
+    // tallest first, then widest, then input order, a total order so the
+    // result never depends on the sort
+    std::vector<uint32_t> order( sprites.size() );
+    std::iota( order.begin(), order.end(), 0 );
+    std::sort( order.begin(), order.end(), [ &sprites ]( uint32_t a, uint32_t b ) {
+        if ( sprites[ a ].height != sprites[ b ].height )
+        {
+            return sprites[ a ].height > sprites[ b ].height;
+        }
+        if ( sprites[ a ].width != sprites[ b ].width )
+        {
+            return sprites[ a ].width > sprites[ b ].width;
+        }
+        return a < b;
+    } );
+
+    for ( uint32_t nSprite : order )
+    {
+        AtlasEntry& entry = entries[ nSprite ];
+
+        entry.width        = sprites[ nSprite ].width;
+        entry.height       = sprites[ nSprite ].height;
+        entry.sourceWidth  = entry.width;
+        entry.sourceHeight = entry.height;
+
+        if ( sheets.empty() )
+        {
+            sheets.push_back( { { { 0, 0, atlasConfig.sheetWidth } }, 0, 0, 0, UINT32_MAX, UINT32_MAX } );
+        }
+
+        // empty sprites take no space, they sit at the top of the first sheet
+        if ( entry.width == 0 || entry.height == 0 )
+        {
+            continue;
+        }
+
+        // the padding goes right and below, and is dropped at the sheet edge
+        uint32_t width  = std::min( entry.width + atlasConfig.padding, atlasConfig.sheetWidth );
+        uint32_t height = std::min( entry.height + atlasConfig.padding, atlasConfig.sheetHeight );
+        uint32_t x      = 0;
+        uint32_t y      = 0;
+        size_t   node   = 0;
+        size_t   nSheet = 0;
+
+        for ( ; nSheet < sheets.size(); nSheet++ )
+        {
+            Sheet& sheet = sheets[ nSheet ];
+
+            if ( width >= sheet.failWidth && height >= sheet.failHeight )
+            {
+                continue;
+            }
+            if ( findPosition( sheet, width, height, x, y, node ) )
+            {
+                break;
+            }
+            sheet.failWidth  = width;
+            sheet.failHeight = height;
+        }
+
+        if ( nSheet == sheets.size() )
+        {
+            sheets.push_back( { { { 0, 0, atlasConfig.sheetWidth } }, 0, 0, 0, UINT32_MAX, UINT32_MAX } );
+            findPosition( sheets.back(), width, height, x, y, node );
+        }
+
+        placeRect( sheets[ nSheet ], node, x, y, width, height );
+        sheets[ nSheet ].usedArea += (uint64_t)entry.width * entry.height;
+        sheets[ nSheet ].usedHeight = std::max( sheets[ nSheet ].usedHeight, y + entry.height );
+
+        entry.sheet = (uint32_t)nSheet;
+        entry.x     = x;
+        entry.y     = y;
+    }
+
+    // number the sprites of each sheet in input order
+    for ( AtlasEntry& entry : entries )
+    {
+        entry.sheetIndex = sheets[ entry.sheet ].spriteCount++;
+    }
+
+    return true;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Trims and packs the sprites, then draws them onto the sheets
+    @param      sprites - Sprite pixels, colour index 0 is transparent
+    @param      sheetPixels - Receives the pixels of each sheet, sheetWidth wide
+                and cut to the rows used (see getSheetHeight())
+    @param      entries - Receives where each sprite was placed
+    @return     bool - False if a sprite is larger than a sheet
+  --------------------------------------------------------------------------*/
+bool AtlasPacker::build( const std::vector<ImageView<const uint8_t>>& sprites, std::vector<std::vector<uint8_t>>& sheetPixels, std::vector<AtlasEntry>& entries )
+{
+    std::vector<SpriteRect> trimmed( sprites.size() );
+
+    for ( size_t nSprite = 0; nSprite < sprites.size(); nSprite++ )
+    {
+        const ImageView<const uint8_t>& sprite = sprites[ nSprite ];
+
+        trimmed[ nSprite ] = atlasConfig.trim ? TrimSprite( sprite ) : SpriteRect{ 0, 0, sprite.getWidth(), sprite.getHeight(), 0 };
+    }
+
+    if ( pack( trimmed, entries ) == false )
+    {
+        sheetPixels.clear();
+        return false;
+    }
+
+    sheetPixels.resize( sheets.size() );
+    for ( size_t nSheet = 0; nSheet < sheets.size(); nSheet++ )
+    {
+        sheetPixels[ nSheet ].assign( (size_t)atlasConfig.sheetWidth * sheets[ nSheet ].usedHeight, 0 );
+    }
+
+    for ( size_t nSprite = 0; nSprite < sprites.size(); nSprite++ )
+    {
+        AtlasEntry& entry = entries[ nSprite ];
+
+        entry.trimX        = trimmed[ nSprite ].x;
+        entry.trimY        = trimmed[ nSprite ].y;
+        entry.sourceWidth  = sprites[ nSprite ].getWidth();
+        entry.sourceHeight = sprites[ nSprite ].getHeight();
+
+        ImageView<const uint8_t> source = sprites[ nSprite ].subView( entry.trimX, entry.trimY, entry.width, entry.height );
+        ImageView<uint8_t>       target( sheetPixels[ entry.sheet ].data(), atlasConfig.sheetWidth, sheets[ entry.sheet ].usedHeight );
+
+        for ( uint32_t y = 0; y < entry.height; y++ )
+        {
+            memcpy( target.getRow( entry.y + y ) + entry.x, source.getRow( y ), entry.width );
+        }
+    }
+
+    return true;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Builds the lookup table file for packed sprites
+    @param      entries - Placements from pack() or build()
+    @param      tableFile - Receives the table file data
+    @return     bool - False if a field is over 65535, the table is empty
+  --------------------------------------------------------------------------*/
+bool AtlasPacker::buildTable( const std::vector<AtlasEntry>& entries, std::vector<uint8_t>& tableFile ) const
+{
+    char   header[ 64 ];
+    size_t headerLen = snprintf( header, sizeof( header ), "ATLAS:%u,%u:", (uint32_t)entries.size(), (uint32_t)sheets.size() );
+
+    for ( size_t nEntry = 0; nEntry < entries.size(); nEntry++ )
+    {
+        const AtlasEntry& entry = entries[ nEntry ];
+
+        if ( std::max( { entry.sheet, entry.sheetIndex, entry.x, entry.y, entry.width, entry.height, entry.trimX, entry.trimY, entry.sourceWidth, entry.sourceHeight } ) > UINT16_MAX )
+        {
+            ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::SpriteList_OutOfRange,
+                                                     "Atlas entry " + std::to_string( nEntry ) + " has a position or size over 65535" );
+            tableFile.clear();
+            return false;
+        }
+    }
+
+    tableFile.resize( headerLen + entries.size() * 10 * sizeof( uint16_t ) );
+    memcpy( tableFile.data(), header, headerLen );
+
+    uint8_t* pOut = tableFile.data() + headerLen;
+
+    for ( const AtlasEntry& entry : entries )
+    {
+        uint16_t fields[ 10 ] = { (uint16_t)entry.sheet, (uint16_t)entry.sheetIndex, (uint16_t)entry.x,     (uint16_t)entry.y,     (uint16_t)entry.width,
+                                  (uint16_t)entry.height, (uint16_t)entry.trimX,     (uint16_t)entry.trimY, (uint16_t)entry.sourceWidth, (uint16_t)entry.sourceHeight };
+
+        memcpy( pOut, fields, sizeof( fields ) );
+        pOut += sizeof( fields );
+    }
+
+    return true;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Number of sheets used by the last pack
+    @return     uint32_t - Sheet count
+  --------------------------------------------------------------------------*/
+uint32_t AtlasPacker::getSheetCount() const
+{
+    return (uint32_t)sheets.size();
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Rows of a sheet used by the last pack
+    @param      sheet - Sheet number
+    @return     uint32_t - Rows used, 0 for an unknown sheet
+  --------------------------------------------------------------------------*/
+uint32_t AtlasPacker::getSheetHeight( uint32_t sheet ) const
+{
+    return sheet < sheets.size() ? sheets[ sheet ].usedHeight : 0;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Share of the used sheet area covered by sprites
+    @return     double - 0.0 to 1.0
+  --------------------------------------------------------------------------*/
+double AtlasPacker::getOccupancy() const
+{
+    uint64_t usedArea  = 0;
+    uint64_t sheetArea = 0;
+
+    for ( const Sheet& sheet : sheets )
+    {
+        usedArea += sheet.usedArea;
+        sheetArea += (uint64_t)atlasConfig.sheetWidth * sheet.usedHeight;
+    }
+
+    return sheetArea ? (double)usedArea / (double)sheetArea : 0.0;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Finds the opaque (non zero) part of a sprite
+    @param      sprite - Sprite pixels
+    @return     SpriteRect - Smallest box holding every opaque pixel,
+                relative to the sprite, empty if there are none
+  --------------------------------------------------------------------------*/
+SpriteRect AtlasPacker::TrimSprite( ImageView<const uint8_t> sprite )
+{
+    uint32_t left       = sprite.getWidth();
+    uint32_t right      = 0;
+    uint32_t top        = sprite.getHeight();
+    uint32_t bottom     = 0;
+    uint32_t pixelCount = 0;
+
+    for ( uint32_t y = 0; y < sprite.getHeight(); y++ )
+    {
+        const uint8_t* pLine = sprite.getRow( y );
+
+        for ( uint32_t x = 0; x < sprite.getWidth(); x++ )
+        {
+            if ( pLine[ x ] )
+            {
+                left   = std::min( left, x );
+                right  = std::max( right, x + 1 );
+                top    = std::min( top, y );
+                bottom = y + 1;
+                pixelCount++;
+            }
+        }
+    }
+
+    if ( pixelCount == 0 )
+    {
+        return { 0, 0, 0, 0, 0 };
+    }
+
+    return { left, top, right - left, bottom - top, pixelCount };
+}
+
+// Private Functions ----------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Finds the skyline position where a rectangle's bottom edge
+                is highest, ties going to the left
+    @param      sheet - Sheet to search
+    @param      width - Width of the rectangle
+    @param      height - Height of the rectangle
+    @param      x - Receives the left edge
+    @param      y - Receives the top edge
+    @param      node - Receives the skyline node the rectangle starts on
+    @return     bool - False if the rectangle does not fit on the sheet
+  --------------------------------------------------------------------------*/
+bool AtlasPacker::findPosition( const Sheet& sheet, uint32_t width, uint32_t height, uint32_t& x, uint32_t& y, size_t& node ) const
+{
+    uint32_t bestBottom = UINT32_MAX;
+
+    for ( size_t nNode = 0; nNode < sheet.skyline.size(); nNode++ )
+    {
+        uint32_t left = sheet.skyline[ nNode ].x;
+
+        if ( left + width > atlasConfig.sheetWidth )
+        {
+            break;
+        }
+
+        // the rectangle rests on the highest node it spans
+        uint32_t top   = 0;
+        uint32_t span  = 0;
+        bool     bFits = true;
+
+        for ( size_t nSpan = nNode; span < width; nSpan++ )
+        {
+            top = std::max( top, sheet.skyline[ nSpan ].y );
+            if ( top + height > atlasConfig.sheetHeight || top + height >= bestBottom )
+            {
+                bFits = false;
+                break;
+            }
+            span += sheet.skyline[ nSpan ].width;
+        }
+
+        if ( bFits )
+        {
+            bestBottom = top + height;
+            x          = left;
+            y          = top;
+            node       = nNode;
+        }
+    }
+
+    return bestBottom != UINT32_MAX;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Raises the skyline over a placed rectangle
+    @param      sheet - Sheet the rectangle is on
+    @param      node - Skyline node the rectangle starts on
+    @param      x - Left edge
+    @param      y - Top edge
+    @param      width - Width of the rectangle
+    @param      height - Height of the rectangle
+  --------------------------------------------------------------------------*/
+void AtlasPacker::placeRect( Sheet& sheet, size_t node, uint32_t x, uint32_t y, uint32_t width, uint32_t height )
+{
+    std::vector<SkylineNode>& skyline = sheet.skyline;
+
+    skyline.insert( skyline.begin() + node, { x, y + height, width } );
+
+    // cut back the nodes the rectangle now covers
+    for ( size_t nNode = node + 1; nNode < skyline.size(); )
+    {
+        SkylineNode& next = skyline[ nNode ];
+
+        if ( next.x >= x + width )
+        {
+            break;
+        }
+
+        uint32_t covered = x + width - next.x;
+
+        if ( covered >= next.width )
+        {
+            skyline.erase( skyline.begin() + nNode );
+            continue;
+        }
+
+        next.x += covered;
+        next.width -= covered;
+        break;
+    }
+
+    // join neighbours at the same height
+    for ( size_t nNode = 0; nNode + 1 < skyline.size(); )
+    {
+        if ( skyline[ nNode ].y == skyline[ nNode + 1 ].y )
+        {
+            skyline[ nNode ].width += skyline[ nNode + 1 ].width;
+            skyline.erase( skyline.begin() + nNode + 1 );
+        }
+        else
+        {
+            nNode++;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+} // end namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: AtlasPacker.cpp
+// ----------------------------------------------------------------------------
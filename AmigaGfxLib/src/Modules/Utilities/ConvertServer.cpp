@@ -0,0 +1,752 @@
+/**----------------------------------------------------------------------------
+
+    @file       ConvertServer.cpp
+    @defgroup   AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Resident conversion server and client (Unix domain socket)
+
+    @copyright  Neil Bereford 2024
+
+Notes:
+
+    A build system that runs the converter once per PNG pays for a process
+    start, the Tools and ErrorHandler singletons and cold caches on every
+    asset. The server is started once and kept running, the client sends
+    it one line per image and waits for the one line reply.
+
+    Each connection is served by a task on the connection ThreadPool and
+    may carry any number of requests, handled in order. Connections are
+    served at once up to the pool size, later ones wait for a thread. An
+    image is converted with Decode_PNG() and Encode_Image(), which are safe
+    to call from several threads, never with Read_PNG(), which keeps its
+    libpng state in the Tools instance.
+
+    The source PNGs are read through a FileManager with its cache enabled,
+    so a file requested again, unchanged, is not read from disk. The dedup
+    index keeps the outputs of recent conversions in a byte budgeted LRU,
+    keyed by a hash of the PNG and the sprite size. A request for the same
+    PNG bytes and sprite size, under any name, writes the kept outputs
+    rather than converting again. A hash match is checked against the kept
+    PNG, so a collision is just a miss.
+
+    The protocol is plain text so it can be driven by hand (socat):
+
+        CONVERT <sprW> <sprH> <path>   -> OK <microseconds> [DEDUP] | FAIL <reason>
+        STATS                          -> OK jobs=... failed=... ...
+        SHUTDOWN                       -> OK, serve() then returns false
+
+    Paths are used as sent, so the client makes them absolute. Sockets are
+    only supported on Linux, elsewhere start() and connect() report
+    Server_NotSupported.
+
+-----------------------------------------------------------------------------*/
+
+//-----------------------------------------------------------------------------
+// Include files
+// ----------------------------------------------------------------------------
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <sstream>
+
+#if defined( __linux__ )
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "../../../inc/Modules/Utilities/ConvertServer.h"
+#include "../../../inc/Modules/ErrorHandling/ErrorHandler.h"
+
+//-----------------------------------------------------------------------------
+// Namespace
+//-----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------
+
+static constexpr size_t MAX_REQUEST_LENGTH = 8192; //!< Longest request line accepted, a path plus the command
+
+//-----------------------------------------------------------------------------
+// Local functions
+//-----------------------------------------------------------------------------
+
+#if defined( __linux__ )
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Fills in a Unix socket address
+    @param      socketPath - Path of the socket
+    @param      address - Receives the address
+    @return     bool - false if the path is too long for a socket address
+  --------------------------------------------------------------------------*/
+static bool SocketAddress( const std::string& socketPath, sockaddr_un& address )
+{
+    std::memset( &address, 0, sizeof( address ) );
+    address.sun_family = AF_UNIX;
+
+    if ( socketPath.empty() || socketPath.size() >= sizeof( address.sun_path ) )
+    {
+        return false;
+    }
+
+    std::memcpy( address.sun_path, socketPath.c_str(), socketPath.size() );
+    return true;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Connects to a Unix socket
+    @param      socketPath - Path of the socket
+    @return     int - Connected socket, -1 if nothing is listening
+  --------------------------------------------------------------------------*/
+static int ConnectSocket( const std::string& socketPath )
+{
+    sockaddr_un address;
+    int         connection = -1;
+
+    if ( SocketAddress( socketPath, address ) )
+    {
+        connection = socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+        if ( connection >= 0 && connect( connection, (sockaddr*)&address, sizeof( address ) ) != 0 )
+        {
+            close( connection );
+            connection = -1;
+        }
+    }
+
+    return connection;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Sends all of a string, retrying partial sends
+    @param      connection - Connected socket
+    @param      data - Bytes to send
+    @return     bool - false if the connection failed
+  --------------------------------------------------------------------------*/
+static bool SendAll( int connection, const std::string& data )
+{
+    for ( size_t sent = 0; sent < data.size(); )
+    {
+        ssize_t count = send( connection, data.data() + sent, data.size() - sent, MSG_NOSIGNAL );
+        if ( count <= 0 )
+        {
+            return false;
+        }
+        sent += count;
+    }
+
+    return true;
+}
+#endif
+
+//-----------------------------------------------------------------------------
+// Class support functions
+// ----------------------------------------------------------------------------
+
+// Constructor and destructor  -------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Constructor for the ConvertServer class, starts the
+                connection threads, start() opens the socket
+    @param      config - Socket path, thread count and cache budgets
+  --------------------------------------------------------------------------*/
+ConvertServer::ConvertServer( const ServerConfig& config ) : serverConfig( config ), connectionPool( config.connectionThreads )
+{
+    listenSocket = -1;
+    stopping     = false;
+    stats        = {};
+
+    fileManager.setCacheBudget( config.fileCacheBudget );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Destructor for the ConvertServer class, closes the socket
+                and waits for the open connections to end
+  --------------------------------------------------------------------------*/
+ConvertServer::~ConvertServer()
+{
+    stop();
+}
+
+// Public Functions ----------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Opens the listening socket. A socket file left by a server
+                that has gone is replaced, one with a server still
+                answering is left alone.
+    @return     bool - true if the server is listening
+  --------------------------------------------------------------------------*/
+bool ConvertServer::start()
+{
+#if defined( __linux__ )
+    sockaddr_un address;
+
+    if ( SocketAddress( serverConfig.socketPath, address ) == false )
+    {
+        ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::Server_FailedToListen, "Socket path is empty or too long: " + serverConfig.socketPath );
+        return false;
+    }
+
+    int running = ConnectSocket( serverConfig.socketPath );
+    if ( running >= 0 )
+    {
+        close( running );
+        ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::Server_AlreadyRunning, "A server is already listening on " + serverConfig.socketPath );
+        return false;
+    }
+    unlink( serverConfig.socketPath.c_str() );
+
+    listenSocket = socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+    if ( listenSocket < 0 || bind( listenSocket, (sockaddr*)&address, sizeof( address ) ) != 0 || listen( listenSocket, SOMAXCONN ) != 0 )
+    {
+        ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::Server_FailedToListen, "Unable to listen on " + serverConfig.socketPath + ": " + std::strerror( errno ) );
+        if ( listenSocket >= 0 )
+        {
+            close( listenSocket );
+            listenSocket = -1;
+        }
+        return false;
+    }
+
+    stopping = false;
+    return true;
+#else
+    ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::Server_NotSupported, "Conversion server is not available: " + serverConfig.socketPath );
+    return false;
+#endif
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Accepts client connections for up to timeoutMs, handing each
+                to a connection thread. Call in a loop, from one thread,
+                until it returns false.
+    @param      timeoutMs - Longest wait for a connection, -1 waits forever
+    @return     bool - false once the server has been stopped or a client
+                has sent SHUTDOWN
+  --------------------------------------------------------------------------*/
+bool ConvertServer::serve( int32_t timeoutMs )
+{
+#if defined( __linux__ )
+    if ( listenSocket < 0 || stopping )
+    {
+        return false;
+    }
+
+    struct pollfd listening = { listenSocket, POLLIN, 0 };
+
+    if ( poll( &listening, 1, timeoutMs ) > 0 && ( listening.revents & POLLIN ) )
+    {
+        int connection = accept4( listenSocket, NULL, NULL, SOCK_CLOEXEC );
+
+        if ( connection >= 0 )
+        {
+            {
+                std::lock_guard<std::mutex> guard( lock );
+                connections.insert( connection );
+                stats.connections++;
+            }
+            connectionPool.submit( [ this, connection ]() { serveConnection( connection ); } );
+        }
+    }
+
+    return stopping == false;
+#else
+    return false;
+#endif
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Stops the server, removes the socket, ends the open
+                connections and waits for their threads. Call from the
+                thread that calls serve(), never from a request.
+  --------------------------------------------------------------------------*/
+void ConvertServer::stop()
+{
+    stopping = true;
+
+#if defined( __linux__ )
+    if ( listenSocket >= 0 )
+    {
+        close( listenSocket );
+        unlink( serverConfig.socketPath.c_str() );
+        listenSocket = -1;
+    }
+
+    // wake any connection thread blocked reading, it then closes its socket
+    {
+        std::lock_guard<std::mutex> guard( lock );
+        for ( int connection : connections )
+        {
+            shutdown( connection, SHUT_RDWR );
+        }
+    }
+#endif
+
+    connectionPool.wait();
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Converts one image, writing the PAL, RAW and SPR files next
+                to it, from the dedup index when the same PNG has been
+                converted with the same sprite size
+    @param      fileName - PNG file to convert
+    @param      sprW - Sprite grid width, 0 finds the sprites on the sheet
+    @param      sprH - Sprite grid height, 0 finds the sprites on the sheet
+    @param      bDeduplicated - Set true if the outputs came from the index
+    @return     bool - true if the outputs were written
+  --------------------------------------------------------------------------*/
+bool ConvertServer::convert( const std::string& fileName, uint32_t sprW, uint32_t sprH, bool& bDeduplicated )
+{
+    bool written = false;
+
+    bDeduplicated = false;
+
+    // a throw, such as a PNG whose header asks for more memory than there
+    // is, fails this job and is still counted, the connection carries on
+    try
+    {
+        written = convertImage( fileName, sprW, sprH, bDeduplicated );
+    }
+    catch ( const std::exception& error )
+    {
+        ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::Pipeline_ImageFailed, "Exception converting " + fileName + ": " + error.what() );
+        written = false;
+    }
+    catch ( ... )
+    {
+        ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::Pipeline_ImageFailed, "Exception converting " + fileName );
+        written = false;
+    }
+
+    std::lock_guard<std::mutex> guard( lock );
+    stats.jobs++;
+    stats.failed += written ? 0 : 1;
+
+    return written;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Handles one request line, see the Notes for the requests
+    @param      request - Request, without the line end
+    @return     std::string - Reply, without the line end
+  --------------------------------------------------------------------------*/
+std::string ConvertServer::handleRequest( const std::string& request )
+{
+    std::istringstream input( request );
+    std::string        command;
+
+    input >> command;
+
+    if ( command == "CONVERT" )
+    {
+        int64_t     sprW = 0;
+        int64_t     sprH = 0;
+        std::string fileName;
+        bool        bDeduplicated = false;
+
+        // the rest of the line is the path, spaces and all, the sizes are
+        // read signed so "-1" is refused rather than wrapping to UINT32_MAX
+        input >> sprW >> sprH;
+        input.ignore( 1 );
+        std::getline( input, fileName );
+
+        if ( input.fail() || fileName.empty() )
+        {
+            return "FAIL expected CONVERT <sprW> <sprH> <path>";
+        }
+        if ( sprW < 0 || sprH < 0 || sprW > UINT32_MAX || sprH > UINT32_MAX )
+        {
+            return "FAIL sprite size out of range";
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        if ( convert( fileName, (uint32_t)sprW, (uint32_t)sprH, bDeduplicated ) == false )
+        {
+            return "FAIL " + fileName;
+        }
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - start );
+        return "OK " + std::to_string( elapsed.count() ) + ( bDeduplicated ? " DEDUP" : "" );
+    }
+    else if ( command == "STATS" )
+    {
+        ServerStats         server = getStats();
+        TS_FILE_CACHE_STATS cache  = fileManager.getCacheStatistics();
+
+        return std::format( "OK jobs={} failed={} dedupHits={} dedupBytes={} connections={} cacheHits={} cacheMisses={} cacheBytes={}", server.jobs, server.failed, server.dedupHits,
+                            server.dedupBytes, server.connections, cache.cacheHits, cache.cacheMisses, cache.bytesCached );
+    }
+    else if ( command == "SHUTDOWN" )
+    {
+        stopping = true;
+        return "OK";
+    }
+
+    return "FAIL unknown request " + command;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Job, dedup and connection statistics
+    @return     ServerStats - Statistics since the server was created
+  --------------------------------------------------------------------------*/
+ServerStats ConvertServer::getStats()
+{
+    std::lock_guard<std::mutex> guard( lock );
+    return stats;
+}
+
+// Private Functions ----------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Reads, converts and writes one image for convert()
+    @param      fileName - PNG file to convert
+    @param      sprW - Sprite grid width, 0 finds the sprites on the sheet
+    @param      sprH - Sprite grid height, 0 finds the sprites on the sheet
+    @param      bDeduplicated - Set true if the outputs came from the index
+    @return     bool - true if the outputs were written
+  --------------------------------------------------------------------------*/
+bool ConvertServer::convertImage( const std::string& fileName, uint32_t sprW, uint32_t sprH, bool& bDeduplicated )
+{
+    Tools&               tools = Tools::getInstance();
+    std::vector<uint8_t> pngData;
+    bool                 written = false;
+
+    if ( fileManager.OpenFile( fileName, pngData ) == false )
+    {
+        ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::Pipeline_FailedToReadFile, "Failed to read " + fileName );
+    }
+    else
+    {
+        uint64_t     key   = Tools::getInstance().hash64( pngData.data(), pngData.size(), (uint64_t)sprW << 32 | sprH );
+        DedupPointer found = serverConfig.dedupBudget ? findOutputs( key, pngData, sprW, sprH ) : nullptr;
+
+        if ( found )
+        {
+            bDeduplicated = true;
+            written       = writeOutputs( fileName, found->outputs, 0 );
+        }
+        else
+        {
+            // each connection thread keeps its decoded image between jobs
+            thread_local DecodedImage   image;
+            std::shared_ptr<DedupEntry> entry = std::make_shared<DedupEntry>();
+
+            if ( tools.Decode_PNG( pngData, image ) == false )
+            {
+                ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::Pipeline_FailedToDecode, "Failed to decode, not an 8 bit indexed PNG or too large " + fileName );
+            }
+            else if ( sprW > image.width || sprH > image.height )
+            {
+                ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::Pipeline_FailedToDecode,
+                                                         std::format( "Sprite size {}x{} is larger than the image {}", sprW, sprH, fileName ) );
+            }
+            else
+            {
+                image.fileName.assign( fileName );
+                written = tools.Encode_Image( image, entry->outputs, sprW, sprH ) && writeOutputs( fileName, entry->outputs, fileName.size() );
+            }
+
+            if ( written && serverConfig.dedupBudget )
+            {
+                entry->key       = key;
+                entry->sprW      = sprW;
+                entry->sprH      = sprH;
+                entry->entrySize = pngData.size();
+                entry->pngData   = std::move( pngData );
+                for ( ConvertedFile& output : entry->outputs )
+                {
+                    output.fileName.erase( 0, fileName.size() );
+                    entry->entrySize += output.fileData.size();
+                }
+                addOutputs( std::move( entry ) );
+            }
+        }
+    }
+
+    return written;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Serves one client connection, replying to each request line
+                until the client closes it or the server stops
+    @param      connection - Accepted socket, closed before returning
+  --------------------------------------------------------------------------*/
+void ConvertServer::serveConnection( int connection )
+{
+#if defined( __linux__ )
+    // closes the socket and forgets it however the connection ends
+    struct ConnectionGuard
+    {
+        ConvertServer* pServer;
+        int            connection;
+
+        ~ConnectionGuard()
+        {
+            {
+                std::lock_guard<std::mutex> guard( pServer->lock );
+                pServer->connections.erase( connection );
+            }
+            close( connection );
+        }
+    } connectionGuard = { this, connection };
+
+    std::string received;
+    char        buffer[ 4096 ];
+    bool        open = true;
+
+    while ( open )
+    {
+        ssize_t count = recv( connection, buffer, sizeof( buffer ), 0 );
+        if ( count <= 0 )
+        {
+            break;
+        }
+        received.append( buffer, count );
+
+        size_t lineEnd;
+        while ( open && ( lineEnd = received.find( '\n' ) ) != std::string::npos )
+        {
+            std::string reply;
+
+            // every request gets a reply, a throw is a failure like any other
+            try
+            {
+                reply = handleRequest( received.substr( 0, lineEnd ) ) + "\n";
+            }
+            catch ( const std::exception& error )
+            {
+                reply = std::string( "FAIL " ) + error.what() + "\n";
+            }
+            catch ( ... )
+            {
+                reply = "FAIL unknown exception\n";
+            }
+
+            received.erase( 0, lineEnd + 1 );
+            open = SendAll( connection, reply );
+        }
+
+        // a client that never ends its line is dropped
+        open = open && received.size() <= MAX_REQUEST_LENGTH;
+    }
+#endif
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Looks up the outputs of a PNG converted before
+    @param      key - Hash of the PNG and sprite size
+    @param      pngData - PNG, compared with the kept one
+    @param      sprW - Sprite grid width
+    @param      sprH - Sprite grid height
+    @return     DedupPointer - Kept outputs, nullptr if there are none
+  --------------------------------------------------------------------------*/
+ConvertServer::DedupPointer ConvertServer::findOutputs( uint64_t key, const std::vector<uint8_t>& pngData, uint32_t sprW, uint32_t sprH )
+{
+    std::lock_guard<std::mutex> guard( lock );
+    auto                        found = dedupIndex.find( key );
+
+    if ( found == dedupIndex.end() )
+    {
+        return nullptr;
+    }
+
+    const DedupEntry& entry = **found->second;
+    if ( entry.sprW != sprW || entry.sprH != sprH || entry.pngData != pngData )
+    {
+        return nullptr;
+    }
+
+    dedupList.splice( dedupList.begin(), dedupList, found->second );
+    stats.dedupHits++;
+
+    return *found->second;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Keeps the outputs of a conversion, dropping the least
+                recently used entries to stay within the budget
+    @param      entry - Outputs, with the suffix of each file name
+  --------------------------------------------------------------------------*/
+void ConvertServer::addOutputs( DedupPointer entry )
+{
+    std::lock_guard<std::mutex> guard( lock );
+
+    if ( entry->entrySize > serverConfig.dedupBudget )
+    {
+        return;
+    }
+
+    auto found = dedupIndex.find( entry->key );
+    if ( found != dedupIndex.end() )
+    {
+        stats.dedupBytes -= ( *found->second )->entrySize;
+        dedupList.erase( found->second );
+        dedupIndex.erase( found );
+    }
+
+    stats.dedupBytes += entry->entrySize;
+    dedupList.push_front( std::move( entry ) );
+    dedupIndex[ dedupList.front()->key ] = dedupList.begin();
+
+    while ( stats.dedupBytes > serverConfig.dedupBudget )
+    {
+        stats.dedupBytes -= dedupList.back()->entrySize;
+        dedupIndex.erase( dedupList.back()->key );
+        dedupList.pop_back();
+    }
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Writes the outputs of an image
+    @param      fileName - Source PNG, the output names start with it
+    @param      outputs - Output files
+    @param      suffixStart - Start of the suffix in each output file name
+    @return     bool - true if every file was written
+  --------------------------------------------------------------------------*/
+bool ConvertServer::writeOutputs( const std::string& fileName, const std::vector<ConvertedFile>& outputs, size_t suffixStart )
+{
+    bool        written = true;
+    std::string outputName;
+
+    for ( const ConvertedFile& output : outputs )
+    {
+        outputName.assign( fileName ).append( output.fileName, suffixStart );
+
+        if ( fileManager.SaveFile( outputName, output.fileData ) == false )
+        {
+            ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::Pipeline_FailedToWriteFile, "Failed to write " + outputName );
+            written = false;
+        }
+    }
+
+    return written;
+}
+
+//-----------------------------------------------------------------------------
+// ConvertClient
+//-----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Constructor for the ConvertClient class
+  --------------------------------------------------------------------------*/
+ConvertClient::ConvertClient()
+{
+    clientSocket = -1;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Destructor for the ConvertClient class, closes the connection
+  --------------------------------------------------------------------------*/
+ConvertClient::~ConvertClient()
+{
+    disconnect();
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Connects to a server
+    @param      socketPath - Socket the server listens on
+    @return     bool - true if connected
+  --------------------------------------------------------------------------*/
+bool ConvertClient::connect( const std::string& socketPath )
+{
+    disconnect();
+
+#if defined( __linux__ )
+    clientSocket = ConnectSocket( socketPath );
+    if ( clientSocket < 0 )
+    {
+        ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::Server_FailedToConnect, "No conversion server listening on " + socketPath );
+        return false;
+    }
+
+    return true;
+#else
+    ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::Server_NotSupported, "Conversion server is not available: " + socketPath );
+    return false;
+#endif
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Sends a request and waits for its reply
+    @param      request - Request, without the line end
+    @param      reply - Receives the reply, without the line end
+    @return     bool - false if the connection failed
+  --------------------------------------------------------------------------*/
+bool ConvertClient::request( const std::string& request, std::string& reply )
+{
+#if defined( __linux__ )
+    if ( clientSocket < 0 || SendAll( clientSocket, request + "\n" ) == false )
+    {
+        return false;
+    }
+
+    char   buffer[ 256 ];
+    size_t lineEnd;
+
+    while ( ( lineEnd = received.find( '\n' ) ) == std::string::npos )
+    {
+        ssize_t count = recv( clientSocket, buffer, sizeof( buffer ), 0 );
+        if ( count <= 0 )
+        {
+            disconnect();
+            return false;
+        }
+        received.append( buffer, count );
+    }
+
+    reply.assign( received, 0, lineEnd );
+    received.erase( 0, lineEnd + 1 );
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Closes the connection
+  --------------------------------------------------------------------------*/
+void ConvertClient::disconnect()
+{
+#if defined( __linux__ )
+    if ( clientSocket >= 0 )
+    {
+        close( clientSocket );
+    }
+#endif
+    clientSocket = -1;
+    received.clear();
+}
+
+//-----------------------------------------------------------------------------
+
+} // end namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: ConvertServer.cpp
+// ----------------------------------------------------------------------------
@@ -0,0 +1,490 @@
+/**----------------------------------------------------------------------------
+
+    @file       CostModel.cpp
+    @defgroup   AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Estimates the cost of drawing sprites in each output format
+
+    @copyright  Neil Bereford 2024
+
+Notes:
+
+    The model is static: nothing is run, each output is walked and every
+    command or instruction in it is given a cost from the CPU's row of
+    CYCLE_TABLES. The costs are of drawing a sprite once, in CPU cycles of
+    the CPU modelled, restoring the background is left out.
+
+    RLE streams are costed by command as a decoder loop runs them: skips,
+    literal runs set up and copied a pixel at a time (eight at a time with
+    AMMX on the 68080), fill runs and line ends. Compiled sprites are
+    costed by instruction. The 68000 needs an odd address variant of each
+    compiled sprite, so there both variants are built, their bytes added
+    and their cycles averaged, as a sprite is as likely at either.
+
+    Planar sprites are cookie cut one blit per plane, mask, sprite plane
+    and background in, screen out, so every word costs four DMA slots, the
+    CPU waits for the blitter, and the words a row are those of an
+    unshifted copy at any x. Hardware sprites cost the CPU only the
+    control words it rewrites each frame, the sprite DMA draws them for
+    nothing.
+
+    Costing encodes every sprite but converts nothing, so it goes through
+    the encoders' metrics free paths and leaves the run's counters alone.
+
+    The timings are the documented 68000 instruction times with chip RAM
+    wait states averaged in, and cache hit times for the 68020 and 68080,
+    so they rank formats rather than predict a frame to the cycle.
+
+    chooseFormats() gives each sprite its cheapest format. Hardware sprites
+    are then limited to the 8 DMA channels, kept for the sprites that save
+    the most cycles per channel. With a memory budget, while the chosen
+    formats are over it, the sprite whose move to a smaller format costs
+    the fewest extra cycles per byte saved is moved.
+
+-----------------------------------------------------------------------------*/
+
+//-----------------------------------------------------------------------------
+// Include files
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "../../../inc/Modules/Utilities/CostModel.h"
+#include "../../../inc/Modules/Utilities/Metrics.h"
+#include "../../../inc/Modules/Utilities/PlanarSprites.h"
+#include "../../../inc/Modules/Utilities/Tools.h"
+
+//-----------------------------------------------------------------------------
+// Namespace
+//-----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Local Data
+//-----------------------------------------------------------------------------
+
+static const char* cpuNames[] = { "68000", "68020", "68080" };
+
+static const char* formatNames[] = { "RLE", "Planar", "Compiled", "Hardware" };
+
+static_assert( sizeof( cpuNames ) / sizeof( cpuNames[ 0 ] ) == (size_t)CpuModel::TotalModels );
+static_assert( sizeof( formatNames ) / sizeof( formatNames[ 0 ] ) == (size_t)DrawFormat::TotalFormats );
+
+//-----------------------------------------------------------------------------
+// Cycle tables, one row per CpuModel
+//-----------------------------------------------------------------------------
+const DrawCostModel::CycleTable DrawCostModel::CYCLE_TABLES[ (size_t)CpuModel::TotalModels ] = {
+    // 68000
+    { .rleSkip         = 34,
+      .rleLiteral      = 38,
+      .rleLiteralPixel = 22,
+      .rleFill         = 46,
+      .rleFillPixel    = 18,
+      .rleEndLine      = 30,
+      .rleEndSprite    = 24,
+      .moveLong        = 20,
+      .moveWord        = 12,
+      .moveByte        = 12,
+      .stepQuick       = 8,
+      .lea             = 8,
+      .addRow          = 8,
+      .rts             = 16,
+      .blitSetup       = 140,
+      .blitWord        = 8,
+      .spriteCell      = 40,
+      .spriteChannel   = 32 },
+    // 68020
+    { .rleSkip         = 12,
+      .rleLiteral      = 14,
+      .rleLiteralPixel = 6,
+      .rleFill         = 16,
+      .rleFillPixel    = 4,
+      .rleEndLine      = 10,
+      .rleEndSprite    = 10,
+      .moveLong        = 4,
+      .moveWord        = 4,
+      .moveByte        = 4,
+      .stepQuick       = 2,
+      .lea             = 2,
+      .addRow          = 2,
+      .rts             = 10,
+      .blitSetup       = 90,
+      .blitWord        = 16,
+      .spriteCell      = 14,
+      .spriteChannel   = 10 },
+    // 68080, literal and fill runs moved eight pixels at a time with AMMX
+    { .rleSkip         = 3,
+      .rleLiteral      = 4,
+      .rleLiteralPixel = 0.25,
+      .rleFill         = 4,
+      .rleFillPixel    = 0.125,
+      .rleEndLine      = 2,
+      .rleEndSprite    = 3,
+      .moveLong        = 1,
+      .moveWord        = 1,
+      .moveByte        = 1,
+      .stepQuick       = 0.5,
+      .lea             = 0.5,
+      .addRow          = 0.5,
+      .rts             = 2,
+      .blitSetup       = 40,
+      .blitWord        = 20,
+      .spriteCell      = 4,
+      .spriteChannel   = 2 },
+};
+
+//-----------------------------------------------------------------------------
+// Class support functions
+// ----------------------------------------------------------------------------
+
+// Constructor and destructor  -------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Constructor for the DrawCostModel class
+    @param      cpu - CPU to cost for
+  --------------------------------------------------------------------------*/
+DrawCostModel::DrawCostModel( CpuModel cpu ) : cpuModel( cpu ), timings( CYCLE_TABLES[ cpu < CpuModel::TotalModels ? (size_t)cpu : 0 ] )
+{
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Destructor for the DrawCostModel class
+  --------------------------------------------------------------------------*/
+DrawCostModel::~DrawCostModel()
+{
+}
+
+// Public Functions ----------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Cycles to decode one sprite's RLE command stream
+    @param      pStream - First command of the sprite
+    @param      pEnd - End of the data, the walk stops here if the stream
+                has no EndSprite
+    @return     uint64_t - Cycles
+  --------------------------------------------------------------------------*/
+uint64_t DrawCostModel::rleCycles( const uint8_t* pStream, const uint8_t* pEnd ) const
+{
+    double cycles = 0;
+
+    while ( pStream < pEnd )
+    {
+        uint8_t cmd = *pStream++;
+
+        if ( cmd == (uint8_t)SpriteCmd::EndSprite )
+        {
+            cycles += timings.rleEndSprite;
+            break;
+        }
+        else if ( cmd == (uint8_t)SpriteCmd::EndLine )
+        {
+            cycles += timings.rleEndLine;
+        }
+        else if ( cmd == (uint8_t)SpriteCmd::Skip )
+        {
+            cycles += timings.rleSkip;
+        }
+        else if ( cmd == (uint8_t)SpriteCmd::Fill )
+        {
+            if ( pEnd - pStream < 2 )
+            {
+                break;
+            }
+            cycles += timings.rleFill + timings.rleFillPixel * pStream[ 0 ];
+            pStream += 2;
+        }
+        else if ( pStream < pEnd )
+        {
+            // a skip of 0-199 pixels, then a literal run
+            uint8_t count = *pStream++;
+
+            cycles += timings.rleSkip + timings.rleLiteral + timings.rleLiteralPixel * count;
+            pStream += count;
+        }
+    }
+
+    return (uint64_t)std::llround( cycles );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Cycles to run a compiled sprite
+    @param      code - Instructions from SpriteCompiler
+    @return     uint64_t - Cycles
+  --------------------------------------------------------------------------*/
+uint64_t DrawCostModel::compiledCycles( const std::vector<M68kInstruction>& code ) const
+{
+    double cycles = 0;
+
+    for ( const M68kInstruction& instruction : code )
+    {
+        switch ( instruction.op )
+        {
+            case M68kOp::MoveLong: cycles += timings.moveLong; break;
+            case M68kOp::MoveWord: cycles += timings.moveWord; break;
+            case M68kOp::MoveByte: cycles += timings.moveByte; break;
+            case M68kOp::AddQuick:
+            case M68kOp::SubQuick: cycles += timings.stepQuick; break;
+            case M68kOp::Lea:      cycles += timings.lea; break;
+            case M68kOp::AddRow:   cycles += timings.addRow; break;
+            case M68kOp::Return:   cycles += timings.rts; break;
+        }
+    }
+
+    return (uint64_t)std::llround( cycles );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Cycles to cookie cut a planar sprite, one blit per plane
+    @param      words - Words a row of each blit
+    @param      rows - Rows of each blit
+    @param      planes - Bitplanes
+    @return     uint64_t - Cycles
+  --------------------------------------------------------------------------*/
+uint64_t DrawCostModel::planarCycles( uint32_t words, uint32_t rows, uint32_t planes ) const
+{
+    return (uint64_t)std::llround( planes * ( timings.blitSetup + timings.blitWord * words * rows ) );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Cycles a frame to show a hardware sprite cell
+    @param      cell - Cell from HardwareSpriteEncoder
+    @return     uint64_t - Cycles, DRAW_UNAVAILABLE if the cell does not fit
+                the sprite hardware
+  --------------------------------------------------------------------------*/
+uint64_t DrawCostModel::hardwareCycles( const HardwareSpriteCell& cell ) const
+{
+    if ( cell.bFits == false )
+    {
+        return DRAW_UNAVAILABLE;
+    }
+    return (uint64_t)std::llround( timings.spriteCell + timings.spriteChannel * cell.channels );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Encodes every sprite in every format and costs each one
+    @param      image - Sheet holding the sprites, colour index 0 is transparent
+    @param      sprites - Sprites to cost
+    @param      costs - Receives the cost of each sprite, in the order given,
+                with the cheapest format chosen, empty if a sprite is
+                placed beyond what a sprite list holds
+  --------------------------------------------------------------------------*/
+void DrawCostModel::costSprites( ImageView<const uint8_t> image, const std::vector<SpriteRect>& sprites, std::vector<SpriteDrawCost>& costs ) const
+{
+    std::vector<uint8_t>            sprFile;
+    std::vector<HardwareSpriteCell> cells;
+    std::vector<M68kInstruction>    code;
+    uint64_t                        opCounts[ (size_t)MetricCounter::TotalCounters ] = { 0 };
+    bool                            bOddVariants = cpuModel == CpuModel::M68000;
+    SpriteCompiler                  compiler( bOddVariants );
+
+    // AGA machines fetch sprites 64 pixels wide, the 68000 ones only 16
+    HardwareSpriteEncoder hardware( HardwareSpriteConfig{ .fetchWidth = cpuModel == CpuModel::M68000 ? 16u : 64u } );
+    uint32_t              planes = PlanarSpriteEncoder::PlanesFor( image );
+    char                  header[ 64 ];
+    size_t                headerLen = snprintf( header, sizeof( header ), "SPRITELIST:%u:", (uint32_t)sprites.size() );
+
+    if ( Tools::getInstance().EncodeSpriteList( image, sprites, "cost model", sprFile, opCounts ) == false )
+    {
+        costs.clear();
+        return;
+    }
+    hardware.plan( image, sprites, cells );
+
+    const uint8_t* pTable = sprFile.data() + headerLen;
+    const uint8_t* pData  = pTable + sprites.size() * Tools::SPR_LIST_ENTRY;
+    const uint8_t* pEnd   = sprFile.data() + sprFile.size();
+
+    costs.resize( sprites.size() );
+    for ( size_t nSprite = 0; nSprite < sprites.size(); nSprite++ )
+    {
+        SpriteDrawCost&          cost   = costs[ nSprite ];
+        ImageView<const uint8_t> sprite = image.subView( sprites[ nSprite ].x, sprites[ nSprite ].y, sprites[ nSprite ].width, sprites[ nSprite ].height );
+        uint32_t                 start, end;
+
+        // each stream ends where the next one starts
+        memcpy( &start, pTable + nSprite * Tools::SPR_LIST_ENTRY, sizeof( start ) );
+        if ( nSprite + 1 < sprites.size() )
+        {
+            memcpy( &end, pTable + ( nSprite + 1 ) * Tools::SPR_LIST_ENTRY, sizeof( end ) );
+        }
+        else
+        {
+            end = (uint32_t)( pEnd - pData );
+        }
+        cost.cycles[ (size_t)DrawFormat::Rle ] = rleCycles( pData + start, pData + end );
+        cost.bytes[ (size_t)DrawFormat::Rle ]  = end - start;
+
+        // an unshifted planar copy, a word wider than the sprite for the shift
+        uint32_t words = ( sprite.getWidth() + 30 ) / 16;
+        cost.cycles[ (size_t)DrawFormat::Planar ] = planarCycles( words, sprite.getHeight(), planes );
+        cost.bytes[ (size_t)DrawFormat::Planar ]  = (uint64_t)( planes + 1 ) * words * sprite.getHeight() * 2;
+
+        // the 68000 keeps an odd variant too, drawn as often as the even one
+        uint64_t compiledTotal = 0;
+        cost.bytes[ (size_t)DrawFormat::Compiled ] = 0;
+        for ( bool bOdd : { false, true } )
+        {
+            if ( bOdd && bOddVariants == false )
+            {
+                break;
+            }
+            compiler.compile( sprite, bOdd, code );
+            compiledTotal += compiledCycles( code );
+            for ( const M68kInstruction& instruction : code )
+            {
+                cost.bytes[ (size_t)DrawFormat::Compiled ] += SpriteCompiler::InstructionBytes( instruction );
+            }
+        }
+        cost.cycles[ (size_t)DrawFormat::Compiled ] = bOddVariants ? ( compiledTotal + 1 ) / 2 : compiledTotal;
+
+        cost.cycles[ (size_t)DrawFormat::Hardware ] = hardwareCycles( cells[ nSprite ] );
+        cost.bytes[ (size_t)DrawFormat::Hardware ]  = cells[ nSprite ].dataSize + sizeof( cells[ nSprite ].colourMap );
+        cost.channels                               = cells[ nSprite ].channels;
+    }
+
+    chooseFormats( costs );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Chooses the format of every sprite to draw the sheet in the
+                fewest cycles, with no more hardware sprites than there are
+                DMA channels and, if a budget is given, no more bytes
+    @param      costs - Sprite costs, chosen is set on each
+    @param      byteBudget - Most bytes for all the sprites, 0 for no limit.
+                A budget smaller than the sprites in their smallest formats
+                leaves them in their smallest formats.
+    @return     uint64_t - Cycles to draw every sprite once in the chosen formats
+  --------------------------------------------------------------------------*/
+uint64_t DrawCostModel::chooseFormats( std::vector<SpriteDrawCost>& costs, uint64_t byteBudget ) const
+{
+    const size_t formats = (size_t)DrawFormat::TotalFormats;
+    const size_t hwIndex = (size_t)DrawFormat::Hardware;
+
+    // cheapest first, ties to the smaller, and the next best without hardware
+    std::vector<std::pair<double, size_t>> hardwareUsers;
+    for ( size_t nSprite = 0; nSprite < costs.size(); nSprite++ )
+    {
+        SpriteDrawCost& cost = costs[ nSprite ];
+        size_t          best = 0, bestSoft = 0;
+
+        for ( size_t nFormat = 1; nFormat < formats; nFormat++ )
+        {
+            auto cheaper = [ & ]( size_t a, size_t b ) { return cost.cycles[ a ] < cost.cycles[ b ] || ( cost.cycles[ a ] == cost.cycles[ b ] && cost.bytes[ a ] < cost.bytes[ b ] ); };
+
+            best     = cheaper( nFormat, best ) ? nFormat : best;
+            bestSoft = nFormat != hwIndex && cheaper( nFormat, bestSoft ) ? nFormat : bestSoft;
+        }
+
+        cost.chosen = (DrawFormat)best;
+        if ( best == hwIndex )
+        {
+            double saved = (double)( cost.cycles[ bestSoft ] - cost.cycles[ hwIndex ] );
+            hardwareUsers.push_back( { saved / std::max( cost.channels, 1u ), nSprite } );
+            cost.chosen = (DrawFormat)bestSoft;
+        }
+    }
+
+    // the DMA channels go to the sprites that save the most with them
+    std::sort( hardwareUsers.begin(), hardwareUsers.end(), []( const auto& a, const auto& b ) { return a.first > b.first || ( a.first == b.first && a.second < b.second ); } );
+    uint32_t channels = 0;
+    for ( const auto& [ saving, nSprite ] : hardwareUsers )
+    {
+        if ( channels + costs[ nSprite ].channels <= HardwareSpriteEncoder::HWS_CHANNELS )
+        {
+            channels += costs[ nSprite ].channels;
+            costs[ nSprite ].chosen = DrawFormat::Hardware;
+        }
+    }
+
+    uint64_t bytes = 0;
+    for ( const SpriteDrawCost& cost : costs )
+    {
+        bytes += cost.bytes[ (size_t)cost.chosen ];
+    }
+
+    // over budget, give up the fewest cycles for each byte saved
+    while ( byteBudget && bytes > byteBudget )
+    {
+        double bestRatio  = 0;
+        size_t bestSprite = costs.size(), bestFormat = 0;
+
+        for ( size_t nSprite = 0; nSprite < costs.size(); nSprite++ )
+        {
+            const SpriteDrawCost& cost    = costs[ nSprite ];
+            size_t                current = (size_t)cost.chosen;
+
+            for ( size_t nFormat = 0; nFormat < formats; nFormat++ )
+            {
+                if ( nFormat == hwIndex || cost.cycles[ nFormat ] == DRAW_UNAVAILABLE || cost.bytes[ nFormat ] >= cost.bytes[ current ] )
+                {
+                    continue;
+                }
+
+                double extra = (double)cost.cycles[ nFormat ] - (double)cost.cycles[ current ];
+                double ratio = extra / (double)( cost.bytes[ current ] - cost.bytes[ nFormat ] );
+                if ( bestSprite == costs.size() || ratio < bestRatio )
+                {
+                    bestRatio  = ratio;
+                    bestSprite = nSprite;
+                    bestFormat = nFormat;
+                }
+            }
+        }
+
+        if ( bestSprite == costs.size() )
+        {
+            break;
+        }
+        bytes -= costs[ bestSprite ].bytes[ (size_t)costs[ bestSprite ].chosen ] - costs[ bestSprite ].bytes[ bestFormat ];
+        costs[ bestSprite ].chosen = (DrawFormat)bestFormat;
+    }
+
+    uint64_t cycles = 0;
+    for ( const SpriteDrawCost& cost : costs )
+    {
+        cycles += cost.cycles[ (size_t)cost.chosen ];
+    }
+    return cycles;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Returns the name of a CPU model
+    @param      cpu - CPU model
+    @return     const char* - Name used in the reports
+  --------------------------------------------------------------------------*/
+const char* DrawCostModel::getCpuName( CpuModel cpu )
+{
+    return cpu < CpuModel::TotalModels ? cpuNames[ (size_t)cpu ] : "Unknown";
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Returns the name of an output format
+    @param      format - Output format
+    @return     const char* - Name used in the reports
+  --------------------------------------------------------------------------*/
+const char* DrawCostModel::getFormatName( DrawFormat format )
+{
+    return format < DrawFormat::TotalFormats ? formatNames[ (size_t)format ] : "Unknown";
+}
+
+//-----------------------------------------------------------------------------
+
+} // end namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: CostModel.cpp
+// ----------------------------------------------------------------------------
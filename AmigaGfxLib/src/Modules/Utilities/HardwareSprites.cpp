@@ -0,0 +1,311 @@
+/**----------------------------------------------------------------------------
+
+    @file       HardwareSprites.cpp
+    @defgroup   AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Encodes sprite cells as Amiga hardware sprites
+
+    @copyright  Neil Bereford 2024
+
+Notes:
+
+    A hardware sprite is one fetch width wide (16 pixels, or 32 or 64 with
+    the AGA fetch modes) and shows 3 colours, two bits a pixel held in two
+    bitplane words a line. A cell wider than that is cut into strips, one
+    sprite each. With more than 3 colours each strip is an attached pair,
+    the even sprite holding bits 0 and 1 of the colour and the odd sprite
+    bits 2 and 3 with the attach bit set in its control word, for 15
+    colours. The colours a cell uses are numbered in palette order, the
+    colour map of the cell gives the palette index of each sprite colour.
+
+    There are 8 sprite DMA channels, so a cell needing more is reported as
+    not fitting. It is still written, it can be shown by reusing channels
+    further down the screen. A cell with too many colours, or more lines
+    than the stop position can hold, is reported and written with no data.
+
+    Each sprite is a DMA list: the position and control words, then the
+    two bitplane words of each line, then two zero words to end the list.
+    Each word is the fetch width wide, the control words padded with zero.
+    The position word is 0 and the stop line in the control word is the
+    line count, so the display code adds the screen position to both.
+
+    The file starts "HWSPRITE:count,fetch:" followed by a 12 byte entry
+    per cell: uint32 offset of the cell's data, uint16 trimmed top rows,
+    uint16 lines, uint8 strips, channels and colours, and flags (bit 0
+    attached, bit 1 fits, bit 2 has data). The data of each cell is its 16
+    byte colour map, then one DMA list per channel, strip by strip, even
+    sprite first.
+
+-----------------------------------------------------------------------------*/
+
+//-----------------------------------------------------------------------------
+// Include files
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "../../../inc/Modules/Utilities/HardwareSprites.h"
+#include "../../../inc/Modules/Utilities/Metrics.h"
+#include "../../../inc/Modules/ErrorHandling/ErrorHandler.h"
+
+//-----------------------------------------------------------------------------
+// Namespace
+//-----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Class support functions
+// ----------------------------------------------------------------------------
+
+// Constructor and destructor  -------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Constructor for the HardwareSpriteEncoder class
+    @param      config - Sprite width and pairing settings
+  --------------------------------------------------------------------------*/
+HardwareSpriteEncoder::HardwareSpriteEncoder( const HardwareSpriteConfig& config ) : spriteConfig( config )
+{
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Destructor for the HardwareSpriteEncoder class
+  --------------------------------------------------------------------------*/
+HardwareSpriteEncoder::~HardwareSpriteEncoder()
+{
+}
+
+// Public Functions ----------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Encodes cells of an image as hardware sprites
+    @param      image - Sheet holding the cells, colour index 0 is transparent
+    @param      cells - Cells to encode
+    @param      hwsFile - Receives the .HWS file data
+    @param      report - Receives how each cell was split, in the order given
+    @return     bool - false if the fetch width is not 16, 32 or 64
+  --------------------------------------------------------------------------*/
+bool HardwareSpriteEncoder::encode( ImageView<const uint8_t> image, const std::vector<SpriteRect>& cells, std::vector<uint8_t>& hwsFile,
+                                    std::vector<HardwareSpriteCell>& report ) const
+{
+    if ( spriteConfig.fetchWidth != 16 && spriteConfig.fetchWidth != 32 && spriteConfig.fetchWidth != 64 )
+    {
+        ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::HardwareSprite_InvalidWidth,
+                                                 "Hardware sprites are 16, 32 or 64 pixels wide, not " + std::to_string( spriteConfig.fetchWidth ) );
+        return false;
+    }
+
+    ScopedTimer timer( MetricStage::Compress );
+    size_t      dataSize = 0;
+    char        header[ 64 ];
+    size_t      headerLen = snprintf( header, sizeof( header ), "HWSPRITE:%u,%u:", (uint32_t)cells.size(), spriteConfig.fetchWidth );
+
+    // plan every cell first, so the file is sized once
+    plan( image, cells, report );
+    for ( const HardwareSpriteCell& info : report )
+    {
+        dataSize += sizeof( info.colourMap ) + info.dataSize;
+    }
+
+    hwsFile.resize( headerLen + cells.size() * HWS_ENTRY + dataSize );
+    memcpy( hwsFile.data(), header, headerLen );
+
+    uint8_t* pTable = hwsFile.data() + headerLen;
+    uint8_t* pData  = pTable + cells.size() * HWS_ENTRY;
+    uint8_t* pOut   = pData;
+
+    for ( const HardwareSpriteCell& info : report )
+    {
+        uint32_t cellStart = pOut - pData;
+        uint16_t lines[ 2 ] = { (uint16_t)info.firstLine, (uint16_t)info.lines };
+        uint8_t  sizes[ 4 ] = { (uint8_t)info.strips, (uint8_t)info.channels, (uint8_t)info.colours,
+                                (uint8_t)( ( info.bAttached ? 1 : 0 ) | ( info.bFits ? 2 : 0 ) | ( info.dataSize ? 4 : 0 ) ) };
+
+        memcpy( pTable, &cellStart, sizeof( uint32_t ) );
+        memcpy( pTable + sizeof( uint32_t ), lines, sizeof( lines ) );
+        memcpy( pTable + sizeof( uint32_t ) + sizeof( lines ), sizes, sizeof( sizes ) );
+        pTable += HWS_ENTRY;
+
+        memcpy( pOut, info.colourMap, sizeof( info.colourMap ) );
+        pOut += sizeof( info.colourMap );
+
+        if ( info.dataSize == 0 )
+        {
+            continue;
+        }
+
+        // palette index to sprite colour, anything not in the map is transparent
+        uint8_t colourOf[ 256 ] = { 0 };
+        for ( uint32_t nColour = 1; nColour <= info.colours; nColour++ )
+        {
+            colourOf[ info.colourMap[ nColour ] ] = (uint8_t)nColour;
+        }
+
+        ImageView<const uint8_t> rows = image.subView( info.x, info.y, info.width, info.height ).rows( info.firstLine, info.lines );
+        for ( uint32_t nStrip = 0; nStrip < info.strips; nStrip++ )
+        {
+            pOut = writeSprite( rows, colourOf, nStrip, 0, false, pOut );
+            if ( info.bAttached )
+            {
+                pOut = writeSprite( rows, colourOf, nStrip, 2, true, pOut );
+            }
+        }
+    }
+
+    Metrics::getInstance().addCount( MetricCounter::SpritesEncoded, cells.size() );
+
+    return true;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Plans how each cell splits into hardware sprites, without
+                writing the sprite data or recording metrics, for callers
+                that only need the report. The fetch width must be 16, 32
+                or 64, as encode() checks.
+    @param      image - Sheet holding the cells, colour index 0 is transparent
+    @param      cells - Cells to plan
+    @param      report - Receives how each cell splits, in the order given
+  --------------------------------------------------------------------------*/
+void HardwareSpriteEncoder::plan( ImageView<const uint8_t> image, const std::vector<SpriteRect>& cells, std::vector<HardwareSpriteCell>& report ) const
+{
+    report.resize( cells.size() );
+    for ( size_t nCell = 0; nCell < cells.size(); nCell++ )
+    {
+        HardwareSpriteCell& info = report[ nCell ];
+        const SpriteRect&   cell = cells[ nCell ];
+
+        info   = {};
+        info.x = cell.x;
+        info.y = cell.y;
+        planCell( image.subView( cell.x, cell.y, cell.width, cell.height ), info );
+    }
+}
+
+// Private Functions ----------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Works out the colours, lines and channels of a cell
+    @param      cell - Pixels of the cell
+    @param      info - Cell to fill in, x and y already set
+  --------------------------------------------------------------------------*/
+void HardwareSpriteEncoder::planCell( ImageView<const uint8_t> cell, HardwareSpriteCell& info ) const
+{
+    bool     bUsed[ 256 ] = { false };
+    uint32_t firstRow     = cell.getHeight();
+    uint32_t lastRow      = 0;
+
+    for ( uint32_t y = 0; y < cell.getHeight(); y++ )
+    {
+        const uint8_t* pRow  = cell.getRow( y );
+        uint8_t        solid = 0;
+
+        for ( uint32_t x = 0; x < cell.getWidth(); x++ )
+        {
+            bUsed[ pRow[ x ] ] = true;
+            solid |= pRow[ x ];
+        }
+
+        if ( solid )
+        {
+            firstRow = std::min( firstRow, y );
+            lastRow  = y;
+        }
+    }
+
+    // sprite colours in palette order, the map holds the first 15
+    info.width  = cell.getWidth();
+    info.height = cell.getHeight();
+    for ( uint32_t nIndex = 1; nIndex < 256; nIndex++ )
+    {
+        if ( bUsed[ nIndex ] && ++info.colours < sizeof( info.colourMap ) )
+        {
+            info.colourMap[ info.colours ] = (uint8_t)nIndex;
+        }
+    }
+
+    if ( firstRow == cell.getHeight() )
+    {
+        info.bFits = true;
+        return;
+    }
+
+    info.firstLine = spriteConfig.bTrim ? firstRow : 0;
+    info.lines     = spriteConfig.bTrim ? lastRow - firstRow + 1 : cell.getHeight();
+    info.bAttached = spriteConfig.bAttach && info.colours > 3;
+    info.strips    = ( info.width + spriteConfig.fetchWidth - 1 ) / spriteConfig.fetchWidth;
+    info.channels  = info.strips * ( info.bAttached ? 2 : 1 );
+
+    bool bEncodable = info.colours <= ( info.bAttached ? 15u : 3u ) && info.lines <= HWS_MAX_LINES;
+
+    info.bFits    = bEncodable && info.channels <= HWS_CHANNELS;
+    info.dataSize = bEncodable ? info.channels * ( info.lines + 2 ) * 2 * ( spriteConfig.fetchWidth / 8 ) : 0;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Writes the DMA list of one sprite
+    @param      rows - Rows of the cell the sprite shows
+    @param      colourOf - Sprite colour of each palette index
+    @param      strip - Strip of the cell
+    @param      shift - Bit of the sprite colour held in the first bitplane,
+                0 for a plain or even sprite, 2 for the odd sprite of a pair
+    @param      bAttach - Set the attach bit in the control word
+    @param      pOut - Where to write the list
+    @return     uint8_t* - End of the list
+  --------------------------------------------------------------------------*/
+uint8_t* HardwareSpriteEncoder::writeSprite( ImageView<const uint8_t> rows, const uint8_t* colourOf, uint32_t strip, uint32_t shift, bool bAttach,
+                                             uint8_t* pOut ) const
+{
+    uint32_t fetchBytes = spriteConfig.fetchWidth / 8;
+    uint32_t lines      = rows.getHeight();
+    uint32_t firstX     = strip * spriteConfig.fetchWidth;
+    uint32_t lastX      = std::min( firstX + spriteConfig.fetchWidth, rows.getWidth() );
+    uint16_t control    = (uint16_t)( ( ( lines & 0xFF ) << 8 ) | ( bAttach ? 0x80 : 0 ) | ( ( lines >> 8 ) & 1 ) << 1 );
+
+    // position and control words, each padded out to the fetch width
+    memset( pOut, 0, ( lines + 2 ) * 2 * fetchBytes );
+    pOut[ fetchBytes ]     = (uint8_t)( control >> 8 );
+    pOut[ fetchBytes + 1 ] = (uint8_t)control;
+    pOut += 2 * fetchBytes;
+
+    for ( uint32_t y = 0; y < lines; y++ )
+    {
+        const uint8_t* pRow = rows.getRow( y );
+
+        for ( uint32_t x = firstX; x < lastX; x++ )
+        {
+            uint32_t colour = colourOf[ pRow[ x ] ] >> shift;
+            uint8_t  bit    = 0x80 >> ( ( x - firstX ) & 7 );
+            uint32_t byte   = ( x - firstX ) >> 3;
+
+            if ( colour & 1 )
+            {
+                pOut[ byte ] |= bit;
+            }
+            if ( colour & 2 )
+            {
+                pOut[ fetchBytes + byte ] |= bit;
+            }
+        }
+        pOut += 2 * fetchBytes;
+    }
+
+    // the zero words ending the list were cleared with the rest
+    return pOut + 2 * fetchBytes;
+}
+
+//-----------------------------------------------------------------------------
+
+} // end namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: HardwareSprites.cpp
+// ----------------------------------------------------------------------------
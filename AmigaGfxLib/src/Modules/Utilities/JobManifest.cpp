@@ -0,0 +1,625 @@
+/**----------------------------------------------------------------------------
+
+    @file       JobManifest.cpp
+    @defgroup   AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Manifest of conversion jobs, run in one process
+
+    @copyright  Neil Bereford 2024
+
+Notes:
+
+    The manifest is plain text, one job per line, blank lines and lines
+    starting with # are skipped. Fields are separated by white space, a
+    field holding spaces is written in double quotes:
+
+        # input               cell    outputs      destination
+        art/hero.png          60x60   spr,pal      build/sprites
+        art/sheet.png         auto
+        "art/title card.png"  32x32   all          build/title
+
+    Only the input is required. The cell defaults to auto, which finds the
+    sprites on the sheet, a given cell must be at least 1x1 and no larger
+    than the image, the outputs to all three indexed ones (pal, raw
+    and spr) and the destination to the folder of the input. The Apollo V4
+    truecolour outputs, 565 and argb, are only built when listed. Relative
+    paths are taken from the folder of the manifest. A bad line is
+    reported and skipped, the rest of the manifest still runs. A line that
+    would write a file an earlier line writes is bad too: the jobs run at
+    the same time, and the file would be torn and its CRC wrong.
+
+    All the jobs run on one ThreadPool, scheduled largest input first, so
+    a few big sheets do not end up running alone at the end while the
+    other threads sit idle. The inputs are read through one FileManager
+    with its cache enabled, so an input listed with several cell sizes is
+    read from disk once, and each thread keeps its decode and encode
+    buffers between jobs.
+
+    The results are kept in manifest order, whatever order the jobs ran
+    in, and saved as JSON with the timings of each stage and the size and
+    zlib CRC-32 of every file written.
+
+-----------------------------------------------------------------------------*/
+
+//-----------------------------------------------------------------------------
+// Include files
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+#include <zlib.h>
+
+#include "../../../inc/Modules/Utilities/JobManifest.h"
+#include "../../../inc/Modules/ErrorHandling/ErrorHandler.h"
+
+//-----------------------------------------------------------------------------
+// Namespace
+//-----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Local functions
+//-----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Quotes a string for JSON, escaping quotes, back slashes (as
+                in Windows paths) and control characters
+    @param      text - String to quote
+    @return     std::string - Quoted string
+  --------------------------------------------------------------------------*/
+static std::string JsonString( const std::string& text )
+{
+    std::ostringstream ss;
+
+    ss << '"';
+    for ( char character : text )
+    {
+        if ( character == '"' || character == '\\' )
+        {
+            ss << '\\' << character;
+        }
+        else if ( (unsigned char)character < 0x20 )
+        {
+            ss << "\\u" << std::hex << std::setw( 4 ) << std::setfill( '0' ) << (int)character << std::dec;
+        }
+        else
+        {
+            ss << character;
+        }
+    }
+    ss << '"';
+
+    return ss.str();
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      zlib CRC-32 of a buffer, in blocks zlib's uInt can hold
+    @param      data - Bytes to check
+    @return     uint32_t - CRC-32
+  --------------------------------------------------------------------------*/
+static uint32_t BufferCRC32( const std::vector<uint8_t>& data )
+{
+    uLong crc = crc32( 0L, Z_NULL, 0 );
+
+    for ( size_t offset = 0; offset < data.size(); offset += 0x40000000 )
+    {
+        crc = crc32( crc, data.data() + offset, (uInt)std::min<size_t>( data.size() - offset, 0x40000000 ) );
+    }
+
+    return (uint32_t)crc;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Microseconds between two times
+    @param      from - Earlier time
+    @param      to - Later time
+    @return     uint64_t - Microseconds
+  --------------------------------------------------------------------------*/
+static uint64_t Micros( std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to )
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>( to - from ).count();
+}
+
+//-----------------------------------------------------------------------------
+// Class support functions
+// ----------------------------------------------------------------------------
+
+// Constructor and destructor  -------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Constructor for the JobManifest class, starts the job threads
+    @param      threadCount - Jobs run at once, 0 uses one per hardware thread
+  --------------------------------------------------------------------------*/
+JobManifest::JobManifest( uint32_t threadCount ) : jobPool( threadCount )
+{
+    runMicros = 0;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Destructor for the JobManifest class
+  --------------------------------------------------------------------------*/
+JobManifest::~JobManifest()
+{
+}
+
+// Public Functions ----------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Reads the jobs of a manifest file, relative paths in it are
+                taken from the folder of the manifest
+    @param      fileName - Manifest file
+    @return     bool - false if the file could not be read or a line was bad
+  --------------------------------------------------------------------------*/
+bool JobManifest::load( const std::string& fileName )
+{
+    std::ifstream      file( fileName );
+    std::ostringstream text;
+
+    if ( !file.is_open() )
+    {
+        ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::Manifest_FailedToOpen, "Failed to open manifest " + fileName );
+        return false;
+    }
+
+    text << file.rdbuf();
+    return parse( text.str(), std::filesystem::path( fileName ).parent_path().string() );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Reads the jobs of a manifest held in memory. Bad lines are
+                reported and skipped, the good ones are still added.
+    @param      text - Manifest text
+    @param      basePath - Folder relative paths are taken from
+    @return     bool - false if a line was bad
+  --------------------------------------------------------------------------*/
+bool JobManifest::parse( const std::string& text, const std::string& basePath )
+{
+    std::istringstream lines( text );
+    std::string        line;
+    std::string        error;
+    uint32_t           lineNumber = 0;
+    bool               bValid     = true;
+
+    while ( std::getline( lines, line ) )
+    {
+        ManifestJob job = {};
+        job.line        = ++lineNumber;
+
+        size_t first = line.find_first_not_of( " \t\r" );
+        if ( first == std::string::npos || line[ first ] == '#' )
+        {
+            continue;
+        }
+
+        if ( ParseLine( line, basePath, job, error ) == false )
+        {
+            ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::Manifest_InvalidLine, std::format( "Manifest line {}: {}", lineNumber, error ) );
+            bValid = false;
+            continue;
+        }
+
+        bValid = addJob( job ) && bValid;
+    }
+
+    return bValid;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Adds a job without a manifest. A job that would write a
+                file another job writes is reported and not added, the
+                jobs run at once and would tear each other's files.
+    @param      job - Job, paths used as given
+    @return     bool - false if the job's outputs clash with another job's
+  --------------------------------------------------------------------------*/
+bool JobManifest::addJob( const ManifestJob& job )
+{
+    const ManifestJob* pClash = findClash( job );
+
+    if ( pClash )
+    {
+        ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::Manifest_OutputClash,
+                                                 std::format( "Manifest line {}: writes the outputs of line {} to {}", job.line, pClash->line, OutputBase( job ) ) );
+        return false;
+    }
+
+    jobs.push_back( job );
+    return true;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Runs every job, returning once they have all finished
+    @return     uint32_t - Number of jobs that failed
+  --------------------------------------------------------------------------*/
+uint32_t JobManifest::run()
+{
+    std::vector<uint64_t> inputSizes( jobs.size(), 0 );
+    std::vector<size_t>   schedule( jobs.size() );
+    std::error_code       error;
+    auto                  runStart = std::chrono::steady_clock::now();
+
+    results.assign( jobs.size(), ManifestResult() );
+
+    // largest input first, the input size stands in for the job's cost
+    for ( size_t nJob = 0; nJob < jobs.size(); nJob++ )
+    {
+        uint64_t size      = std::filesystem::file_size( jobs[ nJob ].input, error );
+        inputSizes[ nJob ] = error ? 0 : size;
+    }
+    std::iota( schedule.begin(), schedule.end(), 0 );
+    std::stable_sort( schedule.begin(), schedule.end(), [ &inputSizes ]( size_t a, size_t b ) { return inputSizes[ a ] > inputSizes[ b ]; } );
+
+    for ( size_t jobIndex : schedule )
+    {
+        jobPool.submit( [ this, jobIndex, runStart ]() { runJob( jobIndex, runStart ); } );
+    }
+    jobPool.wait();
+
+    runMicros = Micros( runStart, std::chrono::steady_clock::now() );
+
+    return (uint32_t)std::count_if( results.begin(), results.end(), []( const ManifestResult& result ) { return result.bConverted == false; } );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Saves the results of the last run as JSON
+    @param      fileName - Result manifest to write
+    @return     bool - true if the file was written
+  --------------------------------------------------------------------------*/
+bool JobManifest::saveResults( const std::string& fileName ) const
+{
+    std::ofstream file( fileName );
+    uint32_t      failed = 0;
+
+    if ( !file.is_open() )
+    {
+        return false;
+    }
+
+    for ( const ManifestResult& result : results )
+    {
+        failed += result.bConverted ? 0 : 1;
+    }
+
+    file << "{\n  \"jobs\": " << results.size() << ",\n  \"failed\": " << failed << ",\n  \"threads\": " << jobPool.getThreadCount() << ",\n  \"runMicros\": " << runMicros
+         << ",\n  \"results\": [\n";
+
+    for ( size_t nJob = 0; nJob < results.size(); nJob++ )
+    {
+        const ManifestJob&    job    = jobs[ nJob ];
+        const ManifestResult& result = results[ nJob ];
+
+        file << "    {\n      \"line\": " << job.line << ",\n      \"input\": " << JsonString( job.input ) << ",\n      \"cell\": \""
+             << ( job.sprW && job.sprH ? std::to_string( job.sprW ) + "x" + std::to_string( job.sprH ) : "auto" ) << "\",\n      \"status\": "
+             << ( result.bConverted ? "\"ok\"" : "\"failed\"" ) << ",\n";
+        if ( result.bConverted == false )
+        {
+            file << "      \"error\": " << JsonString( result.error ) << ",\n";
+        }
+        file << "      \"startMicros\": " << result.startMicros << ",\n      \"readMicros\": " << result.readMicros << ",\n      \"decodeMicros\": " << result.decodeMicros
+             << ",\n      \"encodeMicros\": " << result.encodeMicros << ",\n      \"writeMicros\": " << result.writeMicros << ",\n      \"outputs\": [";
+
+        for ( size_t nOutput = 0; nOutput < result.outputs.size(); nOutput++ )
+        {
+            const ManifestOutput& output = result.outputs[ nOutput ];
+
+            file << ( nOutput ? ",\n" : "\n" ) << "        { \"file\": " << JsonString( output.fileName ) << ", \"bytes\": " << output.size << ", \"crc32\": \"" << std::hex
+                 << std::setw( 8 ) << std::setfill( '0' ) << output.crc32 << std::dec << std::setfill( ' ' ) << "\" }";
+        }
+        file << ( result.outputs.empty() ? "]\n" : "\n      ]\n" ) << "    }" << ( nJob + 1 < results.size() ? "," : "" ) << "\n";
+    }
+
+    file << "  ]\n}\n";
+    return (bool)file;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Wall time of the last run
+    @return     uint64_t - Microseconds from the first job starting to the
+                last one finishing
+  --------------------------------------------------------------------------*/
+uint64_t JobManifest::getRunMicros() const
+{
+    return runMicros;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Jobs, in manifest order
+    @return     const std::vector<ManifestJob>& - Jobs
+  --------------------------------------------------------------------------*/
+const std::vector<ManifestJob>& JobManifest::getJobs() const
+{
+    return jobs;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Results of the last run, one per job in manifest order
+    @return     const std::vector<ManifestResult>& - Results
+  --------------------------------------------------------------------------*/
+const std::vector<ManifestResult>& JobManifest::getResults() const
+{
+    return results;
+}
+
+// Private Functions ----------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Runs one job on a pool thread, filling in its result. A throw
+                fails the job with its message as the error.
+    @param      jobIndex - Job to run
+    @param      runStart - Start of the run, for the job's start time
+  --------------------------------------------------------------------------*/
+void JobManifest::runJob( size_t jobIndex, std::chrono::steady_clock::time_point runStart )
+{
+    ManifestResult& result = results[ jobIndex ];
+
+    try
+    {
+        convertJob( jobIndex, runStart );
+        return;
+    }
+    catch ( const std::exception& error )
+    {
+        result.error = error.what();
+    }
+    catch ( ... )
+    {
+        result.error = "unknown exception";
+    }
+
+    result.bConverted = false;
+    ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::Pipeline_ImageFailed, std::format( "Manifest line {}: {}", jobs[ jobIndex ].line, result.error ) );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Reads, converts and writes the files of one job for runJob()
+    @param      jobIndex - Job to run
+    @param      runStart - Start of the run, for the job's start time
+  --------------------------------------------------------------------------*/
+void JobManifest::convertJob( size_t jobIndex, std::chrono::steady_clock::time_point runStart )
+{
+    // each pool thread keeps its buffers from one job to the next
+    thread_local std::vector<uint8_t>       pngData;
+    thread_local DecodedImage               image;
+    thread_local std::vector<ConvertedFile> outputs;
+
+    Tools&             tools  = Tools::getInstance();
+    const ManifestJob& job    = jobs[ jobIndex ];
+    ManifestResult&    result = results[ jobIndex ];
+    auto               start  = std::chrono::steady_clock::now();
+
+    result.startMicros = Micros( runStart, start );
+
+    if ( fileManager.OpenFile( job.input, pngData ) == false )
+    {
+        result.error = "unable to read " + job.input;
+        ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::Pipeline_FailedToReadFile, "Failed to read " + job.input );
+        return;
+    }
+    auto read         = std::chrono::steady_clock::now();
+    result.readMicros = Micros( start, read );
+
+    if ( tools.Decode_PNG( pngData, image ) == false )
+    {
+        result.error = "not an 8 bit indexed PNG or too large";
+        ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::Pipeline_FailedToDecode, "Failed to decode, not an 8 bit indexed PNG or too large " + job.input );
+        return;
+    }
+    auto decoded        = std::chrono::steady_clock::now();
+    result.decodeMicros = Micros( read, decoded );
+
+    if ( job.sprW > image.width || job.sprH > image.height )
+    {
+        result.error = std::format( "cell size {}x{} is larger than the image", job.sprW, job.sprH );
+        ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::Manifest_InvalidLine, std::format( "Manifest line {}: {}", job.line, result.error ) );
+        return;
+    }
+
+    // the output names are built from the image name, so point it at the destination
+    if ( job.destination.empty() == false )
+    {
+        std::error_code error;
+        std::filesystem::create_directories( job.destination, error );
+    }
+    image.fileName.assign( OutputBase( job ) );
+
+    if ( tools.Encode_Image( image, outputs, job.sprW, job.sprH, job.formats ) == false )
+    {
+        result.error = "a sprite position or size is over 65535";
+        return;
+    }
+    auto encoded        = std::chrono::steady_clock::now();
+    result.encodeMicros = Micros( decoded, encoded );
+
+    result.bConverted = true;
+    for ( const ConvertedFile& output : outputs )
+    {
+        if ( fileManager.SaveFile( output.fileName, output.fileData ) == false )
+        {
+            result.bConverted = false;
+            result.error      = "unable to write " + output.fileName;
+            ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::Pipeline_FailedToWriteFile, "Failed to write " + output.fileName );
+            continue;
+        }
+        result.outputs.push_back( { output.fileName, output.fileData.size(), BufferCRC32( output.fileData ) } );
+    }
+    result.writeMicros = Micros( encoded, std::chrono::steady_clock::now() );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Finds a job already added that writes one of the files a
+                job would. The outputs are named from the same base, so
+                jobs sharing a base clash when they share an output. RAW
+                names also hold the image size, which is not known until
+                the image is read, so a shared base and RAW is a clash.
+    @param      job - Job to check
+    @return     const ManifestJob* - Clashing job, nullptr if none
+  --------------------------------------------------------------------------*/
+const ManifestJob* JobManifest::findClash( const ManifestJob& job ) const
+{
+    std::string base = OutputBase( job );
+
+    for ( const ManifestJob& other : jobs )
+    {
+        if ( ( other.formats & job.formats ) && OutputBase( other ) == base )
+        {
+            return &other;
+        }
+    }
+    return nullptr;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Returns the name a job's outputs are built from, the input
+                moved to the destination folder
+    @param      job - Job
+    @return     std::string - Output base name, the extensions are added to it
+  --------------------------------------------------------------------------*/
+std::string JobManifest::OutputBase( const ManifestJob& job )
+{
+    std::filesystem::path base = job.destination.empty() ? std::filesystem::path( job.input ) : std::filesystem::path( job.destination ) / std::filesystem::path( job.input ).filename();
+    return base.lexically_normal().string();
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Reads one manifest line into a job
+    @param      line - Manifest line, not blank or a comment
+    @param      basePath - Folder relative paths are taken from
+    @param      job - Receives the job
+    @param      error - Receives why the line is bad
+    @return     bool - false if the line is bad
+  --------------------------------------------------------------------------*/
+bool JobManifest::ParseLine( const std::string& line, const std::string& basePath, ManifestJob& job, std::string& error )
+{
+    std::istringstream       input( line );
+    std::vector<std::string> fields;
+    std::string              field;
+
+    while ( input >> std::ws && input.peek() != EOF )
+    {
+        if ( input.peek() == '"' )
+        {
+            input >> std::quoted( field );
+        }
+        else
+        {
+            input >> field;
+        }
+        fields.push_back( field );
+    }
+
+    if ( fields.empty() || fields.size() > 4 )
+    {
+        error = "expected <png> [<W>x<H>|auto [<outputs> [<destination>]]]";
+        return false;
+    }
+
+    auto resolve = [ &basePath ]( const std::string& path ) {
+        return basePath.empty() || std::filesystem::path( path ).is_absolute() ? path : ( std::filesystem::path( basePath ) / path ).string();
+    };
+
+    job.input   = resolve( fields[ 0 ] );
+    job.formats = OutputAll;
+    job.sprW    = 0;
+    job.sprH    = 0;
+
+    if ( fields.size() > 1 && fields[ 1 ] != "auto" )
+    {
+        // read signed, so a negative size is refused rather than wrapped
+        auto number = []( const std::string& text, int64_t& value ) {
+            auto [ pEnd, result ] = std::from_chars( text.data(), text.data() + text.size(), value );
+            return text.empty() == false && result == std::errc() && pEnd == text.data() + text.size();
+        };
+
+        const std::string& cell  = fields[ 1 ];
+        size_t             cross = cell.find_first_of( "xX" );
+        int64_t            width = 0, height = 0;
+
+        if ( cross == std::string::npos || number( cell.substr( 0, cross ), width ) == false || number( cell.substr( cross + 1 ), height ) == false )
+        {
+            error = "cell size '" + cell + "' is not <W>x<H> or auto";
+            return false;
+        }
+        if ( width < 1 || height < 1 || width > UINT32_MAX || height > UINT32_MAX )
+        {
+            error = "cell size '" + cell + "' is out of range, a cell is at least 1x1";
+            return false;
+        }
+        job.sprW = (uint32_t)width;
+        job.sprH = (uint32_t)height;
+    }
+
+    if ( fields.size() > 2 && fields[ 2 ] != "all" )
+    {
+        std::istringstream formats( fields[ 2 ] );
+        std::string        format;
+
+        job.formats = 0;
+        while ( std::getline( formats, format, ',' ) )
+        {
+            if ( format == "pal" )
+            {
+                job.formats |= OutputPalette;
+            }
+            else if ( format == "raw" )
+            {
+                job.formats |= OutputRaw;
+            }
+            else if ( format == "spr" )
+            {
+                job.formats |= OutputSprites;
+            }
+            else if ( format == "565" )
+            {
+                job.formats |= OutputRgb565;
+            }
+            else if ( format == "argb" )
+            {
+                job.formats |= OutputArgb32;
+            }
+            else
+            {
+                error = "unknown output '" + format + "', expected pal, raw, spr, 565, argb or all";
+                return false;
+            }
+        }
+    }
+
+    if ( fields.size() > 3 )
+    {
+        job.destination = resolve( fields[ 3 ] );
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+
+} // end namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: JobManifest.cpp
+// ----------------------------------------------------------------------------
@@ -0,0 +1,488 @@
+/**----------------------------------------------------------------------------
+
+    @file       Metrics.cpp
+    @defgroup   AmigaGfxLIBMetrics AmigaGfx Library Metrics Module
+    @brief      Pipeline stage timers and counters
+
+    @copyright  Neil Bereford 2024
+
+Notes:
+
+    Low overhead instrumentation of the conversion pipeline. Stages are
+    timed with ScopedTimer (std::chrono::steady_clock, which is a vDSO
+    call on Linux and QueryPerformanceCounter on Windows, so it stays
+    portable unlike reading the TSC directly). Counters record bytes in
+    and out, images, sprites and the sprite commands emitted per type.
+
+    Each thread records into its own ThreadMetrics block, found through a
+    thread_local pointer, so recording is an uncontended relaxed atomic
+    add. The blocks are only summed when a report is asked for, which
+    gives both the per thread figures and the run totals. When a thread
+    exits its block is added to the retired totals and freed, so a program
+    that keeps starting threads, a server or a watch loop, does not grow
+    the registry without end. The run totals include the exited threads,
+    the per thread figures are of the threads still running.
+
+    Call saveSummary() at the end of a run, the file extension picks the
+    format (.csv for CSV, anything else JSON).
+
+-----------------------------------------------------------------------------*/
+
+//-----------------------------------------------------------------------------
+// Include files
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "../../../inc/Modules/Utilities/Metrics.h"
+
+//-----------------------------------------------------------------------------
+// Namespace
+//-----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Local Data
+//-----------------------------------------------------------------------------
+
+static const char* stageNames[] = {
+    "PngDecode", "PixelCopy", "Compress", "PaletteWrite", "FileWrite", "FileRead", "DirectoryWalk", "PngEncode", "SpriteSlice", "TrueColour",
+};
+
+static const char* counterNames[] = {
+    "BytesIn", "BytesOut", "ImagesConverted", "SpritesEncoded", "OpSkip", "OpLiteral", "OpFill", "OpEndLine", "OpEndSprite", "BufferAllocations", "PalettesWritten",
+    "PalettesShared",
+};
+
+static_assert( sizeof( stageNames ) / sizeof( stageNames[ 0 ] ) == (size_t)MetricStage::TotalStages );
+static_assert( sizeof( counterNames ) / sizeof( counterNames[ 0 ] ) == (size_t)MetricCounter::TotalCounters );
+
+//-----------------------------------------------------------------------------
+// Class support functions
+// ----------------------------------------------------------------------------
+
+// Constructor and destructor  -------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBMetrics AmigaGfx Library Metrics Module
+    @brief      Constructor for the Metrics class
+
+  --------------------------------------------------------------------------*/
+Metrics::Metrics()
+{
+    retiredTotals.Clear();
+    nextThreadIndex = 0;
+    enabled         = true;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBMetrics AmigaGfx Library Metrics Module
+    @brief      Destructor for the Metrics class
+
+  --------------------------------------------------------------------------*/
+Metrics::~Metrics()
+{
+}
+
+// Recording -------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBMetrics AmigaGfx Library Metrics Module
+    @brief      Adds a timed call to a stage
+    @param      stage - Stage that was timed
+    @param      nanoSeconds - Time taken
+  --------------------------------------------------------------------------*/
+void Metrics::addTime( MetricStage stage, uint64_t nanoSeconds )
+{
+    if ( enabled.load( std::memory_order_relaxed ) )
+    {
+        ThreadMetrics& metrics = getThreadMetrics();
+        metrics.stageCalls[ (size_t)stage ].fetch_add( 1, std::memory_order_relaxed );
+        metrics.stageNanos[ (size_t)stage ].fetch_add( nanoSeconds, std::memory_order_relaxed );
+    }
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBMetrics AmigaGfx Library Metrics Module
+    @brief      Adds to a counter
+    @param      counter - Counter to add to
+    @param      count - Amount to add
+  --------------------------------------------------------------------------*/
+void Metrics::addCount( MetricCounter counter, uint64_t count )
+{
+    if ( enabled.load( std::memory_order_relaxed ) && count )
+    {
+        getThreadMetrics().counters[ (size_t)counter ].fetch_add( count, std::memory_order_relaxed );
+    }
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBMetrics AmigaGfx Library Metrics Module
+    @brief      Enables or disables recording
+    @param      enable - True to record
+  --------------------------------------------------------------------------*/
+void Metrics::setEnabled( bool enable )
+{
+    enabled = enable;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBMetrics AmigaGfx Library Metrics Module
+    @brief      Checks if recording is enabled
+    @return     bool - True if recording
+  --------------------------------------------------------------------------*/
+bool Metrics::isEnabled() const
+{
+    return enabled.load( std::memory_order_relaxed );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBMetrics AmigaGfx Library Metrics Module
+    @brief      Sets all the timers and counters back to zero
+
+  --------------------------------------------------------------------------*/
+void Metrics::reset()
+{
+    std::lock_guard<std::mutex> lock( registryLock );
+
+    for ( auto& metrics : threadMetrics )
+    {
+        for ( size_t nIndex = 0; nIndex < (size_t)MetricStage::TotalStages; nIndex++ )
+        {
+            metrics->stageCalls[ nIndex ] = 0;
+            metrics->stageNanos[ nIndex ] = 0;
+        }
+        for ( auto& counter : metrics->counters )
+        {
+            counter = 0;
+        }
+    }
+    retiredTotals.Clear();
+}
+
+// Reporting -------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBMetrics AmigaGfx Library Metrics Module
+    @brief      Sums the metrics of all the threads
+    @return     MetricTotals - Run totals
+  --------------------------------------------------------------------------*/
+MetricTotals Metrics::getTotals()
+{
+    std::lock_guard<std::mutex> lock( registryLock );
+    MetricTotals                totals;
+
+    totals.Clear();
+    addRetired( totals );
+    for ( auto& metrics : threadMetrics )
+    {
+        addTotals( totals, *metrics );
+    }
+
+    return totals;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBMetrics AmigaGfx Library Metrics Module
+    @brief      Builds a JSON summary, run totals followed by each thread
+    @return     std::string - JSON text
+  --------------------------------------------------------------------------*/
+std::string Metrics::toJSON()
+{
+    std::lock_guard<std::mutex> lock( registryLock );
+    std::stringstream           ss;
+    MetricTotals                totals;
+    MetricTotals                local;
+
+    auto                        writeTotals = [ &ss ]( const MetricTotals& values, const char* indent ) {
+        ss << indent << "\"stages\": {\n";
+        for ( size_t nIndex = 0; nIndex < (size_t)MetricStage::TotalStages; nIndex++ )
+        {
+            ss << indent << "  \"" << stageNames[ nIndex ] << "\": { \"calls\": " << values.stageCalls[ nIndex ] << ", \"ms\": " << std::fixed << std::setprecision( 3 )
+               << values.stageNanos[ nIndex ] / 1000000.0 << " }" << ( nIndex + 1 < (size_t)MetricStage::TotalStages ? "," : "" ) << "\n";
+        }
+        ss << indent << "},\n" << indent << "\"counters\": {\n";
+        for ( size_t nIndex = 0; nIndex < (size_t)MetricCounter::TotalCounters; nIndex++ )
+        {
+            ss << indent << "  \"" << counterNames[ nIndex ] << "\": " << values.counters[ nIndex ] << ( nIndex + 1 < (size_t)MetricCounter::TotalCounters ? "," : "" ) << "\n";
+        }
+        ss << indent << "}\n";
+    };
+
+    totals.Clear();
+    addRetired( totals );
+    for ( auto& metrics : threadMetrics )
+    {
+        addTotals( totals, *metrics );
+    }
+
+    ss << "{\n  \"totals\": {\n";
+    writeTotals( totals, "    " );
+    ss << "  },\n  \"threads\": [\n";
+    for ( size_t nThread = 0; nThread < threadMetrics.size(); nThread++ )
+    {
+        local.Clear();
+        addTotals( local, *threadMetrics[ nThread ] );
+        ss << "    {\n      \"thread\": " << threadMetrics[ nThread ]->threadIndex << ",\n";
+        writeTotals( local, "      " );
+        ss << "    }" << ( nThread + 1 < threadMetrics.size() ? "," : "" ) << "\n";
+    }
+    ss << "  ]\n}\n";
+
+    return ss.str();
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBMetrics AmigaGfx Library Metrics Module
+    @brief      Builds a CSV summary, one row per thread and metric, with the
+                run totals given as thread "total"
+    @return     std::string - CSV text
+  --------------------------------------------------------------------------*/
+std::string Metrics::toCSV()
+{
+    std::lock_guard<std::mutex> lock( registryLock );
+    std::stringstream           ss;
+    MetricTotals                totals;
+    MetricTotals                local;
+
+    auto                        writeRows = [ &ss ]( const MetricTotals& values, const std::string& thread ) {
+        for ( size_t nIndex = 0; nIndex < (size_t)MetricStage::TotalStages; nIndex++ )
+        {
+            ss << thread << ",stage," << stageNames[ nIndex ] << "," << values.stageCalls[ nIndex ] << "," << std::fixed << std::setprecision( 3 ) << values.stageNanos[ nIndex ] / 1000000.0 << "\n";
+        }
+        for ( size_t nIndex = 0; nIndex < (size_t)MetricCounter::TotalCounters; nIndex++ )
+        {
+            ss << thread << ",counter," << counterNames[ nIndex ] << ",," << values.counters[ nIndex ] << "\n";
+        }
+    };
+
+    totals.Clear();
+    addRetired( totals );
+    for ( auto& metrics : threadMetrics )
+    {
+        addTotals( totals, *metrics );
+    }
+
+    ss << "thread,kind,name,calls,value\n";
+    writeRows( totals, "total" );
+    for ( auto& metrics : threadMetrics )
+    {
+        local.Clear();
+        addTotals( local, *metrics );
+        writeRows( local, std::to_string( metrics->threadIndex ) );
+    }
+
+    return ss.str();
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBMetrics AmigaGfx Library Metrics Module
+    @brief      Saves the summary to disk, .csv files are written as CSV and
+                everything else as JSON
+    @param      fileName - File to write
+    @return     bool - True if the file was written
+  --------------------------------------------------------------------------*/
+bool Metrics::saveSummary( const std::string& fileName )
+{
+    std::string   summary = fileName.ends_with( ".csv" ) ? toCSV() : toJSON();
+    std::ofstream file( fileName );
+
+    if ( !file.is_open() )
+    {
+        return false;
+    }
+
+    file << summary;
+    return (bool)file;
+}
+
+// Names -----------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBMetrics AmigaGfx Library Metrics Module
+    @brief      Returns the name of a stage
+    @param      stage - Stage
+    @return     const char* - Name used in the reports
+  --------------------------------------------------------------------------*/
+const char* Metrics::getStageName( MetricStage stage )
+{
+    return stage < MetricStage::TotalStages ? stageNames[ (size_t)stage ] : "Unknown";
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBMetrics AmigaGfx Library Metrics Module
+    @brief      Returns the name of a counter
+    @param      counter - Counter
+    @return     const char* - Name used in the reports
+  --------------------------------------------------------------------------*/
+const char* Metrics::getCounterName( MetricCounter counter )
+{
+    return counter < MetricCounter::TotalCounters ? counterNames[ (size_t)counter ] : "Unknown";
+}
+
+// Private functions -----------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBMetrics AmigaGfx Library Metrics Module
+    @brief      Returns the metrics block of the calling thread, creating it
+                on the first call from that thread. The block is released
+                when the thread exits.
+    @return     ThreadMetrics& - Metrics of this thread
+  --------------------------------------------------------------------------*/
+Metrics::ThreadMetrics& Metrics::getThreadMetrics()
+{
+    // releases the thread's block when the thread exits
+    struct ThreadSlot
+    {
+        ThreadMetrics** ppMetrics = nullptr;
+
+        ~ThreadSlot()
+        {
+            if ( ppMetrics && *ppMetrics )
+            {
+                Metrics::getInstance().releaseThreadMetrics( *ppMetrics );
+                *ppMetrics = nullptr;
+            }
+        }
+    };
+
+    thread_local ThreadMetrics* pMetrics = nullptr;
+
+    if ( pMetrics == nullptr )
+    {
+        thread_local ThreadSlot     slot;
+        std::lock_guard<std::mutex> lock( registryLock );
+        auto                        metrics = std::make_unique<ThreadMetrics>();
+
+        metrics->threadIndex                = nextThreadIndex++;
+        for ( size_t nIndex = 0; nIndex < (size_t)MetricStage::TotalStages; nIndex++ )
+        {
+            metrics->stageCalls[ nIndex ] = 0;
+            metrics->stageNanos[ nIndex ] = 0;
+        }
+        for ( auto& counter : metrics->counters )
+        {
+            counter = 0;
+        }
+
+        pMetrics       = metrics.get();
+        slot.ppMetrics = &pMetrics;
+        threadMetrics.push_back( std::move( metrics ) );
+    }
+
+    return *pMetrics;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBMetrics AmigaGfx Library Metrics Module
+    @brief      Adds the metrics block of an exiting thread to the retired
+                totals and frees it
+    @param      pMetrics - Block of the exiting thread
+  --------------------------------------------------------------------------*/
+void Metrics::releaseThreadMetrics( ThreadMetrics* pMetrics )
+{
+    std::lock_guard<std::mutex> lock( registryLock );
+    auto found = std::find_if( threadMetrics.begin(), threadMetrics.end(), [ pMetrics ]( const auto& metrics ) { return metrics.get() == pMetrics; } );
+
+    if ( found != threadMetrics.end() )
+    {
+        addTotals( retiredTotals, **found );
+        threadMetrics.erase( found );
+    }
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBMetrics AmigaGfx Library Metrics Module
+    @brief      Adds the metrics of one thread to the totals
+    @param      totals - Totals to add to
+    @param      metrics - Thread metrics
+  --------------------------------------------------------------------------*/
+void Metrics::addTotals( MetricTotals& totals, const ThreadMetrics& metrics )
+{
+    for ( size_t nIndex = 0; nIndex < (size_t)MetricStage::TotalStages; nIndex++ )
+    {
+        totals.stageCalls[ nIndex ] += metrics.stageCalls[ nIndex ].load( std::memory_order_relaxed );
+        totals.stageNanos[ nIndex ] += metrics.stageNanos[ nIndex ].load( std::memory_order_relaxed );
+    }
+    for ( size_t nIndex = 0; nIndex < (size_t)MetricCounter::TotalCounters; nIndex++ )
+    {
+        totals.counters[ nIndex ] += metrics.counters[ nIndex ].load( std::memory_order_relaxed );
+    }
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBMetrics AmigaGfx Library Metrics Module
+    @brief      Adds the metrics of the exited threads to the totals,
+                registryLock must be held
+    @param      totals - Totals to add to
+  --------------------------------------------------------------------------*/
+void Metrics::addRetired( MetricTotals& totals )
+{
+    for ( size_t nIndex = 0; nIndex < (size_t)MetricStage::TotalStages; nIndex++ )
+    {
+        totals.stageCalls[ nIndex ] += retiredTotals.stageCalls[ nIndex ];
+        totals.stageNanos[ nIndex ] += retiredTotals.stageNanos[ nIndex ];
+    }
+    for ( size_t nIndex = 0; nIndex < (size_t)MetricCounter::TotalCounters; nIndex++ )
+    {
+        totals.counters[ nIndex ] += retiredTotals.counters[ nIndex ];
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+/**----------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBMetrics AmigaGfx Library Metrics Module
+    @brief      Clears all the members of MetricTotals
+    @return     void
+  --------------------------------------------------------------------------*/
+void MetricTotals::Clear()
+{
+    stageCalls.fill( 0 );
+    stageNanos.fill( 0 );
+    counters.fill( 0 );
+}
+
+//-----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBMetrics AmigaGfx Library Metrics Module
+    @brief      Starts timing a stage
+    @param      timedStage - Stage to add the time to
+  --------------------------------------------------------------------------*/
+ScopedTimer::ScopedTimer( MetricStage timedStage )
+{
+    stage   = timedStage;
+    running = Metrics::getInstance().isEnabled();
+    if ( running )
+    {
+        start = std::chrono::steady_clock::now();
+    }
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBMetrics AmigaGfx Library Metrics Module
+    @brief      Adds the time since construction to the stage
+
+  --------------------------------------------------------------------------*/
+ScopedTimer::~ScopedTimer()
+{
+    if ( running )
+    {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        Metrics::getInstance().addTime( stage, std::chrono::duration_cast<std::chrono::nanoseconds>( elapsed ).count() );
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+} // namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: Metrics.cpp
+// ----------------------------------------------------------------------------
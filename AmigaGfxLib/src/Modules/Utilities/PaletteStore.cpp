@@ -0,0 +1,290 @@
+/**----------------------------------------------------------------------------
+
+    @file       PaletteStore.cpp
+    @defgroup   AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Content addressed store of Apollo V4 palettes
+
+    @copyright  Neil Bereford 2024
+
+Notes:
+
+    Read_PNG() writes palette.bin for every image, and the pipeline a .PAL
+    beside every image, so a batch of sheets drawn with one palette writes
+    that palette once per image. The store writes it once.
+
+    A palette's ID is a 64 bit hash of its Apollo V4 palette data, and its
+    file is palette-<ID as 16 hex digits>.PAL in the store folder. The same
+    palette gets the same file name in every run, so a file already on
+    disk holding the same data is not written again, one holding anything
+    else, a stale or damaged file, is overwritten. The file is checked and
+    written outside the store lock, so threads adding other palettes are
+    not held up by the disk. A palette is only reported as stored once its
+    file is on disk, a thread adding it while another writes it waits for
+    the write, and takes it over if the write failed. Two different
+    palettes with the same hash are told apart by comparing the data, the
+    second takes the next free ID.
+
+    Each add() records the palette of the output it was called for,
+    replacing the one recorded before, so converting an image again keeps
+    one line for it. saveIndex() writes palettes.idx, one "<output>
+    <palette ID>" line per output, sorted by output name so the file is
+    the same whatever order the threads ran in. Outputs inside the store
+    folder are given relative to it.
+
+-----------------------------------------------------------------------------*/
+
+//-----------------------------------------------------------------------------
+// Include files
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "../../../inc/Modules/Utilities/PaletteStore.h"
+#include "../../../inc/Modules/Utilities/Metrics.h"
+#include "../../../inc/Modules/Utilities/Tools.h"
+#include "../../../inc/Modules/ErrorHandling/ErrorHandler.h"
+
+//-----------------------------------------------------------------------------
+// Namespace
+//-----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Class support functions
+// ----------------------------------------------------------------------------
+
+// Constructor and destructor  -------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Constructor for the PaletteStore class
+    @param      folder - Folder for the palette files and the index, created
+                when the first palette is written
+  --------------------------------------------------------------------------*/
+PaletteStore::PaletteStore( const std::string& folder ) : storeFolder( folder )
+{
+    writeCount = 0;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Destructor for the PaletteStore class
+  --------------------------------------------------------------------------*/
+PaletteStore::~PaletteStore()
+{
+}
+
+// Public Functions ----------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Adds the palette of an output, writing the palette file the
+                first time the palette is seen. Can be called from any
+                number of threads at once.
+    @param      palette - Palette colours
+    @param      outputName - Output using the palette, recorded in the index
+    @param      paletteId - Receives the palette ID
+    @return     bool - false if the palette file could not be written
+  --------------------------------------------------------------------------*/
+bool PaletteStore::add( const std::vector<png_color>& palette, const std::string& outputName, uint64_t& paletteId )
+{
+    thread_local std::vector<uint8_t> paletteData;
+
+    Tools::getInstance().Build_ApolloV4_Palette( palette, paletteData );
+    uint64_t hashId = Tools::getInstance().hash64( paletteData.data(), paletteData.size() );
+
+    std::unique_lock<std::mutex> guard( lock );
+    auto                         found = palettes.end();
+
+    while ( true )
+    {
+        // a matching hash with different data takes the next ID along
+        paletteId = hashId;
+        found     = palettes.find( paletteId );
+        while ( found != palettes.end() && found->second.paletteData != paletteData )
+        {
+            found = palettes.find( ++paletteId );
+        }
+
+        if ( found == palettes.end() || found->second.bOnDisk )
+        {
+            break;
+        }
+
+        // another thread is writing this palette, wait until it is on disk or has failed
+        fileDone.wait( guard );
+    }
+
+    if ( found != palettes.end() )
+    {
+        references[ outputName ] = paletteId;
+        Metrics::getInstance().addCount( MetricCounter::PalettesShared );
+        return true;
+    }
+
+    palettes.emplace( paletteId, PaletteEntry{ .paletteData = paletteData, .bOnDisk = false } );
+    guard.unlock();
+
+    // the file name is the content, one already holding this palette is left alone
+    std::string fileName = getFileName( paletteId );
+    bool        bWritten = false;
+    bool        bOnDisk  = FileMatches( fileName, paletteData );
+
+    if ( bOnDisk == false )
+    {
+        ScopedTimer     timer( MetricStage::PaletteWrite );
+        std::error_code error;
+
+        std::filesystem::create_directories( storeFolder, error );
+        std::ofstream file( fileName, std::ios::binary );
+
+        file.write( (const char*)paletteData.data(), paletteData.size() );
+        file.close();
+        bOnDisk  = (bool)file;
+        bWritten = bOnDisk;
+    }
+
+    // only now is the palette published, to this output and to the waiting threads
+    guard.lock();
+    if ( bOnDisk == false )
+    {
+        palettes.erase( paletteId );
+        fileDone.notify_all();
+        ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::Palette_FailedToWrite, "Failed to write palette " + fileName );
+        return false;
+    }
+
+    palettes[ paletteId ].bOnDisk = true;
+    references[ outputName ]      = paletteId;
+    fileDone.notify_all();
+
+    if ( bWritten )
+    {
+        writeCount++;
+        Metrics::getInstance().addCount( MetricCounter::PalettesWritten );
+        Metrics::getInstance().addCount( MetricCounter::BytesOut, paletteData.size() );
+    }
+
+    return true;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      File holding a palette
+    @param      paletteId - Palette ID from add()
+    @return     std::string - Palette file name
+  --------------------------------------------------------------------------*/
+std::string PaletteStore::getFileName( uint64_t paletteId ) const
+{
+    std::ostringstream name;
+
+    name << "palette-" << std::hex << std::setw( 16 ) << std::setfill( '0' ) << paletteId << ".PAL";
+    return ( std::filesystem::path( storeFolder ) / name.str() ).string();
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Writes the index, the palette ID of every output added, in
+                one write
+    @return     bool - false if the index could not be written
+  --------------------------------------------------------------------------*/
+bool PaletteStore::saveIndex() const
+{
+    std::map<std::string, uint64_t> sorted;
+    std::ostringstream              index;
+    std::error_code                 error;
+
+    {
+        std::lock_guard<std::mutex> guard( lock );
+        sorted = references;
+    }
+
+    // outputs inside the store folder are listed relative to it
+    for ( const auto& [ outputName, paletteId ] : sorted )
+    {
+        std::string relative = std::filesystem::path( outputName ).lexically_relative( storeFolder ).generic_string();
+
+        index << ( relative.empty() || relative.starts_with( ".." ) ? outputName : relative ) << ' ';
+        index << std::hex << std::setw( 16 ) << std::setfill( '0' ) << paletteId << std::dec << '\n';
+    }
+
+    std::filesystem::create_directories( storeFolder, error );
+    std::ofstream file( getIndexName(), std::ios::binary );
+    std::string   text = index.str();
+
+    file.write( text.data(), text.size() );
+    return (bool)file;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      File saveIndex() writes
+    @return     std::string - Index file name
+  --------------------------------------------------------------------------*/
+std::string PaletteStore::getIndexName() const
+{
+    return ( std::filesystem::path( storeFolder ) / "palettes.idx" ).string();
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Number of unique palettes added, a palette still being
+                written is not counted
+    @return     uint32_t - Palette count
+  --------------------------------------------------------------------------*/
+uint32_t PaletteStore::getPaletteCount() const
+{
+    std::lock_guard<std::mutex> guard( lock );
+    return (uint32_t)std::count_if( palettes.begin(), palettes.end(), []( const auto& entry ) { return entry.second.bOnDisk; } );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Number of palette files written, a palette already on disk
+                from an earlier run is not counted
+    @return     uint32_t - Files written
+  --------------------------------------------------------------------------*/
+uint32_t PaletteStore::getWriteCount() const
+{
+    std::lock_guard<std::mutex> guard( lock );
+    return writeCount;
+}
+
+// Private Functions ----------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Checks a palette file on disk holds exactly the palette data
+    @param      fileName - Palette file
+    @param      paletteData - Apollo V4 palette data
+    @return     bool - true if the file exists and its contents match
+  --------------------------------------------------------------------------*/
+bool PaletteStore::FileMatches( const std::string& fileName, const std::vector<uint8_t>& paletteData )
+{
+    std::error_code error;
+
+    if ( std::filesystem::file_size( fileName, error ) != paletteData.size() || error )
+    {
+        return false;
+    }
+
+    std::ifstream        file( fileName, std::ios::binary );
+    std::vector<uint8_t> fileData( paletteData.size() );
+
+    file.read( (char*)fileData.data(), fileData.size() );
+    return file && fileData == paletteData;
+}
+
+//-----------------------------------------------------------------------------
+
+} // end namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: PaletteStore.cpp
+// ----------------------------------------------------------------------------
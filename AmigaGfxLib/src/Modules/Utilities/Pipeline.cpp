@@ -0,0 +1,424 @@
+/**----------------------------------------------------------------------------
+
+    @file       Pipeline.cpp
+    @defgroup   AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Staged coroutine conversion pipeline
+
+    @copyright  Neil Bereford 2024
+
+Notes:
+
+    Read_PNG() decodes, compresses and writes one image after another, so
+    the disk and the CPU are never busy at the same time. The pipeline
+    splits the work into four stages joined by bounded AsyncChannels:
+
+        read   - loads the PNG file (FileManager, cache disabled)
+        decode - Tools::Decode_PNG()
+        encode - Tools::Encode_Image(), builds the RAW, SPR and palette,
+                 or hands the palette to a PaletteStore when there is one
+        write  - writes the output files behind the encoder
+
+    Each stage runs one coroutine per thread on its own ThreadPool, so the
+    concurrency of each stage is set separately. A stage waiting on a full
+    or empty channel suspends rather than holding its thread, and the
+    channel depth bounds the images in flight, which caps the memory used
+    however many files are queued.
+
+    The read buffers, decoded images and output file sets are taken from
+    ObjectPools and handed back once the next stage is done with them, and
+    libpng decodes into the thread arena, so once warmed up the decode and
+    encode stages convert an image without any heap allocation (the
+    BufferAllocations metric stays flat). File I/O through FileManager
+    still allocates its stream objects.
+
+    The read stage takes the file names from a blocking Channel, normally
+    filled by FileManager::walkFiles() on another thread. Failed images
+    are reported to the ErrorHandler and counted, the rest carry on. An
+    exception thrown converting an image, such as std::bad_alloc or a
+    throwing write, fails only that image. One that escapes a stage
+    anyway ends that stage coroutine, which is reported and closes its
+    side of the channel, so the other stages still finish.
+
+-----------------------------------------------------------------------------*/
+
+//-----------------------------------------------------------------------------
+// Include files
+// ----------------------------------------------------------------------------
+
+#include "../../../inc/Modules/Utilities/Pipeline.h"
+#include "../../../inc/Modules/ErrorHandling/ErrorHandler.h"
+
+//-----------------------------------------------------------------------------
+// Namespace
+//-----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Macros
+//-----------------------------------------------------------------------------
+
+//! Objects each pool keeps, enough for every channel slot and stage thread
+#define POOL_SIZE( config ) ( 3 * ( config.channelDepth + 1 ) + config.readThreads + config.writeThreads + 2 * std::thread::hardware_concurrency() )
+
+//-----------------------------------------------------------------------------
+// Local functions
+//-----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Describes an exception for an error message
+    @param      exception - Exception caught
+    @return     std::string - Its what(), or a note that it was not a
+                std::exception
+  --------------------------------------------------------------------------*/
+static std::string ExceptionText( std::exception_ptr exception )
+{
+    try
+    {
+        std::rethrow_exception( exception );
+    }
+    catch ( const std::exception& error )
+    {
+        return error.what();
+    }
+    catch ( ... )
+    {
+        return "unknown exception";
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Class support functions
+// ----------------------------------------------------------------------------
+
+// Constructor and destructor  -------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Constructor for the ConvertPipeline class, starts the stage
+                threads, which are kept between runs
+    @param      config - Stage concurrency, channel depth and sprite grid
+  --------------------------------------------------------------------------*/
+ConvertPipeline::ConvertPipeline( const PipelineConfig& config )
+    : readPool( config.readThreads ), decodePool( config.decodeThreads ), encodePool( config.encodeThreads ), writePool( config.writeThreads ),
+      jobPool( POOL_SIZE( config ) ), imagePool( POOL_SIZE( config ) ), outputPool( POOL_SIZE( config ) )
+{
+    channelDepth    = config.channelDepth;
+    spriteWidth     = config.spriteWidth;
+    spriteHeight    = config.spriteHeight;
+    paletteStore    = config.paletteStore;
+    runningStages   = 0;
+    convertedImages = 0;
+    failedImages    = 0;
+
+    // every file is read once, caching them would only hold memory
+    fileManager.setCaching( false );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Destructor for the ConvertPipeline class
+
+  --------------------------------------------------------------------------*/
+ConvertPipeline::~ConvertPipeline()
+{
+}
+
+// Public Functions ----------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Converts every PNG taken from the channel, returning once
+                the channel is closed and all the images have been written
+    @param      pngFiles - Channel of PNG file names, closed by the producer
+    @return     uint32_t - Number of images converted
+  --------------------------------------------------------------------------*/
+uint32_t ConvertPipeline::run( Channel<std::string>& pngFiles )
+{
+    AsyncChannel<FileJob>                    readToDecode( channelDepth, readPool.getThreadCount() );
+    AsyncChannel<DecodedImage>               decodeToEncode( channelDepth, decodePool.getThreadCount() );
+    AsyncChannel<std::vector<ConvertedFile>> encodeToWrite( channelDepth, encodePool.getThreadCount() );
+
+    convertedImages = 0;
+    failedImages    = 0;
+    runningStages   = readPool.getThreadCount() + decodePool.getThreadCount() + encodePool.getThreadCount() + writePool.getThreadCount();
+
+    for ( uint32_t nStage = 0; nStage < readPool.getThreadCount(); nStage++ )
+    {
+        readStage( pngFiles, readToDecode )
+            .onException( [ this, &readToDecode ]( std::exception_ptr exception ) {
+                readToDecode.producerDone();
+                stageFailed( exception );
+            } )
+            .start( readPool );
+    }
+    for ( uint32_t nStage = 0; nStage < decodePool.getThreadCount(); nStage++ )
+    {
+        decodeStage( readToDecode, decodeToEncode )
+            .onException( [ this, &decodeToEncode ]( std::exception_ptr exception ) {
+                decodeToEncode.producerDone();
+                stageFailed( exception );
+            } )
+            .start( decodePool );
+    }
+    for ( uint32_t nStage = 0; nStage < encodePool.getThreadCount(); nStage++ )
+    {
+        encodeStage( decodeToEncode, encodeToWrite )
+            .onException( [ this, &encodeToWrite ]( std::exception_ptr exception ) {
+                encodeToWrite.producerDone();
+                stageFailed( exception );
+            } )
+            .start( encodePool );
+    }
+    for ( uint32_t nStage = 0; nStage < writePool.getThreadCount(); nStage++ )
+    {
+        writeStage( encodeToWrite ).onException( [ this ]( std::exception_ptr exception ) { stageFailed( exception ); } ).start( writePool );
+    }
+
+    // wait for the last stage coroutine to finish
+    for ( uint32_t running = runningStages; running != 0; running = runningStages )
+    {
+        runningStages.wait( running );
+    }
+
+    // let the coroutines finish tidying up before the channels go
+    readPool.wait();
+    decodePool.wait();
+    encodePool.wait();
+    writePool.wait();
+
+    return convertedImages;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Number of images that failed in the last run
+    @return     uint32_t - Failed image count
+  --------------------------------------------------------------------------*/
+uint32_t ConvertPipeline::getFailedCount() const
+{
+    return failedImages;
+}
+
+// Private Functions ----------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Read stage, loads each PNG file named in the input channel
+    @param      pngFiles - Channel of PNG file names
+    @param      output - Channel to the decode stage
+  --------------------------------------------------------------------------*/
+Task ConvertPipeline::readStage( Channel<std::string>& pngFiles, AsyncChannel<FileJob>& output )
+{
+    std::string fileName;
+
+    while ( pngFiles.pop( fileName ) )
+    {
+        FileJob job   = jobPool.acquire();
+        bool    bRead = false;
+
+        try
+        {
+            job.fileName.assign( fileName );
+            bRead = fileManager.OpenFile( fileName, job.pngData );
+            if ( bRead == false )
+            {
+                ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::Pipeline_FailedToReadFile, "Failed to read " + fileName );
+                failedImages++;
+            }
+        }
+        catch ( ... )
+        {
+            imageFailed( fileName, std::current_exception() );
+        }
+
+        if ( bRead == false )
+        {
+            jobPool.release( std::move( job ) );
+            continue;
+        }
+
+        co_await output.push( std::move( job ), readPool );
+    }
+
+    output.producerDone();
+    stageFinished();
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Decode stage, decodes each PNG into its palette and pixels
+    @param      input - Channel from the read stage
+    @param      output - Channel to the encode stage
+  --------------------------------------------------------------------------*/
+Task ConvertPipeline::decodeStage( AsyncChannel<FileJob>& input, AsyncChannel<DecodedImage>& output )
+{
+    Tools& tools = Tools::getInstance();
+
+    while ( std::optional<FileJob> job = co_await input.pop( decodePool ) )
+    {
+        DecodedImage image    = imagePool.acquire();
+        bool         bDecoded = false;
+
+        try
+        {
+            image.fileName.assign( job->fileName );
+            bDecoded = tools.Decode_PNG( job->pngData, image );
+            if ( bDecoded == false )
+            {
+                ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::Pipeline_FailedToDecode, "Failed to decode, not an 8 bit indexed PNG or too large " + job->fileName );
+                failedImages++;
+            }
+        }
+        catch ( ... )
+        {
+            imageFailed( job->fileName, std::current_exception() );
+        }
+
+        if ( bDecoded == false )
+        {
+            imagePool.release( std::move( image ) );
+            jobPool.release( std::move( *job ) );
+            continue;
+        }
+
+        // the PNG data is no longer needed, hand it back before waiting
+        jobPool.release( std::move( *job ) );
+        co_await output.push( std::move( image ), decodePool );
+    }
+
+    output.producerDone();
+    stageFinished();
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Encode stage, builds the output files for each image
+    @param      input - Channel from the decode stage
+    @param      output - Channel to the write stage
+  --------------------------------------------------------------------------*/
+Task ConvertPipeline::encodeStage( AsyncChannel<DecodedImage>& input, AsyncChannel<std::vector<ConvertedFile>>& output )
+{
+    Tools& tools = Tools::getInstance();
+
+    while ( std::optional<DecodedImage> image = co_await input.pop( encodePool ) )
+    {
+        std::vector<ConvertedFile> outputs  = outputPool.acquire();
+        bool                       bEncoded = false;
+
+        try
+        {
+            if ( paletteStore )
+            {
+                uint64_t paletteId;
+
+                bEncoded = tools.Encode_Image( *image, outputs, spriteWidth, spriteHeight, OutputRaw | OutputSprites ) &&
+                           paletteStore->add( image->palette, outputs.back().fileName, paletteId );
+            }
+            else
+            {
+                bEncoded = tools.Encode_Image( *image, outputs, spriteWidth, spriteHeight );
+            }
+            failedImages += bEncoded ? 0 : 1;
+        }
+        catch ( ... )
+        {
+            imageFailed( image->fileName, std::current_exception() );
+        }
+
+        imagePool.release( std::move( *image ) );
+        if ( bEncoded == false )
+        {
+            outputPool.release( std::move( outputs ) );
+            continue;
+        }
+        co_await output.push( std::move( outputs ), encodePool );
+    }
+
+    output.producerDone();
+    stageFinished();
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Write stage, writes the output files of each image
+    @param      input - Channel from the encode stage
+  --------------------------------------------------------------------------*/
+Task ConvertPipeline::writeStage( AsyncChannel<std::vector<ConvertedFile>>& input )
+{
+    while ( std::optional<std::vector<ConvertedFile>> outputs = co_await input.pop( writePool ) )
+    {
+        bool written = true;
+
+        for ( ConvertedFile& file : *outputs )
+        {
+            try
+            {
+                if ( fileManager.SaveFile( file.fileName, file.fileData ) == false )
+                {
+                    ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::Pipeline_FailedToWriteFile, "Failed to write " + file.fileName );
+                    written = false;
+                }
+            }
+            catch ( ... )
+            {
+                ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::Pipeline_FailedToWriteFile,
+                                                         "Failed to write " + file.fileName + ": " + ExceptionText( std::current_exception() ) );
+                written = false;
+            }
+        }
+
+        written ? convertedImages++ : failedImages++;
+        outputPool.release( std::move( *outputs ) );
+    }
+
+    stageFinished();
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Called as each stage coroutine ends, wakes run() after the last
+  --------------------------------------------------------------------------*/
+void ConvertPipeline::stageFinished()
+{
+    if ( --runningStages == 0 )
+    {
+        runningStages.notify_all();
+    }
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Reports an image whose conversion threw, and counts it as
+                failed
+    @param      fileName - Source file of the image
+    @param      exception - Exception thrown
+  --------------------------------------------------------------------------*/
+void ConvertPipeline::imageFailed( const std::string& fileName, std::exception_ptr exception )
+{
+    ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::Pipeline_ImageFailed, "Failed to convert " + fileName + ": " + ExceptionText( exception ) );
+    failedImages++;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBPipeline AmigaGfx Library Pipeline Module
+    @brief      Called from a stage coroutine ended by an exception, in
+                place of the end of the stage. The caller closes the stage's
+                output channel first, run() may return once this is done.
+    @param      exception - Exception that ended the stage
+  --------------------------------------------------------------------------*/
+void ConvertPipeline::stageFailed( std::exception_ptr exception )
+{
+    ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::Pipeline_StageFailed, "Pipeline stage ended: " + ExceptionText( exception ) );
+    stageFinished();
+}
+
+//-----------------------------------------------------------------------------
+
+} // end namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: Pipeline.cpp
+// ----------------------------------------------------------------------------
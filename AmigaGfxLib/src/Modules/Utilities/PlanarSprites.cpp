@@ -0,0 +1,364 @@
+/**----------------------------------------------------------------------------
+
+    @file       PlanarSprites.cpp
+    @defgroup   AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Encodes sprites as blitter bitplanes and masks, pre-shifted
+
+    @copyright  Neil Bereford 2024
+
+Notes:
+
+    The blitter moves whole words, so a sprite drawn at an x that is not a
+    multiple of 16 is shifted on the way and needs one more word per row
+    than its width. Pre-shifted copies move that work to the host: with
+    shifts copies, copy k is the sprite moved k * 16 / shifts pixels right,
+    and the display code draws the copy for (x % 16) / step at x rounded
+    down to the step, leaving the blitter only the shift within a step.
+    With 16 copies there is no shift at all, and the unshifted copy is no
+    wider than the sprite. A copy shifted by s holds the sprite plus up to
+    step - 1 more pixels of blitter shift, (width + s + step - 1 + 15) / 16
+    words a row.
+
+    Each sprite's planes are built once unshifted, a word per 16 pixels,
+    and each copy is made from them a word at a time. The mask plane is
+    every pixel that is not colour 0.
+
+    Every plane goes through addPlane(), which looks its data up by
+    Tools::hash64() and returns the offset of an identical plane already
+    written, so an empty plane, a sprite repeated on the sheet or a copy
+    whose planes match another is stored once.
+
+    The file starts "PLANAR:count,planes,shifts,mask:" followed by an
+    entry per copy of each sprite, sprite by sprite: uint16 words a row,
+    uint16 rows, then a uint32 offset into the plane data for each plane
+    and the mask. The plane data follows the table, rows of big endian
+    words.
+
+-----------------------------------------------------------------------------*/
+
+//-----------------------------------------------------------------------------
+// Include files
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <format>
+#include <string>
+
+#include "../../../inc/Modules/Utilities/PlanarSprites.h"
+#include "../../../inc/Modules/Utilities/Metrics.h"
+#include "../../../inc/Modules/Utilities/Tools.h"
+#include "../../../inc/Modules/ErrorHandling/ErrorHandler.h"
+
+//-----------------------------------------------------------------------------
+// Namespace
+//-----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Class support functions
+// ----------------------------------------------------------------------------
+
+// Constructor and destructor  -------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Constructor for the PlanarSpriteEncoder class
+    @param      config - Bitplane, mask and pre-shift settings
+  --------------------------------------------------------------------------*/
+PlanarSpriteEncoder::PlanarSpriteEncoder( const PlanarConfig& config ) : planarConfig( config )
+{
+    planeCount  = 0;
+    planeBytes  = 0;
+    sharedBytes = 0;
+    blitWords   = 0;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Destructor for the PlanarSpriteEncoder class
+  --------------------------------------------------------------------------*/
+PlanarSpriteEncoder::~PlanarSpriteEncoder()
+{
+}
+
+// Public Functions ----------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Encodes sprites of an image as bitplanes and masks
+    @param      image - Sheet holding the sprites, colour index 0 is transparent
+    @param      sprites - Sprites to encode
+    @param      plnFile - Receives the .PLN file data
+    @return     bool - false if the shift count or plane count is not valid
+  --------------------------------------------------------------------------*/
+bool PlanarSpriteEncoder::encode( ImageView<const uint8_t> image, const std::vector<SpriteRect>& sprites, std::vector<uint8_t>& plnFile )
+{
+    uint32_t shifts = planarConfig.shifts;
+
+    if ( shifts == 0 || shifts > 16 || ( shifts & ( shifts - 1 ) ) || planarConfig.planes > PLN_MAX_PLANES )
+    {
+        ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::Planar_InvalidConfig,
+                                                 std::format( "Planar sprites take 1, 2, 4, 8 or 16 shifts and up to 8 planes, not {} and {}", shifts, planarConfig.planes ) );
+        return false;
+    }
+
+    ScopedTimer timer( MetricStage::Compress );
+
+    planeCount  = planarConfig.planes ? planarConfig.planes : PlanesFor( image );
+    planeBytes  = 0;
+    sharedBytes = 0;
+    blitWords   = 0;
+    planeOffsets.clear();
+
+    uint32_t              step           = 16 / shifts;
+    uint32_t              planeTotal     = planeCount + ( planarConfig.bMask ? 1 : 0 );
+    size_t                entrySize      = 2 * sizeof( uint16_t ) + planeTotal * sizeof( uint32_t );
+    std::vector<uint8_t>  table( sprites.size() * shifts * entrySize );
+    std::vector<uint8_t>  planeData;
+    std::vector<uint16_t> basePlanes;
+    std::vector<uint16_t> shifted;
+    uint8_t*              pEntry         = table.data();
+    uint64_t              blitSixteenths = 0;
+
+    for ( const SpriteRect& sprite : sprites )
+    {
+        ImageView<const uint8_t> cell      = image.subView( sprite.x, sprite.y, sprite.width, sprite.height );
+        uint32_t                 width     = cell.getWidth();
+        uint32_t                 rows      = cell.getHeight();
+        uint32_t                 baseWords = ( width + 15 ) / 16;
+        size_t                   planeSize = (size_t)rows * baseWords;
+
+        // unshifted planes, then the mask
+        basePlanes.assign( ( planeCount + 1 ) * planeSize, 0 );
+        for ( uint32_t y = 0; y < rows; y++ )
+        {
+            const uint8_t* pRow = cell.getRow( y );
+
+            for ( uint32_t x = 0; x < width; x++ )
+            {
+                size_t   word = (size_t)y * baseWords + x / 16;
+                uint16_t bit  = (uint16_t)( 0x8000 >> ( x % 16 ) );
+
+                for ( uint32_t nPlane = 0; nPlane < planeCount; nPlane++ )
+                {
+                    if ( ( pRow[ x ] >> nPlane ) & 1 )
+                    {
+                        basePlanes[ nPlane * planeSize + word ] |= bit;
+                    }
+                }
+                if ( pRow[ x ] )
+                {
+                    basePlanes[ planeCount * planeSize + word ] |= bit;
+                }
+            }
+        }
+
+        for ( uint32_t nCopy = 0; nCopy < shifts; nCopy++ )
+        {
+            uint32_t shift     = nCopy * step;
+            uint32_t words     = ( width + shift + step - 1 + 15 ) / 16;
+            uint16_t size[ 2 ] = { (uint16_t)words, (uint16_t)rows };
+
+            memcpy( pEntry, size, sizeof( size ) );
+            pEntry += sizeof( size );
+
+            // the copy is drawn for step positions of x
+            blitSixteenths += (uint64_t)step * words * rows * planeCount;
+
+            for ( uint32_t nPlane = 0; nPlane < planeTotal; nPlane++ )
+            {
+                const uint16_t* pBase = basePlanes.data() + ( nPlane < planeCount ? nPlane : planeCount ) * planeSize;
+
+                shifted.assign( (size_t)words * rows, 0 );
+                for ( uint32_t y = 0; y < rows; y++ )
+                {
+                    const uint16_t* pIn  = pBase + (size_t)y * baseWords;
+                    uint16_t*       pOut = shifted.data() + (size_t)y * words;
+
+                    for ( uint32_t nWord = 0; nWord < words; nWord++ )
+                    {
+                        uint32_t high = nWord < baseWords ? pIn[ nWord ] : 0;
+                        uint32_t low  = nWord && nWord - 1 < baseWords ? pIn[ nWord - 1 ] : 0;
+
+                        pOut[ nWord ] = (uint16_t)( ( ( low << 16 ) | high ) >> shift );
+                    }
+                }
+
+                uint32_t offset = addPlane( shifted, planeData );
+                memcpy( pEntry, &offset, sizeof( offset ) );
+                pEntry += sizeof( offset );
+            }
+        }
+    }
+
+    char   header[ 64 ];
+    size_t headerLen = snprintf( header, sizeof( header ), "PLANAR:%u,%u,%u,%u:", (uint32_t)sprites.size(), planeCount, shifts, planarConfig.bMask ? 1 : 0 );
+
+    plnFile.resize( headerLen + table.size() + planeData.size() );
+    memcpy( plnFile.data(), header, headerLen );
+    memcpy( plnFile.data() + headerLen, table.data(), table.size() );
+    memcpy( plnFile.data() + headerLen + table.size(), planeData.data(), planeData.size() );
+
+    blitWords = blitSixteenths / 16;
+    Metrics::getInstance().addCount( MetricCounter::SpritesEncoded, sprites.size() );
+
+    return true;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Encodes the sprites with 1, 2, 4, 8 and 16 shifts, keeping
+                the other settings, to weigh the memory each choice costs
+                against the blitter words it saves
+    @param      image - Sheet holding the sprites
+    @param      sprites - Sprites to encode
+    @param      costs - Receives the cost of each shift count
+    @return     bool - false if the settings are not valid
+  --------------------------------------------------------------------------*/
+bool PlanarSpriteEncoder::measure( ImageView<const uint8_t> image, const std::vector<SpriteRect>& sprites, std::vector<PlanarCost>& costs ) const
+{
+    std::vector<uint8_t> plnFile;
+
+    costs.clear();
+    for ( uint32_t shifts = 1; shifts <= 16; shifts *= 2 )
+    {
+        PlanarConfig config = planarConfig;
+        config.shifts       = shifts;
+
+        PlanarSpriteEncoder encoder( config );
+        if ( encoder.encode( image, sprites, plnFile ) == false )
+        {
+            return false;
+        }
+        costs.push_back( { shifts, plnFile.size(), encoder.getPlaneBytes(), encoder.getSharedBytes(), encoder.getBlitWords() } );
+    }
+
+    return true;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Bitplanes written by the last encode
+    @return     uint32_t - Plane count, not counting the mask
+  --------------------------------------------------------------------------*/
+uint32_t PlanarSpriteEncoder::getPlaneCount() const
+{
+    return planeCount;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Plane data the last encode would have written with no
+                planes shared
+    @return     uint64_t - Bytes
+  --------------------------------------------------------------------------*/
+uint64_t PlanarSpriteEncoder::getPlaneBytes() const
+{
+    return planeBytes;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Plane data the last encode saved by sharing identical planes
+    @return     uint64_t - Bytes
+  --------------------------------------------------------------------------*/
+uint64_t PlanarSpriteEncoder::getSharedBytes() const
+{
+    return sharedBytes;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Words of bitplane data the blitter moves to draw every
+                sprite of the last encode once, averaged over the 16 x
+                positions within a word, masks not counted
+    @return     uint64_t - Words
+  --------------------------------------------------------------------------*/
+uint64_t PlanarSpriteEncoder::getBlitWords() const
+{
+    return blitWords;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Bitplanes needed for the highest colour index on an image
+    @param      image - Pixels to check
+    @return     uint32_t - Plane count, at least 1
+  --------------------------------------------------------------------------*/
+uint32_t PlanarSpriteEncoder::PlanesFor( ImageView<const uint8_t> image )
+{
+    uint8_t used = 0;
+
+    for ( uint32_t y = 0; y < image.getHeight(); y++ )
+    {
+        const uint8_t* pRow = image.getRow( y );
+
+        for ( uint32_t x = 0; x < image.getWidth(); x++ )
+        {
+            used |= pRow[ x ];
+        }
+    }
+
+    uint32_t planes = 1;
+    while ( planes < PLN_MAX_PLANES && ( used >> planes ) )
+    {
+        planes++;
+    }
+    return planes;
+}
+
+// Private Functions ----------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Adds a plane to the plane data as big endian words, or finds
+                an identical plane already there
+    @param      words - Plane, rows of words
+    @param      planeData - Plane data so far
+    @return     uint32_t - Offset of the plane in the plane data
+  --------------------------------------------------------------------------*/
+uint32_t PlanarSpriteEncoder::addPlane( const std::vector<uint16_t>& words, std::vector<uint8_t>& planeData )
+{
+    uint32_t offset = (uint32_t)planeData.size();
+    size_t   size   = words.size() * sizeof( uint16_t );
+
+    planeData.resize( offset + size );
+    for ( size_t nWord = 0; nWord < words.size(); nWord++ )
+    {
+        planeData[ offset + nWord * 2 ]     = (uint8_t)( words[ nWord ] >> 8 );
+        planeData[ offset + nWord * 2 + 1 ] = (uint8_t)words[ nWord ];
+    }
+    planeBytes += size;
+
+    if ( planarConfig.bDedup == false )
+    {
+        return offset;
+    }
+
+    // a plane already written with the same data is used instead
+    std::vector<uint32_t>& matches = planeOffsets[ Tools::getInstance().hash64( planeData.data() + offset, size ) ];
+    for ( uint32_t match : matches )
+    {
+        if ( match + size <= offset && memcmp( planeData.data() + match, planeData.data() + offset, size ) == 0 )
+        {
+            planeData.resize( offset );
+            sharedBytes += size;
+            return match;
+        }
+    }
+
+    matches.push_back( offset );
+    return offset;
+}
+
+//-----------------------------------------------------------------------------
+
+} // end namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: PlanarSprites.cpp
+// ----------------------------------------------------------------------------
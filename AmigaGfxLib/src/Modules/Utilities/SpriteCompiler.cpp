@@ -0,0 +1,365 @@
+/**----------------------------------------------------------------------------
+
+    @file       SpriteCompiler.cpp
+    @defgroup   AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Compiles sprites into 68k drawing code
+
+    @copyright  Neil Bereford 2024
+
+Notes:
+
+    A compiled sprite is called with a0 pointing at the screen byte under
+    its top left pixel and d0.l holding the bytes per screen row, which
+    must be even. It trashes a0 and nothing else.
+
+    Each run of opaque pixels is written with move #imm,(a0)+: a byte
+    first if the run starts on an odd address, then longs, then a word
+    and a byte for what is left. Long and word moves are then always on
+    even addresses, which the 68000 needs. Whether an address is odd
+    depends on where the sprite is drawn, so each sprite is compiled for
+    an even and for an odd destination.
+
+    Between runs a0 is stepped with addq/subq for up to 8 bytes and lea
+    for more. At the end of a row adda.l d0,a0 moves a0 down a row
+    without going back to the left edge, the step to the first run of
+    the next row takes care of that, and rows with nothing on them cost
+    only their adda. Nothing is written after the last opaque row.
+
+    The code uses only a0 relative addressing, so it runs wherever it is
+    loaded. The file starts "COMPILED:count,variants:" padded with zero
+    bytes to a multiple of 4, then the jump table, a big endian uint32
+    per sprite and variant (even first) giving the offset of its code
+    from the start of the table, then the code.
+
+-----------------------------------------------------------------------------*/
+
+//-----------------------------------------------------------------------------
+// Include files
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "../../../inc/Modules/Utilities/SpriteCompiler.h"
+#include "../../../inc/Modules/Utilities/Metrics.h"
+
+//-----------------------------------------------------------------------------
+// Namespace
+//-----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Class support functions
+// ----------------------------------------------------------------------------
+
+// Constructor and destructor  -------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Constructor for the SpriteCompiler class
+    @param      bOddVariants - Compile each sprite for odd destinations too,
+                false when every sprite is drawn at even addresses, or on a
+                68020 or later which allows unaligned moves
+  --------------------------------------------------------------------------*/
+SpriteCompiler::SpriteCompiler( bool bOddVariants ) : bOddCode( bOddVariants )
+{
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Destructor for the SpriteCompiler class
+  --------------------------------------------------------------------------*/
+SpriteCompiler::~SpriteCompiler()
+{
+}
+
+// Public Functions ----------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Compiles one sprite
+    @param      sprite - Pixels of the sprite, colour index 0 is transparent
+    @param      bOdd - Compile for a destination at an odd address
+    @param      code - Receives the instructions, ending with rts
+  --------------------------------------------------------------------------*/
+void SpriteCompiler::compile( ImageView<const uint8_t> sprite, bool bOdd, std::vector<M68kInstruction>& code ) const
+{
+    int32_t  position    = 0; // a0, in bytes from the left edge of the current row
+    uint32_t pendingRows = 0;
+
+    code.clear();
+    for ( uint32_t y = 0; y < sprite.getHeight(); y++ )
+    {
+        const uint8_t* pRow = sprite.getRow( y );
+        uint32_t       x    = 0;
+
+        while ( true )
+        {
+            while ( x < sprite.getWidth() && pRow[ x ] == 0 )
+            {
+                x++;
+            }
+            if ( x == sprite.getWidth() )
+            {
+                break;
+            }
+
+            uint32_t end = x;
+            while ( end < sprite.getWidth() && pRow[ end ] )
+            {
+                end++;
+            }
+
+            // rows are only stepped down once there is something to draw on them
+            for ( ; pendingRows; pendingRows-- )
+            {
+                code.push_back( { M68kOp::AddRow, 0 } );
+            }
+            AddSkip( (int32_t)x - position, code );
+
+            if ( ( x + ( bOdd ? 1 : 0 ) ) & 1 )
+            {
+                code.push_back( { M68kOp::MoveByte, pRow[ x++ ] } );
+            }
+            for ( ; end - x >= 4; x += 4 )
+            {
+                code.push_back( { M68kOp::MoveLong, (uint32_t)pRow[ x ] << 24 | (uint32_t)pRow[ x + 1 ] << 16 | (uint32_t)pRow[ x + 2 ] << 8 | pRow[ x + 3 ] } );
+            }
+            if ( end - x >= 2 )
+            {
+                code.push_back( { M68kOp::MoveWord, (uint32_t)pRow[ x ] << 8 | pRow[ x + 1 ] } );
+                x += 2;
+            }
+            if ( end > x )
+            {
+                code.push_back( { M68kOp::MoveByte, pRow[ x++ ] } );
+            }
+            position = (int32_t)end;
+        }
+        pendingRows++;
+    }
+
+    code.push_back( { M68kOp::Return, 0 } );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Compiles sprites of an image into one file of code behind a
+                jump table
+    @param      image - Sheet holding the sprites
+    @param      sprites - Sprites to compile
+    @param      codeFile - Receives the .CSP file data
+    @param      compiled - Receives the code of each sprite and variant, in
+                jump table order
+  --------------------------------------------------------------------------*/
+void SpriteCompiler::build( ImageView<const uint8_t> image, const std::vector<SpriteRect>& sprites, std::vector<uint8_t>& codeFile,
+                            std::vector<CompiledSprite>& compiled ) const
+{
+    ScopedTimer timer( MetricStage::Compress );
+    uint32_t    variants = bOddCode ? 2 : 1;
+    char        header[ 64 ];
+    size_t      headerLen = snprintf( header, sizeof( header ), "COMPILED:%u,%u:", (uint32_t)sprites.size(), variants );
+
+    // the jump table is read with move.l, which the 68000 needs on an even address
+    headerLen = ( headerLen + 3 ) & ~(size_t)3;
+
+    uint32_t tableSize = (uint32_t)( sprites.size() * variants * sizeof( uint32_t ) );
+    uint32_t codeSize  = 0;
+
+    compiled.resize( sprites.size() * variants );
+    for ( size_t nSprite = 0; nSprite < sprites.size(); nSprite++ )
+    {
+        const SpriteRect&        rect = sprites[ nSprite ];
+        ImageView<const uint8_t> cell = image.subView( rect.x, rect.y, rect.width, rect.height );
+
+        for ( uint32_t nVariant = 0; nVariant < variants; nVariant++ )
+        {
+            CompiledSprite& sprite = compiled[ nSprite * variants + nVariant ];
+
+            sprite.index  = (uint32_t)nSprite;
+            sprite.x      = rect.x;
+            sprite.y      = rect.y;
+            sprite.width  = cell.getWidth();
+            sprite.height = cell.getHeight();
+            sprite.bOdd   = nVariant == 1;
+            compile( cell, sprite.bOdd, sprite.code );
+
+            sprite.offset    = tableSize + codeSize;
+            sprite.codeBytes = 0;
+            for ( const M68kInstruction& instruction : sprite.code )
+            {
+                sprite.codeBytes += InstructionBytes( instruction );
+            }
+            codeSize += sprite.codeBytes;
+        }
+    }
+
+    codeFile.assign( headerLen + tableSize + codeSize, 0 );
+    memcpy( codeFile.data(), header, strlen( header ) );
+
+    uint8_t* pTable = codeFile.data() + headerLen;
+    uint8_t* pOut   = pTable + tableSize;
+
+    for ( const CompiledSprite& sprite : compiled )
+    {
+        *pTable++ = (uint8_t)( sprite.offset >> 24 );
+        *pTable++ = (uint8_t)( sprite.offset >> 16 );
+        *pTable++ = (uint8_t)( sprite.offset >> 8 );
+        *pTable++ = (uint8_t)sprite.offset;
+
+        for ( const M68kInstruction& instruction : sprite.code )
+        {
+            pOut = Assemble( instruction, pOut );
+        }
+    }
+
+    Metrics::getInstance().addCount( MetricCounter::SpritesEncoded, sprites.size() );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Writes the machine code of an instruction, big endian
+    @param      instruction - Instruction to assemble
+    @param      pOut - Where to write it
+    @return     uint8_t* - End of the instruction
+  --------------------------------------------------------------------------*/
+uint8_t* SpriteCompiler::Assemble( const M68kInstruction& instruction, uint8_t* pOut )
+{
+    uint16_t opcode  = 0;
+    uint32_t operand = instruction.operand;
+
+    switch ( instruction.op )
+    {
+        case M68kOp::MoveLong: opcode = 0x20FC; break;
+        case M68kOp::MoveWord: opcode = 0x30FC; break;
+        case M68kOp::MoveByte: opcode = 0x10FC; break;
+        case M68kOp::AddQuick: opcode = (uint16_t)( 0x5048 | ( operand & 7 ) << 9 ); break;
+        case M68kOp::SubQuick: opcode = (uint16_t)( 0x5148 | ( operand & 7 ) << 9 ); break;
+        case M68kOp::Lea:      opcode = 0x41E8; break;
+        case M68kOp::AddRow:   opcode = 0xD1C0; break;
+        case M68kOp::Return:   opcode = 0x4E75; break;
+    }
+
+    *pOut++ = (uint8_t)( opcode >> 8 );
+    *pOut++ = (uint8_t)opcode;
+
+    // immediates and displacements follow the opcode, a byte immediate in the low half of a word
+    uint32_t extension = InstructionBytes( instruction ) - 2;
+    for ( uint32_t nByte = extension; nByte--; )
+    {
+        *pOut++ = (uint8_t)( operand >> ( nByte * 8 ) );
+    }
+
+    return pOut;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Size of the machine code of an instruction
+    @param      instruction - Instruction to size
+    @return     uint32_t - Bytes, opcode and extension words
+  --------------------------------------------------------------------------*/
+uint32_t SpriteCompiler::InstructionBytes( const M68kInstruction& instruction )
+{
+    switch ( instruction.op )
+    {
+        case M68kOp::MoveLong: return 6;
+        case M68kOp::MoveWord:
+        case M68kOp::MoveByte:
+        case M68kOp::Lea:      return 4;
+        default:               return 2;
+    }
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Assembler listing of compiled sprites, for checking the code
+                by eye, each line the offset from the jump table, the code
+                bytes and the instruction
+    @param      compiled - Sprites from build()
+    @return     std::string - Listing text
+  --------------------------------------------------------------------------*/
+std::string SpriteCompiler::Listing( const std::vector<CompiledSprite>& compiled )
+{
+    std::string listing;
+    char        line[ 128 ];
+
+    listing += "; a0 = destination of the top left pixel, d0.l = bytes per screen row\n";
+    for ( const CompiledSprite& sprite : compiled )
+    {
+        const char* pParity = sprite.bOdd ? "odd" : "even";
+        uint32_t    offset  = sprite.offset;
+
+        snprintf( line, sizeof( line ), "\n; %ux%u at %u,%u, %s destination, %u bytes\nsprite_%u_%s:\n", sprite.width, sprite.height, sprite.x, sprite.y, pParity,
+                  sprite.codeBytes, sprite.index, pParity );
+        listing += line;
+
+        for ( const M68kInstruction& instruction : sprite.code )
+        {
+            uint8_t bytes[ 8 ];
+            char    hex[ 32 ] = "";
+            char    text[ 48 ];
+            int16_t distance  = (int16_t)instruction.operand;
+
+            Assemble( instruction, bytes );
+            for ( uint32_t nByte = 0, nEnd = InstructionBytes( instruction ); nByte < nEnd; nByte += 2 )
+            {
+                snprintf( hex + strlen( hex ), sizeof( hex ) - strlen( hex ), "%02X%02X ", bytes[ nByte ], bytes[ nByte + 1 ] );
+            }
+
+            switch ( instruction.op )
+            {
+                case M68kOp::MoveLong: snprintf( text, sizeof( text ), "move.l  #$%08X,(a0)+", instruction.operand ); break;
+                case M68kOp::MoveWord: snprintf( text, sizeof( text ), "move.w  #$%04X,(a0)+", instruction.operand ); break;
+                case M68kOp::MoveByte: snprintf( text, sizeof( text ), "move.b  #$%02X,(a0)+", instruction.operand ); break;
+                case M68kOp::AddQuick: snprintf( text, sizeof( text ), "addq.w  #%u,a0", instruction.operand ); break;
+                case M68kOp::SubQuick: snprintf( text, sizeof( text ), "subq.w  #%u,a0", instruction.operand ); break;
+                case M68kOp::Lea:      snprintf( text, sizeof( text ), "lea     %d(a0),a0", distance ); break;
+                case M68kOp::AddRow:   snprintf( text, sizeof( text ), "adda.l  d0,a0" ); break;
+                case M68kOp::Return:   snprintf( text, sizeof( text ), "rts" ); break;
+            }
+
+            snprintf( line, sizeof( line ), "    %06X  %-16s%s\n", offset, hex, text );
+            listing += line;
+            offset += InstructionBytes( instruction );
+        }
+    }
+
+    return listing;
+}
+
+// Private Functions ----------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Adds the cheapest step of a0 over a distance
+    @param      distance - Bytes to step, negative steps back
+    @param      code - Instructions to add to
+  --------------------------------------------------------------------------*/
+void SpriteCompiler::AddSkip( int32_t distance, std::vector<M68kInstruction>& code )
+{
+    if ( distance > 0 && distance <= 8 )
+    {
+        code.push_back( { M68kOp::AddQuick, (uint32_t)distance } );
+    }
+    else if ( distance < 0 && distance >= -8 )
+    {
+        code.push_back( { M68kOp::SubQuick, (uint32_t)-distance } );
+    }
+    else if ( distance )
+    {
+        code.push_back( { M68kOp::Lea, (uint32_t)(uint16_t)(int16_t)distance } );
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+} // end namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: SpriteCompiler.cpp
+// ----------------------------------------------------------------------------
@@ -0,0 +1,397 @@
+/**----------------------------------------------------------------------------
+
+    @file       SpriteSlicer.cpp
+    @defgroup   AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Finds the sprites on a sheet by connected components
+
+    @copyright  Neil Bereford 2024
+
+Notes:
+
+    Labelling is a union-find over the pixels. Every opaque pixel starts
+    as its own set and is joined to its opaque neighbours to the left and
+    in the row above (8 connected, so diagonal pixels belong together).
+    Sets are always linked to the smaller root, so the root of a
+    component is its first pixel in reading order.
+
+    The sheet is cut into bands of rows that are labelled in parallel.
+    Within a band only pixels of that band are touched, so the bands need
+    no locking. Once every band is done, the first row of each band is
+    joined to the last row of the band above, then a single pass gives
+    each component its bounding box.
+
+    Components whose boxes overlap or sit within mergeDistance pixels of
+    each other are then merged, repeatedly, until nothing more merges.
+
+-----------------------------------------------------------------------------*/
+
+//-----------------------------------------------------------------------------
+// Include files
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+
+#include "../../../inc/Modules/Utilities/Metrics.h"
+#include "../../../inc/Modules/Utilities/SpriteSlicer.h"
+
+//-----------------------------------------------------------------------------
+// Namespace
+//-----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Class support functions
+// ----------------------------------------------------------------------------
+
+// Constructor and destructor  -------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Constructor for the SpriteSlicer class, the labelling
+                threads are not started until a sheet needs them
+    @param      config - Slicing settings
+  --------------------------------------------------------------------------*/
+SpriteSlicer::SpriteSlicer( const SliceConfig& config )
+{
+    sliceConfig    = config;
+    componentCount = 0;
+
+    if ( sliceConfig.bandHeight == 0 )
+    {
+        sliceConfig.bandHeight = 1;
+    }
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Destructor for the SpriteSlicer class
+
+  --------------------------------------------------------------------------*/
+SpriteSlicer::~SpriteSlicer()
+{
+}
+
+// Public Functions ----------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Finds the sprites on a sheet
+    @param      image - Sheet to slice, colour index 0 is transparent
+    @param      sprites - Receives one box per sprite, positions relative
+                to the view, sorted top to bottom then left to right
+  --------------------------------------------------------------------------*/
+void SpriteSlicer::slice( ImageView<const uint8_t> image, std::vector<SpriteRect>& sprites )
+{
+    ScopedTimer timer( MetricStage::SpriteSlice );
+    uint32_t    bandHeight = sliceConfig.bandHeight;
+    uint32_t    bandCount  = ( image.getHeight() + bandHeight - 1 ) / bandHeight;
+
+    sprites.clear();
+    componentCount = 0;
+
+    if ( image.isEmpty() )
+    {
+        return;
+    }
+
+    parent.resize( (size_t)image.getWidth() * image.getHeight() );
+    componentIndex.resize( parent.size() );
+
+    // label each band on its own, bands only touch their own pixels
+    if ( sliceConfig.threadCount == 1 || bandCount == 1 )
+    {
+        for ( uint32_t y = 0; y < image.getHeight(); y += bandHeight )
+        {
+            labelBand( image, y, std::min( bandHeight, image.getHeight() - y ) );
+        }
+    }
+    else
+    {
+        if ( labelPool == nullptr )
+        {
+            labelPool = std::make_unique<ThreadPool>( sliceConfig.threadCount );
+        }
+
+        for ( uint32_t y = 0; y < image.getHeight(); y += bandHeight )
+        {
+            labelPool->submit( [ this, image, y, bandHeight ]() { labelBand( image, y, std::min( bandHeight, image.getHeight() - y ) ); } );
+        }
+        labelPool->wait();
+    }
+
+    // then stitch the bands together
+    for ( uint32_t y = bandHeight; y < image.getHeight(); y += bandHeight )
+    {
+        joinRows( image, y );
+    }
+
+    collectComponents( image, sprites );
+    componentCount = (uint32_t)sprites.size();
+
+    mergeNearby( sprites );
+
+    sprites.erase( std::remove_if( sprites.begin(), sprites.end(), [ this ]( const SpriteRect& sprite ) { return sprite.pixelCount < sliceConfig.minPixels; } ), sprites.end() );
+    std::sort( sprites.begin(), sprites.end(), []( const SpriteRect& a, const SpriteRect& b ) { return a.y != b.y ? a.y < b.y : a.x < b.x; } );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Number of connected components found by the last slice,
+                before nearby components were merged
+    @return     uint32_t - Component count
+  --------------------------------------------------------------------------*/
+uint32_t SpriteSlicer::getComponentCount() const
+{
+    return componentCount;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Cuts an image into cells on a sprite grid, the last row and
+                column clipped to the image
+    @param      width - Image width
+    @param      height - Image height
+    @param      sprW - Width of the sprite grid
+    @param      sprH - Height of the sprite grid
+    @param      cells - Receives the cells, left to right, top to bottom
+  --------------------------------------------------------------------------*/
+void SpriteSlicer::GridCells( uint32_t width, uint32_t height, uint32_t sprW, uint32_t sprH, std::vector<SpriteRect>& cells )
+{
+    cells.clear();
+    if ( sprW == 0 || sprH == 0 )
+    {
+        return;
+    }
+
+    for ( uint32_t y = 0; y < height; y += sprH )
+    {
+        for ( uint32_t x = 0; x < width; x += sprW )
+        {
+            cells.push_back( { x, y, std::min( sprW, width - x ), std::min( sprH, height - y ), 0 } );
+        }
+    }
+}
+
+// Private Functions ----------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Labels a band of rows, joining each opaque pixel to its
+                opaque neighbours to the left and in the row above
+    @param      image - Sheet being sliced
+    @param      firstRow - First row of the band
+    @param      rowCount - Rows in the band
+  --------------------------------------------------------------------------*/
+void SpriteSlicer::labelBand( ImageView<const uint8_t> image, uint32_t firstRow, uint32_t rowCount )
+{
+    uint32_t w = image.getWidth();
+
+    for ( uint32_t y = firstRow; y < firstRow + rowCount; y++ )
+    {
+        const uint8_t* pLine  = image.getRow( y );
+        const uint8_t* pAbove = y > firstRow ? image.getRow( y - 1 ) : nullptr;
+        uint32_t       pixel  = y * w;
+
+        for ( uint32_t x = 0; x < w; x++, pixel++ )
+        {
+            if ( pLine[ x ] == 0 )
+            {
+                parent[ pixel ] = NO_LABEL;
+                continue;
+            }
+
+            parent[ pixel ] = pixel;
+
+            if ( x > 0 && pLine[ x - 1 ] )
+            {
+                unite( pixel, pixel - 1 );
+            }
+
+            if ( pAbove )
+            {
+                for ( uint32_t nx = x > 0 ? x - 1 : 0; nx <= x + 1 && nx < w; nx++ )
+                {
+                    if ( pAbove[ nx ] )
+                    {
+                        unite( pixel, pixel - w - x + nx );
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Joins the opaque pixels of a row to their neighbours in the
+                row above, used where two bands meet
+    @param      image - Sheet being sliced
+    @param      y - First row of the lower band
+  --------------------------------------------------------------------------*/
+void SpriteSlicer::joinRows( ImageView<const uint8_t> image, uint32_t y )
+{
+    uint32_t       w      = image.getWidth();
+    const uint8_t* pLine  = image.getRow( y );
+    const uint8_t* pAbove = image.getRow( y - 1 );
+
+    for ( uint32_t x = 0; x < w; x++ )
+    {
+        if ( pLine[ x ] == 0 )
+        {
+            continue;
+        }
+
+        for ( uint32_t nx = x > 0 ? x - 1 : 0; nx <= x + 1 && nx < w; nx++ )
+        {
+            if ( pAbove[ nx ] )
+            {
+                unite( y * w + x, ( y - 1 ) * w + nx );
+            }
+        }
+    }
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Builds the bounding box and pixel count of each component.
+                A root is the first pixel of its component in reading
+                order, so its box exists before any other pixel needs it.
+    @param      image - Sheet being sliced
+    @param      sprites - Receives one box per component
+  --------------------------------------------------------------------------*/
+void SpriteSlicer::collectComponents( ImageView<const uint8_t> image, std::vector<SpriteRect>& sprites )
+{
+    uint32_t w = image.getWidth();
+
+    for ( uint32_t y = 0, pixel = 0; y < image.getHeight(); y++ )
+    {
+        for ( uint32_t x = 0; x < w; x++, pixel++ )
+        {
+            if ( parent[ pixel ] == NO_LABEL )
+            {
+                continue;
+            }
+
+            uint32_t root = findRoot( pixel );
+
+            if ( root == pixel )
+            {
+                componentIndex[ pixel ] = (uint32_t)sprites.size();
+                sprites.push_back( { x, y, 1, 1, 1 } );
+                continue;
+            }
+
+            SpriteRect& sprite = sprites[ componentIndex[ root ] ];
+            uint32_t    right  = std::max( sprite.x + sprite.width, x + 1 );
+
+            sprite.x      = std::min( sprite.x, x );
+            sprite.width  = right - sprite.x;
+            sprite.height = y + 1 - sprite.y;
+            sprite.pixelCount++;
+        }
+    }
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Merges boxes that overlap or are within mergeDistance
+                pixels of each other, until no more merge. The boxes are
+                swept in x order, so each is only compared with its
+                neighbours along x.
+    @param      sprites - Boxes to merge, merged boxes are removed
+  --------------------------------------------------------------------------*/
+void SpriteSlicer::mergeNearby( std::vector<SpriteRect>& sprites ) const
+{
+    uint32_t distance = sliceConfig.mergeDistance;
+    bool     bMerged  = true;
+
+    auto gap = []( uint32_t startA, uint32_t endA, uint32_t startB, uint32_t endB ) -> uint32_t {
+        return startB >= endA ? startB - endA : ( startA >= endB ? startA - endB : 0 );
+    };
+
+    while ( bMerged )
+    {
+        bMerged = false;
+        std::sort( sprites.begin(), sprites.end(), []( const SpriteRect& a, const SpriteRect& b ) { return a.x != b.x ? a.x < b.x : a.y < b.y; } );
+
+        for ( size_t nSprite = 0; nSprite < sprites.size(); nSprite++ )
+        {
+            SpriteRect& sprite = sprites[ nSprite ];
+
+            if ( sprite.width == 0 )
+            {
+                continue;
+            }
+
+            for ( size_t nOther = nSprite + 1; nOther < sprites.size() && sprites[ nOther ].x <= sprite.x + sprite.width + distance; nOther++ )
+            {
+                SpriteRect& other = sprites[ nOther ];
+
+                if ( other.width == 0 || gap( sprite.x, sprite.x + sprite.width, other.x, other.x + other.width ) > distance || gap( sprite.y, sprite.y + sprite.height, other.y, other.y + other.height ) > distance )
+                {
+                    continue;
+                }
+
+                uint32_t right  = std::max( sprite.x + sprite.width, other.x + other.width );
+                uint32_t bottom = std::max( sprite.y + sprite.height, other.y + other.height );
+
+                sprite.y = std::min( sprite.y, other.y );
+                sprite.width  = right - sprite.x;
+                sprite.height = bottom - sprite.y;
+                sprite.pixelCount += other.pixelCount;
+                other.width = 0;
+                bMerged     = true;
+            }
+        }
+
+        sprites.erase( std::remove_if( sprites.begin(), sprites.end(), []( const SpriteRect& sprite ) { return sprite.width == 0; } ), sprites.end() );
+    }
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Finds the root of a pixel's set, halving the path as it goes
+    @param      pixel - Pixel index
+    @return     uint32_t - Root pixel index
+  --------------------------------------------------------------------------*/
+uint32_t SpriteSlicer::findRoot( uint32_t pixel )
+{
+    while ( parent[ pixel ] != pixel )
+    {
+        parent[ pixel ] = parent[ parent[ pixel ] ];
+        pixel           = parent[ pixel ];
+    }
+    return pixel;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Joins the sets of two pixels, the larger root is linked to
+                the smaller
+    @param      pixelA - First pixel index
+    @param      pixelB - Second pixel index
+  --------------------------------------------------------------------------*/
+void SpriteSlicer::unite( uint32_t pixelA, uint32_t pixelB )
+{
+    uint32_t rootA = findRoot( pixelA );
+    uint32_t rootB = findRoot( pixelB );
+
+    if ( rootA < rootB )
+    {
+        parent[ rootB ] = rootA;
+    }
+    else if ( rootB < rootA )
+    {
+        parent[ rootA ] = rootB;
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+} // end namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: SpriteSlicer.cpp
+// ----------------------------------------------------------------------------
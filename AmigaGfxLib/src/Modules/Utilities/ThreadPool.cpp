@@ -0,0 +1,177 @@
+/**----------------------------------------------------------------------------
+
+    @file       ThreadPool.cpp
+    @defgroup   AmigaGfxLIBThreads AmigaGfx Library Threading Module
+    @brief      Fixed size pool of worker threads
+
+    @copyright  Neil Bereford 2024
+
+Notes:
+
+    The workers are started by the constructor and live until the pool is
+    destroyed, so the cost of creating threads is paid once per run rather
+    than once per job. Tasks are taken in the order they were submitted.
+    Tasks are expected to report their own errors through the
+    ErrorHandler. A task that throws anyway is caught and reported, so one
+    failed task does not take the worker, and the process, down with it.
+
+-----------------------------------------------------------------------------*/
+
+//-----------------------------------------------------------------------------
+// Include files
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <exception>
+#include <string>
+
+#include "../../../inc/Modules/ErrorHandling/ErrorHandler.h"
+#include "../../../inc/Modules/Utilities/ThreadPool.h"
+
+//-----------------------------------------------------------------------------
+// Namespace
+//-----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Class support functions
+// ----------------------------------------------------------------------------
+
+// Constructor and destructor  -------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBThreads AmigaGfx Library Threading Module
+    @brief      Constructor for the ThreadPool class, starts the workers
+    @param      threadCount - Number of worker threads, 0 uses one per
+                hardware thread
+  --------------------------------------------------------------------------*/
+ThreadPool::ThreadPool( uint32_t threadCount )
+{
+    pendingTasks = 0;
+    running      = true;
+
+    if ( threadCount == 0 )
+    {
+        threadCount = std::max( 1u, std::thread::hardware_concurrency() );
+    }
+
+    for ( uint32_t nThread = 0; nThread < threadCount; nThread++ )
+    {
+        workers.emplace_back( &ThreadPool::workerThread, this );
+    }
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBThreads AmigaGfx Library Threading Module
+    @brief      Destructor for the ThreadPool class, finishes the queued
+                tasks and stops the workers
+  --------------------------------------------------------------------------*/
+ThreadPool::~ThreadPool()
+{
+    wait();
+
+    {
+        std::lock_guard<std::mutex> guard( lock );
+        running = false;
+    }
+    taskReady.notify_all();
+
+    for ( auto& worker : workers )
+    {
+        worker.join();
+    }
+}
+
+// Public Functions ----------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBThreads AmigaGfx Library Threading Module
+    @brief      Queues a task to be run by the next free worker
+    @param      task - Task to run
+  --------------------------------------------------------------------------*/
+void ThreadPool::submit( std::function<void()> task )
+{
+    {
+        std::lock_guard<std::mutex> guard( lock );
+        tasks.push_back( std::move( task ) );
+        pendingTasks++;
+    }
+
+    taskReady.notify_one();
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBThreads AmigaGfx Library Threading Module
+    @brief      Waits until every submitted task has finished. Must not be
+                called from a task, it would wait on itself.
+  --------------------------------------------------------------------------*/
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> guard( lock );
+    tasksDone.wait( guard, [ this ]() { return pendingTasks == 0; } );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBThreads AmigaGfx Library Threading Module
+    @brief      Number of worker threads in the pool
+    @return     uint32_t - Worker count
+  --------------------------------------------------------------------------*/
+uint32_t ThreadPool::getThreadCount() const
+{
+    return (uint32_t)workers.size();
+}
+
+// Private Functions ----------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBThreads AmigaGfx Library Threading Module
+    @brief      Worker thread, runs tasks until the pool is destroyed
+  --------------------------------------------------------------------------*/
+void ThreadPool::workerThread()
+{
+    std::unique_lock<std::mutex> guard( lock );
+
+    while ( true )
+    {
+        taskReady.wait( guard, [ this ]() { return running == false || tasks.empty() == false; } );
+
+        if ( tasks.empty() )
+        {
+            // only reached once running is false
+            break;
+        }
+
+        std::function<void()> task = std::move( tasks.front() );
+        tasks.pop_front();
+
+        guard.unlock();
+        try
+        {
+            task();
+        }
+        catch ( const std::exception& error )
+        {
+            ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::ThreadPool_TaskFailed, std::string( "Thread pool task failed: " ) + error.what() );
+        }
+        catch ( ... )
+        {
+            ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::ThreadPool_TaskFailed, "Thread pool task failed" );
+        }
+        guard.lock();
+
+        if ( --pendingTasks == 0 )
+        {
+            tasksDone.notify_all();
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+} // end namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: ThreadPool.cpp
+// ----------------------------------------------------------------------------
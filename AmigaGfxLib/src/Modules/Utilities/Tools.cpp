@@ -8,6 +8,40 @@
 
 Notes:
 
+    Compressed sprite data (.SPR) is a stream of command bytes per line,
+    see SpriteCmd. Opaque spans are stored as literal runs, apart from
+    same colour runs long enough to be cheaper as a fill run (command,
+    length, colour). Run detection uses SSE2 byte compares where available.
+    The output is sized for the worst case up front (SpriteDataBound()), so
+    the encoder writes through a plain pointer with no capacity checks.
+
+    A .SPR file cut on a fixed grid starts "SPRITEDATA:count,w,h:" and a
+    table of uint32 offsets. When no grid is given the sprites are found
+    by SpriteSlicer and the file starts "SPRITELIST:count:" instead, with a
+    table of uint32 offset, uint16 x, y, width and height per sprite. The
+    command streams are the same in both.
+
+    Cells 16, 32, 60 or 64 pixels wide are encoded by a kernel built for
+    that width (CELL_KERNELS), which works from per line bit masks instead
+    of byte scans. The output is the same as the generic encoder, which
+    handles every other width. AmigaSpriteCompress --bench times both.
+
+    The kernels work on ImageViews, so a sprite cell is a sub view of the
+    sheet rather than a copy, and Decode_PNG() has libpng write its rows
+    straight into the decoded image.
+
+    Encode_PNG() writes PNGs itself rather than through libpng, so the zlib
+    level and strategy and the row filter are the caller's choice. The
+    rows are filtered and deflated in bands of about 256KB, each band
+    primed with the 32KB before it. Every band but the last ends with a
+    sync flush, so the bands join into one zlib stream, and their Adler-32s
+    are joined with adler32_combine(). The bands are set by the image, not
+    the number of threads, so a pool changes the speed but not the file.
+
+    Read_PNG() reads from a file and writes its outputs, and palette.bin,
+    as it goes. Convert_PNG() is the in memory path, PNG bytes in and the
+    palette, RAW, sprite and truecolour buffers out, with Save_Converted()
+    as an optional layer to write them to disk.
 
 -----------------------------------------------------------------------------*/
 
@@ -21,8 +55,24 @@ Notes:
 #include <iostream>
 #include <vector>
 #include <string>
-
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <latch>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#include <emmintrin.h>
+#define TOOLS_USE_SSE2
+#endif
+
+#include "../../../inc/Modules/ErrorHandling/ErrorHandler.h"
+#include "../../../inc/Modules/Utilities/Arena.h"
+#include "../../../inc/Modules/Utilities/Metrics.h"
+#include "../../../inc/Modules/Utilities/PaletteStore.h"
+#include "../../../inc/Modules/Utilities/ThreadPool.h"
 #include "../../../inc/Modules/Utilities/Tools.h"
+#include "../../../inc/Modules/Utilities/TrueColour.h"
 
 //-----------------------------------------------------------------------------
 // Namespace
@@ -44,6 +94,7 @@ namespace AmigaGfx
   --------------------------------------------------------------------------*/
 Tools::Tools()
 {
+    paletteStore = nullptr;
 }
 //-----------------------------------------------------------------------------
 /**---------------------------------------------------------------------------
@@ -90,12 +141,45 @@ uint16_t Tools::crc16( uint8_t* pData, uint32_t len ) const
     return crc;
 }
 
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      64 bit hash of a buffer, eight bytes at a time. Used as the
+                key of content addressed data, palette IDs and the convert
+                server's dedup index, it is not a cryptographic hash
+    @param      pData - Pointer to the data
+    @param      len - Length of the data to hash
+    @param      seed - Mixed into the hash, so the same bytes hashed for
+                different uses give different keys
+    @return     uint64_t - Hash value
+  --------------------------------------------------------------------------*/
+uint64_t Tools::hash64( const uint8_t* pData, size_t len, uint64_t seed ) const
+{
+    uint64_t hash  = 0x9E3779B97F4A7C15ull ^ len ^ seed;
+    size_t   nByte = 0;
+    uint64_t word;
+
+    for ( ; nByte + 8 <= len; nByte += 8 )
+    {
+        std::memcpy( &word, pData + nByte, 8 );
+        hash = ( hash ^ word ) * 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 32;
+    }
+
+    for ( ; nByte < len; nByte++ )
+    {
+        hash = ( hash ^ pData[ nByte ] ) * 0xC4CEB9FE1A85EC53ull;
+    }
+
+    return hash ^ ( hash >> 29 );
+}
+
 /**---------------------------------------------------------------------------
     @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
     @brief      Reads PNG file - PLEASE note this will only read 8bit indexed
                 PNG files. The image data is saved to disk in RAW format and
                 the sprite data is compressed and saved to disk. The palette
-                is saved in a format used by the Apollo V4.
+                is saved in a format used by the Apollo V4. Convert_PNG()
+                builds the same data in memory without writing anything.
     @param      file_name - Pointer to the file name
   --------------------------------------------------------------------------*/
 void Tools::Read_PNG( const char* file_name, uint32_t sprWidth, uint32_t sprHeight )
@@ -109,16 +193,35 @@ void Tools::Read_PNG( const char* file_name, uint32_t sprWidth, uint32_t sprHeig
         throw std::runtime_error( "Failed to open file for reading" );
     }
 
-    info_ptr = png_create_info_struct( png_ptr ); // <-- creating a new, local info_ptr
-    png_init_io( png_ptr, fp );
-    png_read_png( png_ptr, info_ptr, PNG_TRANSFORM_IDENTITY, NULL );
-    row_pointers = png_get_rows( png_ptr, info_ptr );
+    png_infop  info_ptr = png_create_info_struct( png_ptr );
+    png_bytepp row_pointers;
+    {
+        ScopedTimer timer( MetricStage::PngDecode );
+        png_init_io( png_ptr, fp );
+        png_read_png( png_ptr, info_ptr, PNG_TRANSFORM_IDENTITY, NULL );
+        row_pointers = png_get_rows( png_ptr, info_ptr );
+    }
+
+    Metrics& metrics = Metrics::getInstance();
+    metrics.addCount( MetricCounter::ImagesConverted );
+    metrics.addCount( MetricCounter::BytesIn, ftell( fp ) );
 
     // Get the image information
     uint32_t picWidth   = png_get_image_width( png_ptr, info_ptr );
     uint32_t picHeight  = png_get_image_height( png_ptr, info_ptr );
     uint32_t picColours = png_get_palette_max( png_ptr, info_ptr );
 
+    AGL_LOG_DEBUG( ErrorHandler::getInstance(), "Read {} {}x{} max colour index {}", file_name, picWidth, picHeight, picColours );
+
+    // a cell bigger than the image is a mistake in the sizes given, refuse it
+    // before anything is written
+    if ( sprWidth > picWidth || sprHeight > picHeight )
+    {
+        png_destroy_read_struct( &png_ptr, &info_ptr, NULL );
+        fclose( fp );
+        throw std::runtime_error( "Sprite size is larger than the image" );
+    }
+
     //-------------------------------------------------------------------------
     // PArt one - get the palette and save it in a format used by the Apollo V4
     //-------------------------------------------------------------------------
@@ -128,21 +231,48 @@ void Tools::Read_PNG( const char* file_name, uint32_t sprWidth, uint32_t sprHeig
     png_get_PLTE( png_ptr, info_ptr, &palette, &num_palette );
     std::vector<png_color> color_palette( palette, palette + num_palette );
 
-    // Save the palette in a format used for the Apollo V4
-    Save_ApolloV4_Palette( color_palette, "palette.bin" );
+    // keep the image for Write_PNG(), with its transparency
+    png_bytep trans_alpha = NULL;
+    int       num_trans   = 0;
+
+    readImage.fileName.assign( file_name );
+    readImage.width  = picWidth;
+    readImage.height = picHeight;
+    readImage.palette.assign( palette, palette + num_palette );
+    readImage.transparency.clear();
+    if ( png_get_tRNS( png_ptr, info_ptr, &trans_alpha, &num_trans, NULL ) && trans_alpha )
+    {
+        readImage.transparency.assign( trans_alpha, trans_alpha + num_trans );
+    }
+
+    // Save the palette in a format used for the Apollo V4, once per palette
+    // when there is a palette store, otherwise over palette.bin each time
+    if ( paletteStore )
+    {
+        uint64_t paletteId;
+        if ( paletteStore->add( color_palette, std::string( file_name ) + ".SPR", paletteId ) == false )
+        {
+            throw std::runtime_error( "Failed to write palette" );
+        }
+    }
+    else
+    {
+        Save_ApolloV4_Palette( color_palette, "palette.bin" );
+    }
 
     //-------------------------------------------------------------------------
     // Part two - get the image data and save it in RAW format
     // -------------------------------------------------------------------------
     // At this point row_pointers contain all the lines of the image in a raw format
     // get the image raw data for saving
-    std::vector<uint8_t> rawData( picWidth * picHeight );
-    for ( uint32_t y = 0; y < picHeight; y++ )
+    std::vector<uint8_t>& rawData = readImage.pixels;
+    rawData.resize( (size_t)picWidth * picHeight );
     {
-        for ( uint32_t x = 0; x < picWidth; x++ )
+        ScopedTimer        timer( MetricStage::PixelCopy );
+        ImageView<uint8_t> raw( rawData.data(), picWidth, picHeight );
+        for ( uint32_t y = 0; y < picHeight; y++ )
         {
-            uint8_t* pLine              = ( (uint8_t**)row_pointers )[ y ];
-            rawData[ y * picWidth + x ] = pLine[ x ];
+            memcpy( raw.getRow( y ), row_pointers[ y ], picWidth );
         }
     }
 
@@ -152,219 +282,1438 @@ void Tools::Read_PNG( const char* file_name, uint32_t sprWidth, uint32_t sprHeig
     std::string rawName( file_name );
     rawName += std::format( "-{0}-{1}.RAW", picWidth, picHeight );
 
-    // Crude check for the sprite height
-    uint32_t sprH = picHeight;
-    if ( picWidth == 60 && picHeight > picWidth * 2 )
-        sprH = picWidth;
-
     Save_Vector_To_File( rawData, rawName );
 
     //-------------------------------------------------------------------------
     // Part three - get the sprite data and save it in compressed format
     // -------------------------------------------------------------------------
-    // Compress and save the sprite data
+    // Compress and save the sprite data, cut on the given grid, or with no
+    // grid given, one sprite per shape found on the sheet
+    if ( sprWidth && sprHeight )
+    {
+        CompressSpriteData( rawData, picWidth, picHeight, sprWidth, sprHeight, rawName2 );
+    }
+    else
+    {
+        std::vector<SpriteRect> sprites;
+        std::vector<uint8_t>    sprFile;
+        ImageView<uint8_t>      sheet( rawData.data(), picWidth, picHeight );
 
-    // if ( picHeight > ( picWidth * 4 ) )
+        sheetSlicer.slice( sheet, sprites );
+        if ( EncodeSpriteList( sheet, sprites, rawName2, sprFile ) )
+        {
+            Save_Vector_To_File( sprFile, rawName2 + ".SPR" );
+        }
 
-    CompressSpriteData( rawData, picWidth, picHeight, picWidth, sprH, rawName2 );
+        AGL_LOG_DEBUG( ErrorHandler::getInstance(), "{} sliced into {} sprites from {} shapes", file_name, sprites.size(), sheetSlicer.getComponentCount() );
+    }
 
     //-------------------------------------------------------------------------
     // tidy up before exiting
-    png_destroy_read_struct( &png_ptr, NULL, NULL ); // <-- destroying the info_ptr (as well).
+    png_destroy_read_struct( &png_ptr, &info_ptr, NULL );
     fclose( fp );
 }
 
 /**---------------------------------------------------------------------------
     @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
-    @brief      Saves the Apollo V4 palette to disk
-    @param      palette - Pointer to the palette
-    @param      filename - Pointer to the file name
+    @brief      Decodes an 8 bit indexed PNG held in memory. Unlike
+                Read_PNG() nothing is kept in the Tools instance, so it can
+                be called from any number of threads at once.
+    @param      pngData - PNG file data
+    @param      image - Receives the size, palette and pixels
+    @return     bool - False if the data is not a valid 8 bit indexed PNG
   --------------------------------------------------------------------------*/
-void Tools::Save_ApolloV4_Palette( std::vector<png_color>& palette, const std::string& filename )
+bool Tools::Decode_PNG( const std::vector<uint8_t>& pngData, DecodedImage& image ) const
 {
-    std::ofstream file( filename, std::ios::binary );
+    return Decode_PNG( pngData.data(), pngData.size(), image );
+}
 
-    uint32_t      nSaveVal = palette.size();
-    uint8_t       nIndex   = 0;
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Decodes an 8 bit indexed PNG from any buffer, such as one
+                received over a network, libpng reads it through
+                png_set_read_fn() so there is no FILE* or temporary file
+    @param      pData - PNG file data
+    @param      size - Bytes of PNG file data
+    @param      image - Receives the size, palette and pixels
+    @return     bool - False if the data is not a valid 8 bit indexed PNG,
+                or it has more than PNG_MAX_PIXELS pixels
+  --------------------------------------------------------------------------*/
+bool Tools::Decode_PNG( const uint8_t* pData, size_t size, DecodedImage& image ) const
+{
+    // timed from before the setjmp, so a longjmp never skips the timer's destructor
+    ScopedTimer timer( MetricStage::PngDecode );
+
+    // libpng allocates from this thread's arena, which is reset when done
+    Arena&          arena    = Arena::getThreadArena();
+    PngMemoryReader reader   = { pData, size, 0 };
+    png_structp     png_ptr  = png_create_read_struct_2( PNG_LIBPNG_VER_STRING, NULL, NULL, NULL, &arena, PngArenaMalloc, PngArenaFree );
+    png_infop       info_ptr = png_ptr ? png_create_info_struct( png_ptr ) : NULL;
+
+    // releases libpng's structs and the arena on every way out, a decode
+    // error, a rejected image or a throw while allocating the pixels
+    struct PngReadGuard
+    {
+        png_structp& png;
+        png_infop&   info;
+        Arena&       arena;
 
-    if ( !file.is_open() )
+        ~PngReadGuard()
+        {
+            png_destroy_read_struct( &png, &info, NULL );
+            arena.reset();
+        }
+    } readGuard = { png_ptr, info_ptr, arena };
+
+    // libpng jumps back here on a decode error
+    if ( info_ptr == NULL || setjmp( png_jmpbuf( png_ptr ) ) )
     {
-        throw std::runtime_error( "Failed to open file for writing" );
+        return false;
     }
 
-    // first the number of colours
-    file.write( (char*)&nSaveVal, sizeof( uint32_t ) );
+    png_set_read_fn( png_ptr, &reader, PngReadFromMemory );
+    png_read_info( png_ptr, info_ptr );
 
-    // now the palette
-    for ( auto& color : palette )
+    if ( png_get_color_type( png_ptr, info_ptr ) != PNG_COLOR_TYPE_PALETTE || png_get_bit_depth( png_ptr, info_ptr ) != 8 )
     {
-        // save the index and colour values in the format used by the Apollo V4
-        nSaveVal = nIndex | color.red << 8 | color.green << 16 | color.blue << 24;
-        file.write( (char*)&nSaveVal, sizeof( uint32_t ) );
-        nIndex++;
+        return false;
     }
 
-    if ( !file )
+    // the header is checked before anything is sized from it, a small file
+    // can claim to be a huge image
+    if ( (uint64_t)png_get_image_width( png_ptr, info_ptr ) * png_get_image_height( png_ptr, info_ptr ) > PNG_MAX_PIXELS )
     {
-        throw std::runtime_error( "Failed to write data to file" );
+        return false;
     }
 
-    file.close();
+    png_colorp palette;
+    int        num_palette = 0;
+
+    image.width  = png_get_image_width( png_ptr, info_ptr );
+    image.height = png_get_image_height( png_ptr, info_ptr );
+
+    png_get_PLTE( png_ptr, info_ptr, &palette, &num_palette );
+    image.palette.assign( palette, palette + num_palette );
+
+    png_bytep trans_alpha = NULL;
+    int       num_trans   = 0;
+
+    image.transparency.clear();
+    if ( png_get_tRNS( png_ptr, info_ptr, &trans_alpha, &num_trans, NULL ) && trans_alpha )
+    {
+        image.transparency.assign( trans_alpha, trans_alpha + num_trans );
+    }
+
+    // libpng decodes straight into the image, each row pointer is a row of
+    // a view over the pixels, so there is no copy out of libpng's buffers
+    image.pixels.resize( (size_t)image.width * image.height );
+
+    ImageView<uint8_t> pixels( image.pixels.data(), image.width, image.height );
+    png_bytepp         rows = (png_bytepp)arena.allocate( image.height * sizeof( png_bytep ) );
+
+    for ( uint32_t y = 0; y < image.height; y++ )
+    {
+        rows[ y ] = pixels.getRow( y );
+    }
+
+    png_set_interlace_handling( png_ptr );
+    png_read_update_info( png_ptr, info_ptr );
+    png_read_image( png_ptr, rows );
+    png_read_end( png_ptr, NULL );
+
+    Metrics::getInstance().addCount( MetricCounter::ImagesConverted );
+
+    return true;
 }
 
 /**---------------------------------------------------------------------------
     @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
-    @brief      Compress the RAW image data into compressed sprite data
-                and save to disk.
-    @param      data - Pointer to the data
-    @param      w - Width of the image
-    @param      h - Height of the image
-    @param      sprW - Width of the sprite
-    @param      sprH - Height of the sprite
+    @brief      Builds the output files for a decoded image in memory, the
+                same RAW and compressed sprite files Read_PNG() writes, and
+                the Apollo V4 palette named after the image. Can be called
+                from any number of threads at once.
+    @param      image - Decoded image
+    @param      outputs - Receives the file names and data to write
+    @param      sprW - Width of the sprite grid, 0 finds the sprites
+    @param      sprH - Height of the sprite grid, 0 finds the sprites
+    @param      formats - OutputFormat flags, the outputs to build, in the
+                order palette, RAW, sprites, RGB565, ARGB32
+    @return     bool - False if the sprites do not fit a sprite list, see
+                EncodeSpriteList()
   --------------------------------------------------------------------------*/
-void Tools::CompressSpriteData( std::vector<uint8_t>& data, uint32_t w, uint32_t h, uint32_t sprW, uint32_t sprH, std::string fileName )
+bool Tools::Encode_Image( const DecodedImage& image, std::vector<ConvertedFile>& outputs, uint32_t sprW, uint32_t sprH, uint32_t formats ) const
 {
-    std::vector<uint32_t> sprOffsets;
-    std::vector<uint8_t>  sprData;
-    uint32_t              sprDataStart = 0;
-    uint32_t              sprCount     = 0;
-    uint32_t              tmpValue     = 0;
+    char   sizeSuffix[ 32 ];
+    size_t nOutput = 0;
+    bool   bEncoded = true;
+
+    // assign rather than build new strings and vectors, so pooled outputs
+    // are refilled without allocating
+    snprintf( sizeSuffix, sizeof( sizeSuffix ), "-%u-%u", image.width, image.height );
+    outputs.resize( std::popcount( formats & OutputEvery ) );
+
+    if ( formats & OutputPalette )
+    {
+        outputs[ nOutput ].fileName.assign( image.fileName ).append( ".PAL" );
+        Build_ApolloV4_Palette( image.palette, outputs[ nOutput++ ].fileData );
+    }
+
+    if ( formats & OutputRaw )
+    {
+        outputs[ nOutput ].fileName.assign( image.fileName ).append( sizeSuffix ).append( ".RAW" );
+        outputs[ nOutput++ ].fileData.assign( image.pixels.begin(), image.pixels.end() );
+    }
+
+    if ( formats & OutputSprites )
+    {
+        ConvertedFile& spriteFile = outputs[ nOutput++ ];
 
-    // calculate the offsets
-    for ( uint32_t sprDy = 0; sprDy < h; sprDy += sprH )
+        spriteFile.fileName.assign( image.fileName ).append( ".SPR" );
+        bEncoded = EncodeImageSprites( image.getView(), sprW, sprH, image.fileName, spriteFile.fileData );
+    }
+
+    // index 0 is transparent, as it is for the sprites, and becomes the key colour
+    for ( TrueColourFormat format : { TrueColourFormat::Rgb565, TrueColourFormat::Argb32 } )
     {
-        for ( uint32_t sprDx = 0; sprDx < w; sprDx += sprW )
+        if ( formats & ( format == TrueColourFormat::Rgb565 ? OutputRgb565 : OutputArgb32 ) )
         {
+            TrueColourConverter converter( TrueColourConfig{ .format = format } );
 
-            sprDataStart = sprData.size();
-            sprOffsets.push_back( sprDataStart );
+            outputs[ nOutput ].fileName.assign( image.fileName ).append( sizeSuffix ).append( format == TrueColourFormat::Rgb565 ? ".565" : ".ARGB" );
+            converter.setPalette( image.palette, image.transparency );
+            converter.convert( image.getView(), outputs[ nOutput++ ].fileData );
+        }
+    }
 
-            for ( uint32_t y = 0; y < sprH; y++ )
-            {
-                bool     bLoop = true;
+    return bEncoded;
+}
 
-                uint32_t x     = 0;
-                while ( bLoop )
-                {
-                    uint8_t sprCmd = 0;
-                    // sprCMD is offset to start of drawable data (0-199)
-                    // sprCMD 200 = skip 200 pixels, no data
-                    // sprCMD 201 = skip line
-                    // sprCMD 255 = end of sprite
-                    // scan for the first non transparent pixel
-                    for ( uint32_t scanBG = 0; scanBG <= 200; scanBG++ )
-                    {
-                        if ( scanBG + x == ( sprW ) )
-                        {
-                            x      = sprW;
-                            sprCmd = 201;
-                            sprData.push_back( sprCmd );
-                            bLoop = false;
-                            break;
-                        }
-
-                        if ( ( data[ ( sprDy + y ) * w + sprDx + x + scanBG ] != 0 ) )
-                        {
-                            x += scanBG;
-                            sprCmd = scanBG;
-                            sprData.push_back( sprCmd );
-                            break;
-                        }
-
-                        if ( scanBG == 200 )
-                        {
-                            x += scanBG;
-                            sprCmd = scanBG;
-                            sprData.push_back( sprCmd );
-                            break;
-                        }
-                    }
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Converts an 8 bit indexed PNG held in memory into the
+                palette, RAW, sprite and truecolour buffers, writing
+                nothing to disk.
+                Save_Converted() writes them when files are wanted. Can be
+                called from any number of threads at once.
+    @param      pngData - PNG file data
+    @param      converted - Receives the image size, palette and outputs
+    @param      sprW - Width of the sprite grid, 0 finds the sprites
+    @param      sprH - Height of the sprite grid, 0 finds the sprites
+    @param      formats - OutputFormat flags, the buffers to fill
+    @return     bool - False if the data is not a valid 8 bit indexed PNG
+  --------------------------------------------------------------------------*/
+bool Tools::Convert_PNG( const std::vector<uint8_t>& pngData, ConvertedImage& converted, uint32_t sprW, uint32_t sprH, uint32_t formats ) const
+{
+    return Convert_PNG( pngData.data(), pngData.size(), converted, sprW, sprH, formats );
+}
 
-                    // write the run of pixel data
-                    if ( sprCmd < 200 )
-                    {
-                        // SprCMD is the offset to the start of the pixel data
-                        // search for the end of the run of pixel data
-                        // and write the length of the data length
-                        tmpValue = 0;
-                        while ( x + tmpValue < sprW && data[ ( sprDy + y ) * w + sprDx + x + tmpValue ] != 0 )
-                        {
-                            tmpValue++;
-                        }
-                        sprData.push_back( tmpValue );
-
-                        while ( tmpValue )
-                        {
-                            sprData.push_back( data[ ( sprDy + y ) * w + sprDx + x ] );
-                            x++;
-                            tmpValue--;
-                        }
-                    }
-                }
-            }
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Converts an 8 bit indexed PNG from any buffer into the
+                palette, RAW, sprite and truecolour buffers, writing
+                nothing to disk
+    @param      pData - PNG file data
+    @param      size - Bytes of PNG file data
+    @param      converted - Receives the image size, palette and outputs
+    @param      sprW - Width of the sprite grid, 0 finds the sprites
+    @param      sprH - Height of the sprite grid, 0 finds the sprites
+    @param      formats - OutputFormat flags, the buffers to fill
+    @return     bool - False if the data is not a valid 8 bit indexed PNG,
+                or its sprites do not fit a sprite list
+  --------------------------------------------------------------------------*/
+bool Tools::Convert_PNG( const uint8_t* pData, size_t size, ConvertedImage& converted, uint32_t sprW, uint32_t sprH, uint32_t formats ) const
+{
+    // decode into this thread's image, its pixels become the RAW buffer
+    thread_local DecodedImage image;
 
-            // stored the compressed sprite data
-            sprData.push_back( 255 );
-            sprCount++;
+    if ( Decode_PNG( pData, size, image ) == false )
+    {
+        return false;
+    }
+
+    converted.width  = image.width;
+    converted.height = image.height;
+    converted.palette.assign( image.palette.begin(), image.palette.end() );
+    converted.paletteData.clear();
+    converted.raw.clear();
+    converted.sprites.clear();
+    converted.rgb565.clear();
+    converted.argb32.clear();
+
+    if ( formats & OutputPalette )
+    {
+        Build_ApolloV4_Palette( image.palette, converted.paletteData );
+    }
+
+    if ( ( formats & OutputSprites ) && EncodeImageSprites( image.getView(), sprW, sprH, "<memory>", converted.sprites ) == false )
+    {
+        return false;
+    }
+
+    // index 0 is the key colour, as Encode_Image() writes it
+    for ( TrueColourFormat format : { TrueColourFormat::Rgb565, TrueColourFormat::Argb32 } )
+    {
+        if ( formats & ( format == TrueColourFormat::Rgb565 ? OutputRgb565 : OutputArgb32 ) )
+        {
+            TrueColourConverter converter( TrueColourConfig{ .format = format } );
+
+            converter.setPalette( image.palette, image.transparency );
+            converter.convert( image.getView(), format == TrueColourFormat::Rgb565 ? converted.rgb565 : converted.argb32 );
         }
     }
 
-    // save the compressed sprite data to disk...
-    fileName += ".SPR";
-    std::ofstream file( fileName, std::ios::binary );
+    // hand the decoded pixels over rather than copy them, the swapped in
+    // buffer is reused by the next decode on this thread
+    if ( formats & OutputRaw )
+    {
+        converted.raw.swap( image.pixels );
+    }
+
+    return true;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Encodes an 8 bit indexed image as a PNG held in memory. The
+                rows are filtered and deflated in bands, each band its own
+                run of deflate primed with the end of the band before, and
+                the bands are joined into one zlib stream, one IDAT chunk
+                per band. With a pool in the options the bands are filtered
+                and deflated in parallel, the output is the same either way.
+                Can be called from any number of threads at once, but not
+                from a thread of the pool it is given.
+    @param      image - Image to encode, its transparency is kept
+    @param      pngData - Receives the PNG file data
+    @param      options - zlib level and strategy, row filter and bands
+    @return     bool - False if the image is empty or zlib failed
+  --------------------------------------------------------------------------*/
+bool Tools::Encode_PNG( const DecodedImage& image, std::vector<uint8_t>& pngData, const PngEncodeOptions& options ) const
+{
+    // one band's filtered rows and deflated data
+    struct PngBand
+    {
+        size_t               start;    //!< First filtered byte of the band
+        size_t               size;     //!< Filtered bytes in the band
+        uLong                adler;    //!< Adler-32 of the filtered bytes
+        std::vector<uint8_t> deflated; //!< Raw deflate data, byte aligned
+        bool                 bDone;    //!< False if zlib failed
+    };
+
+    if ( image.width == 0 || image.height == 0 || image.palette.empty() || image.palette.size() > 256 )
+    {
+        return false;
+    }
+
+    ScopedTimer timer( MetricStage::PngEncode );
+
+    // filter byte then the row, bands sized from the image alone, so the
+    // output does not depend on the number of threads
+    size_t   rowBytes = (size_t)image.width + 1;
+    uint32_t bandRows = options.bandRows ? options.bandRows : image.height;
+    if ( options.bandRows == 0 && rowBytes * image.height > 2 * PNG_BAND_BYTES )
+    {
+        bandRows = (uint32_t)std::max<size_t>( 1, PNG_BAND_BYTES / rowBytes );
+    }
+    uint32_t bandCount = ( image.height + bandRows - 1 ) / bandRows;
+
+    thread_local std::vector<uint8_t> filtered;
+    std::vector<PngBand>              bands( bandCount );
+    ImageView<const uint8_t>          pixels = image.getView();
+
+    // the bands run on the pool threads, which have thread_locals of their own
+    filtered.resize( rowBytes * image.height );
+    uint8_t* pFiltered = filtered.data();
+
+    RunPngBands( bandCount, options.pool, [ & ]( uint32_t nBand ) {
+        uint32_t firstRow = nBand * bandRows;
+        uint32_t lastRow  = std::min( firstRow + bandRows, image.height );
+
+        for ( uint32_t y = firstRow; y < lastRow; y++ )
+        {
+            FilterPngRow( pixels.getRow( y ), y ? pixels.getRow( y - 1 ) : nullptr, image.width, options.filter, pFiltered + y * rowBytes );
+        }
+        bands[ nBand ].start = firstRow * rowBytes;
+        bands[ nBand ].size  = ( lastRow - firstRow ) * rowBytes;
+    } );
+
+    // each band is deflated on its own, primed with the window before it,
+    // every band but the last ends on a byte boundary so they join up
+    RunPngBands( bandCount, options.pool, [ & ]( uint32_t nBand ) {
+        PngBand& band   = bands[ nBand ];
+        z_stream stream = {};
+        bool     bLast  = nBand + 1 == bandCount;
+
+        band.bDone = false;
+        band.adler = adler32( adler32( 0L, Z_NULL, 0 ), pFiltered + band.start, (uInt)band.size );
+
+        if ( deflateInit2( &stream, options.zlibLevel, Z_DEFLATED, -MAX_WBITS, 8, options.zlibStrategy ) != Z_OK )
+        {
+            return;
+        }
+        if ( band.start )
+        {
+            size_t window = std::min( band.start, PNG_WINDOW );
+            deflateSetDictionary( &stream, pFiltered + band.start - window, (uInt)window );
+        }
+
+        band.deflated.resize( deflateBound( &stream, band.size ) + 16 );
+        stream.next_in   = pFiltered + band.start;
+        stream.avail_in  = (uInt)band.size;
+        stream.next_out  = band.deflated.data();
+        stream.avail_out = (uInt)band.deflated.size();
+
+        int result = deflate( &stream, bLast ? Z_FINISH : Z_SYNC_FLUSH );
+        band.bDone = bLast ? result == Z_STREAM_END : ( result == Z_OK && stream.avail_in == 0 && stream.avail_out != 0 );
+        band.deflated.resize( stream.total_out );
+        deflateEnd( &stream );
+    } );
+
+    // the zlib header, level hint and check bits, and the joined Adler-32
+    int     level   = options.zlibLevel < 0 ? 6 : options.zlibLevel;
+    uint8_t zlibCMF = 0x78;
+    uint8_t zlibFLG = ( level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3 ) << 6;
+    uLong   adler   = adler32( 0L, Z_NULL, 0 );
+
+    zlibFLG += 31 - ( zlibCMF * 256 + zlibFLG ) % 31;
+
+    for ( const PngBand& band : bands )
+    {
+        if ( band.bDone == false )
+        {
+            return false;
+        }
+        adler = adler32_combine( adler, band.adler, band.size );
+    }
+
+    static const uint8_t signature[ 8 ] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    size_t               chunk;
+
+    // PNG numbers are big endian
+    auto appendBigEndian = [ &pngData ]( uint32_t value ) {
+        pngData.insert( pngData.end(), { (uint8_t)( value >> 24 ), (uint8_t)( value >> 16 ), (uint8_t)( value >> 8 ), (uint8_t)value } );
+    };
+
+    pngData.assign( signature, signature + sizeof( signature ) );
+
+    // 8 bit palette, deflate, adaptive filtering, not interlaced
+    chunk = BeginPngChunk( pngData, "IHDR" );
+    appendBigEndian( image.width );
+    appendBigEndian( image.height );
+    pngData.insert( pngData.end(), { 8, PNG_COLOR_TYPE_PALETTE, 0, 0, 0 } );
+    EndPngChunk( pngData, chunk );
+
+    chunk = BeginPngChunk( pngData, "PLTE" );
+    for ( const png_color& colour : image.palette )
+    {
+        pngData.insert( pngData.end(), { colour.red, colour.green, colour.blue } );
+    }
+    EndPngChunk( pngData, chunk );
+
+    if ( image.transparency.empty() == false )
+    {
+        chunk = BeginPngChunk( pngData, "tRNS" );
+        pngData.insert( pngData.end(), image.transparency.begin(), image.transparency.end() );
+        EndPngChunk( pngData, chunk );
+    }
+
+    for ( uint32_t nBand = 0; nBand < bandCount; nBand++ )
+    {
+        chunk = BeginPngChunk( pngData, "IDAT" );
+        if ( nBand == 0 )
+        {
+            pngData.insert( pngData.end(), { zlibCMF, zlibFLG } );
+        }
+        pngData.insert( pngData.end(), bands[ nBand ].deflated.begin(), bands[ nBand ].deflated.end() );
+        if ( nBand + 1 == bandCount )
+        {
+            appendBigEndian( (uint32_t)adler );
+        }
+        EndPngChunk( pngData, chunk );
+    }
+
+    EndPngChunk( pngData, BeginPngChunk( pngData, "IEND" ) );
+
+    return true;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Saves the Apollo V4 palette to disk
+    @param      palette - Pointer to the palette
+    @param      filename - Pointer to the file name
+  --------------------------------------------------------------------------*/
+void Tools::Save_ApolloV4_Palette( std::vector<png_color>& palette, const std::string& filename )
+{
+    ScopedTimer          timer( MetricStage::PaletteWrite );
+    std::vector<uint8_t> paletteData;
+    std::ofstream        file( filename, std::ios::binary );
 
     if ( !file.is_open() )
     {
         throw std::runtime_error( "Failed to open file for writing" );
     }
 
-    file << "SPRITEDATA:" << sprCount << "," << sprW << "," << sprH << ":";
-    file.write( (char*)sprOffsets.data(), sprOffsets.size() * sizeof( uint32_t ) );
-    file.write( (char*)sprData.data(), sprData.size() );
+    Build_ApolloV4_Palette( palette, paletteData );
+    file.write( (char*)paletteData.data(), paletteData.size() );
+
     if ( !file )
     {
         throw std::runtime_error( "Failed to write data to file" );
     }
+
     file.close();
+    Metrics::getInstance().addCount( MetricCounter::BytesOut, paletteData.size() );
 }
 
 /**---------------------------------------------------------------------------
     @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
-    @brief      Saves the vector to disk
-    @param      file_name - Pointer to the file name
+    @brief      Gives Read_PNG() a palette store, each palette is then
+                written once to the store rather than to palette.bin for
+                every image
+    @param      store - Palette store, nullptr goes back to palette.bin
   --------------------------------------------------------------------------*/
-void Tools::Save_Vector_To_File( const std::vector<uint8_t>& vData, const std::string& filename )
+void Tools::Set_PaletteStore( PaletteStore* store )
 {
-    std::ofstream file( filename, std::ios::binary );
+    paletteStore = store;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Builds the Apollo V4 palette file in memory, the number of
+                colours followed by a uint32_t per colour
+    @param      palette - Palette colours
+    @param      paletteData - Receives the palette file data
+  --------------------------------------------------------------------------*/
+void Tools::Build_ApolloV4_Palette( const std::vector<png_color>& palette, std::vector<uint8_t>& paletteData ) const
+{
+    uint32_t nSaveVal = palette.size();
+    uint8_t  nIndex   = 0;
+
+    paletteData.resize( ( palette.size() + 1 ) * sizeof( uint32_t ) );
+    uint8_t* pOut = paletteData.data();
+
+    // first the number of colours
+    memcpy( pOut, &nSaveVal, sizeof( uint32_t ) );
+    pOut += sizeof( uint32_t );
+
+    // now the palette
+    for ( auto& color : palette )
+    {
+        // save the index and colour values in the format used by the Apollo V4
+        nSaveVal = nIndex | color.red << 8 | color.green << 16 | color.blue << 24;
+        memcpy( pOut, &nSaveVal, sizeof( uint32_t ) );
+        pOut += sizeof( uint32_t );
+        nIndex++;
+    }
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Compress the RAW image data into compressed sprite data
+                and save to disk.
+    @param      data - Pointer to the data
+    @param      w - Width of the image
+    @param      h - Height of the image
+    @param      sprW - Width of the sprite
+    @param      sprH - Height of the sprite
+  --------------------------------------------------------------------------*/
+void Tools::CompressSpriteData( std::vector<uint8_t>& data, uint32_t w, uint32_t h, uint32_t sprW, uint32_t sprH, std::string fileName )
+{
+    std::vector<uint8_t> sprFile;
+
+    EncodeSpriteData( data, w, h, sprW, sprH, fileName, sprFile );
+
+    // save the compressed sprite data to disk...
+    ScopedTimer writeTimer( MetricStage::FileWrite );
+    fileName += ".SPR";
+    std::ofstream file( fileName, std::ios::binary );
+
     if ( !file.is_open() )
     {
         throw std::runtime_error( "Failed to open file for writing" );
     }
 
-    file.write( (char*)vData.data(), vData.size() );
+    file.write( (char*)sprFile.data(), sprFile.size() );
     if ( !file )
     {
         throw std::runtime_error( "Failed to write data to file" );
     }
-
+    Metrics::getInstance().addCount( MetricCounter::BytesOut, sprFile.size() );
     file.close();
 }
 
 /**---------------------------------------------------------------------------
     @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
-    @brief      Writes PNG file, please note at present the image needs to be
-                opened via Read_PNG first.
-    @param      file_name - Pointer to the file name
-  --------------------------------------------------------------------------*/
-void Tools::Write_PNG( const char* file_name )
-{
-    FILE*       fp      = fopen( file_name, "wb" );
-    png_structp png_ptr = png_create_write_struct( PNG_LIBPNG_VER_STRING, NULL, NULL, NULL );
-    png_init_io( png_ptr, fp );
-    png_set_rows( png_ptr, info_ptr, row_pointers );
-    png_write_png( png_ptr, info_ptr, PNG_TRANSFORM_IDENTITY, NULL );
-    png_destroy_write_struct( &png_ptr, &info_ptr );
-    fclose( fp );
+    @brief      Compress the RAW image data into a compressed sprite (.SPR)
+                file held in memory. Only reads the Tools instance, so it
+                can be called from any number of threads at once.
+    @param      data - Pointer to the data
+    @param      w - Width of the image
+    @param      h - Height of the image
+    @param      sprW - Width of the sprite
+    @param      sprH - Height of the sprite
+    @param      fileName - Source file name, used for logging
+    @param      sprFile - Receives the .SPR file data
+  --------------------------------------------------------------------------*/
+void Tools::EncodeSpriteData( const std::vector<uint8_t>& data, uint32_t w, uint32_t h, uint32_t sprW, uint32_t sprH, const std::string& fileName, std::vector<uint8_t>& sprFile ) const
+{
+    EncodeSpriteData( ImageView<const uint8_t>( data.data(), w, h ), sprW, sprH, fileName, sprFile );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Compress a view of an image into a compressed sprite (.SPR)
+                file held in memory, cutting it into sprW x sprH cells. The
+                view can be a sub rectangle of a larger sheet, each cell is
+                encoded in place. Cells along the right and bottom edges are
+                clipped to the view. Can be called from any number of
+                threads at once.
+    @param      image - Pixels to compress
+    @param      sprW - Width of the sprite
+    @param      sprH - Height of the sprite
+    @param      fileName - Source file name, used for logging
+    @param      sprFile - Receives the .SPR file data
+  --------------------------------------------------------------------------*/
+void Tools::EncodeSpriteData( ImageView<const uint8_t> image, uint32_t sprW, uint32_t sprH, const std::string& fileName, std::vector<uint8_t>& sprFile ) const
+{
+    uint32_t    w            = image.getWidth();
+    uint32_t    h            = image.getHeight();
+    uint32_t    sprDataStart = 0;
+    uint32_t    sprCount     = 0;
+    uint64_t    opCounts[ (size_t)MetricCounter::TotalCounters ] = { 0 };
+    ScopedTimer timer( MetricStage::Compress );
+
+    // cells bigger than the image are clipped to it, so size and step by the
+    // clipped cell, and count in 64 bits so a huge cell cannot wrap to 0 cells
+    uint32_t cellW       = std::min( sprW, w );
+    uint32_t cellH       = std::min( sprH, h );
+    uint64_t cellsAcross = cellW ? ( (uint64_t)w + cellW - 1 ) / cellW : 0;
+    uint64_t cellsDown   = cellH ? ( (uint64_t)h + cellH - 1 ) / cellH : 0;
+
+    // size the file for the worst case up front, header, offsets table and
+    // then the command stream, so the commands go through an unchecked cursor
+    uint64_t sprTotal = cellsAcross * cellsDown;
+    char     header[ 64 ];
+    size_t   headerLen = snprintf( header, sizeof( header ), "SPRITEDATA:%llu,%u,%u:", (unsigned long long)sprTotal, sprW, sprH );
+
+    sprFile.resize( headerLen + sprTotal * sizeof( uint32_t ) + SpriteDataBound( w, h, sprW, sprH ) );
+    memcpy( sprFile.data(), header, headerLen );
+
+    uint8_t* pOffsets = sprFile.data() + headerLen;
+    uint8_t* pData    = pOffsets + sprTotal * sizeof( uint32_t );
+    uint8_t* pOut     = pData;
+
+    for ( uint64_t nRow = 0; nRow < cellsDown; nRow++ )
+    {
+        for ( uint64_t nColumn = 0; nColumn < cellsAcross; nColumn++ )
+        {
+            uint32_t sprDx = (uint32_t)( nColumn * cellW );
+            uint32_t sprDy = (uint32_t)( nRow * cellH );
+
+            sprDataStart = pOut - pData;
+            memcpy( pOffsets + sprCount * sizeof( uint32_t ), &sprDataStart, sizeof( uint32_t ) );
+
+            pOut = EncodeSpriteCell( image.subView( sprDx, sprDy, cellW, cellH ), pOut, opCounts );
+            sprCount++;
+
+            AGL_LOG_TRACE( ErrorHandler::getInstance(), "{} sprite {} at {},{} packed into {} bytes", fileName, sprCount - 1, sprDx, sprDy, ( pOut - pData ) - sprDataStart );
+        }
+    }
+
+    // record the sprite and command counts, once per call
+    Metrics& metrics = Metrics::getInstance();
+    metrics.addCount( MetricCounter::SpritesEncoded, sprCount );
+    for ( size_t nIndex = (size_t)MetricCounter::OpSkip; nIndex <= (size_t)MetricCounter::OpEndSprite; nIndex++ )
+    {
+        metrics.addCount( (MetricCounter)nIndex, opCounts[ nIndex ] );
+    }
+
+    // trim to the bytes used, shrinking never reallocates
+    sprFile.resize( pOut - sprFile.data() );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Compress sprites of any size and position on a sheet into a
+                compressed sprite list file held in memory. Each table
+                entry gives the offset of the sprite's commands followed by
+                its x, y, width and height. Can be called from any number
+                of threads at once.
+    @param      image - Sheet holding the sprites
+    @param      sprites - Position and size of each sprite on the sheet
+    @param      fileName - Source file name, used for logging
+    @param      sprFile - Receives the sprite list file data
+    @return     bool - False if a position or size is over 65535, the file
+                is left empty
+  --------------------------------------------------------------------------*/
+bool Tools::EncodeSpriteList( ImageView<const uint8_t> image, const std::vector<SpriteRect>& sprites, const std::string& fileName, std::vector<uint8_t>& sprFile ) const
+{
+    uint64_t    opCounts[ (size_t)MetricCounter::TotalCounters ] = { 0 };
+    ScopedTimer timer( MetricStage::Compress );
+
+    if ( EncodeSpriteList( image, sprites, fileName, sprFile, opCounts ) == false )
+    {
+        return false;
+    }
+
+    Metrics& metrics = Metrics::getInstance();
+    metrics.addCount( MetricCounter::SpritesEncoded, sprites.size() );
+    for ( size_t nIndex = (size_t)MetricCounter::OpSkip; nIndex <= (size_t)MetricCounter::OpEndSprite; nIndex++ )
+    {
+        metrics.addCount( (MetricCounter)nIndex, opCounts[ nIndex ] );
+    }
+
+    return true;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Compress sprites into a sprite list file as above, adding the
+                command counts to the caller's table and recording no
+                metrics, for callers measuring the sprites rather than
+                converting them
+    @param      image - Sheet holding the sprites
+    @param      sprites - Position and size of each sprite on the sheet
+    @param      fileName - Source file name, used for logging
+    @param      sprFile - Receives the sprite list file data
+    @param      opCounts - Command counts, indexed by MetricCounter
+    @return     bool - False if a position or size is over 65535, the file
+                is left empty
+  --------------------------------------------------------------------------*/
+bool Tools::EncodeSpriteList( ImageView<const uint8_t> image, const std::vector<SpriteRect>& sprites, const std::string& fileName, std::vector<uint8_t>& sprFile,
+                              uint64_t* opCounts ) const
+{
+    size_t bound = 0;
+    char   header[ 64 ];
+    size_t headerLen = snprintf( header, sizeof( header ), "SPRITELIST:%u:", (uint32_t)sprites.size() );
+
+    // the table holds 16 bit positions and sizes, checked before anything
+    // is written rather than wrapped
+    for ( const SpriteRect& sprite : sprites )
+    {
+        if ( std::max( { sprite.x, sprite.y, sprite.width, sprite.height } ) > UINT16_MAX )
+        {
+            ErrorHandler::getInstance().handleError( ErrorType::Error, LibraryError::SpriteList_OutOfRange,
+                                                     fileName + " has a sprite at " + std::to_string( sprite.x ) + "," + std::to_string( sprite.y ) + " sized " + std::to_string( sprite.width ) + "x" +
+                                                         std::to_string( sprite.height ) + ", a sprite list holds up to 65535" );
+            sprFile.clear();
+            return false;
+        }
+        bound += SpriteDataBound( sprite.width, sprite.height, sprite.width, sprite.height );
+    }
+
+    sprFile.resize( headerLen + sprites.size() * SPR_LIST_ENTRY + bound );
+    memcpy( sprFile.data(), header, headerLen );
+
+    uint8_t* pTable = sprFile.data() + headerLen;
+    uint8_t* pData  = pTable + sprites.size() * SPR_LIST_ENTRY;
+    uint8_t* pOut   = pData;
+
+    for ( const SpriteRect& sprite : sprites )
+    {
+        uint32_t sprDataStart = pOut - pData;
+        uint16_t position[ 4 ] = { (uint16_t)sprite.x, (uint16_t)sprite.y, (uint16_t)sprite.width, (uint16_t)sprite.height };
+
+        memcpy( pTable, &sprDataStart, sizeof( uint32_t ) );
+        memcpy( pTable + sizeof( uint32_t ), position, sizeof( position ) );
+        pTable += SPR_LIST_ENTRY;
+
+        pOut = EncodeSpriteCell( image.subView( sprite.x, sprite.y, sprite.width, sprite.height ), pOut, opCounts );
+
+        AGL_LOG_TRACE( ErrorHandler::getInstance(), "{} sprite {}x{} at {},{} packed into {} bytes", fileName, sprite.width, sprite.height, sprite.x, sprite.y, ( pOut - pData ) - sprDataStart );
+    }
+
+    sprFile.resize( pOut - sprFile.data() );
+
+    return true;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Compress an image into a sprite file held in memory, cut on
+                the sprite grid, or with no grid given, one sprite per
+                shape found on the image
+    @param      image - Pixels to compress
+    @param      sprW - Width of the sprite grid, 0 finds the sprites
+    @param      sprH - Height of the sprite grid, 0 finds the sprites
+    @param      fileName - Source file name, used for logging
+    @param      sprFile - Receives the .SPR file data
+    @return     bool - False if the shapes found do not fit a sprite list
+  --------------------------------------------------------------------------*/
+bool Tools::EncodeImageSprites( ImageView<const uint8_t> image, uint32_t sprW, uint32_t sprH, const std::string& fileName, std::vector<uint8_t>& sprFile ) const
+{
+    if ( sprW && sprH )
+    {
+        EncodeSpriteData( image, sprW, sprH, fileName, sprFile );
+        return true;
+    }
+    else
+    {
+        // callers already run one image per thread, so each thread slices
+        // inline with its own slicer and keeps its buffers between images
+        thread_local SpriteSlicer            slicer( SliceConfig{ .threadCount = 1 } );
+        thread_local std::vector<SpriteRect> sprites;
+
+        slicer.slice( image, sprites );
+        return EncodeSpriteList( image, sprites, fileName, sprFile );
+    }
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Encodes one sprite cell into the command stream, ending with
+                an EndSprite command. The caller makes sure there is room
+                for the worst case, see SpriteDataBound(). Cells of a width
+                in CELL_KERNELS go through the kernel built for that width,
+                which gives the same output as the generic encoder.
+    @param      cell - Pixels of the sprite
+    @param      pOut - Where to write the commands
+    @param      opCounts - Command counts, indexed by MetricCounter
+    @param      bSpecialised - False always uses the generic encoder
+    @return     uint8_t* - Byte after the last command written
+  --------------------------------------------------------------------------*/
+uint8_t* Tools::EncodeSpriteCell( ImageView<const uint8_t> cell, uint8_t* pOut, uint64_t* opCounts, bool bSpecialised ) const
+{
+    if ( bSpecialised )
+    {
+        for ( const CellKernel& kernel : CELL_KERNELS )
+        {
+            if ( kernel.width == cell.getWidth() )
+            {
+                return ( this->*kernel.encoder )( cell, pOut, opCounts );
+            }
+        }
+    }
+
+    return EncodeSpriteCellGeneric( cell, pOut, opCounts );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Encodes one sprite cell of any width, scanning each line for
+                the runs
+    @param      cell - Pixels of the sprite
+    @param      pOut - Where to write the commands
+    @param      opCounts - Command counts, indexed by MetricCounter
+    @return     uint8_t* - Byte after the last command written
+  --------------------------------------------------------------------------*/
+uint8_t* Tools::EncodeSpriteCellGeneric( ImageView<const uint8_t> cell, uint8_t* pOut, uint64_t* opCounts ) const
+{
+    uint32_t sprW = cell.getWidth();
+
+    for ( uint32_t y = 0; y < cell.getHeight(); y++ )
+    {
+        const uint8_t* pLine = cell.getRow( y );
+        bool           bLoop = true;
+        uint32_t       x     = 0;
+
+        while ( bLoop )
+        {
+            // sprCMD is offset to start of drawable data (0-199)
+            // sprCMD 200 = skip 200 pixels, no data
+            // sprCMD 201 = skip line
+            // sprCMD 202 = fill run, length and colour index follow
+            // sprCMD 255 = end of sprite
+            // scan for the first non transparent pixel
+            uint32_t scanBG = ScanRunLength( pLine + x, std::min( sprW - x, (uint32_t)SpriteCmd::Skip ), 0 );
+
+            if ( x + scanBG == sprW )
+            {
+                *pOut++ = (uint8_t)SpriteCmd::EndLine;
+                opCounts[ (size_t)MetricCounter::OpEndLine ]++;
+                bLoop = false;
+                break;
+            }
+
+            x += scanBG;
+            *pOut++ = scanBG;
+            opCounts[ (size_t)MetricCounter::OpSkip ]++;
+
+            if ( scanBG == (uint32_t)SpriteCmd::Skip )
+            {
+                continue;
+            }
+
+            // write the span of pixel data, the first segment is always
+            // a literal run (which can be empty when a fill comes first)
+            uint32_t spanEnd = x + ScanOpaqueLength( pLine + x, sprW - x );
+            bool     bFirst  = true;
+
+            while ( x < spanEnd )
+            {
+                // grow the literal run until a same colour run is found
+                // that is cheaper to store as a fill
+                uint32_t litLen  = 0;
+                uint32_t fillLen = 0;
+                while ( x + litLen < spanEnd && litLen < SPR_MAX_RUN )
+                {
+                    uint32_t runLen = ScanRunLength( pLine + x + litLen, spanEnd - x - litLen, pLine[ x + litLen ] );
+                    uint32_t cost   = SPR_FILL_COST + ( x + litLen + runLen < spanEnd ? SPR_LIT_COST : 0 );
+                    if ( runLen > cost )
+                    {
+                        fillLen = std::min( runLen, SPR_MAX_RUN );
+                        break;
+                    }
+                    litLen = std::min( litLen + runLen, SPR_MAX_RUN );
+                }
+
+                if ( bFirst || litLen )
+                {
+                    if ( bFirst == false )
+                    {
+                        *pOut++ = 0;
+                        opCounts[ (size_t)MetricCounter::OpSkip ]++;
+                    }
+                    opCounts[ (size_t)MetricCounter::OpLiteral ]++;
+                    *pOut++ = litLen;
+                    memcpy( pOut, pLine + x, litLen );
+                    pOut += litLen;
+                    x += litLen;
+                    bFirst = false;
+                }
+
+                if ( fillLen )
+                {
+                    *pOut++ = (uint8_t)SpriteCmd::Fill;
+                    opCounts[ (size_t)MetricCounter::OpFill ]++;
+                    *pOut++ = fillLen;
+                    *pOut++ = pLine[ x ];
+                    x += fillLen;
+                }
+            }
+        }
+    }
+
+    // stored the compressed sprite data
+    *pOut++ = (uint8_t)SpriteCmd::EndSprite;
+    opCounts[ (size_t)MetricCounter::OpEndSprite ]++;
+
+    return pOut;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Encodes one sprite cell exactly W pixels wide. Each line is
+                turned into two bit masks up front, opaque pixels and pixels
+                equal to their right hand neighbour, so skips, spans and
+                runs are found with bit counts rather than byte scans. Gives
+                the same commands as EncodeSpriteCellGeneric().
+    @param      cell - Pixels of the sprite, W wide
+    @param      pOut - Where to write the commands
+    @param      opCounts - Command counts, indexed by MetricCounter
+    @return     uint8_t* - Byte after the last command written
+  --------------------------------------------------------------------------*/
+template <uint32_t W>
+uint8_t* Tools::EncodeSpriteCellFixed( ImageView<const uint8_t> cell, uint8_t* pOut, uint64_t* opCounts ) const
+{
+    // a line fits one mask, so no skip reaches 200 and no run reaches 255
+    static_assert( W > 0 && W <= 64, "line masks hold at most 64 pixels" );
+
+    constexpr uint32_t LINE_BYTES = ( W + 15 ) / 16 * 16;
+    constexpr uint64_t LINE_MASK  = W == 64 ? ~0ull : ( 1ull << W ) - 1;
+
+    // the line is copied into a padded buffer so the vector loads, and the
+    // neighbour compare one byte on, never read past the cell
+    alignas( 16 ) uint8_t line[ LINE_BYTES + 16 ] = { 0 };
+
+    for ( uint32_t y = 0; y < cell.getHeight(); y++ )
+    {
+        uint64_t opaque = 0;
+        uint64_t same   = 0;
+
+        memcpy( line, cell.getRow( y ), W );
+
+#ifdef TOOLS_USE_SSE2
+        const __m128i vZero = _mm_setzero_si128();
+        for ( uint32_t x = 0; x < LINE_BYTES; x += 16 )
+        {
+            __m128i vData = _mm_load_si128( (const __m128i*)( line + x ) );
+            __m128i vNext = _mm_loadu_si128( (const __m128i*)( line + x + 1 ) );
+            opaque |= (uint64_t)( ~_mm_movemask_epi8( _mm_cmpeq_epi8( vData, vZero ) ) & 0xFFFF ) << x;
+            same |= (uint64_t)_mm_movemask_epi8( _mm_cmpeq_epi8( vData, vNext ) ) << x;
+        }
+#else
+        for ( uint32_t x = 0; x < W; x++ )
+        {
+            opaque |= (uint64_t)( line[ x ] != 0 ) << x;
+            same |= (uint64_t)( line[ x ] == line[ x + 1 ] ) << x;
+        }
+#endif
+        opaque &= LINE_MASK;
+        same &= LINE_MASK >> 1;
+
+        uint32_t x = 0;
+
+        while ( x < W && ( opaque >> x ) != 0 )
+        {
+            uint32_t scanBG = std::countr_zero( opaque >> x );
+
+            x += scanBG;
+            *pOut++ = scanBG;
+            opCounts[ (size_t)MetricCounter::OpSkip ]++;
+
+            uint32_t spanEnd = x + std::countr_one( opaque >> x );
+            bool     bFirst  = true;
+
+            while ( x < spanEnd )
+            {
+                uint32_t litLen  = 0;
+                uint32_t fillLen = 0;
+                while ( x + litLen < spanEnd )
+                {
+                    uint32_t pixel  = x + litLen;
+                    uint32_t runLen = std::min<uint32_t>( 1 + std::countr_one( same >> pixel ), spanEnd - pixel );
+                    uint32_t cost   = SPR_FILL_COST + ( pixel + runLen < spanEnd ? SPR_LIT_COST : 0 );
+                    if ( runLen > cost )
+                    {
+                        fillLen = runLen;
+                        break;
+                    }
+                    litLen += runLen;
+                }
+
+                if ( bFirst || litLen )
+                {
+                    if ( bFirst == false )
+                    {
+                        *pOut++ = 0;
+                        opCounts[ (size_t)MetricCounter::OpSkip ]++;
+                    }
+                    opCounts[ (size_t)MetricCounter::OpLiteral ]++;
+                    *pOut++ = litLen;
+                    memcpy( pOut, line + x, litLen );
+                    pOut += litLen;
+                    x += litLen;
+                    bFirst = false;
+                }
+
+                if ( fillLen )
+                {
+                    *pOut++ = (uint8_t)SpriteCmd::Fill;
+                    opCounts[ (size_t)MetricCounter::OpFill ]++;
+                    *pOut++ = fillLen;
+                    *pOut++ = line[ x ];
+                    x += fillLen;
+                }
+            }
+        }
+
+        *pOut++ = (uint8_t)SpriteCmd::EndLine;
+        opCounts[ (size_t)MetricCounter::OpEndLine ]++;
+    }
+
+    *pOut++ = (uint8_t)SpriteCmd::EndSprite;
+    opCounts[ (size_t)MetricCounter::OpEndSprite ]++;
+
+    return pOut;
+}
+
+//-----------------------------------------------------------------------------
+// Cell kernels, EncodeSpriteCell() picks one by the width of the cell
+//-----------------------------------------------------------------------------
+const Tools::CellKernel Tools::CELL_KERNELS[ 4 ] = {
+    { 16, &Tools::EncodeSpriteCellFixed<16> },
+    { 32, &Tools::EncodeSpriteCellFixed<32> },
+    { 60, &Tools::EncodeSpriteCellFixed<60> },
+    { 64, &Tools::EncodeSpriteCellFixed<64> },
+};
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Worst case size of the sprite command stream for an image.
+                Each opaque pixel costs at most 3 bytes (a lone pixel needs
+                a skip, a count and the pixel, restarted literals and fills
+                cost less per pixel), each transparent pixel at most 1, and
+                each line and sprite one end command. Cells bigger than the
+                image are clipped to it, as the encoder does.
+    @param      w - Width of the image
+    @param      h - Height of the image
+    @param      sprW - Width of the sprite
+    @param      sprH - Height of the sprite
+    @return     size_t - Most bytes EncodeSpriteData() can emit after the
+                header and offsets table
+  --------------------------------------------------------------------------*/
+size_t Tools::SpriteDataBound( uint32_t w, uint32_t h, uint32_t sprW, uint32_t sprH )
+{
+    uint64_t cellW    = std::min( sprW, w );
+    uint64_t cellH    = std::min( sprH, h );
+    uint64_t sprTotal = cellW && cellH ? ( ( w + cellW - 1 ) / cellW ) * ( ( h + cellH - 1 ) / cellH ) : 0;
+
+    return sprTotal * ( cellH * ( 3 * cellW + 1 ) + 1 );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Counts the bytes matching value from the start of the data
+    @param      pData - Pointer to the data
+    @param      len - Maximum number of bytes to scan
+    @param      value - Byte value to match
+    @return     uint32_t - Length of the run of matching bytes
+  --------------------------------------------------------------------------*/
+uint32_t Tools::ScanRunLength( const uint8_t* pData, uint32_t len, uint8_t value ) const
+{
+    uint32_t count = 0;
+
+#ifdef TOOLS_USE_SSE2
+    const __m128i vValue = _mm_set1_epi8( (char)value );
+    while ( count + 16 <= len )
+    {
+        __m128i  vData = _mm_loadu_si128( (const __m128i*)( pData + count ) );
+        uint32_t mask  = ~_mm_movemask_epi8( _mm_cmpeq_epi8( vData, vValue ) ) & 0xFFFF;
+        if ( mask )
+        {
+            return count + std::countr_zero( mask );
+        }
+        count += 16;
+    }
+#endif
+
+    while ( count < len && pData[ count ] == value )
+    {
+        count++;
+    }
+    return count;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Counts the non transparent (non zero) bytes from the start
+                of the data
+    @param      pData - Pointer to the data
+    @param      len - Maximum number of bytes to scan
+    @return     uint32_t - Length of the opaque span
+  --------------------------------------------------------------------------*/
+uint32_t Tools::ScanOpaqueLength( const uint8_t* pData, uint32_t len ) const
+{
+    uint32_t count = 0;
+
+#ifdef TOOLS_USE_SSE2
+    const __m128i vZero = _mm_setzero_si128();
+    while ( count + 16 <= len )
+    {
+        __m128i  vData = _mm_loadu_si128( (const __m128i*)( pData + count ) );
+        uint32_t mask  = _mm_movemask_epi8( _mm_cmpeq_epi8( vData, vZero ) );
+        if ( mask )
+        {
+            return count + std::countr_zero( mask );
+        }
+        count += 16;
+    }
+#endif
+
+    while ( count < len && pData[ count ] != 0 )
+    {
+        count++;
+    }
+    return count;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      libpng read callback, reads from a PngMemoryReader
+    @param      png_ptr - libpng read structure
+    @param      outBytes - Buffer to fill
+    @param      byteCount - Bytes wanted
+  --------------------------------------------------------------------------*/
+void Tools::PngReadFromMemory( png_structp png_ptr, png_bytep outBytes, png_size_t byteCount )
+{
+    PngMemoryReader* reader = (PngMemoryReader*)png_get_io_ptr( png_ptr );
+
+    if ( reader->offset + byteCount > reader->size )
+    {
+        png_error( png_ptr, "Read past the end of the PNG data" );
+    }
+
+    memcpy( outBytes, reader->pData + reader->offset, byteCount );
+    reader->offset += byteCount;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Filters one row for the PNG encoder, one byte per pixel. The
+                adaptive choices filter the row each way and keep the one
+                with the smallest sum of the bytes taken as signed values.
+    @param      pRow - Pixels of the row
+    @param      pPrior - Pixels of the row above, nullptr for the first row
+    @param      width - Pixels in the row
+    @param      filter - Filter, or adaptive choice of filter
+    @param      pOut - Receives the filter type byte then the filtered row
+  --------------------------------------------------------------------------*/
+void Tools::FilterPngRow( const uint8_t* pRow, const uint8_t* pPrior, uint32_t width, PngFilter filter, uint8_t* pOut )
+{
+    thread_local std::vector<uint8_t> zeros;
+    thread_local std::vector<uint8_t> trial;
+
+    if ( pPrior == nullptr )
+    {
+        zeros.assign( width, 0 );
+        pPrior = zeros.data();
+    }
+
+    if ( filter == PngFilter::MinSum || filter == PngFilter::Fast )
+    {
+        uint32_t  lastFilter = filter == PngFilter::Fast ? (uint32_t)PngFilter::Up : (uint32_t)PngFilter::Paeth;
+        uint64_t  bestSum    = UINT64_MAX;
+        PngFilter best       = PngFilter::None;
+
+        trial.resize( (size_t)width + 1 );
+        for ( uint32_t nFilter = 0; nFilter <= lastFilter; nFilter++ )
+        {
+            uint64_t sum = 0;
+
+            FilterPngRow( pRow, pPrior, width, (PngFilter)nFilter, trial.data() );
+            for ( uint32_t x = 1; x <= width; x++ )
+            {
+                sum += std::abs( (int8_t)trial[ x ] );
+            }
+            if ( sum < bestSum )
+            {
+                bestSum = sum;
+                best    = (PngFilter)nFilter;
+            }
+        }
+        filter = best;
+    }
+
+    pOut[ 0 ] = (uint8_t)filter;
+    pOut++;
+
+    switch ( filter )
+    {
+        case PngFilter::Sub:
+            pOut[ 0 ] = pRow[ 0 ];
+            for ( uint32_t x = 1; x < width; x++ )
+            {
+                pOut[ x ] = pRow[ x ] - pRow[ x - 1 ];
+            }
+            break;
+        case PngFilter::Up:
+            for ( uint32_t x = 0; x < width; x++ )
+            {
+                pOut[ x ] = pRow[ x ] - pPrior[ x ];
+            }
+            break;
+        case PngFilter::Average:
+            pOut[ 0 ] = pRow[ 0 ] - ( pPrior[ 0 ] >> 1 );
+            for ( uint32_t x = 1; x < width; x++ )
+            {
+                pOut[ x ] = pRow[ x ] - ( ( pRow[ x - 1 ] + pPrior[ x ] ) >> 1 );
+            }
+            break;
+        case PngFilter::Paeth:
+            pOut[ 0 ] = pRow[ 0 ] - pPrior[ 0 ];
+            for ( uint32_t x = 1; x < width; x++ )
+            {
+                int left = pRow[ x - 1 ], up = pPrior[ x ], upLeft = pPrior[ x - 1 ];
+                int guess = left + up - upLeft;
+                int dLeft = std::abs( guess - left ), dUp = std::abs( guess - up ), dUpLeft = std::abs( guess - upLeft );
+
+                pOut[ x ] = pRow[ x ] - ( dLeft <= dUp && dLeft <= dUpLeft ? left : dUp <= dUpLeft ? up : upLeft );
+            }
+            break;
+        default:
+            memcpy( pOut, pRow, width );
+            break;
+    }
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Starts a PNG chunk, the length is filled in by EndPngChunk()
+    @param      pngData - PNG data to add the chunk to
+    @param      type - Four character chunk type
+    @return     size_t - Offset of the chunk, for EndPngChunk()
+  --------------------------------------------------------------------------*/
+size_t Tools::BeginPngChunk( std::vector<uint8_t>& pngData, const char* type )
+{
+    size_t chunkStart = pngData.size();
+
+    pngData.insert( pngData.end(), 4, 0 );
+    pngData.insert( pngData.end(), type, type + 4 );
+    return chunkStart;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Finishes a PNG chunk, filling in its length and adding the
+                CRC-32 of its type and data
+    @param      pngData - PNG data holding the chunk
+    @param      chunkStart - Offset from BeginPngChunk()
+  --------------------------------------------------------------------------*/
+void Tools::EndPngChunk( std::vector<uint8_t>& pngData, size_t chunkStart )
+{
+    uint32_t length = (uint32_t)( pngData.size() - chunkStart - 8 );
+    uLong    crc    = crc32( crc32( 0L, Z_NULL, 0 ), pngData.data() + chunkStart + 4, length + 4 );
+
+    pngData[ chunkStart ]     = (uint8_t)( length >> 24 );
+    pngData[ chunkStart + 1 ] = (uint8_t)( length >> 16 );
+    pngData[ chunkStart + 2 ] = (uint8_t)( length >> 8 );
+    pngData[ chunkStart + 3 ] = (uint8_t)length;
+    pngData.insert( pngData.end(), { (uint8_t)( crc >> 24 ), (uint8_t)( crc >> 16 ), (uint8_t)( crc >> 8 ), (uint8_t)crc } );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Runs the work for each band of a PNG, on the pool when there
+                is one and more than one band, returning once all are done
+    @param      bandCount - Number of bands
+    @param      pool - Pool to run the bands on, nullptr runs them in turn
+    @param      work - Work for one band, given the band number
+  --------------------------------------------------------------------------*/
+void Tools::RunPngBands( uint32_t bandCount, ThreadPool* pool, const std::function<void( uint32_t )>& work )
+{
+    if ( pool == nullptr || bandCount < 2 )
+    {
+        for ( uint32_t nBand = 0; nBand < bandCount; nBand++ )
+        {
+            work( nBand );
+        }
+        return;
+    }
+
+    // wait on the bands alone, the pool may be running other work too
+    std::latch bandsDone( bandCount );
+
+    for ( uint32_t nBand = 0; nBand < bandCount; nBand++ )
+    {
+        pool->submit( [ &work, &bandsDone, nBand ]() {
+            work( nBand );
+            bandsDone.count_down();
+        } );
+    }
+    bandsDone.wait();
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Checks whether a PNG file already holds an image, the same
+                size, palette, transparency and pixels
+    @param      fileName - PNG file
+    @param      image - Image to compare with
+    @return     bool - True if the file decodes to the same image
+  --------------------------------------------------------------------------*/
+bool Tools::PngHoldsImage( const std::string& fileName, const DecodedImage& image ) const
+{
+    thread_local DecodedImage onDisk;
+    std::ifstream             file( fileName, std::ios::binary );
+    std::vector<uint8_t>      pngData( ( std::istreambuf_iterator<char>( file ) ), std::istreambuf_iterator<char>() );
+
+    if ( pngData.empty() || Decode_PNG( pngData, onDisk ) == false )
+    {
+        return false;
+    }
+
+    return onDisk.width == image.width && onDisk.height == image.height && onDisk.palette.size() == image.palette.size() &&
+           memcmp( onDisk.palette.data(), image.palette.data(), image.palette.size() * sizeof( png_color ) ) == 0 && onDisk.transparency == image.transparency &&
+           onDisk.pixels == image.pixels;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      libpng allocation callback, allocates from the arena
+    @param      png_ptr - libpng structure
+    @param      size - Bytes wanted
+    @return     png_voidp - Allocated memory
+  --------------------------------------------------------------------------*/
+png_voidp Tools::PngArenaMalloc( png_structp png_ptr, png_alloc_size_t size )
+{
+    return ( (Arena*)png_get_mem_ptr( png_ptr ) )->allocate( size );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      libpng free callback, nothing to do, the arena is reset
+                once the image has been decoded
+    @param      png_ptr - libpng structure
+    @param      pMemory - Memory being freed
+  --------------------------------------------------------------------------*/
+void Tools::PngArenaFree( [[maybe_unused]] png_structp png_ptr, [[maybe_unused]] png_voidp pMemory )
+{
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Saves the vector to disk
+    @param      file_name - Pointer to the file name
+  --------------------------------------------------------------------------*/
+void Tools::Save_Vector_To_File( const std::vector<uint8_t>& vData, const std::string& filename )
+{
+    ScopedTimer   timer( MetricStage::FileWrite );
+    std::ofstream file( filename, std::ios::binary );
+    if ( !file.is_open() )
+    {
+        throw std::runtime_error( "Failed to open file for writing" );
+    }
+
+    file.write( (char*)vData.data(), vData.size() );
+    if ( !file )
+    {
+        throw std::runtime_error( "Failed to write data to file" );
+    }
+
+    file.close();
+    Metrics::getInstance().addCount( MetricCounter::BytesOut, vData.size() );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Saves the buffers of a converted image to disk, under the
+                names Encode_Image() gives them. Empty buffers are skipped.
+    @param      converted - Image converted by Convert_PNG()
+    @param      fileName - Name the output files are built from
+  --------------------------------------------------------------------------*/
+void Tools::Save_Converted( const ConvertedImage& converted, const std::string& fileName )
+{
+    if ( converted.paletteData.empty() == false )
+    {
+        Save_Vector_To_File( converted.paletteData, fileName + ".PAL" );
+    }
+    if ( converted.raw.empty() == false )
+    {
+        Save_Vector_To_File( converted.raw, fileName + std::format( "-{0}-{1}.RAW", converted.width, converted.height ) );
+    }
+    if ( converted.sprites.empty() == false )
+    {
+        Save_Vector_To_File( converted.sprites, fileName + ".SPR" );
+    }
+    if ( converted.rgb565.empty() == false )
+    {
+        Save_Vector_To_File( converted.rgb565, fileName + std::format( "-{0}-{1}.565", converted.width, converted.height ) );
+    }
+    if ( converted.argb32.empty() == false )
+    {
+        Save_Vector_To_File( converted.argb32, fileName + std::format( "-{0}-{1}.ARGB", converted.width, converted.height ) );
+    }
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Writes PNG file, please note at present the image needs to be
+                opened via Read_PNG first. A file already holding the same
+                image, such as the file it was read from, is left alone.
+    @param      file_name - Pointer to the file name
+    @param      options - Encoder settings, see Encode_PNG()
+  --------------------------------------------------------------------------*/
+void Tools::Write_PNG( const char* file_name, const PngEncodeOptions& options )
+{
+    std::vector<uint8_t> pngData;
+
+    if ( readImage.pixels.empty() )
+    {
+        throw std::runtime_error( "No image read to write" );
+    }
+
+    if ( options.bSkipUnchanged && PngHoldsImage( file_name, readImage ) )
+    {
+        AGL_LOG_DEBUG( ErrorHandler::getInstance(), "{} already holds the image, not rewritten", file_name );
+        return;
+    }
+
+    if ( Encode_PNG( readImage, pngData, options ) == false )
+    {
+        throw std::runtime_error( "Failed to encode PNG" );
+    }
+    Save_Vector_To_File( pngData, file_name );
 }
 
 /**---------------------------------------------------------------------------
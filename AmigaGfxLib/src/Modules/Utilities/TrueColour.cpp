@@ -0,0 +1,465 @@
+/**----------------------------------------------------------------------------
+
+    @file       TrueColour.cpp
+    @defgroup   AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Expands indexed images into Apollo V4 truecolour pixels
+
+    @copyright  Neil Bereford 2024
+
+Notes:
+
+    setPalette() turns every index into its finished pixel, packed, keyed
+    and in output byte order, so converting is only ever a lookup and a
+    store. Each table entry holds the pixel's bytes as they are written,
+    copied out with memcpy, so the output is big endian on any host.
+
+    Three kernels do the lookups, each falling through to the next for
+    what it leaves:
+      - Byte shuffles (SSSE3), palettes of up to 16 colours. The table is
+        split into one 16 byte vector per output byte, pshufb looks up 16
+        pixels in each and the results are interleaved into pixels. A
+        block holding an index past 15 stops the kernel.
+      - Gathers (AVX2), 8 table entries a gather, RGB565 packed down to
+        words afterwards.
+      - Table lookups a pixel at a time, for the ends of rows and when the
+        CPU has neither.
+    With GCC and Clang on x86 both vector kernels are always compiled,
+    each for its own instruction set with a target attribute, and the CPU
+    running the library is checked once for them, so a build for plain
+    x86-64 still uses them. Other compilers use the kernels the target
+    they build for has.
+
+    Every kernel reads a byte and writes 2 or 4 a pixel with no other
+    memory touched, so a large background is converted at the speed of
+    memory. convert() splits the image into bands of rows that are
+    converted by a ThreadPool when more than one thread is asked for, to
+    keep enough stores in flight to fill the bus.
+
+    RGB565 rounds each channel to its nearest 5 or 6 bit value. The key
+    colour is kept unique by flipping the lowest blue bit of any other
+    colour that packs to it, in the packed value for RGB565 and in the
+    blue byte for ARGB32, where the key also has an alpha of 0.
+
+-----------------------------------------------------------------------------*/
+
+//-----------------------------------------------------------------------------
+// Include files
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cstring>
+
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#include <immintrin.h>
+#define TRUECOLOUR_USE_SSSE3
+#define TRUECOLOUR_USE_AVX2
+#define TRUECOLOUR_DISPATCH
+#define TRUECOLOUR_TARGET( isa ) __attribute__( ( target( isa ) ) )
+#else
+#if defined( __SSSE3__ ) || defined( __AVX__ )
+#include <tmmintrin.h>
+#define TRUECOLOUR_USE_SSSE3
+#endif
+#if defined( __AVX2__ )
+#include <immintrin.h>
+#define TRUECOLOUR_USE_AVX2
+#endif
+#define TRUECOLOUR_TARGET( isa )
+#endif
+
+#include "../../../inc/Modules/Utilities/Metrics.h"
+#include "../../../inc/Modules/Utilities/TrueColour.h"
+
+//-----------------------------------------------------------------------------
+// Namespace
+//-----------------------------------------------------------------------------
+
+namespace AmigaGfx
+{
+
+//-----------------------------------------------------------------------------
+// Local functions
+//-----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Packs a colour into RGB565, rounding each channel
+    @param      red - Red, 0-255
+    @param      green - Green, 0-255
+    @param      blue - Blue, 0-255
+    @return     uint16_t - RGB565 pixel
+  --------------------------------------------------------------------------*/
+static uint16_t PackRgb565( uint32_t red, uint32_t green, uint32_t blue )
+{
+    return (uint16_t)( ( red * 31 + 127 ) / 255 << 11 | ( green * 63 + 127 ) / 255 << 5 | ( blue * 31 + 127 ) / 255 );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Checks once whether the CPU running the library has SSSE3
+    @return     bool - True if ShufflePixels() can be used
+  --------------------------------------------------------------------------*/
+static bool CpuHasSsse3()
+{
+#if defined( TRUECOLOUR_DISPATCH )
+    static const bool bHas = ( __builtin_cpu_init(), __builtin_cpu_supports( "ssse3" ) != 0 );
+    return bHas;
+#elif defined( TRUECOLOUR_USE_SSSE3 )
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Checks once whether the CPU running the library has AVX2
+    @return     bool - True if GatherPixels() can be used
+  --------------------------------------------------------------------------*/
+static bool CpuHasAvx2()
+{
+#if defined( TRUECOLOUR_DISPATCH )
+    static const bool bHas = ( __builtin_cpu_init(), __builtin_cpu_supports( "avx2" ) != 0 );
+    return bHas;
+#elif defined( TRUECOLOUR_USE_AVX2 )
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef TRUECOLOUR_USE_SSSE3
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Converts 16 pixels at a time with byte shuffles, stopping at
+                the first block holding an index past 15
+    @param      planes - Each output byte of the first 16 pixels
+    @param      bytesPerPixel - 2 for RGB565, 4 for ARGB32
+    @param      pIndexes - Colour indexes
+    @param      count - Pixels to convert
+    @param      pOut - Receives the pixels
+    @return     uint32_t - Pixels converted, a multiple of 16
+  --------------------------------------------------------------------------*/
+TRUECOLOUR_TARGET( "ssse3" ) static uint32_t ShufflePixels( const uint8_t ( *planes )[ 16 ], uint32_t bytesPerPixel, const uint8_t* pIndexes, uint32_t count, uint8_t* pOut )
+{
+    const __m128i vLast   = _mm_set1_epi8( 15 );
+    const __m128i vPlane0 = _mm_load_si128( (const __m128i*)planes[ 0 ] );
+    const __m128i vPlane1 = _mm_load_si128( (const __m128i*)planes[ 1 ] );
+    const __m128i vPlane2 = _mm_load_si128( (const __m128i*)planes[ 2 ] );
+    const __m128i vPlane3 = _mm_load_si128( (const __m128i*)planes[ 3 ] );
+    uint32_t      x       = 0;
+
+    for ( ; x + 16 <= count; x += 16 )
+    {
+        __m128i vIndex = _mm_loadu_si128( (const __m128i*)( pIndexes + x ) );
+        if ( _mm_movemask_epi8( _mm_cmpeq_epi8( _mm_min_epu8( vIndex, vLast ), vIndex ) ) != 0xFFFF )
+        {
+            break;
+        }
+
+        __m128i  vByte0 = _mm_shuffle_epi8( vPlane0, vIndex );
+        __m128i  vByte1 = _mm_shuffle_epi8( vPlane1, vIndex );
+        __m128i* pStore = (__m128i*)( pOut + x * bytesPerPixel );
+
+        if ( bytesPerPixel == 2 )
+        {
+            _mm_storeu_si128( pStore, _mm_unpacklo_epi8( vByte0, vByte1 ) );
+            _mm_storeu_si128( pStore + 1, _mm_unpackhi_epi8( vByte0, vByte1 ) );
+        }
+        else
+        {
+            __m128i vByte2 = _mm_shuffle_epi8( vPlane2, vIndex );
+            __m128i vByte3 = _mm_shuffle_epi8( vPlane3, vIndex );
+            __m128i vLow01 = _mm_unpacklo_epi8( vByte0, vByte1 ), vHigh01 = _mm_unpackhi_epi8( vByte0, vByte1 );
+            __m128i vLow23 = _mm_unpacklo_epi8( vByte2, vByte3 ), vHigh23 = _mm_unpackhi_epi8( vByte2, vByte3 );
+
+            _mm_storeu_si128( pStore, _mm_unpacklo_epi16( vLow01, vLow23 ) );
+            _mm_storeu_si128( pStore + 1, _mm_unpackhi_epi16( vLow01, vLow23 ) );
+            _mm_storeu_si128( pStore + 2, _mm_unpacklo_epi16( vHigh01, vHigh23 ) );
+            _mm_storeu_si128( pStore + 3, _mm_unpackhi_epi16( vHigh01, vHigh23 ) );
+        }
+    }
+
+    return x;
+}
+#endif
+
+#ifdef TRUECOLOUR_USE_AVX2
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Converts 16 pixels at a time with gathers from the table
+    @param      pTable - Finished pixel of each index
+    @param      bytesPerPixel - 2 for RGB565, 4 for ARGB32
+    @param      pIndexes - Colour indexes
+    @param      count - Pixels to convert
+    @param      pOut - Receives the pixels
+    @return     uint32_t - Pixels converted, a multiple of 16
+  --------------------------------------------------------------------------*/
+TRUECOLOUR_TARGET( "avx2" ) static uint32_t GatherPixels( const uint32_t* pTable, uint32_t bytesPerPixel, const uint8_t* pIndexes, uint32_t count, uint8_t* pOut )
+{
+    uint32_t x = 0;
+
+    for ( ; x + 16 <= count; x += 16 )
+    {
+        __m256i  vIndex0 = _mm256_cvtepu8_epi32( _mm_loadl_epi64( (const __m128i*)( pIndexes + x ) ) );
+        __m256i  vIndex1 = _mm256_cvtepu8_epi32( _mm_loadl_epi64( (const __m128i*)( pIndexes + x + 8 ) ) );
+        __m256i  vPixel0 = _mm256_i32gather_epi32( (const int*)pTable, vIndex0, 4 );
+        __m256i  vPixel1 = _mm256_i32gather_epi32( (const int*)pTable, vIndex1, 4 );
+        __m256i* pStore  = (__m256i*)( pOut + x * bytesPerPixel );
+
+        if ( bytesPerPixel == 2 )
+        {
+            // the words fit in 16 bits, packing keeps them, then undo the lane interleave
+            _mm256_storeu_si256( pStore, _mm256_permute4x64_epi64( _mm256_packus_epi32( vPixel0, vPixel1 ), _MM_SHUFFLE( 3, 1, 2, 0 ) ) );
+        }
+        else
+        {
+            _mm256_storeu_si256( pStore, vPixel0 );
+            _mm256_storeu_si256( pStore + 1, vPixel1 );
+        }
+    }
+
+    return x;
+}
+#endif
+
+//-----------------------------------------------------------------------------
+// Class support functions
+// ----------------------------------------------------------------------------
+
+// Constructor and destructor  -------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Constructor for the TrueColourConverter class, every index
+                is black until a palette is set
+    @param      config - Format, key and threading settings
+  --------------------------------------------------------------------------*/
+TrueColourConverter::TrueColourConverter( const TrueColourConfig& config ) : colourConfig( config ), bSmallPalette( false )
+{
+    colourConfig.bandHeight = std::max( colourConfig.bandHeight, 1u );
+    setPalette( {} );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Destructor for the TrueColourConverter class
+  --------------------------------------------------------------------------*/
+TrueColourConverter::~TrueColourConverter()
+{
+}
+
+// Public Functions ----------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Builds the pixel of every index from a palette
+    @param      palette - Palette colours, indexes past the end are black
+    @param      transparency - Alpha of the first palette entries (tRNS),
+                used for ARGB32, the rest are opaque
+  --------------------------------------------------------------------------*/
+void TrueColourConverter::setPalette( const std::vector<png_color>& palette, const std::vector<uint8_t>& transparency )
+{
+    const bool     bArgb     = colourConfig.format == TrueColourFormat::Argb32;
+    const int32_t  keyIndex  = colourConfig.keyIndex < 256 ? colourConfig.keyIndex : -1;
+    const uint32_t keyColour = colourConfig.keyColour & 0xFFFFFF;
+    const uint16_t keyRgb565 = PackRgb565( keyColour >> 16, keyColour >> 8 & 0xFF, keyColour & 0xFF );
+
+    for ( int32_t nIndex = 0; nIndex < 256; nIndex++ )
+    {
+        png_color colour = (size_t)nIndex < palette.size() ? palette[ nIndex ] : png_color{ 0, 0, 0 };
+        uint8_t   alpha  = (size_t)nIndex < transparency.size() ? transparency[ nIndex ] : 0xFF;
+        uint8_t   bytes[ 4 ] = { 0 };
+
+        if ( nIndex == keyIndex )
+        {
+            colour = png_color{ (png_byte)( keyColour >> 16 ), (png_byte)( keyColour >> 8 ), (png_byte)keyColour };
+            alpha  = 0;
+        }
+
+        if ( bArgb )
+        {
+            uint32_t rgb = (uint32_t)colour.red << 16 | colour.green << 8 | colour.blue;
+            if ( keyIndex >= 0 && nIndex != keyIndex && rgb == keyColour )
+            {
+                colour.blue ^= 1;
+            }
+            bytes[ 0 ] = alpha;
+            bytes[ 1 ] = colour.red;
+            bytes[ 2 ] = colour.green;
+            bytes[ 3 ] = colour.blue;
+        }
+        else
+        {
+            uint16_t pixel = PackRgb565( colour.red, colour.green, colour.blue );
+            if ( keyIndex >= 0 && nIndex != keyIndex && pixel == keyRgb565 )
+            {
+                pixel ^= 1;
+            }
+            bytes[ 0 ] = (uint8_t)( pixel >> 8 );
+            bytes[ 1 ] = (uint8_t)pixel;
+        }
+
+        memcpy( &pixelTable[ nIndex ], bytes, sizeof( bytes ) );
+        if ( nIndex < 16 )
+        {
+            for ( uint32_t nByte = 0; nByte < 4; nByte++ )
+            {
+                shuffleTable[ nByte ][ nIndex ] = bytes[ nByte ];
+            }
+        }
+    }
+
+    bSmallPalette = palette.size() <= 16;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Converts an image, band by band
+    @param      image - Colour indexes
+    @param      pixels - Receives width * height pixels, getBytesPerPixel()
+                bytes each, rows packed with no padding
+  --------------------------------------------------------------------------*/
+void TrueColourConverter::convert( ImageView<const uint8_t> image, std::vector<uint8_t>& pixels )
+{
+    ScopedTimer    timer( MetricStage::TrueColour );
+    const uint32_t rowBytes   = image.getWidth() * getBytesPerPixel();
+    const uint32_t bandHeight = colourConfig.bandHeight;
+    const uint32_t bandCount  = ( image.getHeight() + bandHeight - 1 ) / bandHeight;
+
+    pixels.resize( (size_t)rowBytes * image.getHeight() );
+
+    auto convertBand = [ this, image, rowBytes, bandHeight, &pixels ]( uint32_t firstRow ) {
+        for ( uint32_t y = firstRow; y < std::min( firstRow + bandHeight, image.getHeight() ); y++ )
+        {
+            convertRow( image.getRow( y ), image.getWidth(), pixels.data() + (size_t)y * rowBytes );
+        }
+    };
+
+    if ( colourConfig.threadCount == 1 || bandCount <= 1 )
+    {
+        for ( uint32_t y = 0; y < image.getHeight(); y += bandHeight )
+        {
+            convertBand( y );
+        }
+    }
+    else
+    {
+        if ( bandPool == nullptr )
+        {
+            bandPool = std::make_unique<ThreadPool>( colourConfig.threadCount );
+        }
+
+        for ( uint32_t y = 0; y < image.getHeight(); y += bandHeight )
+        {
+            bandPool->submit( [ &convertBand, y ]() { convertBand( y ); } );
+        }
+        bandPool->wait();
+    }
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Converts a run of pixels with the fastest kernel the CPU
+                and palette allow
+    @param      pIndexes - Colour indexes
+    @param      count - Pixels to convert
+    @param      pOut - Receives count * getBytesPerPixel() bytes
+  --------------------------------------------------------------------------*/
+void TrueColourConverter::convertRow( const uint8_t* pIndexes, uint32_t count, uint8_t* pOut ) const
+{
+    const uint32_t bytesPerPixel = getBytesPerPixel();
+    uint32_t       done          = 0;
+
+#ifdef TRUECOLOUR_USE_SSSE3
+    if ( bSmallPalette && CpuHasSsse3() )
+    {
+        done = ShufflePixels( shuffleTable, bytesPerPixel, pIndexes, count, pOut );
+    }
+#endif
+
+#ifdef TRUECOLOUR_USE_AVX2
+    if ( CpuHasAvx2() )
+    {
+        done += GatherPixels( pixelTable, bytesPerPixel, pIndexes + done, count - done, pOut + done * bytesPerPixel );
+    }
+#endif
+
+    convertRowScalar( pIndexes + done, count - done, pOut + done * bytesPerPixel );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Converts a run of pixels a table lookup at a time, the
+                reference the vector kernels match
+    @param      pIndexes - Colour indexes
+    @param      count - Pixels to convert
+    @param      pOut - Receives count * getBytesPerPixel() bytes
+  --------------------------------------------------------------------------*/
+void TrueColourConverter::convertRowScalar( const uint8_t* pIndexes, uint32_t count, uint8_t* pOut ) const
+{
+    if ( colourConfig.format == TrueColourFormat::Argb32 )
+    {
+        for ( uint32_t x = 0; x < count; x++ )
+        {
+            memcpy( pOut + x * 4, &pixelTable[ pIndexes[ x ] ], 4 );
+        }
+    }
+    else
+    {
+        for ( uint32_t x = 0; x < count; x++ )
+        {
+            memcpy( pOut + x * 2, &pixelTable[ pIndexes[ x ] ], 2 );
+        }
+    }
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Returns the size of a converted pixel
+    @return     uint32_t - 2 for RGB565, 4 for ARGB32
+  --------------------------------------------------------------------------*/
+uint32_t TrueColourConverter::getBytesPerPixel() const
+{
+    return colourConfig.format == TrueColourFormat::Argb32 ? 4 : 2;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Returns the pixel the key index is written as, for the
+                code that draws the output to test against
+    @return     uint32_t - RGB565 or ARGB32 key pixel, as a big endian read
+                of it gives
+  --------------------------------------------------------------------------*/
+uint32_t TrueColourConverter::getKeyPixel() const
+{
+    const uint32_t keyColour = colourConfig.keyColour & 0xFFFFFF;
+
+    if ( colourConfig.format == TrueColourFormat::Argb32 )
+    {
+        return keyColour;
+    }
+    return PackRgb565( keyColour >> 16, keyColour >> 8 & 0xFF, keyColour & 0xFF );
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaGfxLIBTools AmigaGfx Library Tools Module
+    @brief      Returns the kernel convertRow() uses for the current palette
+    @return     const char* - Name used in the reports
+  --------------------------------------------------------------------------*/
+const char* TrueColourConverter::getKernelName() const
+{
+    if ( bSmallPalette && CpuHasSsse3() )
+    {
+        return "SSSE3 shuffle";
+    }
+    return CpuHasAvx2() ? "AVX2 gather" : "Table lookup";
+}
+
+//-----------------------------------------------------------------------------
+
+} // end namespace AmigaGfx
+
+//-----------------------------------------------------------------------------
+// End of file: TrueColour.cpp
+// ----------------------------------------------------------------------------
@@ -17,14 +17,42 @@ Notes:
 //-----------------------------------------------------------------------------
 
 #include <stdint.h>
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
 #include <iostream>
+#include <random>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <vector>
 #include <png.h>
 
 #include "../../AmigaGfxLib/inc/AmigaGfxLib.h"
 
 void main_ScriptedConvert( void );
+void main_PrintUsage( void );
+int  main_SingleConvert( const std::vector<std::string>& args );
+int  main_WatchConvert( const std::string& watchPath, const std::vector<std::string>& args );
+int  main_BatchConvert( const std::string& batchPath, const std::vector<std::string>& args );
+int  main_AtlasConvert( const std::string& atlasPath, const std::vector<std::string>& args );
+int  main_BenchEncoders( void );
+int  main_DaemonConvert( const std::string& socketPath );
+int  main_ClientConvert( const std::string& socketPath, const std::vector<std::string>& args );
+int  main_ManifestConvert( const std::string& manifestPath, const std::vector<std::string>& args );
+int  main_HardwareConvert( uint32_t fetchWidth, const std::vector<std::string>& args );
+int  main_PlanarConvert( uint32_t shifts, const std::vector<std::string>& args );
+int  main_CompiledConvert( const std::vector<std::string>& args );
+int  main_CostReport( const std::string& cpuName, const std::vector<std::string>& args );
+int  main_TrueColourConvert( const std::string& formatName, const std::vector<std::string>& args );
+void main_ConvertFile( const std::string& fileName, uint32_t sprWidth, uint32_t sprHeight );
+uint32_t main_SpriteSize( const std::string& arg, uint32_t imageSize = UINT32_MAX );
+uint64_t main_Number( const std::string& arg, uint64_t maxValue = UINT32_MAX );
 
 //-----------------------------------------------------------------------------
 // Namespace access
@@ -40,43 +68,158 @@ int main( int argc, char* argv[] )
 {
     // This will parse the command line and then
     // Check the command line arguments
+    std::vector<std::string> args;
+    std::string              metricsFile;
+    std::string              watchPath;
+    std::string              batchPath;
+    std::string              atlasPath;
+    std::string              daemonSocket;
+    std::string              clientSocket;
+    std::string              manifestPath;
+    std::string              costCpu;
+    std::string              trueColour;
+    uint32_t                 hardwareWidth = 0;
+    uint32_t                 planarShifts  = 0;
+    bool                     bCompiled     = false;
+    bool                     bBench        = false;
+    int                      result = EXIT_SUCCESS;
 
-    if ( argc == 1 )
+    // numbers are checked as they are parsed, a bad one stops the run with the usage
+    try
     {
-        main_ScriptedConvert();
-        return EXIT_SUCCESS;
-    }
-
-    if ( argc < 4 )
-    {
-        std::cout << "Usage: AmigaGfxCalc <PNG filename> <sprW> <sprH>" << std::endl;
-        return EXIT_FAILURE;
-    }
+        for ( int nArg = 1; nArg < argc; nArg++ )
+        {
+            std::string arg = argv[ nArg ];
 
-    std::string pngFileName = argv[ 1 ];
-    uint32_t    sprWidth    = std::stoi( argv[ 2 ] );
-    uint32_t    sprHeight   = std::stoi( argv[ 3 ] );
+            if ( arg == "--metrics" && nArg + 1 < argc )
+            {
+                metricsFile = argv[ ++nArg ];
+            }
+            else if ( arg == "--watch" && nArg + 1 < argc )
+            {
+                watchPath = argv[ ++nArg ];
+            }
+            else if ( arg == "--batch" && nArg + 1 < argc )
+            {
+                batchPath = argv[ ++nArg ];
+            }
+            else if ( arg == "--atlas" && nArg + 1 < argc )
+            {
+                atlasPath = argv[ ++nArg ];
+            }
+            else if ( arg == "--daemon" && nArg + 1 < argc )
+            {
+                daemonSocket = argv[ ++nArg ];
+            }
+            else if ( arg == "--client" && nArg + 1 < argc )
+            {
+                clientSocket = argv[ ++nArg ];
+            }
+            else if ( arg == "--manifest" && nArg + 1 < argc )
+            {
+                manifestPath = argv[ ++nArg ];
+            }
+            else if ( arg == "--hardware" && nArg + 1 < argc )
+            {
+                hardwareWidth = (uint32_t)main_Number( argv[ ++nArg ] );
+            }
+            else if ( arg == "--planar" && nArg + 1 < argc )
+            {
+                planarShifts = (uint32_t)main_Number( argv[ ++nArg ] );
+            }
+            else if ( arg == "--cost" && nArg + 1 < argc )
+            {
+                costCpu = argv[ ++nArg ];
+            }
+            else if ( arg == "--truecolour" && nArg + 1 < argc )
+            {
+                trueColour = argv[ ++nArg ];
+            }
+            else if ( arg == "--compiled" )
+            {
+                bCompiled = true;
+            }
+            else if ( arg == "--bench" )
+            {
+                bBench = true;
+            }
+            else
+            {
+                args.push_back( arg );
+            }
+        }
 
-    // Test for correct PNG format ...
-    if ( pngFileName.ends_with( ".png" ) )
-    {
-        std::cout << "Processing: " << pngFileName << std::endl;
-        Tools& tools = Tools::getInstance();
-        if ( tools.Check_8bitIndexed_PNG( pngFileName.c_str() ) == false )
+        if ( bBench )
         {
-            std::cout << "Image " << pngFileName << " is not 8 bit indexed " << std::endl;
-            return EXIT_FAILURE;
+            result = main_BenchEncoders();
+        }
+        else if ( daemonSocket.empty() == false )
+        {
+            result = main_DaemonConvert( daemonSocket );
+        }
+        else if ( clientSocket.empty() == false )
+        {
+            result = main_ClientConvert( clientSocket, args );
+        }
+        else if ( manifestPath.empty() == false )
+        {
+            result = main_ManifestConvert( manifestPath, args );
+        }
+        else if ( hardwareWidth )
+        {
+            result = main_HardwareConvert( hardwareWidth, args );
+        }
+        else if ( planarShifts )
+        {
+            result = main_PlanarConvert( planarShifts, args );
+        }
+        else if ( bCompiled )
+        {
+            result = main_CompiledConvert( args );
+        }
+        else if ( costCpu.empty() == false )
+        {
+            result = main_CostReport( costCpu, args );
+        }
+        else if ( trueColour.empty() == false )
+        {
+            result = main_TrueColourConvert( trueColour, args );
+        }
+        else if ( watchPath.empty() == false )
+        {
+            result = main_WatchConvert( watchPath, args );
+        }
+        else if ( batchPath.empty() == false )
+        {
+            result = main_BatchConvert( batchPath, args );
+        }
+        else if ( atlasPath.empty() == false )
+        {
+            result = main_AtlasConvert( atlasPath, args );
+        }
+        else if ( args.size() == 0 )
+        {
+            main_ScriptedConvert();
+        }
+        else
+        {
+            result = main_SingleConvert( args );
         }
-        tools.Read_PNG( pngFileName.c_str(), sprWidth, sprHeight );
-        std::cout << "Finisshed." << std::endl;
     }
-    else
+    catch ( const std::invalid_argument& error )
     {
-        std::cout << "Usage: AmigaGfxCalc <PNG filename> <sprW> <sprH>" << std::endl;
+        std::cout << error.what() << std::endl;
+        main_PrintUsage();
         return EXIT_FAILURE;
     }
 
-    return EXIT_SUCCESS;
+    // dump the stage timings and counters for this run
+    if ( metricsFile.empty() == false && Metrics::getInstance().saveSummary( metricsFile ) == false )
+    {
+        std::cout << "Failed to save metrics to " << metricsFile << std::endl;
+    }
+
+    return result;
 
 #if 0
 
@@ -166,22 +309,883 @@ void main_ScriptedConvert( void )
     std::cout << "AmigaSpriteCompress" << std::endl;
 
     // get the tools instance
-    Tools&      tools = Tools::getInstance();
-    FileManager fileManager;
+    Tools&               tools = Tools::getInstance();
+    FileManager          fileManager;
+    Channel<std::string> pngFiles( 64 );
 
-    uint32_t    numFiles = fileManager.listAllFiles( "./" );
+    // walk the tree in the background, converting each PNG as it is found
+    std::thread walker( [ &fileManager, &pngFiles ]() { fileManager.walkFiles( "./", { ".png" }, pngFiles ); } );
+    std::string fileName;
 
-    for ( uint32_t nIndex = 0; nIndex < numFiles; nIndex++ )
+    while ( pngFiles.pop( fileName ) )
     {
-        std::string fileName = fileManager.processFileList( nIndex );
+        std::cout << "Processing: " << fileName << std::endl;
+        tools.Read_PNG( fileName.c_str(), 60, 60 );
+        tools.Write_PNG( fileName.c_str() );
+    }
 
-        if ( fileName.ends_with( ".png" ) )
+    walker.join();
+}
+
+void main_PrintUsage( void )
+{
+    std::cout << "Usage: AmigaGfxCalc <PNG filename> <sprW> <sprH> [--metrics <file.json|file.csv>]\n"
+                 "       AmigaGfxCalc --watch <directory> [<sprW> <sprH>] [--metrics <file.json|file.csv>]\n"
+                 "       AmigaGfxCalc --batch <directory> [<sprW> <sprH>] [--metrics <file.json|file.csv>]\n"
+                 "       AmigaGfxCalc --atlas <directory> [<sprW> <sprH>] [--metrics <file.json|file.csv>]\n"
+                 "       AmigaGfxCalc --daemon <socket> [--metrics <file.json|file.csv>]\n"
+                 "       AmigaGfxCalc --client <socket> <PNG filename> [<PNG filename>...] <sprW> <sprH>\n"
+                 "       AmigaGfxCalc --client <socket> stats|shutdown\n"
+                 "       AmigaGfxCalc --manifest <jobs.txt> [<results.json>] [--metrics <file.json|file.csv>]\n"
+                 "       AmigaGfxCalc --hardware <16|32|64> <PNG filename> [<sprW> <sprH>]\n"
+                 "       AmigaGfxCalc --planar <1|2|4|8|16> <PNG filename> [<sprW> <sprH>]\n"
+                 "       AmigaGfxCalc --compiled <PNG filename> [<sprW> <sprH>]\n"
+                 "       AmigaGfxCalc --cost <68000|68020|68080> <PNG filename> [<sprW> <sprH> [<byte budget>]]\n"
+                 "       AmigaGfxCalc --truecolour <565|argb> <PNG filename> [<threads>]\n"
+                 "       AmigaGfxCalc --bench\n"
+                 "       sprW and sprH of auto find the sprites on the sheet, a size must be 1 up to the image size" << std::endl;
+}
+
+int main_SingleConvert( const std::vector<std::string>& args )
+{
+    if ( args.size() < 3 )
+    {
+        main_PrintUsage();
+        return EXIT_FAILURE;
+    }
+
+    std::string pngFileName = args[ 0 ];
+    uint32_t    sprWidth    = main_SpriteSize( args[ 1 ] );
+    uint32_t    sprHeight   = main_SpriteSize( args[ 2 ] );
+
+    // Test for correct PNG format ...
+    if ( pngFileName.ends_with( ".png" ) )
+    {
+        std::cout << "Processing: " << pngFileName << std::endl;
+        Tools& tools = Tools::getInstance();
+        if ( tools.Check_8bitIndexed_PNG( pngFileName.c_str() ) == false )
         {
-            std::cout << "Processing: " << fileName << std::endl;
-            tools.Read_PNG( fileName.c_str(), 60, 60 );
-            tools.Write_PNG( fileName.c_str() );
+            std::cout << "Image " << pngFileName << " is not 8 bit indexed " << std::endl;
+            return EXIT_FAILURE;
+        }
+        try
+        {
+            tools.Read_PNG( pngFileName.c_str(), sprWidth, sprHeight );
+        }
+        catch ( const std::exception& error )
+        {
+            std::cout << "Failed: " << pngFileName << " " << error.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << "Finisshed." << std::endl;
+    }
+    else
+    {
+        main_PrintUsage();
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+// Batch mode
+//-----------------------------------------------------------------------------
+
+int main_BatchConvert( const std::string& batchPath, const std::vector<std::string>& args )
+{
+    PipelineConfig config;
+    PaletteStore   paletteStore( batchPath );
+
+    if ( args.size() >= 2 )
+    {
+        config.spriteWidth  = main_SpriteSize( args[ 0 ] );
+        config.spriteHeight = main_SpriteSize( args[ 1 ] );
+    }
+
+    // each palette is written once to the batch directory, not per image
+    config.paletteStore = &paletteStore;
+
+    FileManager          fileManager;
+    ConvertPipeline      pipeline( config );
+    Channel<std::string> pngFiles( 256 );
+
+    // the walk feeds the pipeline while it runs
+    std::thread walker( [ & ]() { fileManager.walkFiles( batchPath, { ".png" }, pngFiles ); } );
+    uint32_t    converted = pipeline.run( pngFiles );
+    walker.join();
+
+    paletteStore.saveIndex();
+    std::cout << "Converted " << converted << " images, " << pipeline.getFailedCount() << " failed, " << paletteStore.getPaletteCount() << " palettes in "
+              << paletteStore.getIndexName() << std::endl;
+    return pipeline.getFailedCount() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+//-----------------------------------------------------------------------------
+// Atlas mode
+//-----------------------------------------------------------------------------
+
+int main_AtlasConvert( const std::string& atlasPath, const std::vector<std::string>& args )
+{
+    uint32_t sprWidth  = args.size() >= 2 ? main_SpriteSize( args[ 0 ] ) : 0;
+    uint32_t sprHeight = args.size() >= 2 ? main_SpriteSize( args[ 1 ] ) : 0;
+
+    Tools&                                tools = Tools::getInstance();
+    FileManager                           fileManager;
+    Channel<std::string>                  pngFiles( 256 );
+    std::vector<std::string>              fileNames;
+    std::vector<DecodedImage>             images;
+    std::vector<ImageView<const uint8_t>> sprites;
+    SpriteSlicer                          slicer;
+    auto                                  start = std::chrono::steady_clock::now();
+
+    // sorted, so the same directory always gives the same atlas
+    std::thread walker( [ & ]() { fileManager.walkFiles( atlasPath, { ".png" }, pngFiles ); } );
+    for ( std::string fileName; pngFiles.pop( fileName ); )
+    {
+        fileNames.push_back( fileName );
+    }
+    walker.join();
+    std::sort( fileNames.begin(), fileNames.end() );
+
+    // decode every sheet, keeping them, the sprites are views into them
+    images.reserve( fileNames.size() );
+    for ( const std::string& fileName : fileNames )
+    {
+        std::vector<uint8_t> pngData;
+        DecodedImage         image;
+
+        if ( fileManager.OpenFile( fileName, pngData ) == false || tools.Decode_PNG( pngData, image ) == false )
+        {
+            std::cout << "Skipped: " << fileName << std::endl;
+            continue;
+        }
+        image.fileName = fileName;
+        images.push_back( std::move( image ) );
+    }
+
+    // the sheets share one palette file, so every source must use the same
+    // colours, a shorter palette has to start the longer ones
+    const DecodedImage* pPalette = images.empty() ? nullptr : &images[ 0 ];
+    for ( const DecodedImage& image : images )
+    {
+        const DecodedImage* pShorter = image.palette.size() < pPalette->palette.size() ? &image : pPalette;
+        const DecodedImage* pLonger  = pShorter == &image ? pPalette : &image;
+
+        if ( memcmp( pShorter->palette.data(), pLonger->palette.data(), pShorter->palette.size() * sizeof( png_color ) ) != 0 )
+        {
+            std::cout << image.fileName << " does not use the palette of " << pPalette->fileName << ", an atlas has one palette for every sprite" << std::endl;
+            return EXIT_FAILURE;
+        }
+        pPalette = pLonger;
+    }
+
+    for ( const DecodedImage& image : images )
+    {
+        std::vector<SpriteRect> cells;
+
+        if ( sprWidth && sprHeight )
+        {
+            SpriteSlicer::GridCells( image.width, image.height, sprWidth, sprHeight, cells );
+        }
+        else
+        {
+            slicer.slice( image.getView(), cells );
+        }
+
+        for ( const SpriteRect& cell : cells )
+        {
+            sprites.push_back( image.getView().subView( cell.x, cell.y, cell.width, cell.height ) );
+        }
+    }
+
+    if ( images.empty() )
+    {
+        std::cout << "No 8 bit indexed PNG files found in " << atlasPath << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // pack, then write each sheet as RAW and as a sprite list, plus the table
+    AtlasConfig                       config;
+    AtlasPacker                       packer( config );
+    std::vector<std::vector<uint8_t>> sheets;
+    std::vector<AtlasEntry>           entries;
+    std::vector<uint8_t>              fileData;
+    std::string                       baseName = ( std::filesystem::path( atlasPath ) / "atlas" ).string();
+
+    if ( packer.build( sprites, sheets, entries ) == false )
+    {
+        return EXIT_FAILURE;
+    }
+
+    for ( uint32_t nSheet = 0; nSheet < sheets.size(); nSheet++ )
+    {
+        std::vector<SpriteRect>  placed;
+        ImageView<const uint8_t> sheet( sheets[ nSheet ].data(), config.sheetWidth, packer.getSheetHeight( nSheet ) );
+        std::string              sheetName = baseName + "-" + std::to_string( nSheet );
+
+        for ( const AtlasEntry& entry : entries )
+        {
+            if ( entry.sheet == nSheet )
+            {
+                placed.push_back( { entry.x, entry.y, entry.width, entry.height, 0 } );
+            }
+        }
+
+        if ( tools.EncodeSpriteList( sheet, placed, sheetName, fileData ) == false )
+        {
+            return EXIT_FAILURE;
+        }
+        tools.Save_Vector_To_File( sheets[ nSheet ], std::format( "{}-{}-{}.RAW", sheetName, sheet.getWidth(), sheet.getHeight() ) );
+        tools.Save_Vector_To_File( fileData, sheetName + ".SPR" );
+    }
+
+    if ( packer.buildTable( entries, fileData ) == false )
+    {
+        return EXIT_FAILURE;
+    }
+    tools.Save_Vector_To_File( fileData, baseName + ".ATL" );
+    tools.Build_ApolloV4_Palette( pPalette->palette, fileData );
+    tools.Save_Vector_To_File( fileData, baseName + ".PAL" );
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - start );
+    std::cout << "Packed " << sprites.size() << " sprites from " << images.size() << " images onto " << sheets.size() << " sheets, "
+              << (int)( packer.getOccupancy() * 100.0 ) << "% used, in " << elapsed.count() << " ms" << std::endl;
+
+    return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+// Daemon mode
+//-----------------------------------------------------------------------------
+
+static volatile std::sig_atomic_t daemonStop = 0; //!< Set by Ctrl+C to stop the daemon
+
+int main_DaemonConvert( const std::string& socketPath )
+{
+    ServerConfig config;
+    config.socketPath = socketPath;
+
+    ConvertServer server( config );
+
+    if ( server.start() == false )
+    {
+        std::cout << "Unable to listen on " << socketPath << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::signal( SIGINT, []( int ) { daemonStop = 1; } );
+    std::signal( SIGTERM, []( int ) { daemonStop = 1; } );
+    std::cout << "Listening on " << socketPath << ", Ctrl+C or a shutdown request to stop" << std::endl;
+
+    while ( daemonStop == 0 && server.serve( 100 ) )
+    {
+    }
+    server.stop();
+
+    ServerStats stats = server.getStats();
+    std::cout << "Daemon stopped after " << stats.jobs << " jobs, " << stats.failed << " failed, " << stats.dedupHits << " from the dedup index." << std::endl;
+    return EXIT_SUCCESS;
+}
+
+int main_ClientConvert( const std::string& socketPath, const std::vector<std::string>& args )
+{
+    ConvertClient client;
+    std::string   reply;
+    int           result = EXIT_SUCCESS;
+
+    if ( client.connect( socketPath ) == false )
+    {
+        std::cout << "No daemon listening on " << socketPath << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if ( args.size() == 1 && ( args[ 0 ] == "stats" || args[ 0 ] == "shutdown" ) )
+    {
+        std::string request = args[ 0 ] == "stats" ? "STATS" : "SHUTDOWN";
+        if ( client.request( request, reply ) == false )
+        {
+            std::cout << "Lost the connection to " << socketPath << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << reply << std::endl;
+        return reply.starts_with( "OK" ) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if ( args.size() < 3 )
+    {
+        std::cout << "Usage: AmigaGfxCalc --client <socket> <PNG filename> [<PNG filename>...] <sprW> <sprH>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    uint32_t sprWidth  = main_SpriteSize( args[ args.size() - 2 ] );
+    uint32_t sprHeight = main_SpriteSize( args[ args.size() - 1 ] );
+
+    // the daemon has its own working directory, so send absolute paths
+    for ( size_t nFile = 0; nFile + 2 < args.size(); nFile++ )
+    {
+        std::string fileName = std::filesystem::absolute( args[ nFile ] ).string();
+
+        if ( client.request( std::format( "CONVERT {} {} {}", sprWidth, sprHeight, fileName ), reply ) == false )
+        {
+            std::cout << "Lost the connection to " << socketPath << std::endl;
+            return EXIT_FAILURE;
+        }
+        if ( reply.starts_with( "OK" ) == false )
+        {
+            std::cout << "Failed: " << fileName << std::endl;
+            result = EXIT_FAILURE;
+        }
+    }
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// Manifest mode
+//-----------------------------------------------------------------------------
+
+int main_ManifestConvert( const std::string& manifestPath, const std::vector<std::string>& args )
+{
+    JobManifest manifest;
+    std::string resultsPath = args.empty() ? std::filesystem::path( manifestPath ).replace_extension( ".results.json" ).string() : args[ 0 ];
+
+    // a bad line is reported and skipped, the rest of the jobs still run
+    if ( manifest.load( manifestPath ) == false && manifest.getJobs().empty() )
+    {
+        std::cout << "No jobs in " << manifestPath << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    uint32_t failed = manifest.run();
+
+    if ( manifest.saveResults( resultsPath ) == false )
+    {
+        std::cout << "Unable to write " << resultsPath << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Ran " << manifest.getJobs().size() << " jobs, " << failed << " failed, in " << manifest.getRunMicros() / 1000 << " ms, results in " << resultsPath
+              << std::endl;
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+// Hardware sprite mode
+//-----------------------------------------------------------------------------
+
+int main_HardwareConvert( uint32_t fetchWidth, const std::vector<std::string>& args )
+{
+    if ( args.empty() )
+    {
+        std::cout << "Usage: AmigaGfxCalc --hardware <16|32|64> <PNG filename> [<sprW> <sprH>]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::string fileName  = args[ 0 ];
+    uint32_t    sprWidth  = 0;
+    uint32_t    sprHeight = 0;
+
+    FileManager                     fileManager;
+    std::vector<uint8_t>            pngData;
+    DecodedImage                    image;
+    std::vector<SpriteRect>         cells;
+    std::vector<uint8_t>            hwsFile;
+    std::vector<HardwareSpriteCell> report;
+    HardwareSpriteEncoder           encoder( HardwareSpriteConfig{ .fetchWidth = fetchWidth } );
+
+    if ( fileManager.OpenFile( fileName, pngData ) == false || Tools::getInstance().Decode_PNG( pngData, image ) == false )
+    {
+        std::cout << "Unable to read " << fileName << " as an 8 bit indexed PNG" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // the cell sizes are checked against the image, so read after it
+    if ( args.size() >= 3 )
+    {
+        sprWidth  = main_SpriteSize( args[ 1 ], image.width );
+        sprHeight = main_SpriteSize( args[ 2 ], image.height );
+    }
+
+    if ( sprWidth && sprHeight )
+    {
+        SpriteSlicer::GridCells( image.width, image.height, sprWidth, sprHeight, cells );
+    }
+    else
+    {
+        SpriteSlicer slicer;
+        slicer.slice( image.getView(), cells );
+    }
+
+    if ( encoder.encode( image.getView(), cells, hwsFile, report ) == false )
+    {
+        return EXIT_FAILURE;
+    }
+    Tools::getInstance().Save_Vector_To_File( hwsFile, fileName + ".HWS" );
+
+    // DMA channel use of every cell, the ones the hardware cannot show at once flagged
+    uint32_t misfits = 0;
+    for ( size_t nCell = 0; nCell < report.size(); nCell++ )
+    {
+        const HardwareSpriteCell& cell = report[ nCell ];
+
+        std::cout << "Cell " << nCell << " " << cell.width << "x" << cell.height << " at " << cell.x << "," << cell.y << ": " << cell.colours << " colours, "
+                  << cell.lines << " lines, " << cell.strips << ( cell.bAttached ? " strips of attached pairs, " : " strips, " ) << cell.channels << "/"
+                  << HardwareSpriteEncoder::HWS_CHANNELS << " channels" << ( cell.bFits ? "" : " - does not fit" ) << std::endl;
+        misfits += cell.bFits ? 0 : 1;
+    }
+
+    std::cout << "Wrote " << report.size() << " cells to " << fileName << ".HWS, " << misfits << " do not fit the sprite hardware" << std::endl;
+    return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+// Planar sprite mode
+//-----------------------------------------------------------------------------
+
+int main_PlanarConvert( uint32_t shifts, const std::vector<std::string>& args )
+{
+    if ( args.empty() )
+    {
+        std::cout << "Usage: AmigaGfxCalc --planar <1|2|4|8|16> <PNG filename> [<sprW> <sprH>]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::string fileName  = args[ 0 ];
+    uint32_t    sprWidth  = 0;
+    uint32_t    sprHeight = 0;
+
+    FileManager             fileManager;
+    std::vector<uint8_t>    pngData;
+    DecodedImage            image;
+    std::vector<SpriteRect> sprites;
+    std::vector<uint8_t>    plnFile;
+    std::vector<PlanarCost> costs;
+    PlanarSpriteEncoder     encoder( PlanarConfig{ .shifts = shifts } );
+
+    if ( fileManager.OpenFile( fileName, pngData ) == false || Tools::getInstance().Decode_PNG( pngData, image ) == false )
+    {
+        std::cout << "Unable to read " << fileName << " as an 8 bit indexed PNG" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // the cell sizes are checked against the image, so read after it
+    if ( args.size() >= 3 )
+    {
+        sprWidth  = main_SpriteSize( args[ 1 ], image.width );
+        sprHeight = main_SpriteSize( args[ 2 ], image.height );
+    }
+
+    if ( sprWidth && sprHeight )
+    {
+        SpriteSlicer::GridCells( image.width, image.height, sprWidth, sprHeight, sprites );
+    }
+    else
+    {
+        SpriteSlicer slicer;
+        slicer.slice( image.getView(), sprites );
+    }
+
+    if ( encoder.encode( image.getView(), sprites, plnFile ) == false || encoder.measure( image.getView(), sprites, costs ) == false )
+    {
+        return EXIT_FAILURE;
+    }
+    Tools::getInstance().Save_Vector_To_File( plnFile, fileName + ".PLN" );
+
+    // memory against blitter work for every choice, so the trade can be picked per sheet
+    std::cout << "Shifts      Bytes     Shared  Blit words" << std::endl;
+    for ( const PlanarCost& cost : costs )
+    {
+        std::cout << std::setw( 6 ) << cost.shifts << std::setw( 11 ) << cost.fileBytes << std::setw( 11 ) << cost.sharedBytes << std::setw( 12 ) << cost.blitWords
+                  << ( cost.shifts == shifts ? "  <- written" : "" ) << std::endl;
+    }
+
+    std::cout << "Wrote " << sprites.size() << " sprites in " << encoder.getPlaneCount() << " planes to " << fileName << ".PLN" << std::endl;
+    return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+// Compiled sprite mode
+//-----------------------------------------------------------------------------
+
+int main_CompiledConvert( const std::vector<std::string>& args )
+{
+    if ( args.empty() )
+    {
+        std::cout << "Usage: AmigaGfxCalc --compiled <PNG filename> [<sprW> <sprH>]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::string fileName  = args[ 0 ];
+    uint32_t    sprWidth  = 0;
+    uint32_t    sprHeight = 0;
+
+    FileManager                 fileManager;
+    std::vector<uint8_t>        pngData;
+    DecodedImage                image;
+    std::vector<SpriteRect>     sprites;
+    std::vector<uint8_t>        codeFile;
+    std::vector<CompiledSprite> compiled;
+    SpriteCompiler              compiler;
+
+    if ( fileManager.OpenFile( fileName, pngData ) == false || Tools::getInstance().Decode_PNG( pngData, image ) == false )
+    {
+        std::cout << "Unable to read " << fileName << " as an 8 bit indexed PNG" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // the cell sizes are checked against the image, so read after it
+    if ( args.size() >= 3 )
+    {
+        sprWidth  = main_SpriteSize( args[ 1 ], image.width );
+        sprHeight = main_SpriteSize( args[ 2 ], image.height );
+    }
+
+    if ( sprWidth && sprHeight )
+    {
+        SpriteSlicer::GridCells( image.width, image.height, sprWidth, sprHeight, sprites );
+    }
+    else
+    {
+        SpriteSlicer slicer;
+        slicer.slice( image.getView(), sprites );
+    }
+
+    // the code, and a listing of it to check by eye
+    compiler.build( image.getView(), sprites, codeFile, compiled );
+    Tools::getInstance().Save_Vector_To_File( codeFile, fileName + ".CSP" );
+
+    std::string          listing = SpriteCompiler::Listing( compiled );
+    std::vector<uint8_t> listingData( listing.begin(), listing.end() );
+    Tools::getInstance().Save_Vector_To_File( listingData, fileName + ".LST" );
+
+    std::cout << "Compiled " << sprites.size() << " sprites into " << codeFile.size() << " bytes of 68k code in " << fileName << ".CSP, listing in " << fileName
+              << ".LST" << std::endl;
+    return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+// Draw cost report
+//-----------------------------------------------------------------------------
+
+int main_CostReport( const std::string& cpuName, const std::vector<std::string>& args )
+{
+    CpuModel cpu = CpuModel::TotalModels;
+    for ( uint32_t nCpu = 0; nCpu < (uint32_t)CpuModel::TotalModels; nCpu++ )
+    {
+        cpu = cpuName == DrawCostModel::getCpuName( (CpuModel)nCpu ) ? (CpuModel)nCpu : cpu;
+    }
+
+    if ( args.empty() || cpu == CpuModel::TotalModels )
+    {
+        std::cout << "Usage: AmigaGfxCalc --cost <68000|68020|68080> <PNG filename> [<sprW> <sprH> [<byte budget>]]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::string fileName   = args[ 0 ];
+    uint32_t    sprWidth   = 0;
+    uint32_t    sprHeight  = 0;
+    uint64_t    byteBudget = args.size() >= 4 ? main_Number( args[ 3 ], UINT64_MAX ) : 0;
+
+    FileManager                 fileManager;
+    std::vector<uint8_t>        pngData;
+    DecodedImage                image;
+    std::vector<SpriteRect>     sprites;
+    std::vector<SpriteDrawCost> costs;
+    DrawCostModel               model( cpu );
+
+    if ( fileManager.OpenFile( fileName, pngData ) == false || Tools::getInstance().Decode_PNG( pngData, image ) == false )
+    {
+        std::cout << "Unable to read " << fileName << " as an 8 bit indexed PNG" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // the cell sizes are checked against the image, so read after it
+    if ( args.size() >= 3 )
+    {
+        sprWidth  = main_SpriteSize( args[ 1 ], image.width );
+        sprHeight = main_SpriteSize( args[ 2 ], image.height );
+    }
+
+    if ( sprWidth && sprHeight )
+    {
+        SpriteSlicer::GridCells( image.width, image.height, sprWidth, sprHeight, sprites );
+    }
+    else
+    {
+        SpriteSlicer slicer;
+        slicer.slice( image.getView(), sprites );
+    }
+
+    model.costSprites( image.getView(), sprites, costs );
+    if ( costs.size() != sprites.size() )
+    {
+        return EXIT_FAILURE;
+    }
+    uint64_t chosenCycles = model.chooseFormats( costs, byteBudget );
+
+    // cycles per sprite in each format, the chosen one marked, then the sheet totals
+    const size_t formats = (size_t)DrawFormat::TotalFormats;
+    uint64_t     totals[ formats ] = { 0 };
+    uint64_t     chosenBytes       = 0;
+
+    std::cout << "Draw cycles on the " << cpuName << std::endl << "Sprite      Size";
+    for ( size_t nFormat = 0; nFormat < formats; nFormat++ )
+    {
+        std::cout << std::setw( 12 ) << DrawCostModel::getFormatName( (DrawFormat)nFormat );
+    }
+    std::cout << std::endl;
+
+    for ( size_t nSprite = 0; nSprite < costs.size(); nSprite++ )
+    {
+        std::cout << std::setw( 6 ) << nSprite << std::setw( 10 ) << std::to_string( sprites[ nSprite ].width ) + "x" + std::to_string( sprites[ nSprite ].height );
+        for ( size_t nFormat = 0; nFormat < formats; nFormat++ )
+        {
+            uint64_t cycles = costs[ nSprite ].cycles[ nFormat ];
+            bool     bAvailable = cycles != DrawCostModel::DRAW_UNAVAILABLE;
+
+            totals[ nFormat ] = bAvailable && totals[ nFormat ] != DrawCostModel::DRAW_UNAVAILABLE ? totals[ nFormat ] + cycles : DrawCostModel::DRAW_UNAVAILABLE;
+            std::cout << std::setw( 11 ) << ( bAvailable ? std::to_string( cycles ) : "-" ) << ( (size_t)costs[ nSprite ].chosen == nFormat ? "*" : " " );
+        }
+        std::cout << std::endl;
+        chosenBytes += costs[ nSprite ].bytes[ (size_t)costs[ nSprite ].chosen ];
+    }
+
+    std::cout << " Sheet          ";
+    for ( size_t nFormat = 0; nFormat < formats; nFormat++ )
+    {
+        std::cout << std::setw( 11 ) << ( totals[ nFormat ] != DrawCostModel::DRAW_UNAVAILABLE ? std::to_string( totals[ nFormat ] ) : "-" ) << " ";
+    }
+    std::cout << std::endl << "Chosen formats (*) draw the sheet in " << chosenCycles << " cycles from " << chosenBytes << " bytes" << std::endl;
+
+    return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+// Apollo V4 truecolour mode
+//-----------------------------------------------------------------------------
+
+int main_TrueColourConvert( const std::string& formatName, const std::vector<std::string>& args )
+{
+    if ( args.empty() || ( formatName != "565" && formatName != "argb" ) )
+    {
+        std::cout << "Usage: AmigaGfxCalc --truecolour <565|argb> <PNG filename> [<threads>]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::string      fileName = args[ 0 ];
+    TrueColourConfig config   = { .format = formatName == "565" ? TrueColourFormat::Rgb565 : TrueColourFormat::Argb32 };
+    config.threadCount        = args.size() >= 2 ? (uint32_t)main_Number( args[ 1 ] ) : 0;
+
+    FileManager          fileManager;
+    std::vector<uint8_t> pngData;
+    std::vector<uint8_t> pixels;
+    DecodedImage         image;
+    TrueColourConverter  converter( config );
+
+    if ( fileManager.OpenFile( fileName, pngData ) == false || Tools::getInstance().Decode_PNG( pngData, image ) == false )
+    {
+        std::cout << "Unable to read " << fileName << " as an 8 bit indexed PNG" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    converter.setPalette( image.palette, image.transparency );
+
+    // time a second pass into the same buffer, the first pays for faulting its pages in
+    converter.convert( image.getView(), pixels );
+    auto start = std::chrono::steady_clock::now();
+    converter.convert( image.getView(), pixels );
+    auto elapsed = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+    std::string outName = fileName + "-" + std::to_string( image.width ) + "-" + std::to_string( image.height ) + ( formatName == "565" ? ".565" : ".ARGB" );
+    Tools::getInstance().Save_Vector_To_File( pixels, outName );
+
+    std::cout << "Converted " << image.width << "x" << image.height << " to " << outName << " with the " << converter.getKernelName() << " kernel, key pixel 0x"
+              << std::hex << converter.getKeyPixel() << std::dec << ", " << std::fixed << std::setprecision( 1 )
+              << ( image.pixels.size() + pixels.size() ) / std::max( elapsed, 1e-9 ) / ( 1024.0 * 1024.0 ) << " MB/s read and written" << std::endl;
+
+    return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+// Encoder benchmark
+//-----------------------------------------------------------------------------
+
+int main_BenchEncoders( void )
+{
+    Tools&       tools = Tools::getInstance();
+    std::mt19937 random( 1 );
+
+    std::cout << "Width  Generic MB/s  Specialised MB/s  Gain" << std::endl;
+
+    for ( uint32_t width : { 16u, 32u, 48u, 60u, 64u } )
+    {
+        // a sheet of typical sprite lines, transparent edges around short runs
+        const uint32_t       height = 4096;
+        std::vector<uint8_t> pixels( width * height, 0 );
+        for ( size_t nPixel = 0; nPixel < pixels.size(); )
+        {
+            uint32_t runLen = 1 + random() % 10;
+            uint8_t  colour = random() % 3 ? (uint8_t)( 1 + random() % 15 ) : 0;
+            for ( ; runLen && nPixel < pixels.size(); runLen--, nPixel++ )
+            {
+                pixels[ nPixel ] = colour;
+            }
+        }
+
+        ImageView<const uint8_t> sheet( pixels.data(), width, height );
+        std::vector<uint8_t>     output( Tools::SpriteDataBound( width, height, width, height ) );
+        uint64_t                 opCounts[ (size_t)MetricCounter::TotalCounters ] = { 0 };
+        double                   rate[ 2 ] = { 0.0, 0.0 };
+
+        // best of several alternating passes, so both see a warm cache
+        for ( int nPass = 0; nPass < 10; nPass++ )
+        {
+            auto start = std::chrono::steady_clock::now();
+            for ( int nRepeat = 0; nRepeat < 20; nRepeat++ )
+            {
+                tools.EncodeSpriteCell( sheet, output.data(), opCounts, nPass & 1 );
+            }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            rate[ nPass & 1 ]                     = std::max( rate[ nPass & 1 ], 20.0 * pixels.size() / elapsed.count() / ( 1024.0 * 1024.0 ) );
         }
+
+        std::cout << std::fixed << std::setprecision( 1 ) << std::setw( 5 ) << width << std::setw( 14 ) << rate[ 0 ] << std::setw( 18 ) << rate[ 1 ]
+                  << std::setprecision( 2 ) << std::setw( 6 ) << rate[ 1 ] / rate[ 0 ] << "x" << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+// Watch mode
+//-----------------------------------------------------------------------------
+
+static volatile std::sig_atomic_t watchStop = 0; //!< Set by Ctrl+C to leave watch mode
+
+int main_WatchConvert( const std::string& watchPath, const std::vector<std::string>& args )
+{
+    uint32_t sprWidth  = args.size() >= 2 ? main_SpriteSize( args[ 0 ] ) : 0;
+    uint32_t sprHeight = args.size() >= 2 ? main_SpriteSize( args[ 1 ] ) : 0;
+
+    FileWatcher watcher;
+
+    if ( watcher.addWatch( watchPath ) == false )
+    {
+        std::cout << "Unable to watch " << watchPath << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // one worker, Tools keeps its libpng state in the instance, so images are
+    // converted one at a time, but the worker and Tools stay alive between changes
+    ThreadPool               converter( 1 );
+    PaletteStore             paletteStore( watchPath );
+    std::vector<std::string> changed;
+    std::vector<std::string> filters = { ".png" };
+
+    // the store lives on this stack, so Tools lets go of it on every way out
+    struct PaletteStoreGuard
+    {
+        PaletteStoreGuard( PaletteStore* store ) { Tools::getInstance().Set_PaletteStore( store ); }
+        ~PaletteStoreGuard() { Tools::getInstance().Set_PaletteStore( nullptr ); }
+    } paletteStoreGuard( &paletteStore );
+
+    std::signal( SIGINT, []( int ) { watchStop = 1; } );
+    std::cout << "Watching " << watchPath << " (" << watcher.getWatchCount() << " directories), Ctrl+C to stop" << std::endl;
+
+    while ( watchStop == 0 )
+    {
+        WatchStatus status = watcher.waitForChanges( changed, filters, 50 );
+
+        if ( status == WatchStatus::Overflow )
+        {
+            // events were lost, convert the whole tree again
+            FileManager          fileManager;
+            Channel<std::string> pngFiles( 64 );
+            std::thread          walker( [ & ]() { fileManager.walkFiles( watchPath, filters, pngFiles ); } );
+            std::string          fileName;
+
+            changed.clear();
+            while ( pngFiles.pop( fileName ) )
+            {
+                changed.push_back( fileName );
+            }
+            walker.join();
+        }
+        else if ( status == WatchStatus::Failed )
+        {
+            return EXIT_FAILURE;
+        }
+
+        for ( const std::string& fileName : changed )
+        {
+            converter.submit( [ fileName, sprWidth, sprHeight ]() { main_ConvertFile( fileName, sprWidth, sprHeight ); } );
+        }
+        converter.wait();
+
+        if ( changed.empty() == false )
+        {
+            paletteStore.saveIndex();
+        }
+    }
+
+    std::cout << "Watch stopped." << std::endl;
+    return EXIT_SUCCESS;
+}
+
+void main_ConvertFile( const std::string& fileName, uint32_t sprWidth, uint32_t sprHeight )
+{
+    Tools& tools = Tools::getInstance();
+    auto   start = std::chrono::steady_clock::now();
+
+    if ( tools.Check_8bitIndexed_PNG( fileName.c_str() ) == false )
+    {
+        std::cout << "Skipped: " << fileName << " is not 8 bit indexed" << std::endl;
+        return;
+    }
+
+    try
+    {
+        tools.Read_PNG( fileName.c_str(), sprWidth, sprHeight );
+    }
+    catch ( const std::exception& error )
+    {
+        std::cout << "Failed: " << fileName << " " << error.what() << std::endl;
+        return;
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - start );
+    std::cout << "Converted: " << fileName << " in " << elapsed.count() / 1000.0 << " ms" << std::endl;
+}
+
+uint32_t main_SpriteSize( const std::string& arg, uint32_t imageSize )
+{
+    // auto leaves the sprites to be found on the sheet, a size is a cell of
+    // at least one pixel that fits the image
+    if ( arg == "auto" )
+    {
+        return 0;
+    }
+
+    uint64_t size = main_Number( arg );
+    if ( size == 0 || size > imageSize )
+    {
+        throw std::invalid_argument( "Invalid sprite size: " + arg );
+    }
+    return (uint32_t)size;
+}
+
+uint64_t main_Number( const std::string& arg, uint64_t maxValue )
+{
+    // whole, unsigned and in range, a sign or trailing characters are refused
+    uint64_t value = 0;
+    auto [ pEnd, error ] = std::from_chars( arg.data(), arg.data() + arg.size(), value );
+
+    if ( arg.empty() || error != std::errc() || pEnd != arg.data() + arg.size() || value > maxValue )
+    {
+        throw std::invalid_argument( "Invalid number: " + arg );
     }
+    return value;
 }
 
 //-----------------------------------------------------------------------------
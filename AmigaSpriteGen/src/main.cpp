@@ -0,0 +1,481 @@
+/**----------------------------------------------------------------------------
+
+    @file       main.cpp
+    @defgroup   AmigaSpriteGen AmigaSpriteGen
+    @brief      Main entry and control point for the AmigaSpriteGen
+
+    @copyright  Neil Beresford 2024
+
+Notes:
+
+    Writes a corpus of synthetic 8 bit indexed sprite sheets for scaling
+    tests and benchmarks of AmigaSpriteCompress.
+
+    Every pixel comes from a hash of the seed, the cell and the row, never
+    from std::mt19937 and the std distributions, whose output differs
+    between standard libraries. The same settings therefore give the same
+    pixels on every platform and compiler.
+
+    Sheets are written a row at a time, the only buffer is one row of the
+    sheet, so sheets of many GB are written without holding them.
+
+    A cell either has its own content or, duplicateRatio of the time, the
+    content of one of the cells a little before it in the corpus, which
+    may be on an earlier sheet. Duplicates are exact, so the dedup index
+    sees them as repeats.
+
+-----------------------------------------------------------------------------*/
+
+//-----------------------------------------------------------------------------
+// Headers
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <png.h>
+
+#include "../../AmigaGfxLib/inc/AmigaGfxLib.h"
+
+//-----------------------------------------------------------------------------
+// Local types
+//-----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaSpriteGen AmigaSpriteGen
+    @brief      Corpus settings, all from the command line
+  --------------------------------------------------------------------------*/
+struct CorpusConfig
+{
+    std::string outputPath       = "corpus"; //!< Folder the sheets are written to
+    uint64_t    sheetCount       = 1;        //!< Sheets to write
+    uint32_t    sheetWidth       = 320;      //!< Width of each sheet
+    uint32_t    sheetHeight      = 256;      //!< Height of each sheet
+    uint32_t    cellWidth        = 32;       //!< Width of each sprite cell
+    uint32_t    cellHeight       = 32;       //!< Height of each sprite cell
+    double      transparency     = 0.5;      //!< Fraction of each cell left transparent
+    uint32_t    colourCount      = 32;       //!< Palette entries, index 0 is transparent
+    double      duplicateRatio   = 0.25;     //!< Fraction of cells repeating an earlier cell
+    uint64_t    seed             = 1;        //!< Corpus seed
+    int         compressionLevel = -1;       //!< zlib level, -1 for the zlib default
+};
+
+//-----------------------------------------------------------------------------
+// Local functions
+//-----------------------------------------------------------------------------
+
+int      main_Usage( void );
+bool     main_ParseArgs( int argc, char* argv[], CorpusConfig& config );
+uint64_t main_ParseSize( const std::string& arg );
+bool     main_ParseDimensions( const std::string& arg, uint32_t& width, uint32_t& height );
+uint64_t main_Hash( uint64_t a, uint64_t b = 0, uint64_t c = 0 );
+uint64_t main_CellContent( const CorpusConfig& config, uint64_t cell );
+void     main_CellRow( const CorpusConfig& config, uint64_t content, uint32_t y, uint8_t* pRow, uint32_t width );
+bool     main_WriteSheet( const CorpusConfig& config, uint64_t sheet, const std::string& fileName, uint64_t& uniqueCells );
+bool     main_WritePng( const CorpusConfig& config, uint64_t firstCell, FILE* fp, png_color* pPalette, uint64_t* pContents, uint8_t* pRow, uint64_t& uniqueCells );
+
+//-----------------------------------------------------------------------------
+// Namespace access
+//-----------------------------------------------------------------------------
+
+using namespace AmigaGfx;
+
+//-----------------------------------------------------------------------------
+// External Functionality
+//-----------------------------------------------------------------------------
+
+int main( int argc, char* argv[] )
+{
+    CorpusConfig config;
+
+    if ( main_ParseArgs( argc, argv, config ) == false )
+    {
+        return main_Usage();
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories( config.outputPath, error );
+    if ( error )
+    {
+        std::cout << "Failed to create " << config.outputPath << ": " << error.message() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    uint64_t uniqueCells = 0;
+    uint64_t bytesOut    = 0;
+    auto     start       = std::chrono::steady_clock::now();
+
+    for ( uint64_t nSheet = 0; nSheet < config.sheetCount; nSheet++ )
+    {
+        std::ostringstream name;
+        name << "sheet-" << std::setw( 5 ) << std::setfill( '0' ) << nSheet << "-" << config.sheetWidth << "x" << config.sheetHeight << ".png";
+
+        std::string fileName = ( std::filesystem::path( config.outputPath ) / name.str() ).string();
+        if ( main_WriteSheet( config, nSheet, fileName, uniqueCells ) == false )
+        {
+            std::cout << "Failed to write " << fileName << std::endl;
+            return EXIT_FAILURE;
+        }
+        bytesOut += std::filesystem::file_size( fileName, error );
+    }
+
+    uint32_t cellsAcross = ( config.sheetWidth + config.cellWidth - 1 ) / config.cellWidth;
+    uint32_t cellsDown   = ( config.sheetHeight + config.cellHeight - 1 ) / config.cellHeight;
+    uint64_t totalCells  = config.sheetCount * cellsAcross * cellsDown;
+    double   pixels      = (double)config.sheetCount * config.sheetWidth * config.sheetHeight;
+    double   seconds     = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+    std::cout << "Wrote " << config.sheetCount << " sheets, " << totalCells << " cells (" << uniqueCells << " unique), " << std::fixed << std::setprecision( 1 )
+              << pixels / ( 1024.0 * 1024.0 ) << " MB of pixels as " << bytesOut / ( 1024.0 * 1024.0 ) << " MB of PNG in " << seconds << " s" << std::endl;
+
+    return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+// Internal Functionality
+//-----------------------------------------------------------------------------
+
+int main_Usage( void )
+{
+    std::cout << "Usage: AmigaSpriteGen [options]" << std::endl
+              << "  --out <dir>            folder to write to (corpus)" << std::endl
+              << "  --sheets <count>       sheets to write (1)" << std::endl
+              << "  --size <W>x<H>         sheet size in pixels (320x256)" << std::endl
+              << "  --cell <W>x<H>         sprite cell size in pixels (32x32)" << std::endl
+              << "  --total <bytes>        write sheets until this many pixels, K, M and G suffixes, overrides --sheets" << std::endl
+              << "  --transparency <0-1>   fraction of each cell left transparent (0.5)" << std::endl
+              << "  --colours <2-256>      palette size, index 0 is transparent (32)" << std::endl
+              << "  --duplicates <0-1>     fraction of cells repeating an earlier cell (0.25)" << std::endl
+              << "  --seed <n>             corpus seed, the same seed gives the same files (1)" << std::endl
+              << "  --level <0-9>          zlib compression level (zlib default)" << std::endl;
+
+    return EXIT_FAILURE;
+}
+
+bool main_ParseArgs( int argc, char* argv[], CorpusConfig& config )
+{
+    uint64_t totalBytes = 0;
+
+    try
+    {
+        for ( int nArg = 1; nArg < argc; nArg++ )
+        {
+            std::string arg = argv[ nArg ];
+
+            if ( nArg + 1 >= argc )
+            {
+                return false;
+            }
+
+            std::string value = argv[ ++nArg ];
+
+            if ( arg == "--out" )
+            {
+                config.outputPath = value;
+            }
+            else if ( arg == "--sheets" )
+            {
+                config.sheetCount = std::stoull( value );
+            }
+            else if ( arg == "--size" )
+            {
+                if ( main_ParseDimensions( value, config.sheetWidth, config.sheetHeight ) == false )
+                {
+                    return false;
+                }
+            }
+            else if ( arg == "--cell" )
+            {
+                if ( main_ParseDimensions( value, config.cellWidth, config.cellHeight ) == false )
+                {
+                    return false;
+                }
+            }
+            else if ( arg == "--total" )
+            {
+                totalBytes = main_ParseSize( value );
+            }
+            else if ( arg == "--transparency" )
+            {
+                config.transparency = std::stod( value );
+            }
+            else if ( arg == "--colours" )
+            {
+                config.colourCount = std::stoul( value );
+            }
+            else if ( arg == "--duplicates" )
+            {
+                config.duplicateRatio = std::stod( value );
+            }
+            else if ( arg == "--seed" )
+            {
+                config.seed = std::stoull( value );
+            }
+            else if ( arg == "--level" )
+            {
+                config.compressionLevel = std::stoi( value );
+            }
+            else
+            {
+                return false;
+            }
+        }
+    }
+    catch ( const std::exception& )
+    {
+        return false;
+    }
+
+    if ( config.transparency < 0.0 || config.transparency > 1.0 || config.duplicateRatio < 0.0 || config.duplicateRatio > 1.0 )
+    {
+        return false;
+    }
+    if ( config.colourCount < 2 || config.colourCount > 256 || config.compressionLevel < -1 || config.compressionLevel > 9 )
+    {
+        return false;
+    }
+
+    // a pixel is a byte, so the total is a count of sheets, rounded up
+    if ( totalBytes )
+    {
+        uint64_t sheetBytes = (uint64_t)config.sheetWidth * config.sheetHeight;
+        config.sheetCount   = ( totalBytes + sheetBytes - 1 ) / sheetBytes;
+    }
+
+    return config.sheetCount > 0;
+}
+
+uint64_t main_ParseSize( const std::string& arg )
+{
+    size_t   used  = 0;
+    uint64_t value = std::stoull( arg, &used );
+
+    switch ( used < arg.size() ? std::toupper( (unsigned char)arg[ used ] ) : 0 )
+    {
+        case 'G':
+            value *= 1024;
+            [[fallthrough]];
+        case 'M':
+            value *= 1024;
+            [[fallthrough]];
+        case 'K':
+            value *= 1024;
+            break;
+        default:
+            break;
+    }
+
+    return value;
+}
+
+bool main_ParseDimensions( const std::string& arg, uint32_t& width, uint32_t& height )
+{
+    size_t split = arg.find_first_of( "xX" );
+
+    if ( split == std::string::npos )
+    {
+        return false;
+    }
+
+    width  = std::stoul( arg.substr( 0, split ) );
+    height = std::stoul( arg.substr( split + 1 ) );
+
+    // PNG caps each side at 2^31 - 1, keep well inside it
+    return width > 0 && height > 0 && width <= 0x1000000 && height <= 0x1000000;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaSpriteGen AmigaSpriteGen
+    @brief      Mixes up to three values into 64 well spread bits, the
+                splitmix64 finaliser applied to each in turn
+    @param      a - First value
+    @param      b - Second value
+    @param      c - Third value
+    @return     uint64_t - Hash of the three values
+  --------------------------------------------------------------------------*/
+uint64_t main_Hash( uint64_t a, uint64_t b, uint64_t c )
+{
+    uint64_t hash = 0x9E3779B97F4A7C15ull;
+
+    for ( uint64_t value : { a, b, c } )
+    {
+        hash += value + 0x9E3779B97F4A7C15ull;
+        hash  = ( hash ^ ( hash >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+        hash  = ( hash ^ ( hash >> 27 ) ) * 0x94D049BB133111EBull;
+        hash ^= hash >> 31;
+    }
+
+    return hash;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaSpriteGen AmigaSpriteGen
+    @brief      Content of a cell, the index of the cell whose pixels it
+                shares. Duplicates point back up to 4096 cells, following
+                the chain until a cell with its own content.
+    @param      config - Corpus settings
+    @param      cell - Index of the cell in the whole corpus
+    @return     uint64_t - Cell index the pixels are generated from
+  --------------------------------------------------------------------------*/
+uint64_t main_CellContent( const CorpusConfig& config, uint64_t cell )
+{
+    // the top 53 bits of the hash as a double in [0, 1)
+    while ( cell > 0 && ( main_Hash( config.seed, cell, 1 ) >> 11 ) * 0x1.0p-53 < config.duplicateRatio )
+    {
+        cell -= 1 + main_Hash( config.seed, cell, 2 ) % std::min<uint64_t>( cell, 4096 );
+    }
+
+    return cell;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaSpriteGen AmigaSpriteGen
+    @brief      Generates one row of a cell. Each row is a span of opaque
+                pixels, sized so the cell matches the transparency setting,
+                that wanders left and right every few rows, filled with runs
+                of colour a few pixels long.
+    @param      config - Corpus settings
+    @param      content - Cell index the pixels are generated from
+    @param      y - Row of the cell
+    @param      pRow - Receives the row
+    @param      width - Pixels in the row, less than a cell on the right edge
+  --------------------------------------------------------------------------*/
+void main_CellRow( const CorpusConfig& config, uint64_t content, uint32_t y, uint8_t* pRow, uint32_t width )
+{
+    uint32_t span   = (uint32_t)std::lround( config.cellWidth * ( 1.0 - config.transparency ) );
+    uint32_t slack  = config.cellWidth - span;
+    uint64_t wander = main_Hash( config.seed ^ content, y / 4, 3 );
+    uint32_t left   = slack ? slack / 2 + (uint32_t)( wander % ( slack / 2 + 1 ) ) - slack / 4 : 0;
+    uint32_t right  = std::min( left + span, width );
+
+    std::fill( pRow, pRow + width, 0 );
+
+    for ( uint32_t x = left, run = 0; x < right; run++ )
+    {
+        uint64_t hash   = main_Hash( config.seed ^ content, y / 2, run );
+        uint8_t  colour = (uint8_t)( 1 + hash % ( config.colourCount - 1 ) );
+        uint32_t end    = std::min( right, x + 1 + (uint32_t)( ( hash >> 32 ) % 8 ) );
+
+        std::fill( pRow + x, pRow + end, colour );
+        x = end;
+    }
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaSpriteGen AmigaSpriteGen
+    @brief      Writes one sheet of the corpus a row at a time
+    @param      config - Corpus settings
+    @param      sheet - Index of the sheet in the corpus
+    @param      fileName - File to write
+    @param      uniqueCells - Incremented for each cell with its own content
+    @return     bool - true if the sheet was written
+  --------------------------------------------------------------------------*/
+bool main_WriteSheet( const CorpusConfig& config, uint64_t sheet, const std::string& fileName, uint64_t& uniqueCells )
+{
+    uint32_t               cellsAcross = ( config.sheetWidth + config.cellWidth - 1 ) / config.cellWidth;
+    uint32_t               cellsDown   = ( config.sheetHeight + config.cellHeight - 1 ) / config.cellHeight;
+    std::vector<uint64_t>  contents( cellsAcross );
+    std::vector<uint8_t>   row( config.sheetWidth );
+    std::vector<png_color> palette( config.colourCount );
+
+    // the palette is the same for every sheet, index 0 the transparent magenta
+    palette[ 0 ] = { 0xFF, 0x00, 0xFF };
+    for ( uint32_t nColour = 1; nColour < config.colourCount; nColour++ )
+    {
+        uint64_t hash      = main_Hash( config.seed, nColour, 4 );
+        palette[ nColour ] = { (png_byte)hash, (png_byte)( hash >> 8 ), (png_byte)( hash >> 16 ) };
+    }
+
+    FILE* fp = fopen( fileName.c_str(), "wb" );
+    if ( !fp )
+    {
+        return false;
+    }
+
+    bool result = main_WritePng( config, sheet * cellsAcross * cellsDown, fp, palette.data(), contents.data(), row.data(), uniqueCells );
+
+    return fclose( fp ) == 0 && result;
+}
+
+/**---------------------------------------------------------------------------
+    @ingroup    AmigaSpriteGen AmigaSpriteGen
+    @brief      Encodes the rows of a sheet into an open file. Kept apart
+                from main_WriteSheet so the frame holding the setjmp owns
+                no vectors, the buffers are all made by the caller.
+    @param      config - Corpus settings
+    @param      firstCell - Index of the sheet's first cell in the corpus
+    @param      fp - File to write to, left open
+    @param      pPalette - Palette of config.colourCount colours
+    @param      pContents - Buffer of one content index per cell across
+    @param      pRow - Buffer of one row of the sheet
+    @param      uniqueCells - Incremented for each cell with its own content
+    @return     bool - true if the sheet was encoded
+  --------------------------------------------------------------------------*/
+bool main_WritePng( const CorpusConfig& config, uint64_t firstCell, FILE* fp, png_color* pPalette, uint64_t* pContents, uint8_t* pRow, uint64_t& uniqueCells )
+{
+    uint32_t cellsAcross = ( config.sheetWidth + config.cellWidth - 1 ) / config.cellWidth;
+
+    png_structp png  = png_create_write_struct( PNG_LIBPNG_VER_STRING, NULL, NULL, NULL );
+    png_infop   info = png ? png_create_info_struct( png ) : NULL;
+    if ( !info )
+    {
+        png_destroy_write_struct( &png, NULL );
+        return false;
+    }
+
+    if ( setjmp( png_jmpbuf( png ) ) )
+    {
+        png_destroy_write_struct( &png, &info );
+        return false;
+    }
+
+    png_init_io( png, fp );
+    if ( config.compressionLevel >= 0 )
+    {
+        png_set_compression_level( png, config.compressionLevel );
+    }
+    png_set_IHDR( png, info, config.sheetWidth, config.sheetHeight, 8, PNG_COLOR_TYPE_PALETTE, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT );
+    png_set_PLTE( png, info, pPalette, (int)config.colourCount );
+    png_write_info( png, info );
+
+    for ( uint32_t y = 0; y < config.sheetHeight; y++ )
+    {
+        uint32_t cellY = y % config.cellHeight;
+
+        // look the cell contents up once per row of cells
+        if ( cellY == 0 )
+        {
+            for ( uint32_t nCell = 0; nCell < cellsAcross; nCell++ )
+            {
+                uint64_t cell      = firstCell + ( y / config.cellHeight ) * cellsAcross + nCell;
+                pContents[ nCell ] = main_CellContent( config, cell );
+                uniqueCells       += pContents[ nCell ] == cell;
+            }
+        }
+
+        for ( uint32_t nCell = 0; nCell < cellsAcross; nCell++ )
+        {
+            uint32_t x = nCell * config.cellWidth;
+            main_CellRow( config, pContents[ nCell ], cellY, pRow + x, std::min( config.cellWidth, config.sheetWidth - x ) );
+        }
+
+        png_write_row( png, pRow );
+    }
+
+    png_write_end( png, info );
+    png_destroy_write_struct( &png, &info );
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// End of file: main.cpp
+// ----------------------------------------------------------------------------
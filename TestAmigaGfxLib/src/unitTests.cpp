@@ -19,12 +19,183 @@ Notes:
 #include "../../doctest/doctest/doctest.h"
 #include "../../AmigaGfxLib/inc/AmigaGfxLib.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <filesystem>
+#include <thread>
+
 //-----------------------------------------------------------------------------
 // Namespace access
 //-----------------------------------------------------------------------------
 
 using namespace AmigaGfx;
 
+//-----------------------------------------------------------------------------
+// Heap allocation counting
+//-----------------------------------------------------------------------------
+
+static std::atomic<uint64_t> heapAllocations = 0; //!< operator new calls made by the test program
+
+// the replacements pair malloc with free, gcc only sees free after new once they are inlined
+#if defined( __GNUC__ ) && !defined( __clang__ )
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new( size_t size )
+{
+    heapAllocations.fetch_add( 1, std::memory_order_relaxed );
+    if ( void* pMemory = std::malloc( size ? size : 1 ) )
+    {
+        return pMemory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete( void* pMemory ) noexcept
+{
+    std::free( pMemory );
+}
+
+void operator delete( void* pMemory, size_t ) noexcept
+{
+    std::free( pMemory );
+}
+
+//-----------------------------------------------------------------------------
+// Test support functions
+//-----------------------------------------------------------------------------
+
+/**---------------------------------------------------------------------------
+    @brief      Decodes a single sprite from compressed sprite data
+    @param      pData - Pointer to the start of the sprite commands
+    @param      sprW - Width of the sprite
+    @param      sprH - Height of the sprite
+    @param      fillCount - Incremented for each fill run found
+    @return     std::vector<uint8_t> - Decoded sprite pixels
+  --------------------------------------------------------------------------*/
+static std::vector<uint8_t> DecodeSprite( const uint8_t* pData, uint32_t sprW, uint32_t sprH, uint32_t& fillCount )
+{
+    std::vector<uint8_t> pixels( sprW * sprH, 0 );
+    uint32_t             x = 0;
+    uint32_t             y = 0;
+
+    for ( uint8_t cmd = *pData++; cmd != (uint8_t)SpriteCmd::EndSprite; cmd = *pData++ )
+    {
+        if ( cmd == (uint8_t)SpriteCmd::EndLine )
+        {
+            x = 0;
+            y++;
+        }
+        else if ( cmd == (uint8_t)SpriteCmd::Skip )
+        {
+            x += cmd;
+        }
+        else if ( cmd == (uint8_t)SpriteCmd::Fill )
+        {
+            uint8_t len = *pData++;
+            std::memset( &pixels[ y * sprW + x ], *pData++, len );
+            x += len;
+            fillCount++;
+        }
+        else
+        {
+            x += cmd;
+            uint8_t len = *pData++;
+            std::memcpy( &pixels[ y * sprW + x ], pData, len );
+            pData += len;
+            x += len;
+        }
+    }
+
+    return pixels;
+}
+
+/**---------------------------------------------------------------------------
+    @brief      Compresses the image through Tools and loads the .SPR back
+    @param      image - Image pixels
+    @param      w - Width of the image
+    @param      h - Height of the image
+    @param      sprW - Width of the sprite
+    @param      sprH - Height of the sprite
+    @return     std::vector<uint8_t> - Contents of the .SPR file
+  --------------------------------------------------------------------------*/
+static std::vector<uint8_t> CompressToMemory( std::vector<uint8_t>& image, uint32_t w, uint32_t h, uint32_t sprW, uint32_t sprH )
+{
+    std::string          baseName = ( std::filesystem::temp_directory_path() / "AmigaGfxLibTest" ).string();
+    std::vector<uint8_t> sprFile;
+    FileManager          fileManager;
+
+    Tools::getInstance().CompressSpriteData( image, w, h, sprW, sprH, baseName );
+    fileManager.OpenFile( baseName + ".SPR", sprFile );
+    std::filesystem::remove( baseName + ".SPR" );
+
+    return sprFile;
+}
+
+/**---------------------------------------------------------------------------
+    @brief      Writes an 8 bit indexed PNG with a grey ramp palette
+    @param      fileName - File to write
+    @param      image - Image pixels
+    @param      w - Width of the image
+    @param      h - Height of the image
+  --------------------------------------------------------------------------*/
+static void WriteIndexedPNG( const std::string& fileName, const std::vector<uint8_t>& image, uint32_t w, uint32_t h )
+{
+    FILE*       fp       = fopen( fileName.c_str(), "wb" );
+    png_structp png_ptr  = png_create_write_struct( PNG_LIBPNG_VER_STRING, NULL, NULL, NULL );
+    png_infop   info_ptr = png_create_info_struct( png_ptr );
+    png_color   palette[ 256 ];
+
+    for ( int nColour = 0; nColour < 256; nColour++ )
+    {
+        palette[ nColour ] = { (png_byte)nColour, (png_byte)nColour, (png_byte)nColour };
+    }
+
+    png_init_io( png_ptr, fp );
+    png_set_IHDR( png_ptr, info_ptr, w, h, 8, PNG_COLOR_TYPE_PALETTE, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT );
+    png_set_PLTE( png_ptr, info_ptr, palette, 256 );
+    png_write_info( png_ptr, info_ptr );
+    for ( uint32_t y = 0; y < h; y++ )
+    {
+        png_write_row( png_ptr, &image[ y * w ] );
+    }
+    png_write_end( png_ptr, NULL );
+    png_destroy_write_struct( &png_ptr, &info_ptr );
+    fclose( fp );
+}
+
+/**---------------------------------------------------------------------------
+    @brief      Rewrites the size in a PNG's header, keeping the pixel data,
+                to make a small file that claims to be a huge image
+    @param      fileName - PNG file to change
+    @param      w - Width to claim
+    @param      h - Height to claim
+  --------------------------------------------------------------------------*/
+static void SetPNGSize( const std::string& fileName, uint32_t w, uint32_t h )
+{
+    std::vector<uint8_t> pngData;
+    FileManager().OpenFile( fileName, pngData );
+
+    // IHDR follows the signature, its data starts with the big endian size
+    // and its CRC covers the chunk type and data
+    for ( int nByte = 0; nByte < 4; nByte++ )
+    {
+        pngData[ 16 + nByte ] = (uint8_t)( w >> ( 24 - 8 * nByte ) );
+        pngData[ 20 + nByte ] = (uint8_t)( h >> ( 24 - 8 * nByte ) );
+    }
+    uint32_t crc = (uint32_t)crc32( 0, pngData.data() + 12, 17 );
+    for ( int nByte = 0; nByte < 4; nByte++ )
+    {
+        pngData[ 29 + nByte ] = (uint8_t)( crc >> ( 24 - 8 * nByte ) );
+    }
+    FileManager().SaveFile( fileName, pngData );
+}
+
 //-----------------------------------------------------------------------------
 // Unit Tests
 //-----------------------------------------------------------------------------
@@ -39,6 +210,1751 @@ TEST_SUITE( "Amiga Gfx Library Test Suite" )
         {
         }
     }
+    //-----------------------------------------------------------------------------
+    TEST_CASE( "Sprite compression fill runs" )
+    //-----------------------------------------------------------------------------
+    {
+        const uint32_t       w = 64;
+        const uint32_t       h = 16;
+        std::vector<uint8_t> image( w * h, 0 );
+
+        // flat panel with a noisy border and a transparent gap on each line
+        for ( uint32_t y = 0; y < h; y++ )
+        {
+            for ( uint32_t x = 4; x < w; x++ )
+            {
+                image[ y * w + x ] = ( x < 8 || x > 56 ) ? (uint8_t)( 1 + ( x + y ) % 7 ) : 9;
+            }
+            image[ y * w + 30 ] = 0;
+        }
+
+        std::vector<uint8_t> sprFile = CompressToMemory( image, w, h, w, h );
+        REQUIRE( sprFile.size() > 0 );
+
+        SUBCASE( "Round trip matches the source and uses fill runs" )
+        {
+            std::string header( sprFile.begin(), sprFile.begin() + 20 );
+            size_t      dataStart = header.find( ':', 11 ) + 1 + sizeof( uint32_t );
+            uint32_t    fillCount = 0;
+
+            CHECK( header.starts_with( "SPRITEDATA:1,64,16:" ) );
+            CHECK( DecodeSprite( &sprFile[ dataStart ], w, h, fillCount ) == image );
+            CHECK( fillCount == h * 2 );
+            CHECK( sprFile.size() < dataStart + w * h / 2 );
+        }
+    }
+    //-----------------------------------------------------------------------------
+    TEST_CASE( "Asynchronous logger" )
+    //-----------------------------------------------------------------------------
+    {
+        std::string logName = ( std::filesystem::temp_directory_path() / "AmigaGfxLibTest.log" ).string();
+        Logger      logger;
+
+        CHECK( logger.LogMessage( "Not initialised" ) == LibraryError::Logger_InitializeNotCalled );
+
+        logger.loggerInitialize();
+        logger.setOutputTerminal( false );
+
+        SUBCASE( "Messages from many threads are all written, history is bounded" )
+        {
+            std::vector<std::thread> threads;
+
+            logger.setOverflowPolicy( LogOverflow::Block );
+            for ( uint32_t nThread = 0; nThread < 4; nThread++ )
+            {
+                threads.emplace_back( [ &logger, nThread ]() {
+                    for ( uint32_t nIndex = 0; nIndex < 1000; nIndex++ )
+                    {
+                        logger.LogError( LibraryError::Logger_base_error, "Thread " + std::to_string( nThread ) );
+                    }
+                } );
+            }
+            for ( auto& thread : threads )
+            {
+                thread.join();
+            }
+
+            CHECK( logger.saveLog( logName ) == LibraryError::No_Error );
+            CHECK( logger.getDroppedCount() == 0 );
+
+            std::ifstream file( logName );
+            std::string   line;
+            uint32_t      lines = 0;
+            while ( std::getline( file, line ) )
+            {
+                CHECK( line.find( "Error 0x10000000 - Thread " ) != std::string::npos );
+                lines++;
+            }
+            CHECK( lines == 1024 );
+        }
+
+        SUBCASE( "Deferred formatting and level filtering" )
+        {
+            uint32_t evaluated = 0;
+
+            logger.clearLog();
+            AGL_LOG_WARNING( logger, "Value {} hex {:x} text {} {{}}", -42, 255u, std::string( "abc" ) );
+            logger.setLogLevel( LogLevel::Error );
+            AGL_LOG_WARNING( logger, "Filtered at runtime {}", ++evaluated );
+            AGL_LOG_ERROR( logger, "Error level {}", 1.5 );
+#if AGL_LOG_MIN_LEVEL > 1
+            AGL_LOG_DEBUG( logger, "Compiled out {}", ++evaluated );
+#endif
+            CHECK( evaluated == 0 );
+            CHECK( logger.getLogLevel() == LogLevel::Error );
+            CHECK( logger.saveLog( logName ) == LibraryError::No_Error );
+
+            std::ifstream file( logName );
+            std::string   line;
+            std::getline( file, line );
+            CHECK( line.ends_with( "] - Warning - Value -42 hex ff text abc {}" ) );
+            std::getline( file, line );
+            CHECK( line.ends_with( "] - Error level 1.5" ) );
+            CHECK( !std::getline( file, line ) );
+        }
+
+        SUBCASE( "Messages too long for a record are marked as cut" )
+        {
+            std::string longText( LOG_RECORD_TEXT_SIZE + 40, 'x' );
+
+            logger.setLogLevel( LogLevel::Info );
+            logger.clearLog();
+            logger.LogMessage( longText );
+            AGL_LOG_WARNING( logger, "Text {}", longText );
+            logger.LogMessage( longText.substr( 0, LOG_RECORD_TEXT_SIZE ) );
+            CHECK( logger.saveLog( logName ) == LibraryError::No_Error );
+
+            std::ifstream file( logName );
+            std::string   line;
+            std::getline( file, line );
+            CHECK( line.ends_with( "] - " + longText.substr( 0, LOG_RECORD_TEXT_SIZE ) + "..." ) );
+            std::getline( file, line );
+            CHECK( line.ends_with( "] - Warning - Text " + longText.substr( 0, LOG_RECORD_TEXT_SIZE ) + "..." ) );
+            std::getline( file, line );
+            CHECK( line.ends_with( "] - " + longText.substr( 0, LOG_RECORD_TEXT_SIZE ) ) );
+        }
+
+        std::filesystem::remove( logName );
+    }
+    //-----------------------------------------------------------------------------
+    TEST_CASE( "Error handler counts and bounded history" )
+    //-----------------------------------------------------------------------------
+    {
+        ErrorHandler&            errorHandler = ErrorHandler::getInstance();
+        std::vector<std::thread> threads;
+        const uint32_t           perThread = 1000;
+
+        errorHandler.setOutputTerminal( false );
+        errorHandler.clearErrors();
+
+        for ( uint32_t nThread = 0; nThread < 4; nThread++ )
+        {
+            threads.emplace_back( [ &errorHandler, nThread, perThread ]() {
+                for ( uint32_t nIndex = 0; nIndex < perThread; nIndex++ )
+                {
+                    errorHandler.handleError( (ErrorType)( nIndex % 4 ), LibraryError::ErrorHandler_base_error, "Thread " + std::to_string( nThread ) );
+                }
+            } );
+        }
+        for ( auto& thread : threads )
+        {
+            thread.join();
+        }
+
+        ErrorStatus                   status = errorHandler.getStatusInformation();
+        std::vector<ErrorInformation> recent = errorHandler.getRecentErrors();
+
+        CHECK( status.totalErrors == 4 * perThread );
+        CHECK( status.numStatus == perThread );
+        CHECK( status.numWarnings == perThread );
+        CHECK( status.numErrors == perThread );
+        CHECK( status.numCritical == perThread );
+        CHECK( recent.size() == ErrorHandler::ERROR_HISTORY_SIZE );
+        CHECK( recent.size() + status.numOverflow == 4 * perThread );
+        CHECK( recent.front().sequence == 4 * perThread - ErrorHandler::ERROR_HISTORY_SIZE );
+        CHECK( std::is_sorted( recent.begin(), recent.end(), []( auto& a, auto& b ) { return a.sequence < b.sequence; } ) );
+        CHECK( recent.back().sequence == 4 * perThread - 1 );
+
+        errorHandler.clearErrors();
+        CHECK( errorHandler.getStatusInformation().totalErrors == 0 );
+        errorHandler.flushLog();
+        errorHandler.setOutputTerminal( true );
+    }
+    //-----------------------------------------------------------------------------
+    TEST_CASE( "Pipeline metrics" )
+    //-----------------------------------------------------------------------------
+    {
+        Metrics&             metrics = Metrics::getInstance();
+        std::vector<uint8_t> image( 32 * 32, 5 );
+
+        metrics.reset();
+        CompressToMemory( image, 32, 32, 16, 16 );
+
+        std::thread worker( [ &metrics ]() { metrics.addCount( MetricCounter::BytesIn, 100 ); } );
+        worker.join();
+
+        MetricTotals totals = metrics.getTotals();
+        CHECK( totals.counters[ (size_t)MetricCounter::SpritesEncoded ] == 4 );
+        CHECK( totals.counters[ (size_t)MetricCounter::OpEndSprite ] == 4 );
+        CHECK( totals.counters[ (size_t)MetricCounter::OpFill ] == 4 * 16 );
+        CHECK( totals.counters[ (size_t)MetricCounter::OpEndLine ] == 4 * 16 );
+        CHECK( totals.counters[ (size_t)MetricCounter::BytesIn ] >= 100 );
+        CHECK( totals.stageCalls[ (size_t)MetricStage::Compress ] == 1 );
+        CHECK( totals.stageCalls[ (size_t)MetricStage::FileWrite ] == 1 );
+
+        std::string json = metrics.toJSON();
+        CHECK( json.find( "\"SpritesEncoded\": 4" ) != std::string::npos );
+        CHECK( json.find( "\"threads\"" ) != std::string::npos );
+        CHECK( metrics.toCSV().find( "total,counter,OpFill,,64" ) != std::string::npos );
+
+        // the extension picks the summary format
+        std::filesystem::path summaryName = std::filesystem::temp_directory_path() / "agl_metrics.csv";
+        std::ifstream         summary;
+        std::string           firstLine;
+        REQUIRE( metrics.saveSummary( summaryName.string() ) );
+        summary.open( summaryName );
+        std::getline( summary, firstLine );
+        CHECK( firstLine.find( '{' ) == std::string::npos );
+        summary.close();
+        std::filesystem::remove( summaryName );
+        CHECK( metrics.saveSummary( ( std::filesystem::temp_directory_path() / "agl_missing_dir" / "metrics.json" ).string() ) == false );
+
+        // an exited thread's slot is folded into the totals and dropped
+        size_t threadRows = 0;
+        for ( size_t nFound = json.find( "\"thread\":" ); nFound != std::string::npos; nFound = json.find( "\"thread\":", nFound + 1 ) )
+        {
+            threadRows++;
+        }
+        for ( int nThread = 0; nThread < 8; nThread++ )
+        {
+            std::thread( [ &metrics ]() { metrics.addCount( MetricCounter::BytesIn, 1 ); } ).join();
+        }
+        json = metrics.toJSON();
+        for ( size_t nFound = json.find( "\"thread\":" ); nFound != std::string::npos; nFound = json.find( "\"thread\":", nFound + 1 ) )
+        {
+            threadRows--;
+        }
+        CHECK( threadRows == 0 );
+        CHECK( metrics.getTotals().counters[ (size_t)MetricCounter::BytesIn ] == totals.counters[ (size_t)MetricCounter::BytesIn ] + 8 );
+    }
+    //-----------------------------------------------------------------------------
+    TEST_CASE( "Streaming filtered directory walk" )
+    //-----------------------------------------------------------------------------
+    {
+        std::filesystem::path root = std::filesystem::temp_directory_path() / "agl_walk_test";
+        std::filesystem::remove_all( root );
+
+        // 8 directories, each with a sub directory, PNGs and other files
+        for ( int nDir = 0; nDir < 8; nDir++ )
+        {
+            std::filesystem::path dir = root / ( "dir" + std::to_string( nDir ) ) / "sub";
+            std::filesystem::create_directories( dir );
+            std::ofstream( dir / "a.png" ).put( 'x' );
+            std::ofstream( dir.parent_path() / "B.PNG" ).put( 'x' );
+            std::ofstream( dir.parent_path() / "Sprite-01.bmp" ).put( 'x' );
+            std::ofstream( dir / "notes.txt" ).put( 'x' );
+        }
+
+        // a link back to the root is not followed, a link to a file is walked as a file
+        std::filesystem::create_directory_symlink( root, root / "dir0" / "sub" / "up" );
+        std::filesystem::create_symlink( root / "dir1" / "B.PNG", root / "dir1" / "link.png" );
+
+        FileManager              fileManager;
+        Channel<std::string>     found( 4 ); // small, so the walk has to wait on the consumer
+        std::vector<std::string> names;
+        uint32_t                 matched = 0;
+
+        std::thread walker( [ & ]() { matched = fileManager.walkFiles( root.string(), { ".png", "sprite-??.*" }, found, 4 ); } );
+        std::string name;
+
+        while ( found.pop( name ) )
+        {
+            names.push_back( name );
+        }
+        walker.join();
+
+        CHECK( matched == 25 );
+        CHECK( names.size() == 25 );
+        CHECK( std::count_if( names.begin(), names.end(), []( const std::string& n ) { return n.ends_with( ".txt" ); } ) == 0 );
+        CHECK( found.isClosed() );
+
+        CHECK( FileManager::matchesFilter( "dir/x.PnG", { ".png" } ) );
+        CHECK( FileManager::matchesFilter( "anything", {} ) );
+        CHECK( FileManager::matchesFilter( "dir.png/file", { ".png" } ) == false );
+        CHECK( FileManager::matchesFilter( "a/Sprite-0001.png", { "*-00?1.png" } ) );
+        CHECK( FileManager::matchesFilter( "a/Sprite-0001.png", { "*-00?2.png" } ) == false );
+
+        std::filesystem::remove_all( root );
+    }
+    //-----------------------------------------------------------------------------
+    TEST_CASE( "File watcher debounces changes" )
+    //-----------------------------------------------------------------------------
+    {
+#if defined( __linux__ )
+        std::filesystem::path root = std::filesystem::temp_directory_path() / "agl_watch_test";
+        std::filesystem::remove_all( root );
+        std::filesystem::create_directories( root / "existing" );
+
+        FileWatcher              watcher;
+        std::vector<std::string> changed;
+
+        REQUIRE( watcher.addWatch( root.string() ) );
+        CHECK( watcher.getWatchCount() == 2 );
+        CHECK( watcher.waitForChanges( changed, { ".png" }, 10, 50 ) == WatchStatus::Timeout );
+
+        // a burst of writes, repeated saves, a file to ignore and a new directory
+        for ( int nSave = 0; nSave < 3; nSave++ )
+        {
+            std::ofstream( root / "a.png" ).put( 'x' );
+            std::ofstream( root / "existing" / "b.png" ).put( 'x' );
+        }
+        std::ofstream( root / "notes.txt" ).put( 'x' );
+        std::filesystem::create_directories( root / "new" );
+        std::ofstream( root / "new" / "c.png" ).put( 'x' );
+
+        CHECK( watcher.waitForChanges( changed, { ".png" }, 50, 2000 ) == WatchStatus::Changed );
+        REQUIRE( changed.size() == 3 );
+        CHECK( changed[ 0 ] == ( root / "a.png" ).string() );
+        CHECK( changed[ 1 ] == ( root / "existing" / "b.png" ).string() );
+        CHECK( changed[ 2 ] == ( root / "new" / "c.png" ).string() );
+        CHECK( watcher.getWatchCount() == 3 );
+
+        std::filesystem::remove_all( root );
+#endif
+    }
+    //-----------------------------------------------------------------------------
+    TEST_CASE( "File cache" )
+    //-----------------------------------------------------------------------------
+    {
+        std::filesystem::path root = std::filesystem::temp_directory_path() / "agl_cache_test";
+        std::filesystem::remove_all( root );
+        std::filesystem::create_directories( root );
+
+        std::string          fileA = ( root / "a.bin" ).string();
+        std::string          fileB = ( root / "b.bin" ).string();
+        std::vector<uint8_t> dataA( 100, 1 ), dataB( 60, 2 ), data;
+        FileManager          fileManager, otherManager;
+
+        // the cache is shared, start it empty and count from here
+        fileManager.clearCache();
+        TS_FILE_CACHE_STATS before = fileManager.getCacheStatistics();
+
+        REQUIRE( fileManager.SaveFile( fileA, dataA ) );
+        REQUIRE( fileManager.SaveFile( fileB, dataB ) );
+
+        // second read of a file comes from memory, through any FileManager
+        CHECK( fileManager.OpenFile( fileA, data ) );
+        CHECK( otherManager.OpenFile( fileA, data ) );
+        CHECK( data == dataA );
+
+        TS_FILE_CACHE_STATS stats = fileManager.getCacheStatistics();
+        CHECK( stats.cacheHits - before.cacheHits == 1 );
+        CHECK( stats.cacheMisses - before.cacheMisses == 1 );
+        CHECK( stats.bytesCached == 100 );
+
+        // a FileManager with caching off reads from disk and keeps nothing
+        otherManager.setCaching( false );
+        CHECK( otherManager.OpenFile( fileB, data ) );
+        CHECK( otherManager.getCacheStatistics().filesCached == 1 );
+
+        // a file changed behind the cache's back is read again
+        std::ofstream( fileA, std::ios::app ).put( 3 );
+        CHECK( fileManager.OpenFile( fileA, data ) );
+        CHECK( data.size() == 101 );
+        CHECK( fileManager.getCacheStatistics().cacheMisses - before.cacheMisses == 2 );
+
+        // least recently used file is evicted to stay within the budget
+        fileManager.setCacheBudget( 170 );
+        CHECK( fileManager.OpenFile( fileB, data ) );
+        CHECK( fileManager.OpenFile( fileA, data ) );
+        fileManager.setCacheBudget( 110 );
+        stats = fileManager.getCacheStatistics();
+        CHECK( stats.filesCached == 1 );
+        CHECK( stats.bytesCached == 101 );
+        CHECK( stats.cacheEvictions - before.cacheEvictions == 1 );
+
+        // explicit invalidation, and missing files are not cached
+        fileManager.invalidateFile( fileA );
+        CHECK( fileManager.getCacheStatistics().filesCached == 0 );
+        CHECK( fileManager.OpenFile( ( root / "missing.bin" ).string(), data ) == false );
+        fileManager.setCacheBudget( FileManager::FILE_CACHE_BUDGET );
+
+        std::filesystem::remove_all( root );
+    }
+    //-----------------------------------------------------------------------------
+    TEST_CASE( "Coroutine conversion pipeline" )
+    //-----------------------------------------------------------------------------
+    {
+        std::filesystem::path root = std::filesystem::temp_directory_path() / "agl_pipeline_test";
+        std::filesystem::remove_all( root );
+        std::filesystem::create_directories( root );
+
+        // 60 wide strips, cut into 60x60 cells by the encoder
+        std::vector<std::vector<uint8_t>> images;
+        for ( int nImage = 0; nImage < 24; nImage++ )
+        {
+            std::vector<uint8_t> image( 60 * 180, 0 );
+            for ( size_t nPixel = nImage; nPixel < image.size(); nPixel += 7 )
+            {
+                image[ nPixel ] = (uint8_t)( 1 + ( nPixel / 60 + nImage ) % 200 );
+            }
+            WriteIndexedPNG( ( root / ( "img" + std::to_string( nImage ) + ".png" ) ).string(), image, 60, 180 );
+            images.push_back( image );
+        }
+        std::ofstream( root / "broken.png" ) << "not a png";
+
+        PipelineConfig config;
+        config.spriteWidth   = 60;
+        config.spriteHeight  = 60;
+        config.decodeThreads = 3;
+        config.encodeThreads = 2;
+        config.channelDepth  = 2;
+
+        ConvertPipeline      pipeline( config );
+        FileManager          fileManager;
+        Channel<std::string> pngFiles( 4 );
+        uint32_t             converted = 0;
+
+        std::thread walker( [ & ]() { fileManager.walkFiles( root.string(), { ".png" }, pngFiles ); } );
+        converted = pipeline.run( pngFiles );
+        walker.join();
+
+        CHECK( converted == 24 );
+        CHECK( pipeline.getFailedCount() == 1 );
+
+        // outputs match the single threaded encoder
+        for ( int nImage = 0; nImage < 24; nImage++ )
+        {
+            std::string          baseName = ( root / ( "img" + std::to_string( nImage ) + ".png" ) ).string();
+            std::vector<uint8_t> raw, spr, pal, expected;
+
+            REQUIRE( fileManager.OpenFile( baseName + "-60-180.RAW", raw ) );
+            REQUIRE( fileManager.OpenFile( baseName + ".SPR", spr ) );
+            REQUIRE( fileManager.OpenFile( baseName + ".PAL", pal ) );
+            Tools::getInstance().EncodeSpriteData( images[ nImage ], 60, 180, 60, 60, baseName, expected );
+
+            CHECK( raw == images[ nImage ] );
+            CHECK( spr == expected );
+            CHECK( pal.size() == 257 * sizeof( uint32_t ) );
+        }
+
+        std::filesystem::remove_all( root );
+    }
+    //-----------------------------------------------------------------------------
+    TEST_CASE( "Exceptions in coroutines and pool tasks" )
+    //-----------------------------------------------------------------------------
+    {
+        ThreadPool            pool( 2 );
+        std::atomic<uint32_t> handled = 0;
+        std::atomic<uint32_t> ran     = 0;
+
+        // the exception ends the coroutine and reaches its handler, not std::terminate
+        auto failing = []( bool bThrow ) -> Task {
+            if ( bThrow )
+            {
+                throw std::runtime_error( "stage failed" );
+            }
+            co_return;
+        };
+        for ( bool bThrow : { true, false, true } )
+        {
+            failing( bThrow ).onException( [ &handled ]( std::exception_ptr exception ) { handled += exception ? 1 : 0; } ).start( pool );
+        }
+
+        // a throwing task is reported and the workers carry on
+        pool.submit( []() { throw std::bad_alloc(); } );
+        for ( int nTask = 0; nTask < 8; nTask++ )
+        {
+            pool.submit( [ &ran ]() { ran++; } );
+        }
+        pool.wait();
+
+        CHECK( handled == 2 );
+        CHECK( ran == 8 );
+    }
+    //-----------------------------------------------------------------------------
+    TEST_CASE( "Sprite encoder worst case bound and steady state allocations" )
+    //-----------------------------------------------------------------------------
+    {
+        Tools&               tools = Tools::getInstance();
+        std::mt19937         random( 1234 );
+        std::vector<uint8_t> sprFile;
+
+        // patterns chosen to be expensive: lone pixels, pairs, short runs,
+        // runs just over the fill threshold and noise
+        for ( uint32_t pattern = 0; pattern < 6; pattern++ )
+        {
+            std::vector<uint8_t> image( 64 * 64 );
+            for ( size_t nPixel = 0; nPixel < image.size(); nPixel++ )
+            {
+                uint32_t x = nPixel % 64;
+                switch ( pattern )
+                {
+                    case 0: image[ nPixel ] = ( x & 1 ) ? 0 : (uint8_t)( 1 + nPixel % 250 ); break;
+                    case 1: image[ nPixel ] = (uint8_t)( 1 + nPixel % 250 ); break;
+                    case 2: image[ nPixel ] = ( x % 3 == 2 ) ? 0 : (uint8_t)( 1 + ( nPixel / 2 ) % 3 ); break;
+                    case 3: image[ nPixel ] = ( x % 5 == 0 ) ? 0 : (uint8_t)( 1 + ( x / 5 ) % 2 ); break;
+                    case 4: image[ nPixel ] = ( x == 0 ) ? 7 : 0; break;
+                    default: image[ nPixel ] = ( random() % 3 ) ? (uint8_t)( random() % 4 ) : 0; break;
+                }
+            }
+
+            tools.EncodeSpriteData( image, 64, 64, 16, 32, "bound", sprFile );
+
+            size_t header = std::string( (char*)sprFile.data(), sprFile.size() ).find( ":", 11 ) + 1;
+            size_t stream = sprFile.size() - header - 8 * sizeof( uint32_t );
+            CHECK( stream <= Tools::SpriteDataBound( 64, 64, 16, 32 ) );
+
+            // and it still decodes to the same pixels
+            const uint32_t* pOffsets  = (const uint32_t*)( sprFile.data() + header );
+            const uint8_t*  pStream   = sprFile.data() + header + 8 * sizeof( uint32_t );
+            uint32_t        fillCount = 0;
+            std::vector<uint8_t> sprite = DecodeSprite( pStream + pOffsets[ 5 ], 16, 32, fillCount );
+            for ( uint32_t y = 0; y < 32; y++ )
+            {
+                CHECK( std::equal( sprite.begin() + y * 16, sprite.begin() + y * 16 + 16, image.begin() + ( 32 + y ) * 64 + 16 ) );
+            }
+        }
+
+        // a cell bigger than the image is clipped to it, it neither wraps the
+        // cell count to 0 nor sizes the bound for the whole cell
+        std::vector<uint8_t> small( 20 * 10, 3 ), clipped;
+        tools.EncodeSpriteData( small, 20, 10, 20, 10, "bound", sprFile );
+        tools.EncodeSpriteData( small, 20, 10, UINT32_MAX, UINT32_MAX, "bound", clipped );
+        CHECK( Tools::SpriteDataBound( 20, 10, UINT32_MAX, 100000 ) == Tools::SpriteDataBound( 20, 10, 20, 10 ) );
+        std::string clippedText( clipped.begin(), clipped.end() ), cellText( sprFile.begin(), sprFile.end() );
+        CHECK( clippedText.starts_with( "SPRITEDATA:1," ) );
+        CHECK( clippedText.substr( clippedText.find( ':', 11 ) ) == cellText.substr( cellText.find( ':', 11 ) ) );
+
+        // decode and encode the same image repeatedly into reused buffers
+        std::string          pngName = ( std::filesystem::temp_directory_path() / "agl_steady.png" ).string();
+        std::vector<uint8_t> image( 60 * 180, 0 ), pngData;
+        for ( size_t nPixel = 0; nPixel < image.size(); nPixel += 3 )
+        {
+            image[ nPixel ] = (uint8_t)( 1 + nPixel % 9 );
+        }
+        WriteIndexedPNG( pngName, image, 60, 180 );
+        FileManager().OpenFile( pngName, pngData );
+        std::filesystem::remove( pngName );
+
+        DecodedImage               decoded;
+        std::vector<ConvertedFile> outputs;
+        decoded.fileName = "/a/long/path/name/that/does/not/fit/in/a/small/string.png";
+
+        for ( int nWarm = 0; nWarm < 2; nWarm++ )
+        {
+            REQUIRE( tools.Decode_PNG( pngData, decoded ) );
+            tools.Encode_Image( decoded, outputs );
+        }
+
+        uint64_t allocationsBefore = heapAllocations;
+        uint64_t blocksBefore      = Arena::getThreadArena().getBlockAllocations();
+
+        for ( int nImage = 0; nImage < 10; nImage++ )
+        {
+            tools.Decode_PNG( pngData, decoded );
+            tools.Encode_Image( decoded, outputs );
+        }
+
+        CHECK( heapAllocations == allocationsBefore );
+        CHECK( Arena::getThreadArena().getBlockAllocations() == blocksBefore );
+        CHECK( outputs[ 1 ].fileData == image );
+
+        // a header claiming a huge image is refused before the pixels are
+        // sized, and the arena is released for the next image
+        std::vector<uint8_t> hugeData;
+        WriteIndexedPNG( pngName, image, 60, 180 );
+        SetPNGSize( pngName, 1000000, 1000000 );
+        FileManager().OpenFile( pngName, hugeData );
+        std::filesystem::remove( pngName );
+        CHECK( tools.Decode_PNG( hugeData, decoded ) == false );
+        REQUIRE( tools.Decode_PNG( pngData, decoded ) );
+        CHECK( decoded.pixels == image );
+        CHECK( Arena::getThreadArena().getBlockAllocations() == blocksBefore );
+    }
+    //-----------------------------------------------------------------------------
+    TEST_CASE( "Image views encode sub rectangles in place" )
+    //-----------------------------------------------------------------------------
+    {
+        Tools&               tools = Tools::getInstance();
+        std::vector<uint8_t> sheet( 100 * 70 );
+        for ( size_t nPixel = 0; nPixel < sheet.size(); nPixel++ )
+        {
+            sheet[ nPixel ] = ( nPixel % 7 < 2 ) ? 0 : (uint8_t)( 1 + ( nPixel / 5 ) % 11 );
+        }
+
+        ImageView<uint8_t> view( sheet.data(), 100, 70 );
+        ImageView<uint8_t> cell = view.subView( 30, 20, 40, 30 );
+
+        CHECK( cell.getStride() == 100 );
+        CHECK( cell.isContiguous() == false );
+        CHECK( &cell.at( 0, 0 ) == &sheet[ 20 * 100 + 30 ] );
+        CHECK( cell.subView( 5, 6, 10, 10 ).getRow( 2 ) == &sheet[ ( 20 + 6 + 2 ) * 100 + 30 + 5 ] );
+
+        // sub views are clipped to their parent
+        ImageView<uint8_t> edge = view.subView( 90, 60, 32, 32 );
+        CHECK( edge.getWidth() == 10 );
+        CHECK( edge.getHeight() == 10 );
+        CHECK( view.subView( 200, 0, 4, 4 ).isEmpty() );
+        CHECK( view.rows( 65, 10 ).getHeight() == 5 );
+
+        // a view inside the sheet encodes the same as a copy of it
+        std::vector<uint8_t> copied, fromView, fromCopy;
+        cell.copyTo( copied );
+        tools.EncodeSpriteData( cell, 20, 15, "view", fromView );
+        tools.EncodeSpriteData( copied, 40, 30, 20, 15, "copy", fromCopy );
+        CHECK( fromView == fromCopy );
+
+        // cells hanging off the right and bottom edges are clipped, not read
+        // past the end of the sheet
+        std::vector<uint8_t> sprFile;
+        tools.EncodeSpriteData( view, 32, 32, "edges", sprFile );
+
+        size_t          header    = std::string( (char*)sprFile.data(), sprFile.size() ).find( ":", 11 ) + 1;
+        const uint32_t* pOffsets  = (const uint32_t*)( sprFile.data() + header );
+        const uint8_t*  pStream   = sprFile.data() + header + 12 * sizeof( uint32_t );
+        uint32_t        fillCount = 0;
+        std::vector<uint8_t> sprite = DecodeSprite( pStream + pOffsets[ 11 ], 32, 32, fillCount );
+        for ( uint32_t y = 0; y < 6; y++ )
+        {
+            CHECK( std::equal( sprite.begin() + y * 32, sprite.begin() + y * 32 + 4, sheet.begin() + ( 64 + y ) * 100 + 96 ) );
+        }
+        CHECK( std::all_of( sprite.begin() + 6 * 32, sprite.end(), []( uint8_t pixel ) { return pixel == 0; } ) );
+    }
+    //-----------------------------------------------------------------------------
+    TEST_CASE( "Connected component sprite slicing" )
+    //-----------------------------------------------------------------------------
+    {
+        const uint32_t       w = 200, h = 120;
+        std::vector<uint8_t> sheet( w * h, 0 );
+        auto fillRect = [ & ]( uint32_t x, uint32_t y, uint32_t rw, uint32_t rh, uint8_t colour ) {
+            for ( uint32_t py = y; py < y + rh; py++ )
+            {
+                std::memset( &sheet[ py * w + x ], colour, rw );
+            }
+        };
+
+        fillRect( 2, 3, 20, 30, 5 );   // block across two bands
+        fillRect( 40, 0, 4, 50, 6 );   // tall bar, the L's upright
+        fillRect( 40, 46, 30, 4, 6 );  // the L's foot
+        fillRect( 28, 10, 1, 1, 7 );   // detached dot 4 pixels right of the merged block, kept apart
+        fillRect( 23, 20, 1, 1, 7 );   // dot 1 pixel right of the block, merged into it
+        for ( uint32_t d = 0; d < 40; d++ )
+        {
+            sheet[ ( 60 + d ) * w + 100 + d ] = 9; // diagonal, 8 connected
+        }
+        fillRect( 150, 70, 30, 30, 3 );
+        fillRect( 160, 80, 10, 10, 0 ); // hollow square, still one sprite
+        fillRect( 190, 115, 1, 1, 2 );  // lone noise pixel
+
+        ImageView<const uint8_t> view( sheet.data(), w, h );
+        std::vector<SpriteRect>  inline1, parallel;
+
+        SpriteSlicer( SliceConfig{ .bandHeight = 7, .threadCount = 1 } ).slice( view, inline1 );
+        SpriteSlicer threaded( SliceConfig{ .bandHeight = 7, .threadCount = 4 } );
+        threaded.slice( view, parallel );
+
+        REQUIRE( parallel.size() == 6 );
+        CHECK( threaded.getComponentCount() == 7 );
+        CHECK( std::equal( inline1.begin(), inline1.end(), parallel.begin(), parallel.end(), []( const SpriteRect& a, const SpriteRect& b ) {
+            return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height && a.pixelCount == b.pixelCount;
+        } ) );
+
+        // reading order, top to bottom then left to right
+        CHECK( ( parallel[ 0 ].x == 40 && parallel[ 0 ].y == 0 && parallel[ 0 ].width == 30 && parallel[ 0 ].height == 50 ) );
+        CHECK( ( parallel[ 1 ].x == 2 && parallel[ 1 ].y == 3 && parallel[ 1 ].width == 22 && parallel[ 1 ].height == 30 ) );
+        CHECK( parallel[ 1 ].pixelCount == 20 * 30 + 1 );
+        CHECK( ( parallel[ 2 ].x == 28 && parallel[ 2 ].y == 10 && parallel[ 2 ].width == 1 ) );
+        CHECK( ( parallel[ 3 ].x == 100 && parallel[ 3 ].y == 60 && parallel[ 3 ].width == 40 && parallel[ 3 ].height == 40 ) );
+        CHECK( ( parallel[ 4 ].x == 150 && parallel[ 4 ].width == 30 && parallel[ 4 ].pixelCount == 800 ) );
+        CHECK( ( parallel[ 5 ].x == 190 && parallel[ 5 ].y == 115 ) );
+
+        // noise can be dropped
+        std::vector<SpriteRect> clean;
+        SpriteSlicer( SliceConfig{ .minPixels = 2 } ).slice( view, clean );
+        CHECK( clean.size() == 4 );
+
+        // one sprite per component, each decoding back to its rectangle of the sheet
+        std::vector<uint8_t> sprFile;
+        REQUIRE( Tools::getInstance().EncodeSpriteList( view, parallel, "slices", sprFile ) );
+
+        std::string header = std::string( (char*)sprFile.data(), 16 );
+        REQUIRE( header.starts_with( "SPRITELIST:6:" ) );
+
+        const uint8_t* pTable  = sprFile.data() + 13;
+        const uint8_t* pStream = pTable + 6 * 12;
+        for ( uint32_t nSprite = 0; nSprite < 6; nSprite++ )
+        {
+            uint32_t offset;
+            uint16_t position[ 4 ];
+            uint32_t fillCount = 0;
+            std::memcpy( &offset, pTable + nSprite * 12, sizeof( offset ) );
+            std::memcpy( position, pTable + nSprite * 12 + 4, sizeof( position ) );
+
+            CHECK( position[ 0 ] == parallel[ nSprite ].x );
+            CHECK( position[ 3 ] == parallel[ nSprite ].height );
+
+            std::vector<uint8_t> sprite = DecodeSprite( pStream + offset, position[ 2 ], position[ 3 ], fillCount );
+            std::vector<uint8_t> expected;
+            view.subView( position[ 0 ], position[ 1 ], position[ 2 ], position[ 3 ] ).copyTo( expected );
+            CHECK( sprite == expected );
+        }
+    }
+    //-----------------------------------------------------------------------------
+    TEST_CASE( "Atlas packing" )
+    //-----------------------------------------------------------------------------
+    {
+        std::mt19937            random( 42 );
+        std::vector<SpriteRect> sizes( 20000 );
+        for ( SpriteRect& size : sizes )
+        {
+            size = { 0, 0, 4 + (uint32_t)random() % 37, 4 + (uint32_t)random() % 37, 0 };
+        }
+
+        AtlasConfig config;
+        config.padding = 1;
+
+        AtlasPacker             packer( config );
+        std::vector<AtlasEntry> entries, repeat;
+        REQUIRE( packer.pack( sizes, entries ) );
+        REQUIRE( packer.pack( sizes, repeat ) );
+        CHECK( packer.getOccupancy() > 0.75 );
+
+        // same input, same atlas
+        CHECK( std::equal( entries.begin(), entries.end(), repeat.begin(), []( const AtlasEntry& a, const AtlasEntry& b ) {
+            return a.sheet == b.sheet && a.sheetIndex == b.sheetIndex && a.x == b.x && a.y == b.y;
+        } ) );
+
+        // every sprite inside its sheet, no two overlapping, padding included
+        std::vector<std::vector<uint8_t>> covered( packer.getSheetCount(), std::vector<uint8_t>( config.sheetWidth * config.sheetHeight, 0 ) );
+        std::vector<uint32_t>             sheetCounts( packer.getSheetCount(), 0 );
+        bool                              bOverlap = false;
+        for ( size_t nSprite = 0; nSprite < sizes.size(); nSprite++ )
+        {
+            const AtlasEntry& entry = entries[ nSprite ];
+            REQUIRE( entry.x + entry.width <= config.sheetWidth );
+            REQUIRE( entry.y + entry.height <= config.sheetHeight );
+            CHECK( entry.sheetIndex == sheetCounts[ entry.sheet ]++ );
+
+            for ( uint32_t y = entry.y; y < std::min( entry.y + entry.height + 1, config.sheetHeight ); y++ )
+            {
+                for ( uint32_t x = entry.x; x < std::min( entry.x + entry.width + 1, config.sheetWidth ); x++ )
+                {
+                    bOverlap |= covered[ entry.sheet ][ y * config.sheetWidth + x ]++ != 0;
+                }
+            }
+        }
+        CHECK( bOverlap == false );
+
+        // a sprite bigger than a sheet is refused
+        CHECK( packer.pack( { { 0, 0, 400, 10, 0 } }, entries ) == false );
+
+        // build trims the sprites and draws them onto the sheets
+        std::vector<uint8_t> frames( 3 * 24 * 24, 0 );
+        for ( uint32_t nFrame = 0; nFrame < 3; nFrame++ )
+        {
+            for ( uint32_t y = 4 + nFrame; y < 20; y++ )
+            {
+                for ( uint32_t x = 6; x < 18 - nFrame; x++ )
+                {
+                    frames[ ( nFrame * 24 + y ) * 24 + x ] = (uint8_t)( 1 + ( x * y + nFrame ) % 13 );
+                }
+            }
+        }
+
+        ImageView<const uint8_t>              strip( frames.data(), 24, 72 );
+        std::vector<ImageView<const uint8_t>> sprites = { strip.rows( 0, 24 ), strip.rows( 24, 24 ), strip.rows( 48, 24 ), strip.rows( 0, 0 ) };
+        std::vector<std::vector<uint8_t>>     sheets;
+        AtlasPacker                           builder;
+
+        REQUIRE( builder.build( sprites, sheets, entries ) );
+        REQUIRE( sheets.size() == 1 );
+        CHECK( ( entries[ 1 ].trimX == 6 && entries[ 1 ].trimY == 5 && entries[ 1 ].width == 11 && entries[ 1 ].height == 15 ) );
+        CHECK( ( entries[ 1 ].sourceWidth == 24 && entries[ 1 ].sourceHeight == 24 ) );
+        CHECK( entries[ 3 ].width == 0 );
+
+        ImageView<const uint8_t> sheet( sheets[ 0 ].data(), AtlasConfig().sheetWidth, builder.getSheetHeight( 0 ) );
+        for ( uint32_t nFrame = 0; nFrame < 3; nFrame++ )
+        {
+            std::vector<uint8_t> packed, source;
+            sheet.subView( entries[ nFrame ].x, entries[ nFrame ].y, entries[ nFrame ].width, entries[ nFrame ].height ).copyTo( packed );
+            sprites[ nFrame ].subView( entries[ nFrame ].trimX, entries[ nFrame ].trimY, entries[ nFrame ].width, entries[ nFrame ].height ).copyTo( source );
+            CHECK( packed == source );
+        }
+
+        std::vector<uint8_t> table;
+        REQUIRE( builder.buildTable( entries, table ) );
+        CHECK( table.size() == std::string( "ATLAS:4,1:" ).size() + 4 * 10 * sizeof( uint16_t ) );
+
+        // 16 bit table fields are refused rather than wrapped
+        std::vector<AtlasEntry> farEntries = entries;
+        farEntries[ 2 ].y = 70000;
+        CHECK( builder.buildTable( farEntries, table ) == false );
+        CHECK( table.empty() );
+
+        std::vector<uint8_t>     wide( 70000 * 2, 1 ), sprFile;
+        std::vector<SpriteRect>  farSprites = { { 0, 0, 4, 2, 0 }, { 69990, 0, 4, 2, 0 } };
+        ImageView<const uint8_t> wideView( wide.data(), 70000, 2 );
+        CHECK( Tools::getInstance().EncodeSpriteList( wideView, farSprites, "wide", sprFile ) == false );
+        CHECK( sprFile.empty() );
+    }
+    //-----------------------------------------------------------------------------
+    TEST_CASE( "Width specialised encoders match the generic encoder" )
+    //-----------------------------------------------------------------------------
+    {
+        Tools&       tools = Tools::getInstance();
+        std::mt19937 random( 99 );
+
+        for ( uint32_t width : { 16u, 32u, 60u, 64u } )
+        {
+            for ( uint32_t density = 0; density <= 4; density++ )
+            {
+                // density 0 is empty, 4 is solid, with runs of 1 to 12 pixels
+                std::vector<uint8_t> pixels( width * 40, 0 );
+                for ( size_t nPixel = 0; nPixel < pixels.size(); )
+                {
+                    uint32_t runLen = 1 + random() % 12;
+                    uint8_t  colour = ( random() % 4 ) < density ? (uint8_t)( 1 + random() % 3 ) : 0;
+                    for ( ; runLen && nPixel < pixels.size(); runLen--, nPixel++ )
+                    {
+                        pixels[ nPixel ] = colour;
+                    }
+                }
+
+                ImageView<const uint8_t> cell( pixels.data(), width, 40 );
+                std::vector<uint8_t>     generic( Tools::SpriteDataBound( width, 40, width, 40 ) );
+                std::vector<uint8_t>     fixed( generic.size() );
+                uint64_t                 genericCounts[ (size_t)MetricCounter::TotalCounters ] = { 0 };
+                uint64_t                 fixedCounts[ (size_t)MetricCounter::TotalCounters ]   = { 0 };
+
+                size_t genericLen = tools.EncodeSpriteCell( cell, generic.data(), genericCounts, false ) - generic.data();
+                size_t fixedLen   = tools.EncodeSpriteCell( cell, fixed.data(), fixedCounts, true ) - fixed.data();
+
+                CHECK( fixedLen == genericLen );
+                CHECK( std::equal( generic.begin(), generic.begin() + genericLen, fixed.begin() ) );
+                CHECK( std::equal( std::begin( genericCounts ), std::end( genericCounts ), std::begin( fixedCounts ) ) );
+            }
+        }
+    }
+    //-----------------------------------------------------------------------------
+    TEST_CASE( "Conversion server" )
+    //-----------------------------------------------------------------------------
+    {
+#if defined( __linux__ )
+        std::filesystem::path root = std::filesystem::temp_directory_path() / "agl_server_test";
+        std::filesystem::remove_all( root );
+        std::filesystem::create_directories( root );
+
+        // a and b hold the same image under different names, c another
+        std::vector<uint8_t> image( 60 * 120, 0 ), other( 60 * 120, 0 );
+        for ( size_t nPixel = 0; nPixel < image.size(); nPixel += 5 )
+        {
+            image[ nPixel ] = (uint8_t)( 1 + nPixel % 31 );
+            other[ nPixel ] = (uint8_t)( 1 + nPixel % 17 );
+        }
+        std::string a = ( root / "a.png" ).string(), b = ( root / "b.png" ).string(), c = ( root / "c.png" ).string();
+        WriteIndexedPNG( a, image, 60, 120 );
+        WriteIndexedPNG( b, image, 60, 120 );
+        WriteIndexedPNG( c, other, 60, 120 );
+
+        ServerConfig config;
+        config.socketPath        = ( root / "agl.sock" ).string();
+        config.connectionThreads = 2;
+
+        ConvertServer server( config );
+        REQUIRE( server.start() );
+
+        // a second server leaves the running one alone
+        ConvertServer second( config );
+        CHECK( second.start() == false );
+
+        std::thread   serving( [ &server ]() { while ( server.serve( 20 ) ) {} } );
+        ConvertClient client;
+        std::string   reply;
+
+        REQUIRE( client.connect( config.socketPath ) );
+        REQUIRE( client.request( "CONVERT 60 60 " + a, reply ) );
+        CHECK( reply.starts_with( "OK" ) );
+        CHECK( reply.find( "DEDUP" ) == std::string::npos );
+        REQUIRE( client.request( "CONVERT 60 60 " + b, reply ) );
+        CHECK( reply.ends_with( "DEDUP" ) );
+        REQUIRE( client.request( "CONVERT 60 60 " + c, reply ) );
+        CHECK( reply.find( "DEDUP" ) == std::string::npos );
+        REQUIRE( client.request( "CONVERT 60 60 " + ( root / "missing.png" ).string(), reply ) );
+        CHECK( reply.starts_with( "FAIL" ) );
+        REQUIRE( client.request( "BOGUS", reply ) );
+        CHECK( reply.starts_with( "FAIL" ) );
+
+        // a negative size is refused before converting, a size larger than the
+        // image and a PNG claiming to be huge fail their jobs, not the connection
+        std::string huge = ( root / "huge.png" ).string();
+        WriteIndexedPNG( huge, other, 60, 120 );
+        SetPNGSize( huge, 1000000, 1000000 );
+        REQUIRE( client.request( "CONVERT -1 60 " + a, reply ) );
+        CHECK( reply.starts_with( "FAIL" ) );
+        REQUIRE( client.request( "CONVERT 61 60 " + c, reply ) );
+        CHECK( reply.starts_with( "FAIL" ) );
+        REQUIRE( client.request( "CONVERT 60 60 " + huge, reply ) );
+        CHECK( reply.starts_with( "FAIL" ) );
+
+        // the deduplicated outputs match a real conversion
+        FileManager          fileManager;
+        std::vector<uint8_t> raw, spr, expected;
+        Tools::getInstance().EncodeSpriteData( image, 60, 120, 60, 60, b, expected );
+        REQUIRE( fileManager.OpenFile( b + "-60-120.RAW", raw ) );
+        REQUIRE( fileManager.OpenFile( b + ".SPR", spr ) );
+        CHECK( raw == image );
+        CHECK( spr == expected );
+        CHECK( std::filesystem::exists( b + ".PAL" ) );
+
+        // a second client shares the warm server
+        ConvertClient secondClient;
+        REQUIRE( secondClient.connect( config.socketPath ) );
+        REQUIRE( secondClient.request( "CONVERT 60 60 " + c, reply ) );
+        CHECK( reply.ends_with( "DEDUP" ) );
+        REQUIRE( secondClient.request( "STATS", reply ) );
+        CHECK( reply.find( "jobs=7 failed=3 dedupHits=2" ) != std::string::npos );
+
+        REQUIRE( client.request( "SHUTDOWN", reply ) );
+        CHECK( reply == "OK" );
+        serving.join();
+        server.stop();
+
+        CHECK( std::filesystem::exists( config.socketPath ) == false );
+        CHECK( client.request( "STATS", reply ) == false );
+
+        std::filesystem::remove_all( root );
+#endif
+    }
+    //-----------------------------------------------------------------------------
+    TEST_CASE( "Job manifest" )
+    //-----------------------------------------------------------------------------
+    {
+        std::filesystem::path root = std::filesystem::temp_directory_path() / "agl_manifest_test";
+        std::filesystem::remove_all( root );
+        std::filesystem::create_directories( root / "art" );
+
+        std::vector<uint8_t> image( 60 * 120, 0 );
+        for ( size_t nPixel = 0; nPixel < image.size(); nPixel += 3 )
+        {
+            image[ nPixel ] = (uint8_t)( 1 + nPixel % 29 );
+        }
+        WriteIndexedPNG( ( root / "art" / "hero.png" ).string(), image, 60, 120 );
+
+        // relative paths come from the manifest folder, bad lines are skipped
+        JobManifest manifest( 2 );
+        CHECK( manifest.parse( "# sprites\n"
+                               "\n"
+                               "art/hero.png\n"
+                               "\"art/hero.png\"  60x60  spr,pal  out/sprites\n"
+                               "art/hero.png  60by60\n"
+                               "art/hero.png  60x60  bmp\n"
+                               "art/missing.png  16x16  raw\n",
+                               root.string() ) == false );
+
+        const std::vector<ManifestJob>& jobs = manifest.getJobs();
+        REQUIRE( jobs.size() == 3 );
+        CHECK( jobs[ 0 ].line == 3 );
+        CHECK( jobs[ 0 ].input == ( root / "art/hero.png" ).string() );
+        CHECK( jobs[ 0 ].sprW == 0 );
+        CHECK( jobs[ 0 ].formats == OutputAll );
+        CHECK( jobs[ 1 ].sprW == 60 );
+        CHECK( jobs[ 1 ].sprH == 60 );
+        CHECK( jobs[ 1 ].formats == ( OutputSprites | OutputPalette ) );
+        CHECK( jobs[ 1 ].destination == ( root / "out/sprites" ).string() );
+        CHECK( jobs[ 2 ].line == 7 );
+        CHECK( jobs[ 2 ].formats == OutputRaw );
+
+        CHECK( manifest.run() == 1 );
+
+        // results stay in manifest order, the outputs carry their CRC-32
+        const std::vector<ManifestResult>& results = manifest.getResults();
+        REQUIRE( results.size() == 3 );
+        CHECK( results[ 0 ].bConverted );
+        CHECK( results[ 0 ].outputs.size() == 3 );
+        REQUIRE( results[ 1 ].bConverted );
+        REQUIRE( results[ 1 ].outputs.size() == 2 );
+        CHECK( results[ 1 ].outputs[ 0 ].fileName == ( root / "out/sprites/hero.png.PAL" ).string() );
+        CHECK( results[ 1 ].outputs[ 1 ].fileName == ( root / "out/sprites/hero.png.SPR" ).string() );
+        CHECK( results[ 2 ].bConverted == false );
+        CHECK( results[ 2 ].outputs.empty() );
+
+        FileManager fileManager;
+        for ( const ManifestOutput& output : results[ 1 ].outputs )
+        {
+            std::vector<uint8_t> data;
+            REQUIRE( fileManager.OpenFile( output.fileName, data ) );
+            CHECK( data.size() == output.size );
+
+            uint32_t crc = 0xFFFFFFFF;
+            for ( uint8_t byte : data )
+            {
+                crc ^= byte;
+                for ( int nBit = 0; nBit < 8; nBit++ )
+                {
+                    crc = ( crc >> 1 ) ^ ( 0xEDB88320 & ( 0 - ( crc & 1 ) ) );
+                }
+            }
+            CHECK( ( crc ^ 0xFFFFFFFF ) == output.crc32 );
+        }
+        CHECK( std::filesystem::exists( root / "out/sprites/hero.png-60-120.RAW" ) == false );
+
+        // jobs writing the same file are refused, other outputs of the same base are not
+        JobManifest clashing( 1 );
+        CHECK( clashing.parse( "art/hero.png  60x60  spr\n"
+                               "art/hero.png  30x30  spr,pal\n"
+                               "art/hero.png  30x30  pal\n"
+                               "art/hero.png  30x30  raw  out\n"
+                               "other/hero.png  auto  raw  out/./\n",
+                               root.string() ) == false );
+        REQUIRE( clashing.getJobs().size() == 3 );
+        CHECK( clashing.getJobs()[ 0 ].line == 1 );
+        CHECK( clashing.getJobs()[ 1 ].line == 3 );
+        CHECK( clashing.getJobs()[ 2 ].line == 4 );
+
+        // cell sizes are whole, positive and no larger than the image, and a
+        // PNG claiming to be huge fails its job with an error
+        std::string huge = ( root / "art" / "huge.png" ).string();
+        WriteIndexedPNG( huge, image, 60, 120 );
+        SetPNGSize( huge, 1000000, 1000000 );
+
+        JobManifest sizes( 1 );
+        CHECK( sizes.parse( "art/hero.png  -1x-1  spr\n"
+                            "art/hero.png  60x0  spr\n"
+                            "art/hero.png  4294967296x60  spr\n"
+                            "art/hero.png  61x60  spr  big\n"
+                            "art/huge.png  16x16  spr\n",
+                            root.string() ) == false );
+        REQUIRE( sizes.getJobs().size() == 2 );
+        CHECK( sizes.getJobs()[ 0 ].line == 4 );
+        CHECK( sizes.run() == 2 );
+        CHECK( sizes.getResults()[ 0 ].error == "cell size 61x60 is larger than the image" );
+        CHECK( sizes.getResults()[ 1 ].error == "not an 8 bit indexed PNG or too large" );
+
+        REQUIRE( manifest.saveResults( ( root / "jobs.results.json" ).string() ) );
+        std::vector<uint8_t> json;
+        REQUIRE( fileManager.OpenFile( ( root / "jobs.results.json" ).string(), json ) );
+        std::string jsonText( json.begin(), json.end() );
+        CHECK( jsonText.find( "\"jobs\": 3" ) != std::string::npos );
+        CHECK( jsonText.find( "\"failed\": 1" ) != std::string::npos );
+        CHECK( jsonText.find( "\"cell\": \"60x60\"" ) != std::string::npos );
+
+        std::filesystem::remove_all( root );
+    }
+    //-----------------------------------------------------------------------------
+    TEST_CASE( "In memory conversion" )
+    //-----------------------------------------------------------------------------
+    {
+        Tools&                tools = Tools::getInstance();
+        std::filesystem::path root  = std::filesystem::temp_directory_path() / "agl_memory_test";
+        std::filesystem::remove_all( root );
+        std::filesystem::create_directories( root );
+
+        std::vector<uint8_t> image( 64 * 96, 0 );
+        for ( size_t nPixel = 0; nPixel < image.size(); nPixel += 4 )
+        {
+            image[ nPixel ] = (uint8_t)( 1 + nPixel % 23 );
+        }
+        std::string pngName = ( root / "sheet.png" ).string();
+        WriteIndexedPNG( pngName, image, 64, 96 );
+
+        FileManager          fileManager;
+        std::vector<uint8_t> pngData, expected;
+        REQUIRE( fileManager.OpenFile( pngName, pngData ) );
+
+        // nothing is written, the buffers match the files Encode_Image() names
+        ConvertedImage converted;
+        REQUIRE( tools.Convert_PNG( pngData.data(), pngData.size(), converted, 32, 32 ) );
+        CHECK( converted.width == 64 );
+        CHECK( converted.height == 96 );
+        CHECK( converted.palette.size() == 256 );
+        CHECK( converted.raw == image );
+        tools.EncodeSpriteData( image, 64, 96, 32, 32, pngName, expected );
+        CHECK( converted.sprites == expected );
+        tools.Build_ApolloV4_Palette( converted.palette, expected );
+        CHECK( converted.paletteData == expected );
+        CHECK( std::distance( std::filesystem::directory_iterator( root ), std::filesystem::directory_iterator() ) == 1 );
+
+        // outputs not asked for stay empty, bad data is refused
+        REQUIRE( tools.Convert_PNG( pngData, converted, 0, 0, OutputSprites ) );
+        CHECK( converted.raw.empty() );
+        CHECK( converted.paletteData.empty() );
+        CHECK( memcmp( converted.sprites.data(), "SPRITELIST:", 11 ) == 0 );
+        std::vector<uint8_t> truncated( pngData.begin(), pngData.begin() + pngData.size() / 2 );
+        CHECK( tools.Convert_PNG( truncated, converted ) == false );
+
+        // writing is a separate step
+        REQUIRE( tools.Convert_PNG( pngData, converted, 32, 32 ) );
+        tools.Save_Converted( converted, ( root / "out" ).string() );
+        std::vector<uint8_t> raw;
+        REQUIRE( fileManager.OpenFile( ( root / "out-64-96.RAW" ).string(), raw ) );
+        CHECK( raw == image );
+        CHECK( std::filesystem::exists( root / "out.PAL" ) );
+        CHECK( std::filesystem::exists( root / "out.SPR" ) );
+
+        // truecolour buffers hold the same pixels as the files Encode_Image() builds
+        DecodedImage               decoded;
+        std::vector<ConvertedFile> outputs;
+        REQUIRE( tools.Convert_PNG( pngData, converted, 0, 0, OutputRgb565 | OutputArgb32 ) );
+        REQUIRE( tools.Decode_PNG( pngData, decoded ) );
+        tools.Encode_Image( decoded, outputs, 0, 0, OutputRgb565 | OutputArgb32 );
+        REQUIRE( outputs.size() == 2 );
+        CHECK( converted.rgb565 == outputs[ 0 ].fileData );
+        CHECK( converted.argb32 == outputs[ 1 ].fileData );
+        CHECK( converted.raw.empty() );
+        tools.Save_Converted( converted, ( root / "out" ).string() );
+        CHECK( std::filesystem::file_size( root / "out-64-96.565" ) == 64 * 96 * 2 );
+        CHECK( std::filesystem::file_size( root / "out-64-96.ARGB" ) == 64 * 96 * 4 );
+
+        std::filesystem::remove_all( root );
+    }
+    //-----------------------------------------------------------------------------
+    TEST_CASE( "Palette store" )
+    //-----------------------------------------------------------------------------
+    {
+        std::filesystem::path root = std::filesystem::temp_directory_path() / "agl_palette_test";
+        std::filesystem::remove_all( root );
+        std::filesystem::create_directories( root );
+
+        std::vector<png_color> grey( 256 ), warm( 256 );
+        for ( int nColour = 0; nColour < 256; nColour++ )
+        {
+            grey[ nColour ] = { (png_byte)nColour, (png_byte)nColour, (png_byte)nColour };
+            warm[ nColour ] = { (png_byte)nColour, (png_byte)( nColour / 2 ), 0 };
+        }
+
+        // a shared palette is written once and keeps its ID
+        uint64_t     greyId, warmId, sameId;
+        PaletteStore store( ( root / "palettes" ).string() );
+        REQUIRE( store.add( grey, "c.SPR", greyId ) );
+        REQUIRE( store.add( warm, "a.SPR", warmId ) );
+        REQUIRE( store.add( grey, "b.SPR", sameId ) );
+        CHECK( greyId == sameId );
+        CHECK( greyId != warmId );
+        CHECK( store.getPaletteCount() == 2 );
+        CHECK( store.getWriteCount() == 2 );
+
+        FileManager          fileManager;
+        std::vector<uint8_t> data, expected;
+        REQUIRE( fileManager.OpenFile( store.getFileName( greyId ), data ) );
+        Tools::getInstance().Build_ApolloV4_Palette( grey, expected );
+        CHECK( data == expected );
+
+        // the index is sorted by output name
+        REQUIRE( store.saveIndex() );
+        REQUIRE( fileManager.OpenFile( store.getIndexName(), data ) );
+        std::string index( data.begin(), data.end() );
+        std::string greyHex = std::filesystem::path( store.getFileName( greyId ) ).stem().string().substr( 8 );
+        CHECK( index.starts_with( "a.SPR " ) );
+        CHECK( index.find( "b.SPR " + greyHex + "\nc.SPR " + greyHex + "\n" ) != std::string::npos );
+
+        // adding an output again replaces its palette, one line per output
+        std::string warmHex = std::filesystem::path( store.getFileName( warmId ) ).stem().string().substr( 8 );
+        REQUIRE( store.add( warm, "c.SPR", sameId ) );
+        REQUIRE( store.saveIndex() );
+        REQUIRE( fileManager.OpenFile( store.getIndexName(), data ) );
+        index.assign( data.begin(), data.end() );
+        CHECK( std::count( index.begin(), index.end(), '\n' ) == 3 );
+        CHECK( index.ends_with( "c.SPR " + warmHex + "\n" ) );
+
+        // a palette whose file cannot be written is not stored or indexed
+        std::ofstream( root / "blocked" ) << "a file, not a folder";
+        PaletteStore blocked( ( root / "blocked" ).string() );
+        CHECK( blocked.add( grey, "f.SPR", sameId ) == false );
+        CHECK( blocked.getPaletteCount() == 0 );
+
+        // the palette files are named by content, a later run does not rewrite them
+        PaletteStore later( ( root / "palettes" ).string() );
+        REQUIRE( later.add( grey, "d.SPR", sameId ) );
+        CHECK( sameId == greyId );
+        CHECK( later.getWriteCount() == 0 );
+
+        // a file of the right size holding something else is rewritten
+        std::vector<uint8_t> stale( expected.size(), 0xAA );
+        std::ofstream( store.getFileName( greyId ), std::ios::binary ).write( (const char*)stale.data(), stale.size() );
+        PaletteStore repair( ( root / "palettes" ).string() );
+        REQUIRE( repair.add( grey, "e.SPR", sameId ) );
+        CHECK( repair.getWriteCount() == 1 );
+        REQUIRE( fileManager.OpenFile( store.getFileName( greyId ), data ) );
+        CHECK( data == expected );
+
+        // the pipeline hands the palettes to the store instead of writing a .PAL per image
+        std::vector<uint8_t> image( 32 * 32, 3 );
+        for ( int nImage = 0; nImage < 6; nImage++ )
+        {
+            WriteIndexedPNG( ( root / ( "img" + std::to_string( nImage ) + ".png" ) ).string(), image, 32, 32 );
+        }
+
+        PaletteStore   batchStore( root.string() );
+        PipelineConfig config;
+        config.spriteWidth  = 16;
+        config.spriteHeight = 16;
+        config.paletteStore = &batchStore;
+
+        ConvertPipeline      pipeline( config );
+        Channel<std::string> pngFiles( 8 );
+        std::thread          walker( [ & ]() { fileManager.walkFiles( root.string(), { ".png" }, pngFiles ); } );
+        CHECK( pipeline.run( pngFiles ) == 6 );
+        walker.join();
+
+        CHECK( batchStore.getPaletteCount() == 1 );
+        CHECK( batchStore.getWriteCount() == 1 );
+        CHECK( std::filesystem::exists( root / "img0.png.SPR" ) );
+        CHECK( std::filesystem::exists( root / "img0.png.PAL" ) == false );
+
+        std::filesystem::remove_all( root );
+    }
+    //-----------------------------------------------------------------------------
+    TEST_CASE( "PNG encoder options and parallel bands" )
+    //-----------------------------------------------------------------------------
+    {
+        Tools&       tools = Tools::getInstance();
+        DecodedImage image, decoded;
+        image.width  = 203;
+        image.height = 517;
+        image.palette.resize( 40 );
+        image.transparency = { 0, 128 };
+        for ( size_t nColour = 0; nColour < image.palette.size(); nColour++ )
+        {
+            image.palette[ nColour ] = { (png_byte)( nColour * 6 ), (png_byte)( 255 - nColour ), (png_byte)( nColour * 3 ) };
+        }
+        image.pixels.resize( image.width * image.height );
+        for ( size_t nPixel = 0; nPixel < image.pixels.size(); nPixel++ )
+        {
+            image.pixels[ nPixel ] = ( nPixel / 7 ) % 5 ? (uint8_t)( ( nPixel / image.width + nPixel % image.width / 9 ) % 40 ) : 0;
+        }
+
+        // every filter and strategy round trips through libpng
+        std::vector<uint8_t> pngData, single, banded;
+        for ( PngFilter filter : { PngFilter::None, PngFilter::Sub, PngFilter::Up, PngFilter::Average, PngFilter::Paeth, PngFilter::MinSum, PngFilter::Fast } )
+        {
+            PngEncodeOptions options;
+            options.filter       = filter;
+            options.zlibStrategy = filter == PngFilter::Fast ? Z_RLE : Z_DEFAULT_STRATEGY;
+
+            REQUIRE( tools.Encode_PNG( image, pngData, options ) );
+            REQUIRE( tools.Decode_PNG( pngData, decoded ) );
+            CHECK( decoded.pixels == image.pixels );
+            CHECK( decoded.transparency == image.transparency );
+            CHECK( memcmp( decoded.palette.data(), image.palette.data(), 40 * sizeof( png_color ) ) == 0 );
+        }
+
+        // bands joined into one stream, the same file with or without a pool
+        ThreadPool       pool( 3 );
+        PngEncodeOptions options;
+        options.bandRows  = 50;
+        options.zlibLevel = 9;
+        REQUIRE( tools.Encode_PNG( image, single, options ) );
+        options.pool = &pool;
+        REQUIRE( tools.Encode_PNG( image, banded, options ) );
+        CHECK( banded == single );
+        REQUIRE( tools.Decode_PNG( banded, decoded ) );
+        CHECK( decoded.pixels == image.pixels );
+
+        // a rewrite of an unchanged image leaves the file alone
+        std::filesystem::path root = std::filesystem::temp_directory_path() / "agl_encode_test";
+        std::filesystem::remove_all( root );
+        std::filesystem::create_directories( root );
+        std::string pngName = ( root / "sheet.png" ).string();
+        std::string outName = ( root / "copy.png" ).string();
+        WriteIndexedPNG( pngName, std::vector<uint8_t>( image.pixels.begin(), image.pixels.begin() + 64 * 64 ), 64, 64 );
+
+        tools.Read_PNG( pngName.c_str(), 16, 16 );
+        auto written = std::filesystem::last_write_time( pngName );
+        uint64_t size = std::filesystem::file_size( pngName );
+        std::filesystem::last_write_time( pngName, written - std::chrono::hours( 1 ) );
+        tools.Write_PNG( pngName.c_str() );
+        CHECK( std::filesystem::last_write_time( pngName ) == written - std::chrono::hours( 1 ) );
+        CHECK( std::filesystem::file_size( pngName ) == size );
+
+        tools.Write_PNG( outName.c_str(), PngEncodeOptions{ .zlibLevel = 1, .filter = PngFilter::Fast } );
+        FileManager fileManager;
+        REQUIRE( fileManager.OpenFile( outName, pngData ) );
+        REQUIRE( tools.Decode_PNG( pngData, decoded ) );
+        CHECK( decoded.width == 64 );
+        CHECK( memcmp( decoded.pixels.data(), image.pixels.data(), 64 ) == 0 );
+
+        std::filesystem::remove_all( root );
+    }
+    //-----------------------------------------------------------------------------
+    TEST_CASE( "Hardware sprites" )
+    //-----------------------------------------------------------------------------
+    {
+        // a 3 colour cell, a 5 colour cell, a cell too wide for the channels and one with too many colours
+        const uint32_t       sheetW = 160, sheetH = 24;
+        std::vector<uint8_t> sheet( sheetW * sheetH, 0 );
+        for ( uint32_t y = 4; y < 20; y++ )
+        {
+            for ( uint32_t x = 0; x < 20; x++ )
+            {
+                sheet[ y * sheetW + x ]      = ( x + y ) % 4 ? (uint8_t)( 30 + ( x + y ) % 4 ) : 0;
+                sheet[ y * sheetW + 24 + x ] = (uint8_t)( 9 + x % 5 );
+                sheet[ y * sheetW + 56 + x ] = (uint8_t)( 1 + ( x + y ) % 16 );
+            }
+        }
+        for ( uint32_t x = 80; x < 160; x++ )
+        {
+            sheet[ 10 * sheetW + x ] = (uint8_t)( 1 + x % 2 );
+        }
+
+        ImageView<const uint8_t>        view( sheet.data(), sheetW, sheetH );
+        std::vector<SpriteRect>         cells = { { 0, 0, 20, 24, 0 }, { 24, 0, 20, 24, 0 }, { 56, 0, 20, 24, 0 }, { 80, 0, 80, 24, 0 } };
+        std::vector<uint8_t>            hwsFile;
+        std::vector<HardwareSpriteCell> report;
+
+        HardwareSpriteEncoder encoder;
+        REQUIRE( encoder.encode( view, cells, hwsFile, report ) );
+        REQUIRE( report.size() == 4 );
+
+        CHECK( report[ 0 ].colours == 3 );
+        CHECK( report[ 0 ].bAttached == false );
+        CHECK( report[ 0 ].firstLine == 4 );
+        CHECK( report[ 0 ].lines == 16 );
+        CHECK( report[ 0 ].channels == 2 );
+        CHECK( report[ 0 ].bFits );
+
+        CHECK( report[ 1 ].colours == 5 );
+        CHECK( report[ 1 ].bAttached );
+        CHECK( report[ 1 ].channels == 4 );
+        CHECK( report[ 1 ].colourMap[ 1 ] == 9 );
+        CHECK( report[ 1 ].bFits );
+
+        CHECK( report[ 2 ].colours == 16 );
+        CHECK( report[ 2 ].bFits == false );
+        CHECK( report[ 2 ].dataSize == 0 );
+
+        CHECK( report[ 3 ].lines == 1 );
+        CHECK( report[ 3 ].channels == 5 );
+        CHECK( report[ 3 ].bFits );
+
+        // rebuild every pixel from the DMA lists and the colour maps
+        const char* pHeader = "HWSPRITE:4,16:";
+        REQUIRE( memcmp( hwsFile.data(), pHeader, strlen( pHeader ) ) == 0 );
+        const uint8_t* pTable = hwsFile.data() + strlen( pHeader );
+        const uint8_t* pData  = pTable + 4 * HardwareSpriteEncoder::HWS_ENTRY;
+
+        for ( uint32_t nCell : { 0u, 1u, 3u } )
+        {
+            const HardwareSpriteCell& cell = report[ nCell ];
+            uint32_t                  offset;
+            memcpy( &offset, pTable + nCell * HardwareSpriteEncoder::HWS_ENTRY, sizeof( offset ) );
+
+            const uint8_t* pMap    = pData + offset;
+            const uint8_t* pSprite = pMap + 16;
+            uint32_t       listLen = ( cell.lines + 2 ) * 4;
+            for ( uint32_t nStrip = 0; nStrip < cell.strips; nStrip++ )
+            {
+                const uint8_t* pEven = pSprite + nStrip * listLen * ( cell.bAttached ? 2 : 1 );
+                const uint8_t* pOdd  = pEven + listLen;
+                CHECK( pEven[ 2 ] == cell.lines );
+                CHECK( pEven[ 3 ] == 0 );
+                if ( cell.bAttached )
+                {
+                    CHECK( pOdd[ 3 ] == 0x80 );
+                }
+
+                for ( uint32_t y = 0; y < cell.lines; y++ )
+                {
+                    for ( uint32_t x = nStrip * 16; x < std::min( nStrip * 16 + 16, cell.width ); x++ )
+                    {
+                        uint32_t byte  = 4 + y * 4 + ( x % 16 ) / 8;
+                        uint8_t  bit   = 0x80 >> ( x % 8 );
+                        uint32_t value = ( pEven[ byte ] & bit ? 1 : 0 ) | ( pEven[ byte + 2 ] & bit ? 2 : 0 );
+                        if ( cell.bAttached )
+                        {
+                            value |= ( pOdd[ byte ] & bit ? 4 : 0 ) | ( pOdd[ byte + 2 ] & bit ? 8 : 0 );
+                        }
+                        CHECK( ( value ? pMap[ value ] : 0 ) == view.at( cell.x + x, cell.y + cell.firstLine + y ) );
+                    }
+                }
+            }
+        }
+
+        // AGA widths need fewer strips, other widths are refused
+        HardwareSpriteEncoder wide( HardwareSpriteConfig{ .fetchWidth = 64 } );
+        REQUIRE( wide.encode( view, cells, hwsFile, report ) );
+        CHECK( report[ 3 ].channels == 2 );
+        CHECK( report[ 1 ].dataSize == 2 * ( 16 + 2 ) * 16 );
+
+        HardwareSpriteEncoder odd( HardwareSpriteConfig{ .fetchWidth = 24 } );
+        CHECK( odd.encode( view, cells, hwsFile, report ) == false );
+
+        std::vector<SpriteRect> grid;
+        SpriteSlicer::GridCells( 50, 30, 16, 16, grid );
+        CHECK( grid.size() == 8 );
+        CHECK( grid.back().width == 2 );
+        CHECK( grid.back().height == 14 );
+    }
+    //-----------------------------------------------------------------------------
+    TEST_CASE( "Pre-shifted planar sprites" )
+    //-----------------------------------------------------------------------------
+    {
+        // the same 20x10 sprite twice, 3 planes of colour
+        const uint32_t       sheetW = 48, sheetH = 10;
+        std::vector<uint8_t> sheet( sheetW * sheetH, 0 );
+        for ( uint32_t y = 0; y < sheetH; y++ )
+        {
+            for ( uint32_t x = 0; x < 20; x++ )
+            {
+                uint8_t colour = ( x * 3 + y ) % 7 ? (uint8_t)( ( x + y ) % 8 ) : 0;
+                sheet[ y * sheetW + x ]      = colour;
+                sheet[ y * sheetW + 24 + x ] = colour;
+            }
+        }
+
+        ImageView<const uint8_t> view( sheet.data(), sheetW, sheetH );
+        std::vector<SpriteRect>  sprites = { { 0, 0, 20, 10, 0 }, { 24, 0, 20, 10, 0 } };
+        std::vector<uint8_t>     plnFile;
+
+        PlanarSpriteEncoder encoder( PlanarConfig{ .shifts = 16 } );
+        REQUIRE( encoder.encode( view, sprites, plnFile ) );
+        CHECK( encoder.getPlaneCount() == 3 );
+
+        const char* pHeader = "PLANAR:2,3,16,1:";
+        REQUIRE( memcmp( plnFile.data(), pHeader, strlen( pHeader ) ) == 0 );
+        const size_t   entrySize = 4 + 4 * 4;
+        const uint8_t* pTable    = plnFile.data() + strlen( pHeader );
+        const uint8_t* pPlanes   = pTable + 2 * 16 * entrySize;
+
+        // every copy holds the sprite shifted right by its index, the mask where colour is not 0
+        for ( uint32_t nCopy = 0; nCopy < 16; nCopy++ )
+        {
+            const uint8_t* pEntry = pTable + nCopy * entrySize;
+            uint16_t       size[ 2 ];
+            uint32_t       offsets[ 4 ];
+            memcpy( size, pEntry, sizeof( size ) );
+            memcpy( offsets, pEntry + 4, sizeof( offsets ) );
+            CHECK( size[ 0 ] == ( 20 + nCopy + 15 ) / 16 );
+            CHECK( size[ 1 ] == 10 );
+
+            for ( uint32_t y = 0; y < 10; y++ )
+            {
+                for ( uint32_t x = 0; x < 20; x++ )
+                {
+                    uint32_t column = x + nCopy;
+                    uint32_t byte   = y * size[ 0 ] * 2 + column / 8;
+                    uint8_t  bit    = 0x80 >> ( column % 8 );
+                    uint32_t colour = 0;
+                    for ( uint32_t nPlane = 0; nPlane < 3; nPlane++ )
+                    {
+                        colour |= ( pPlanes[ offsets[ nPlane ] + byte ] & bit ? 1 : 0 ) << nPlane;
+                    }
+                    CHECK( colour == view.at( x, y ) );
+                    CHECK( ( pPlanes[ offsets[ 3 ] + byte ] & bit ? 1 : 0 ) == ( view.at( x, y ) ? 1 : 0 ) );
+                }
+            }
+
+            // the second sprite is the same, so it shares every plane
+            CHECK( memcmp( pEntry, pEntry + 16 * entrySize, entrySize ) == 0 );
+        }
+        CHECK( encoder.getSharedBytes() * 2 >= encoder.getPlaneBytes() );
+
+        // more copies cost memory and save blitter words
+        std::vector<PlanarCost> costs;
+        REQUIRE( encoder.measure( view, sprites, costs ) );
+        REQUIRE( costs.size() == 5 );
+        for ( size_t nCost = 1; nCost < costs.size(); nCost++ )
+        {
+            CHECK( costs[ nCost ].shifts == costs[ nCost - 1 ].shifts * 2 );
+            CHECK( costs[ nCost ].fileBytes > costs[ nCost - 1 ].fileBytes );
+            CHECK( costs[ nCost ].blitWords <= costs[ nCost - 1 ].blitWords );
+        }
+        CHECK( costs[ 4 ].fileBytes == plnFile.size() );
+
+        // without sharing both sprites are written out
+        PlanarSpriteEncoder copies( PlanarConfig{ .shifts = 16, .bDedup = false } );
+        std::vector<uint8_t> unshared;
+        REQUIRE( copies.encode( view, sprites, unshared ) );
+        CHECK( copies.getSharedBytes() == 0 );
+        CHECK( unshared.size() == plnFile.size() + encoder.getSharedBytes() );
+
+        PlanarSpriteEncoder odd( PlanarConfig{ .shifts = 3 } );
+        CHECK( odd.encode( view, sprites, plnFile ) == false );
+    }
+    //-----------------------------------------------------------------------------
+    TEST_CASE( "Compiled 68k sprites" )
+    //-----------------------------------------------------------------------------
+    {
+        // runs and gaps of every length, a blank row and a long skip
+        const uint32_t       sheetW = 40, sheetH = 9;
+        std::vector<uint8_t> sheet( sheetW * sheetH, 0 );
+        for ( uint32_t y = 0; y < sheetH; y++ )
+        {
+            for ( uint32_t x = 0; x < sheetW; x++ )
+            {
+                bool bOpaque = y != 4 && ( ( x * 7 + y * 3 ) % 11 < 6 || ( y == 6 && x > 25 ) ) && !( y == 2 && x > 3 && x < 30 );
+                sheet[ y * sheetW + x ] = bOpaque ? (uint8_t)( 1 + ( x + y * 5 ) % 250 ) : 0;
+            }
+        }
+
+        ImageView<const uint8_t>    view( sheet.data(), sheetW, sheetH );
+        std::vector<SpriteRect>     sprites = { { 0, 0, 40, 9, 0 }, { 5, 1, 17, 6, 0 } };
+        std::vector<uint8_t>        codeFile;
+        std::vector<CompiledSprite> compiled;
+
+        SpriteCompiler compiler;
+        compiler.build( view, sprites, codeFile, compiled );
+        REQUIRE( compiled.size() == 4 );
+        REQUIRE( memcmp( codeFile.data(), "COMPILED:2,2:\0\0\0", 16 ) == 0 );
+
+        // run each blob on a 68k model of its instructions, drawing onto a screen
+        for ( const CompiledSprite& sprite : compiled )
+        {
+            const uint8_t* pTable = codeFile.data() + 16;
+            size_t         entry  = ( &sprite - compiled.data() ) * 4;
+            uint32_t       offset = (uint32_t)pTable[ entry ] << 24 | pTable[ entry + 1 ] << 16 | pTable[ entry + 2 ] << 8 | pTable[ entry + 3 ];
+            REQUIRE( offset == sprite.offset );
+
+            const uint32_t       stride = 64;
+            std::vector<uint8_t> screen( stride * 16, 0xEE );
+            uint32_t             a0       = 3 * stride + ( sprite.bOdd ? 9 : 8 );
+            uint32_t             start    = a0;
+            const uint8_t*       pc       = pTable + offset;
+            bool                 bAligned = true;
+
+            for ( bool bRunning = true; bRunning; )
+            {
+                uint16_t opcode = pc[ 0 ] << 8 | pc[ 1 ];
+                pc += 2;
+                if ( opcode == 0x20FC || opcode == 0x30FC || opcode == 0x10FC )
+                {
+                    uint32_t size = opcode == 0x20FC ? 4 : opcode == 0x30FC ? 2 : 1;
+                    bAligned &= size == 1 || ( a0 & 1 ) == 0;
+                    memcpy( &screen[ a0 ], pc + ( size == 1 ? 1 : 0 ), size );
+                    a0 += size;
+                    pc += size == 4 ? 4 : 2;
+                }
+                else if ( ( opcode & 0xF1FF ) == 0x5048 )
+                {
+                    a0 += ( ( opcode >> 9 ) & 7 ) ? ( ( opcode >> 9 ) & 7 ) : 8;
+                }
+                else if ( ( opcode & 0xF1FF ) == 0x5148 )
+                {
+                    a0 -= ( ( opcode >> 9 ) & 7 ) ? ( ( opcode >> 9 ) & 7 ) : 8;
+                }
+                else if ( opcode == 0x41E8 )
+                {
+                    a0 += (int16_t)( pc[ 0 ] << 8 | pc[ 1 ] );
+                    pc += 2;
+                }
+                else if ( opcode == 0xD1C0 )
+                {
+                    a0 += stride;
+                }
+                else
+                {
+                    REQUIRE( opcode == 0x4E75 );
+                    bRunning = false;
+                }
+            }
+            CHECK( pc == pTable + sprite.offset + sprite.codeBytes );
+            CHECK( bAligned );
+
+            bool bMatch = true;
+            for ( uint32_t y = 0; y < sprite.height; y++ )
+            {
+                for ( uint32_t x = 0; x < sprite.width; x++ )
+                {
+                    uint8_t pixel = view.at( sprite.x + x, sprite.y + y );
+                    bMatch &= screen[ start + y * stride + x ] == ( pixel ? pixel : 0xEE );
+                }
+            }
+            CHECK( bMatch );
+        }
+
+        // even code only when asked, and the listing names every blob
+        SpriteCompiler evenOnly( false );
+        evenOnly.build( view, sprites, codeFile, compiled );
+        CHECK( compiled.size() == 2 );
+        std::string listing = SpriteCompiler::Listing( compiled );
+        CHECK( listing.find( "sprite_1_even:" ) != std::string::npos );
+        CHECK( listing.find( "adda.l  d0,a0" ) != std::string::npos );
+        CHECK( listing.find( "rts" ) != std::string::npos );
+    }
+    //-----------------------------------------------------------------------------
+    TEST_CASE( "Draw cost model" )
+    //-----------------------------------------------------------------------------
+    {
+        // skip 2 and 3 literals, fill 5, end line, skip 200, end sprite
+        const uint8_t stream[] = { 2, 3, 1, 2, 3, 202, 5, 7, 201, 200, 255, 9 };
+        DrawCostModel model;
+        REQUIRE( model.rleCycles( stream, stream + sizeof( stream ) ) == ( 34 + 38 + 22 * 3 ) + ( 46 + 18 * 5 ) + 30 + 34 + 24 );
+
+        std::vector<M68kInstruction> code = { { M68kOp::MoveLong, 0 }, { M68kOp::MoveWord, 0 }, { M68kOp::AddQuick, 2 },
+                                              { M68kOp::Lea, 100 },    { M68kOp::AddRow, 0 },   { M68kOp::Return, 0 } };
+        REQUIRE( model.compiledCycles( code ) == 20 + 12 + 8 + 8 + 8 + 16 );
+
+        // ten solid 3 colour sprites, hardware sprites at one channel each, then one of 20 colours
+        const uint32_t       cellW = 16, cellH = 16, cellsX = 11;
+        const uint32_t       sheetW = cellW * cellsX;
+        std::vector<uint8_t> sheet( sheetW * cellH, 0 );
+        for ( uint32_t y = 0; y < cellH; y++ )
+        {
+            for ( uint32_t x = 0; x < sheetW; x++ )
+            {
+                sheet[ y * sheetW + x ] = x / cellW < 10 ? (uint8_t)( 1 + ( x + y ) % 3 ) : (uint8_t)( 1 + ( x + y * 3 ) % 20 );
+            }
+        }
+
+        ImageView<const uint8_t> sheetView( sheet.data(), sheetW, cellH );
+        std::vector<SpriteRect>  sprites;
+        SpriteSlicer::GridCells( sheetW, cellH, cellW, cellH, sprites );
+        REQUIRE( sprites.size() == cellsX );
+
+        // costing converts nothing, the run's counters are left alone
+        std::vector<SpriteDrawCost> costs;
+        uint64_t                    encodedBefore = Metrics::getInstance().getTotals().counters[ (size_t)MetricCounter::SpritesEncoded ];
+        model.costSprites( sheetView, sprites, costs );
+        REQUIRE( costs.size() == cellsX );
+        REQUIRE( Metrics::getInstance().getTotals().counters[ (size_t)MetricCounter::SpritesEncoded ] == encodedBefore );
+
+        // the 68000 keeps both compiled variants, so both are counted
+        std::vector<M68kInstruction> evenCode, oddCode;
+        uint64_t                     compiledBytes = 0;
+        SpriteCompiler().compile( sheetView.subView( 0, 0, cellW, cellH ), false, evenCode );
+        SpriteCompiler().compile( sheetView.subView( 0, 0, cellW, cellH ), true, oddCode );
+        for ( const M68kInstruction& instruction : evenCode )
+        {
+            compiledBytes += SpriteCompiler::InstructionBytes( instruction );
+        }
+        for ( const M68kInstruction& instruction : oddCode )
+        {
+            compiledBytes += SpriteCompiler::InstructionBytes( instruction );
+        }
+        REQUIRE( costs[ 0 ].bytes[ (size_t)DrawFormat::Compiled ] == compiledBytes );
+        REQUIRE( costs[ 0 ].cycles[ (size_t)DrawFormat::Compiled ] == ( model.compiledCycles( evenCode ) + model.compiledCycles( oddCode ) + 1 ) / 2 );
+        REQUIRE( costs[ 0 ].cycles[ (size_t)DrawFormat::Hardware ] == 40 + 32 );
+        REQUIRE( costs[ 10 ].cycles[ (size_t)DrawFormat::Hardware ] == DrawCostModel::DRAW_UNAVAILABLE );
+        REQUIRE( costs[ 10 ].chosen != DrawFormat::Hardware );
+
+        // the first eight get the DMA channels, the rest fall back to the CPU or blitter
+        uint32_t channels = 0;
+        uint64_t bytes = 0, cycles = 0;
+        for ( size_t nSprite = 0; nSprite < costs.size(); nSprite++ )
+        {
+            channels += costs[ nSprite ].chosen == DrawFormat::Hardware ? costs[ nSprite ].channels : 0;
+            bytes += costs[ nSprite ].bytes[ (size_t)costs[ nSprite ].chosen ];
+            cycles += costs[ nSprite ].cycles[ (size_t)costs[ nSprite ].chosen ];
+            REQUIRE( ( costs[ nSprite ].chosen == DrawFormat::Hardware ) == ( nSprite < 8 ) );
+        }
+        REQUIRE( channels <= HardwareSpriteEncoder::HWS_CHANNELS );
+        REQUIRE( model.chooseFormats( costs ) == cycles );
+
+        // a tighter budget trades cycles for bytes
+        uint64_t budgetCycles = model.chooseFormats( costs, bytes - 1 );
+        uint64_t budgetBytes  = 0;
+        for ( const SpriteDrawCost& cost : costs )
+        {
+            budgetBytes += cost.bytes[ (size_t)cost.chosen ];
+        }
+        REQUIRE( budgetBytes < bytes );
+        REQUIRE( budgetCycles > cycles );
+
+        // the same sheet is cheaper on the 68080
+        std::vector<SpriteDrawCost> fastCosts;
+        DrawCostModel               fast( CpuModel::M68080 );
+        fast.costSprites( sheetView, sprites, fastCosts );
+        REQUIRE( fast.chooseFormats( fastCosts ) < cycles );
+        REQUIRE( std::string( DrawCostModel::getCpuName( CpuModel::M68080 ) ) == "68080" );
+    }
+
+    //-----------------------------------------------------------------------------
+    TEST_CASE( "Apollo V4 truecolour" )
+    //-----------------------------------------------------------------------------
+    {
+        // index 0 is the key, index 1 packs to the key and is moved off it
+        std::vector<png_color> palette = { { 1, 2, 3 }, { 255, 0, 255 }, { 255, 255, 255 }, { 8, 4, 2 } };
+        const uint8_t          indexes[] = { 0, 1, 2, 3, 200 };
+        const uint8_t          expect565[] = { 0xF8, 0x1F, 0xF8, 0x1E, 0xFF, 0xFF, 0x08, 0x20, 0x00, 0x00 };
+        uint8_t                row[ sizeof( expect565 ) ];
+
+        TrueColourConverter rgb565;
+        rgb565.setPalette( palette );
+        rgb565.convertRow( indexes, sizeof( indexes ), row );
+        CHECK( memcmp( row, expect565, sizeof( expect565 ) ) == 0 );
+        CHECK( rgb565.getKeyPixel() == 0xF81F );
+        CHECK( rgb565.getBytesPerPixel() == 2 );
+
+        const uint8_t expectArgb[] = { 0x00, 0xFF, 0x00, 0xFF, 0x80, 0xFF, 0x00, 0xFE, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x08, 0x04, 0x02, 0xFF, 0x00, 0x00, 0x00 };
+        uint8_t       rowArgb[ sizeof( expectArgb ) ];
+
+        TrueColourConverter argb32( TrueColourConfig{ .format = TrueColourFormat::Argb32 } );
+        argb32.setPalette( palette, { 0xFF, 0x80 } );
+        argb32.convertRow( indexes, sizeof( indexes ), rowArgb );
+        CHECK( memcmp( rowArgb, expectArgb, sizeof( expectArgb ) ) == 0 );
+        CHECK( argb32.getKeyPixel() == 0xFF00FF );
+
+        // every kernel, small and full palettes, odd widths for the row ends, matches the table lookup
+        std::mt19937 random( 50 );
+        for ( uint32_t colours : { 4u, 16u, 256u } )
+        {
+            std::vector<png_color> bigPalette( colours );
+            for ( png_color& colour : bigPalette )
+            {
+                colour = { (png_byte)random(), (png_byte)random(), (png_byte)random() };
+            }
+
+            const uint32_t       width = 101, height = 37;
+            std::vector<uint8_t> image( width * height );
+            for ( uint8_t& index : image )
+            {
+                index = (uint8_t)( random() % colours );
+            }
+            image[ 40 ] = 255; // past the end of the small palettes, black
+
+            for ( TrueColourFormat format : { TrueColourFormat::Rgb565, TrueColourFormat::Argb32 } )
+            {
+                TrueColourConverter  direct( TrueColourConfig{ .format = format } );
+                TrueColourConverter  banded( TrueColourConfig{ .format = format, .bandHeight = 4, .threadCount = 3 } );
+                std::vector<uint8_t> pixels, bandedPixels;
+
+                direct.setPalette( bigPalette );
+                banded.setPalette( bigPalette );
+                direct.convert( ImageView<const uint8_t>( image.data(), width, height ), pixels );
+                banded.convert( ImageView<const uint8_t>( image.data(), width, height ), bandedPixels );
+                REQUIRE( pixels.size() == (size_t)width * height * direct.getBytesPerPixel() );
+                CHECK( pixels == bandedPixels );
+
+                std::vector<uint8_t> reference( pixels.size() );
+                direct.convertRowScalar( image.data(), width * height, reference.data() );
+                CHECK( pixels == reference );
+
+                // each row length through the kernel the CPU picked, lengths
+                // past 16 cover the vector blocks and their tails
+                std::vector<uint8_t> row( width * direct.getBytesPerPixel() ), rowScalar( row.size() );
+                for ( uint32_t count = 0; count <= width; count++ )
+                {
+                    direct.convertRow( image.data() + count, count, row.data() );
+                    direct.convertRowScalar( image.data() + count, count, rowScalar.data() );
+                    CHECK( row == rowScalar );
+                }
+            }
+
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+            // the kernels are picked from the CPU running the tests, not the build target
+            TrueColourConverter picked;
+            picked.setPalette( bigPalette );
+            CHECK( std::string( picked.getKernelName() ) == ( colours <= 16 && __builtin_cpu_supports( "ssse3" ) ? "SSSE3 shuffle" : __builtin_cpu_supports( "avx2" ) ? "AVX2 gather" : "Table lookup" ) );
+#endif
+        }
+
+        // asked for by name alongside the indexed outputs
+        DecodedImage decoded;
+        decoded.fileName = "truecolour";
+        decoded.width    = 5;
+        decoded.height   = 1;
+        decoded.palette  = palette;
+        decoded.pixels.assign( indexes, indexes + sizeof( indexes ) );
+
+        std::vector<ConvertedFile> outputs;
+        Tools::getInstance().Encode_Image( decoded, outputs, 0, 0, OutputRaw | OutputRgb565 | OutputArgb32 );
+        REQUIRE( outputs.size() == 3 );
+        CHECK( outputs[ 1 ].fileName == "truecolour-5-1.565" );
+        CHECK( outputs[ 1 ].fileData == std::vector<uint8_t>( expect565, expect565 + sizeof( expect565 ) ) );
+        CHECK( outputs[ 2 ].fileName == "truecolour-5-1.ARGB" );
+        CHECK( outputs[ 2 ].fileData.size() == sizeof( expectArgb ) );
+    }
+
     //-----------------------------------------------------------------------------
     // Test the Next Module
     //-----------------------------------------------------------------------------